@@ -0,0 +1,205 @@
+#!/usr/bin/env python3
+
+import optparse
+import struct
+import sys
+
+class RcpBinaryLogConverter(object):
+    MAGIC = b'RCPB'
+    # Version 2 adds the high rate lane and block records
+    VERSIONS = (1, 2)
+    RECORD_SAMPLE = b'S'
+    RECORD_LANE = b'L'
+    RECORD_BLOCK = b'H'
+
+    # Matches enum binary_log_type in include/logger/binary_log.h
+    TYPES = {
+        0: ('<i', 4),
+        1: ('<q', 8),
+        2: ('<f', 4),
+        3: ('<d', 8),
+    }
+    TYPE_FLOAT = 2
+    TYPE_DOUBLE = 3
+
+    def __init__(self, high_rate_output=None):
+        self.channels = []
+        self.lane = []
+        self.high_rate_output = high_rate_output
+
+    @staticmethod
+    def _ftoa(value, precision):
+        # Mimics modp_ftoa/modp_dtoa: fixed precision with trailing zeros
+        # trimmed, but always leaving one digit after the decimal point.
+        precision = max(0, min(precision, 9))
+        s = '{:.{}f}'.format(value, precision)
+        if precision > 0:
+            s = s.rstrip('0')
+            if s.endswith('.'):
+                s += '0'
+        return s
+
+    @staticmethod
+    def _read(fil, length):
+        data = fil.read(length)
+        if len(data) != length:
+            raise EOFError()
+        return data
+
+    def _read_cstr(self, fil):
+        chars = bytearray()
+        while True:
+            c = self._read(fil, 1)
+            if c == b'\0':
+                return chars.decode('ascii', 'replace')
+            chars += c
+
+    def _read_header(self, fil):
+        if self._read(fil, 3) != self.MAGIC[1:]:
+            raise ValueError("Bad header magic")
+
+        version, count = struct.unpack('<BH', self._read(fil, 3))
+        if version not in self.VERSIONS:
+            raise ValueError("Unsupported format version {}".format(version))
+
+        self.channels = []
+        self.lane = []
+        for _ in range(count):
+            vtype, precision, rate, vmin, vmax = \
+                struct.unpack('<BBHff', self._read(fil, 12))
+            label = self._read_cstr(fil)
+            units = self._read_cstr(fil)
+            self.channels.append((vtype, precision, rate, vmin, vmax,
+                                  label, units))
+
+    def _header_line(self):
+        cols = []
+        for vtype, precision, rate, vmin, vmax, label, units in self.channels:
+            cols.append('"{}"|"{}"|{}|{}|{}'.format(
+                label, units, self._ftoa(vmin, precision),
+                self._ftoa(vmax, precision), rate))
+        return ','.join(cols) + '\n'
+
+    def _read_lane(self, fil):
+        rate, count = struct.unpack('<IB', self._read(fil, 5))
+
+        self.lane = []
+        for _ in range(count):
+            bias, multiplier, offset = struct.unpack('<iff',
+                                                     self._read(fil, 12))
+            label = self._read_cstr(fil)
+            units = self._read_cstr(fil)
+            self.lane.append((bias, multiplier, offset, label, units))
+
+        if self.high_rate_output:
+            cols = ['"Seq"|""|0|0|{}'.format(rate)]
+            for bias, multiplier, offset, label, units in self.lane:
+                cols.append('"{}"|"{}"|0|0|{}'.format(label, units, rate))
+            self.high_rate_output.write(','.join(cols) + '\n')
+
+    def _read_block(self, fil):
+        # The block leads up to the sample record with this tick
+        tick, seq, scans = struct.unpack('<IIH', self._read(fil, 10))
+        width = len(self.lane)
+        raw = struct.unpack('<{}H'.format(scans * width),
+                            self._read(fil, 2 * scans * width))
+
+        if not self.high_rate_output:
+            return
+
+        for scan in range(scans):
+            cols = [str(seq + scan)]
+            for i, (bias, multiplier, offset, _, _) in enumerate(self.lane):
+                value = (raw[scan * width + i] - bias) * multiplier + offset
+                cols.append(self._ftoa(value, 6))
+            self.high_rate_output.write(','.join(cols) + '\n')
+
+    def _read_sample(self, fil):
+        self._read(fil, 4) # Logger tick; not part of the CSV layout
+        bitmap = self._read(fil, (len(self.channels) + 7) // 8)
+
+        cols = []
+        for i, chan in enumerate(self.channels):
+            if not bitmap[i // 8] & (1 << (i % 8)):
+                cols.append('')
+                continue
+
+            vtype, precision = chan[0], chan[1]
+            fmt, size = self.TYPES[vtype]
+            value = struct.unpack(fmt, self._read(fil, size))[0]
+            if vtype in (self.TYPE_FLOAT, self.TYPE_DOUBLE):
+                cols.append(self._ftoa(value, precision))
+            else:
+                cols.append(str(value))
+
+        return ','.join(cols) + '\n'
+
+    def convert(self, input_path, output):
+        rows = 0
+        with open(input_path, 'rb') as fil:
+            while True:
+                record = fil.read(1)
+                if not record:
+                    break
+
+                try:
+                    if record == self.MAGIC[0:1]:
+                        self._read_header(fil)
+                        output.write(self._header_line())
+                    elif record == self.RECORD_SAMPLE and self.channels:
+                        output.write(self._read_sample(fil))
+                        rows += 1
+                    elif record == self.RECORD_LANE and self.channels:
+                        self._read_lane(fil)
+                    elif record == self.RECORD_BLOCK and self.lane:
+                        self._read_block(fil)
+                    else:
+                        raise ValueError("Unknown record type")
+                except EOFError:
+                    sys.stderr.write("Warning: truncated final record\n")
+                    break
+                except ValueError as e:
+                    sys.stderr.write("Error at offset {}: {}\n".format(
+                        fil.tell(), e))
+                    break
+
+        return rows
+
+
+def main():
+    parser = optparse.OptionParser()
+    parser.add_option('-f', '--filename',
+                      dest="log_file",
+                      help="Path of binary (.rcb) log file to convert")
+
+    parser.add_option('-o', '--output',
+                      dest="out_file",
+                      help="Path to output CSV file. Defaults to stdout")
+
+    parser.add_option('-r', '--high-rate',
+                      dest="high_rate_file",
+                      help="Path to a CSV file for the high rate lane "
+                      "scans, one row per scan. Skipped if not given")
+
+    options, remainder = parser.parse_args()
+
+    if not options.log_file:
+        parser.error("No log file path given")
+
+    high_rate = None
+    if options.high_rate_file:
+        high_rate = open(options.high_rate_file, 'w')
+
+    converter = RcpBinaryLogConverter(high_rate)
+    if not options.out_file:
+        converter.convert(options.log_file, sys.stdout)
+    else:
+        with open(options.out_file, 'w') as out:
+            rows = converter.convert(options.log_file, out)
+        print("Converted {} rows".format(rows))
+
+    if high_rate:
+        high_rate.close()
+
+if __name__ == '__main__':
+    main()
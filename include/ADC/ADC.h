@@ -22,18 +22,43 @@
 #ifndef ADC_H_
 #define ADC_H_
 
+#include "channel_pipeline.h"
 #include "cpp_guard.h"
 
 #include "loggerConfig.h"
+#include <stdbool.h>
 
 CPP_GUARD_BEGIN
 
+/* Rate assumed for filter cutoffs until the logger sets the real one */
+#define ADC_DEFAULT_UPDATE_HZ	50
+
 int ADC_init(LoggerConfig *loggerConfig);
 
+/**
+ * Tells the ADC how often ADC_sample_all is called so that filter cutoffs
+ * given in Hz come out right.  Restarts the filters.
+ */
+void ADC_set_update_rate(LoggerConfig *loggerConfig, float update_hz);
+
 void ADC_sample_all(void);
 
 float ADC_read(const size_t channel);
 
+/**
+ * Reads the channel in the units of its scaling mode, using the scaling
+ * compiled by ADC_init.
+ */
+float ADC_read_scaled(const size_t channel);
+
+/**
+ * Resolves the channel to its filter output and compiled scaling.  The
+ * scaling of channels with a scaling map is CHANNEL_SCALING_MAPPED, and
+ * follows the channel in and out of that mode.
+ * @return true, every analog channel can be resolved.
+ */
+bool ADC_get_pipeline(const size_t channel, struct channel_pipeline *p);
+
 CPP_GUARD_END
 
 #endif /* ADC_H_ */
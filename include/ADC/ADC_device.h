@@ -25,6 +25,7 @@
 #include "cpp_guard.h"
 
 #include <stddef.h>
+#include <stdint.h>
 
 CPP_GUARD_BEGIN
 
@@ -32,10 +33,27 @@ int ADC_device_init(void);
 
 int ADC_device_sample(const size_t channel);
 
+/**
+ * Reads all channels at once.  Devices that scan in the background
+ * return the average of the scans completed since the last call, and
+ * hold the previous average if none completed.
+ * @param values Set to the raw value of each channel.
+ * @param count The number of channels to read.
+ * @return The number of channels read, which is less than count if the
+ * device has fewer channels.
+ */
+size_t ADC_device_sample_all(int32_t *values, const size_t count);
+
 float ADC_device_get_voltage_range(const size_t channel);
 
 float ADC_device_get_channel_scaling(const size_t channel);
 
+/**
+ * @return The rate in Hz at which the device scans all channels from a
+ * hardware timer, or 0 if it does not scan at a fixed rate.
+ */
+uint32_t ADC_device_get_scan_rate(void);
+
 CPP_GUARD_END
 
 #endif /* ADC_DEVICE_H_ */
@@ -25,6 +25,7 @@
 #include "cpp_guard.h"
 #include "loggerConfig.h"
 
+#include <stddef.h>
 #include <stdint.h>
 
 CPP_GUARD_BEGIN
@@ -49,6 +50,8 @@ typedef struct _CAN_msg {
         uint8_t dataLength;
         uint8_t can_bus;
         bool isExtendedAddress;
+        /* cpu_get_usec() when the frame was received */
+        uint32_t timestamp;
 } CAN_msg;
 
 int CAN_init(LoggerConfig *loggerConfig);
@@ -57,6 +60,8 @@ int CAN_set_filter(const uint8_t, const uint8_t id, const uint8_t extended, cons
                    const uint32_t mask, const bool enabled);
 int CAN_tx_msg(const uint8_t channel, const CAN_msg *msg, const unsigned int timeoutMs);
 int CAN_rx_msg(CAN_msg *msg, const unsigned int timeoutMs);
+size_t CAN_rx_msgs(CAN_msg *msgs, const size_t count,
+                   const unsigned int timeoutMs);
 
 CPP_GUARD_END
 
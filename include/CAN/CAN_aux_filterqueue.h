@@ -41,6 +41,15 @@ bool CAN_aux_filterqueue_init(void);
  */
 void CAN_aux_filterqueue_configure(uint8_t can_bus, uint32_t low_id_range, uint32_t high_id_range);
 
+/**
+ * Get the configured CAN aux filterqueue range
+ * @param can_bus the filtered can bus
+ * @param low_id_range the low ID range, inclusive
+ * @param high_id_range the high ID range, inclusive
+ * @return true if a range is configured
+ */
+bool CAN_aux_filterqueue_get_range(uint8_t *can_bus, uint32_t *low_id_range, uint32_t *high_id_range);
+
 /**
  * Puts a CAN message into the Auxiliary CAN message filterqueue
  * @param msg the CAN message to put
@@ -26,6 +26,7 @@
 #include "CAN.h"
 #include "loggerConfig.h"
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 CPP_GUARD_BEGIN
@@ -33,8 +34,11 @@ CPP_GUARD_BEGIN
 int CAN_device_init(const uint8_t channel, const uint32_t baud, const bool termination_enabled);
 int CAN_device_set_filter(const uint8_t channel, const uint8_t id, const uint8_t extended,
                           const uint32_t filter, const uint32_t mask, const bool enabled);
+int CAN_device_set_filter_list(const uint8_t channel, const uint8_t id, const uint8_t extended,
+                               const uint32_t *ids, const size_t count);
 int CAN_device_tx_msg(const uint8_t channel, const CAN_msg *msg, const unsigned int timeoutMs);
-int CAN_device_rx_msg(CAN_msg *msg, const unsigned int timeoutMs);
+size_t CAN_device_rx_msgs(CAN_msg *msgs, const size_t count,
+                         const unsigned int timeoutMs);
 
 CPP_GUARD_END
 
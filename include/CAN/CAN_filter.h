@@ -0,0 +1,124 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CAN_FILTER_H_
+#define CAN_FILTER_H_
+
+#include "CAN.h"
+#include "cpp_guard.h"
+#include "loggerConfig.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+CPP_GUARD_BEGIN
+
+/* Hardware filter banks available to each CAN bus */
+#define CAN_FILTER_BANKS	13
+
+/* IDs held by a list bank, depending on the ID width */
+#define CAN_FILTER_LIST_STD	4
+#define CAN_FILTER_LIST_EXT	2
+
+#define CAN_STD_ID_MASK		0x7FF
+#define CAN_EXT_ID_MASK		0x1FFFFFFF
+
+/*
+ * A set of CAN IDs some part of the firmware wants to receive: every ID
+ * for which (id & mask) == rule id.  A mask of 0 accepts everything.
+ */
+struct can_filter_rule {
+        uint32_t id;
+        uint32_t mask;
+        bool extended;
+};
+
+enum can_filter_mode {
+        CAN_FILTER_MODE_MASK,
+        CAN_FILTER_MODE_LIST,
+};
+
+struct can_filter_bank {
+        enum can_filter_mode mode;
+        bool extended;
+        /* Mask mode uses ids[0] and mask, list mode the first count ids */
+        uint32_t ids[CAN_FILTER_LIST_STD];
+        uint32_t mask;
+        uint8_t count;
+};
+
+struct can_filter_plan {
+        bool accept_all;
+        uint8_t bank_count;
+        struct can_filter_bank banks[CAN_FILTER_BANKS];
+};
+
+struct can_filter_status {
+        bool accept_all;
+        uint8_t bank_count;
+        /* Frames that made it through the filters */
+        uint32_t accepted;
+        /* Longest a frame waited between the RX ISR and CAN_rx_msgs */
+        uint32_t max_latency_us;
+};
+
+/**
+ * Packs the rules into as few hardware filter banks as possible.  Exact
+ * IDs share list banks and the remaining rules take a mask bank each.
+ * When that needs more banks than there are, the two rules that differ in
+ * the fewest ID bits are merged until it fits, which only lets through
+ * more frames for the software to discard.  A rule that accepts all turns
+ * the filters off.
+ * @param plan the plan to populate
+ * @param rules the rules for one bus.  Reordered and merged in place.
+ * @param count the number of rules
+ */
+void CAN_filter_plan(struct can_filter_plan *plan,
+                     struct can_filter_rule *rules, size_t count);
+
+/**
+ * Sets up the hardware filters of every CAN bus from the enabled CAN
+ * mappings, the OBD2 PIDs, ShiftX and the aux filter queue range.  This
+ * only happens with auto filtering enabled, as Lua scripts reading CAN
+ * only see the frames the filters let through.  Otherwise the banks are
+ * left to the driver defaults and CAN_set_filter, except for opening the
+ * bus back up right after auto filtering gets turned off.
+ * Call whenever any of those change.
+ */
+void CAN_filter_apply(LoggerConfig *lc);
+
+/**
+ * Counts a frame received on its bus and notes how long it was queued
+ * for, going by its receive timestamp.
+ */
+void CAN_filter_count_rx(const CAN_msg *msg);
+
+/**
+ * Reports the filters in effect on the bus, the frames they let through
+ * and their worst queueing latency.  There is no hardware count of the
+ * frames rejected.
+ */
+void CAN_filter_get_status(const uint8_t can_bus,
+                           struct can_filter_status *status);
+
+CPP_GUARD_END
+
+#endif /* CAN_FILTER_H_ */
@@ -0,0 +1,93 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CAN_RX_RING_H_
+#define _CAN_RX_RING_H_
+
+#include "CAN.h"
+#include "FreeRTOS.h"
+#include "cpp_guard.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+CPP_GUARD_BEGIN
+
+/*
+ * Received CAN frames pass from the RX interrupts to the CAN task through
+ * a single ring.  The ring is lock free: only the interrupts move the head
+ * and only the CAN task moves the tail.  All of the CAN RX interrupts run
+ * at the same priority, so they never preempt each other and act as one
+ * producer.  When the ring is full, new frames are dropped and counted.
+ *
+ * The size must be a power of two so that the free running cursors stay
+ * valid when they wrap.  It holds a burst of a few milliseconds of a fully
+ * loaded bus.
+ */
+#define CAN_RX_RING_SIZE	32
+
+#if CAN_RX_RING_SIZE & (CAN_RX_RING_SIZE - 1)
+#error "CAN_RX_RING_SIZE must be a power of two"
+#endif
+
+struct can_rx_stats {
+        /* Frames put into the ring */
+        uint32_t received;
+        /* Frames lost because the ring was full */
+        uint32_t dropped;
+        /* Most frames ever waiting in the ring */
+        uint16_t high_water;
+};
+
+/**
+ * Sets up the ring.  Safe to call more than once.
+ * @return true if successful, false otherwise.
+ */
+bool CAN_rx_ring_init(void);
+
+/**
+ * Puts a received frame into the ring.  Only call from a CAN RX interrupt.
+ * @param msg The frame to put.
+ * @param task_woken Set to pdTRUE if the CAN task needs to be switched to.
+ * @return true if the frame was put, false if it was dropped.
+ */
+bool CAN_rx_ring_put_from_isr(const CAN_msg *msg,
+                              signed portBASE_TYPE *task_woken);
+
+/**
+ * Takes every frame waiting in the ring, up to the count given.  Only the
+ * CAN task may take frames.
+ * @param msgs The frames to populate.
+ * @param count The most frames to take.
+ * @param timeout_ms How long to wait for a frame if none are waiting.
+ * @return The number of frames taken.
+ */
+size_t CAN_rx_ring_get(CAN_msg *msgs, const size_t count,
+                       const unsigned int timeout_ms);
+
+/**
+ * Reports the frames received and dropped and the high water mark.
+ */
+void CAN_rx_ring_get_stats(struct can_rx_stats *stats);
+
+CPP_GUARD_END
+
+#endif /* _CAN_RX_RING_H_ */
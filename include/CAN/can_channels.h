@@ -52,15 +52,36 @@ bool CAN_init_current_values(size_t values);
  */
 float CAN_get_current_channel_value(int index);
 
+/**
+ * retrieves when the current value for the specified channel was received
+ * @param index the index of the channel to retrieve
+ * @return the cpu_get_usec() timestamp of the CAN message that set the
+ * value, or 0 if it was never set
+ */
+uint32_t CAN_get_current_channel_timestamp(int index);
+
 /**
  * Sets the current channel value for the specified index
  * @param index the index of the channel to set
  * @param value the value to set
+ * @param timestamp the receive timestamp of the CAN message
+ */
+void CAN_set_current_channel_value(int index, float value, uint32_t timestamp);
+
+/**
+ * Index the enabled CAN mappings by bus and CAN ID, so a message is only
+ * tested against the mappings for its ID plus those using an ID mask or a
+ * wildcard ID, and compile each mapping into an extractor.  Must be
+ * rebuilt whenever the mappings change.
+ * @param cfg the CAN channel configuration, containing the mappings
+ * @param count the number of channel mappings
+ * @return true if the initialization was successful
  */
-void CAN_set_current_channel_value(int index, float value);
+bool CAN_init_mapping_index(const CANChannelConfig *cfg, uint16_t count);
 
 /**
- * Apply the CAN message to the current list of of CAN channel mappings.
+ * Apply the CAN message to the current list of of CAN channel mappings,
+ * as indexed by CAN_init_mapping_index.
  * @param msg the CAN message containing the raw data
  * @param cfg the CAN channel configuration, containing the mappings
  * @param enabled_mapping_count the number of channel mappings
@@ -27,6 +27,62 @@
 
 CPP_GUARD_BEGIN
 
+/*
+ * A CAN mapping compiled down to what extracting its value needs.  The
+ * field position, byte order and sign handling are resolved up front, and
+ * the formula and units conversion fold into one scale and offset, so each
+ * value costs the same few operations whatever the mapping.
+ */
+struct can_extractor {
+        uint32_t mask;
+        /* sign bit for sign-magnitude values */
+        uint32_t sign;
+        float scale;
+        float offset;
+        /* right shift of the field in the big endian frame bits */
+        uint8_t shift;
+        /* swap little endian bytes, then shift right by swap_shift */
+        bool swap;
+        uint8_t swap_shift;
+        /* shift that moves the sign bit of a signed value to bit 31 */
+        uint8_t sign_shift;
+        /* an enum CANMappingType */
+        uint8_t type;
+};
+
+/**
+ * compile the CAN mapping into an extractor.  Call whenever the mapping
+ * changes.
+ * @param ex the extractor to populate
+ * @param mapping the mapping to compile
+ */
+void canmapping_compile(struct can_extractor *ex, const CANMapping *mapping);
+
+/**
+ * get the data of a CAN message as the big endian frame bits taken by
+ * the extractor.  Only needs doing once per message.
+ * @param can_msg the CAN message containing the raw data
+ * @return the frame bits, with the first data byte in the top 8 bits
+ */
+uint64_t canmapping_frame_bits(const CAN_msg *can_msg);
+
+/**
+ * extract the raw value without the formula or units conversion
+ * @param ex the compiled mapping
+ * @param frame the frame bits from canmapping_frame_bits
+ * @return the extracted value
+ */
+float canmapping_extract_raw(const struct can_extractor *ex,
+                             const uint64_t frame);
+
+/**
+ * extract the value with the formula and units conversion applied
+ * @param ex the compiled mapping
+ * @param frame the frame bits from canmapping_frame_bits
+ * @return the mapped value
+ */
+float canmapping_extract(const struct can_extractor *ex, const uint64_t frame);
+
 /**
  * match the can message based on the specified CAN mapping ID and ID mask
  * @param can_msg the CAN message to test
@@ -32,6 +32,12 @@ int cpu_init(void);
 void cpu_reset(int bootloader);
 const char * cpu_get_serialnumber(void);
 
+/**
+ * Free running microsecond counter, safe to call from an ISR.  It wraps
+ * after about 71 minutes, so only use it for differences.
+ */
+uint32_t cpu_get_usec(void);
+
 CPP_GUARD_END
 
 #endif /* CPU_H_ */
@@ -33,6 +33,8 @@ const char * cpu_device_get_serialnumber(void);
 
 void cpu_device_spin(uint32_t ms);
 
+uint32_t cpu_device_get_usec(void);
+
 CPP_GUARD_END
 
 #endif /* CPU_DEVICE_H_ */
@@ -23,6 +23,7 @@
 #define _SHIFTX_DRV_H_
 
 #include "CAN.h"
+#include <stddef.h>
 
 CPP_GUARD_BEGIN
 
@@ -59,6 +60,16 @@ typedef enum {
  */
 void shiftx_handle_can_rx_msg(const CAN_msg *msg);
 
+/* The number of CAN IDs the ShiftX device sends to us */
+#define SHIFTX_RX_IDS 2
+
+/**
+ * List the CAN IDs the ShiftX device sends to us
+ * @param ids array of SHIFTX_RX_IDS entries to populate
+ * @return the number of IDs populated
+ */
+size_t shiftx_get_rx_ids(uint32_t *ids);
+
 /**
  * Retreive a pointer to the current runtime configuration
  * @return pointer to struct of the shiftx_configuration
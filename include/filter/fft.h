@@ -0,0 +1,81 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _FFT_H_
+#define _FFT_H_
+
+#include "cpp_guard.h"
+#include <stddef.h>
+#include <stdint.h>
+
+CPP_GUARD_BEGIN
+
+/*
+ * Fixed point FFT of a block of FFT_POINTS real samples.  The block has
+ * its mean removed, is shifted to use FFT_INPUT_BITS, and goes through a
+ * Hann window before the transform.  The radix 2 transform works on Q15
+ * values and halves them after every stage, so it can not overflow and
+ * its bins come out scaled by 1 / FFT_POINTS.
+ */
+#define FFT_LOG2_POINTS		8
+#define FFT_POINTS		(1 << FFT_LOG2_POINTS)
+#define FFT_BINS		(FFT_POINTS / 2)
+#define FFT_INPUT_BITS		14
+
+/* Mean square of the Hann window, which the window takes off the power */
+#define FFT_WINDOW_POWER	0.375f
+
+struct fft_block {
+        int16_t re[FFT_POINTS];
+        int16_t im[FFT_POINTS];
+        /* The samples were multiplied by 2^shift to fill FFT_INPUT_BITS */
+        int shift;
+};
+
+/**
+ * Builds the twiddle and window tables.  Safe to call more than once.
+ */
+void fft_init(void);
+
+/**
+ * Loads FFT_POINTS samples into the block and windows them.
+ */
+void fft_load(struct fft_block *b, const int32_t *samples);
+
+/**
+ * Transforms the loaded block in place.
+ */
+void fft_transform(struct fft_block *b);
+
+/**
+ * @return The power of the bin, in the Q15 units of the block.
+ */
+uint32_t fft_bin_power(const struct fft_block *b, size_t bin);
+
+/**
+ * @return The mean square of the samples in the bins first up to last,
+ * in sample units squared.  Bin 0 holds the mean, which was removed.
+ */
+float fft_band_power(const struct fft_block *b, size_t first, size_t last);
+
+CPP_GUARD_END
+
+#endif /* _FFT_H_ */
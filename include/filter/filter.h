@@ -23,22 +23,92 @@
 #define _FILTER_H_
 
 #include "cpp_guard.h"
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 CPP_GUARD_BEGIN
 
+/*
+ * Fixed point low pass filters.  The EMA keeps its output with
+ * FILTER_EMA_SHIFT fractional bits and takes its alpha in Q15.  The biquad
+ * takes Q29 coefficients, which leaves room for the feedback term that
+ * approaches -2 at low cutoffs, and feeds the rounding error of each
+ * output back into the next one so that small signals do not stall.
+ *
+ * Inputs must stay within +/- FILTER_INPUT_MAX so that the 64 bit
+ * accumulators can not overflow.  The first update primes the filter with
+ * its input, so the output does not start out biased towards zero.
+ */
+#define FILTER_EMA_SHIFT	15
+#define FILTER_BIQUAD_SHIFT	29
+#define FILTER_INPUT_MAX	(1 << 27)
+
+enum filter_type {
+        FILTER_TYPE_EMA,
+        FILTER_TYPE_BIQUAD,
+};
+
+struct ema_filter {
+        int32_t alpha;
+        int64_t state;
+};
+
+struct biquad_filter {
+        int32_t b0, b1, b2;
+        int32_t a1, a2;
+        int32_t x1, x2;
+        int32_t y1, y2;
+        int64_t error;
+};
+
 typedef struct _Filter {
-        float alpha;
-        int32_t total;
+        enum filter_type type;
+        bool primed;
         int32_t current_value;
-        int32_t count;
-        int32_t max_samples;
+        union {
+                struct ema_filter ema;
+                struct biquad_filter biquad;
+        };
 } Filter;
 
+/**
+ * Sets up a first order EMA filter with the given smoothing factor.  An
+ * alpha of 1 passes the input straight through.
+ */
 void init_filter(Filter *filter, float alpha);
 
+/**
+ * Sets up a first order EMA filter that responds like an RC low pass with
+ * the given cutoff when it is updated update_hz times a second.
+ */
+void init_ema_filter(Filter *filter, float cutoff_hz, float update_hz);
+
+/**
+ * Sets up a second order Butterworth low pass filter whose -3dB point is
+ * cutoff_hz when it is updated update_hz times a second.  Falls back to
+ * passing the input through if the cutoff is not below Nyquist.
+ */
+void init_biquad_filter(Filter *filter, float cutoff_hz, float update_hz);
+
+/**
+ * Forgets the filter history.  The next update primes the filter again.
+ */
+void reset_filter(Filter *filter);
+
 int32_t update_filter(Filter *filter, int32_t value);
 
+/**
+ * Updates count filters with one new value each, in one pass.
+ */
+void update_filters(Filter *filters, const int32_t *values, size_t count);
+
+/**
+ * @return The EMA alpha of an RC low pass with the given cutoff for a
+ * filter updated update_hz times a second.
+ */
+float filter_cutoff_to_alpha(float cutoff_hz, float update_hz);
+
 CPP_GUARD_END
 
 #endif /* _FILTER_H_ */
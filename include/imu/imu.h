@@ -22,8 +22,11 @@
 #ifndef IMU_H_
 #define IMU_H_
 
+#include "channel_pipeline.h"
 #include "cpp_guard.h"
 #include "loggerConfig.h"
+#include <stdbool.h>
+#include <stddef.h>
 
 CPP_GUARD_BEGIN
 
@@ -31,12 +34,36 @@ void imu_sample_all();
 
 float imu_read_value(enum imu_channel channel, ImuConfig *ac);
 
+/**
+ * Reads the logical channel using the scaling compiled from the working
+ * config by imu_init, imu_soft_init and imu_calibrate_zero.
+ */
+float imu_read_scaled(const size_t channel);
+
+/**
+ * Resolves the logical channel to its filter output and compiled scaling.
+ * @return true, every IMU channel can be read through a pipeline.
+ */
+bool imu_get_pipeline(const size_t channel, struct channel_pipeline *p);
+
 int imu_init(LoggerConfig *loggerConfig);
 
 int imu_soft_init(LoggerConfig *loggerConfig);
 
+/**
+ * Zeroes the channels at the average of the readings the device produces
+ * over about a second, so the unit must sit still meanwhile.
+ */
 void imu_calibrate_zero();
 
+/**
+ * Derives the mounting roll and pitch from gravity while the vehicle sits
+ * still and level, keeping the configured yaw, then zeroes the channels in
+ * the new frame.  The rotation replaces flipping axes with IMU_MODE_INVERTED,
+ * so leave the channels in IMU_MODE_NORMAL when using it.
+ */
+void imu_calibrate_mounting();
+
 int imu_read(enum imu_channel channel);
 
 CPP_GUARD_END
@@ -25,8 +25,22 @@
 #include "cpp_guard.h"
 #include "imu.h"
 
+#include <stddef.h>
+#include <stdint.h>
+
 CPP_GUARD_BEGIN
 
+/* Number of axes in a reading, one per enum imu_channel */
+#define IMU_DEVICE_AXES	6
+
+/**
+ * One reading of all axes, indexed by enum imu_channel and already
+ * mapped to the orientation of the unit.
+ */
+struct imu_sample {
+        int32_t axis[IMU_DEVICE_AXES];
+};
+
 void imu_device_init();
 
 enum imu_init_status {
@@ -39,6 +53,21 @@ enum imu_init_status imu_device_init_status();
 
 int imu_device_read(enum imu_channel channel);
 
+/**
+ * Copies out the readings the device produced since the last call, oldest
+ * first.  Meant to be called by the IMU sampler only, since each call
+ * consumes the readings.
+ * @param samples Buffer to copy the readings into.
+ * @param max The number of readings that fit in the buffer.
+ * @return the number of readings copied.
+ */
+size_t imu_device_read_samples(struct imu_sample *samples, size_t max);
+
+/**
+ * @return the rate in Hz at which the device produces readings.
+ */
+float imu_device_sample_rate();
+
 float imu_device_counts_per_unit(enum imu_channel channel);
 
 CPP_GUARD_END
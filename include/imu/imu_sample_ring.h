@@ -0,0 +1,82 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _IMU_SAMPLE_RING_H_
+#define _IMU_SAMPLE_RING_H_
+
+#include "cpp_guard.h"
+#include "imu_device.h"
+#include <stddef.h>
+#include <stdint.h>
+
+CPP_GUARD_BEGIN
+
+/*
+ * Readings of all IMU axes are pushed by the IMU device task into a ring
+ * and drained by the IMU sampler.  The device task is the only writer of
+ * head and the sampler the only writer of tail, so no locking is needed.
+ * A sampler that falls more than the ring size behind skips ahead to the
+ * oldest sample still in the ring.
+ *
+ * The size must be a power of two so that the free running cursors stay
+ * valid when they wrap.
+ */
+#define IMU_SAMPLE_RING_SIZE	32
+
+#if IMU_SAMPLE_RING_SIZE & (IMU_SAMPLE_RING_SIZE - 1)
+#error "IMU_SAMPLE_RING_SIZE must be a power of two"
+#endif
+
+struct imu_sample_ring {
+        volatile uint32_t head;
+        uint32_t tail;
+        struct imu_sample samples[IMU_SAMPLE_RING_SIZE];
+};
+
+/**
+ * Drops all samples in the ring that were not read yet.
+ */
+void imu_sample_ring_reset(struct imu_sample_ring *ring);
+
+/**
+ * Pushes a sample.  Only the producer of the ring may push.
+ */
+void imu_sample_ring_push(struct imu_sample_ring *ring,
+                          const struct imu_sample *sample);
+
+/**
+ * @return the newest sample pushed, or NULL if there was none.
+ */
+const struct imu_sample* imu_sample_ring_newest(
+        const struct imu_sample_ring *ring);
+
+/**
+ * Copies out the samples pushed since the last read, oldest first.
+ * @param samples Buffer to copy the samples into.
+ * @param max The number of samples that fit in the buffer.
+ * @return the number of samples copied.
+ */
+size_t imu_sample_ring_read(struct imu_sample_ring *ring,
+                            struct imu_sample *samples, const size_t max);
+
+CPP_GUARD_END
+
+#endif /* _IMU_SAMPLE_RING_H_ */
@@ -0,0 +1,136 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _BINARY_LOG_H_
+#define _BINARY_LOG_H_
+
+#include "cpp_guard.h"
+#include "sampleRecord.h"
+#include <stddef.h>
+#include <stdint.h>
+
+CPP_GUARD_BEGIN
+
+/*
+ * Binary log file layout.  A file is a sequence of records; the first
+ * byte of each record identifies its type.  All multi-byte values are
+ * written in the native byte order of the logger (little endian on all
+ * of our targets).
+ *
+ * Header record (describes every column of the rows that follow):
+ *   char[4]     BINARY_LOG_MAGIC
+ *   uint8_t     BINARY_LOG_VERSION
+ *   uint16_t    channel count
+ *   per channel:
+ *     uint8_t   value type (enum binary_log_type)
+ *     uint8_t   precision
+ *     uint16_t  sample rate in Hz
+ *     float     min
+ *     float     max
+ *     char[]    label, NUL terminated
+ *     char[]    units, NUL terminated
+ *
+ * Sample record (one per logged row):
+ *   uint8_t     BINARY_LOG_RECORD_SAMPLE
+ *   uint32_t    logger tick of the sample
+ *   uint8_t[]   populated bitmap, (count + 7) / 8 bytes, LSB first
+ *   values      one fixed width value per populated channel, in order
+ *
+ * High rate lane record (follows the header if the lane captures any
+ * channels; see high_rate_lane.h):
+ *   uint8_t     BINARY_LOG_RECORD_LANE
+ *   uint32_t    scan rate in Hz
+ *   uint8_t     channel count
+ *   per channel:
+ *     int32_t   bias
+ *     float     multiplier
+ *     float     offset
+ *     char[]    label, NUL terminated
+ *     char[]    units, NUL terminated
+ *
+ * High rate block record (written ahead of the sample record they lead up
+ * to, so blocks line up with the sample ticks):
+ *   uint8_t     BINARY_LOG_RECORD_BLOCK
+ *   uint32_t    logger tick of the sample that follows
+ *   uint32_t    sequence number of the first scan.  Gaps are dropped scans
+ *   uint16_t    scan count
+ *   uint16_t[]  raw counts, one per lane channel, scan after scan
+ *
+ * A raw count reads as (raw - bias) * multiplier + offset in channel units.
+ */
+#define BINARY_LOG_MAGIC		"RCPB"
+#define BINARY_LOG_MAGIC_LEN		4
+#define BINARY_LOG_VERSION		2
+#define BINARY_LOG_RECORD_SAMPLE	'S'
+#define BINARY_LOG_RECORD_LANE		'L'
+#define BINARY_LOG_RECORD_BLOCK		'H'
+
+enum binary_log_type {
+        BINARY_LOG_TYPE_INT32 = 0,
+        BINARY_LOG_TYPE_INT64,
+        BINARY_LOG_TYPE_FLOAT,
+        BINARY_LOG_TYPE_DOUBLE,
+};
+
+/**
+ * Sink for encoded bytes.  Must accept the entire buffer.
+ * @return 0 on success, non-zero on failure.
+ */
+typedef int binary_log_write_t(const void *data, size_t len);
+
+/**
+ * @return The binary_log_type used to store the given sample.
+ */
+enum binary_log_type binary_log_get_type(const ChannelSample *cs);
+
+/**
+ * @return The number of bytes used to store a value of the given type.
+ */
+size_t binary_log_type_size(const enum binary_log_type type);
+
+/**
+ * Writes the header record describing all channels in the sample, and
+ * the high rate lane record if the lane captures any channels.
+ * @return 0 on success, the first non-zero writer return otherwise.
+ */
+int binary_log_write_header(const struct sample *s,
+                            binary_log_write_t *write);
+
+/**
+ * Writes a sample record containing only the populated channels.
+ * @return 0 on success, the first non-zero writer return otherwise.
+ */
+int binary_log_write_sample(const struct sample *s,
+                            binary_log_write_t *write);
+
+/**
+ * Writes block records holding the high rate lane scans from the cursor
+ * up to the sample, and advances the cursor past them.
+ * @param skipped Incremented by the number of scans the lane lost before
+ * they could be written.
+ * @return 0 on success, the first non-zero writer return otherwise.
+ */
+int binary_log_write_high_rate(const struct sample *s, uint32_t *cursor,
+                               uint32_t *skipped, binary_log_write_t *write);
+
+CPP_GUARD_END
+
+#endif /* _BINARY_LOG_H_ */
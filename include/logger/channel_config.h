@@ -38,6 +38,15 @@ CPP_GUARD_BEGIN
  */
 #define ALWAYS_SAMPLED 1 << 0
 
+/*
+ * A channel with a deadband is only logged and sent when its value moved
+ * further than the deadband since it was last emitted.  It is emitted
+ * anyway once every DEADBAND_KEYFRAME_MS so that late readers catch up.
+ * A deadband of 0 emits on every due tick.
+ */
+#define DEADBAND_KEYFRAME_MS	5000
+#define DEADBAND_PRECISION	3
+
 typedef struct _ChannelConfig {
         char label[DEFAULT_LABEL_LENGTH];
         char units[DEFAULT_UNITS_LENGTH];
@@ -46,6 +55,7 @@ typedef struct _ChannelConfig {
         unsigned short sampleRate;
         unsigned char precision;
         unsigned char flags;
+        float deadband;
 } ChannelConfig;
 
 enum chan_cfg_status {
@@ -57,6 +67,7 @@ enum chan_cfg_status {
         CHAN_CFG_STATUS_LONG_UNITS,
         CHAN_CFG_STATUS_MAX_LT_MIN,
         CHAN_CFG_STATUS_INVALID_FLAG,
+        CHAN_CFG_STATUS_NEGATIVE_DEADBAND,
 };
 
 void channel_config_defaults(ChannelConfig *cc);
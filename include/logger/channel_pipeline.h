@@ -0,0 +1,75 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CHANNEL_PIPELINE_H_
+#define _CHANNEL_PIPELINE_H_
+
+#include "cpp_guard.h"
+#include <stddef.h>
+#include <stdint.h>
+
+CPP_GUARD_BEGIN
+
+/*
+ * Turns a filtered fixed point reading into channel units.  Modules
+ * compile one of these from their channel config whenever the config
+ * changes, folding calibration, scaling and unit conversion together, so
+ * that reading a channel never has to look at the config.
+ *
+ * Linear channels read as (raw - bias) * multiplier + offset.  Reciprocal
+ * channels, like frequencies measured as a period, read as
+ * multiplier / raw, or 0 while there is no reading.  Mapped channels
+ * scale linearly into a lookup that only their module can do, so a
+ * pipeline ending in one has to be read through the channel getter.
+ */
+enum channel_scaling_op {
+        CHANNEL_SCALING_LINEAR,
+        CHANNEL_SCALING_RECIPROCAL,
+        CHANNEL_SCALING_MAPPED,
+};
+
+struct channel_scaling {
+        enum channel_scaling_op op;
+        int32_t bias;
+        float multiplier;
+        float offset;
+};
+
+/*
+ * A channel resolved down to its filter output and the scaling its module
+ * compiled for it.  Both stay owned by the module, so recompiling the
+ * scaling is picked up without rebuilding the pipeline.
+ */
+struct channel_pipeline {
+        const int32_t *raw;
+        const struct channel_scaling *scaling;
+};
+
+/**
+ * @return The reading in channel units, or the lookup input of a mapped
+ * channel.
+ */
+float channel_scaling_apply(const struct channel_scaling *s,
+                            const int32_t raw);
+
+CPP_GUARD_END
+
+#endif /* _CHANNEL_PIPELINE_H_ */
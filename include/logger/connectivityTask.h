@@ -65,7 +65,7 @@ typedef struct _ConnParams {
         serial_id_t serial;
         size_t periodicMeta;
         uint32_t connection_timeout;
-        xQueueHandle sampleQueue;
+        enum sample_consumer consumer;
         int max_sample_rate;
         enum led activity_led;
 } ConnParams;
@@ -79,6 +79,7 @@ typedef struct _TelemetryConnParams {
         serial_id_t serial;
         uint32_t connection_timeout;
         xQueueHandle sampleQueue;
+        enum sample_consumer consumer;
         int max_sample_rate;
         enum led activity_led;
 } TelemetryConnParams;
@@ -87,7 +88,7 @@ typedef struct _BufferingTaskParams {
         bool always_streaming;
         char * connectionName;
         size_t periodicMeta;
-        xQueueHandle sampleQueue;
+        enum sample_consumer consumer;
         int max_sample_rate;
 } BufferingTaskParams;
 
@@ -112,8 +113,6 @@ typedef struct _CellularState {
         size_t sample_offset_map_index;
 } CellularState;
 
-void queueTelemetryRecord(const LoggerMessage *msg);
-
 void startConnectivityTask(int16_t priority);
 
 void bluetooth_connectivity_task(void *params);
@@ -27,6 +27,7 @@
 #include "ff.h"
 #include "loggerConfig.h"
 #include "sampleRecord.h"
+#include <stdint.h>
 
 CPP_GUARD_BEGIN
 
@@ -43,14 +44,28 @@ struct logging_status {
         bool logging;
         unsigned int rows_written;
         enum writing_status writing_status;
+        enum log_file_format file_format;
         portTickType flush_tick;
         portTickType last_sample_tick;
+        /* Next high rate lane scan to write to a binary log */
+        uint32_t high_rate_seq;
+        /* Rows staged for the last log never made it to the card */
+        bool write_error;
         char name[FILENAME_LEN];
 };
 
+/**
+ * Statistics on the SD card writes of the current log stream.
+ */
+struct file_writer_stats {
+        uint32_t writes;
+        uint32_t bytes;
+        uint32_t latency_ms;
+        uint32_t max_latency_ms;
+};
 
 void startFileWriterTask( int priority );
-portBASE_TYPE queue_logfile_record(const LoggerMessage *msg);
+const struct file_writer_stats* file_writer_get_stats(void);
 
 CPP_GUARD_END
 
@@ -0,0 +1,126 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _HIGH_RATE_LANE_H_
+#define _HIGH_RATE_LANE_H_
+
+#include "capabilities.h"
+#include "channel_config.h"
+#include "channel_pipeline.h"
+#include "cpp_guard.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+CPP_GUARD_BEGIN
+
+/*
+ * The high rate lane captures a few analog channels at the ADC scan rate,
+ * well above the rates the tick driven logger can sample at.  The ADC DMA
+ * interrupt pushes every scan into a ring of its own, and the log writer
+ * drains that ring in blocks that it writes ahead of the sample record
+ * they lead up to, so the blocks line up with the regular sample ticks.
+ * Regular sampling is not affected.
+ *
+ * Scans are stored as raw counts.  Each lane channel carries the linear
+ * scaling that turns its counts into channel units.
+ *
+ * HIGH_RATE_LANE_SCANS comes from the platform capabilities.  0 disables
+ * the lane.  Otherwise it must be a power of two so that the free running
+ * scan sequence numbers stay valid when they wrap.  The ring is only
+ * allocated once a channel is configured for the lane.
+ *
+ * The ring has to last from one logged sample to the next.  Scans it can
+ * not hold, say while the SD card stalls the writer, are skipped and show
+ * up as gaps in the block sequence numbers.
+ */
+#ifndef HIGH_RATE_LANE_SCANS
+#define HIGH_RATE_LANE_SCANS	0
+#endif
+
+#if HIGH_RATE_LANE_SCANS & (HIGH_RATE_LANE_SCANS - 1)
+#error "HIGH_RATE_LANE_SCANS must be a power of two"
+#endif
+
+#define HIGH_RATE_LANE_CHANNELS_MAX	4
+#define HIGH_RATE_LANE_BLOCK_SCANS	32
+
+struct high_rate_lane_channel {
+        const ChannelConfig *cfg;
+        const struct channel_scaling *scaling;
+        /* Position of the channel in the scans that get pushed */
+        uint8_t source;
+};
+
+struct high_rate_block {
+        /* Sequence number of the first scan.  Gaps mean dropped scans */
+        uint32_t seq;
+        uint16_t scans;
+        uint16_t values[HIGH_RATE_LANE_BLOCK_SCANS][HIGH_RATE_LANE_CHANNELS_MAX];
+};
+
+/**
+ * Selects the channels captured by the lane.  Channels past
+ * HIGH_RATE_LANE_CHANNELS_MAX are dropped, and so are channels sampled
+ * too slowly for the ring to last between two of their samples.  A rate
+ * of 0 means the scans can not be pushed at a fixed rate, which disables
+ * the lane.
+ * @return The number of channels the lane captures.
+ */
+size_t high_rate_lane_configure(const struct high_rate_lane_channel *channels,
+                                size_t count, uint32_t rate_hz);
+
+/**
+ * @param channels Set to the channels captured by the lane.
+ * @return The number of channels captured, 0 if the lane is disabled.
+ */
+size_t high_rate_lane_get_channels(const struct high_rate_lane_channel **channels);
+
+/**
+ * @return The rate in Hz at which scans are pushed.
+ */
+uint32_t high_rate_lane_get_rate(void);
+
+/**
+ * @return The sequence number the next scan will get.
+ */
+uint32_t high_rate_lane_get_seq(void);
+
+/**
+ * Stores the lane channels of each scan.  Only the ADC interrupt may
+ * push.
+ * @param scans count scans of width values each, back to back.
+ */
+void high_rate_lane_push_scans(const volatile uint16_t *scans,
+                               size_t count, size_t width);
+
+/**
+ * Copies the next block of scans between the cursor and end out of the
+ * ring, and advances the cursor past it.  A cursor that fell too far
+ * behind skips ahead, leaving a block of room for the interrupt.
+ * @return true if the block holds any scans.
+ */
+bool high_rate_lane_read_block(uint32_t *cursor, uint32_t end,
+                               struct high_rate_block *block);
+
+CPP_GUARD_END
+
+#endif /* _HIGH_RATE_LANE_H_ */
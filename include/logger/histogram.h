@@ -0,0 +1,139 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _HISTOGRAM_H_
+#define _HISTOGRAM_H_
+
+#include "channel_config.h"
+#include "cpp_guard.h"
+#include "loggerConfig.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+CPP_GUARD_BEGIN
+
+/*
+ * Channels with a histogram are read by the background sampler at
+ * HISTOGRAM_SAMPLE_RATE and every reading, or its rate of change, is
+ * counted in one of the configured bins between min and max.  Readings
+ * outside of that range go to the first or last bin.  The bins are logged
+ * at the channel's own sample rate on generated "<label>H<bin>" channels
+ * that carry the share of readings in the bin, in percent.  So the
+ * distribution of a fast signal can be logged without logging the signal
+ * itself at a fast rate.
+ *
+ * LAP histograms start over whenever the lap count changes, after the
+ * completed lap's distribution was logged once more.  ROLLING
+ * histograms halve all their counts once HISTOGRAM_ROLLING_READINGS have
+ * been counted, so older readings fade out.
+ *
+ * Only the first HISTOGRAM_CHANNELS_MAX histograms, analog channels
+ * first, are kept and a warning is logged for the rest.
+ */
+#define HISTOGRAM_SAMPLE_RATE		SAMPLE_500Hz
+#define HISTOGRAM_CHANNELS_MAX		4
+#define HISTOGRAM_ROLLING_READINGS	16384
+
+/* Label prefix of the generated bin channels */
+#define HISTOGRAM_BIN_PREFIX		"H"
+
+struct histogram {
+        uint32_t counts[HISTOGRAM_BINS_MAX];
+        uint32_t total;
+        int lap;
+        bool primed;
+        size_t last_tick;
+        float last_value;
+};
+
+/**
+ * @return true if the config describes a histogram that can be counted.
+ */
+bool is_histogram_config_valid(const struct histogram_config *cfg);
+
+/**
+ * Forgets all readings of the histogram.
+ */
+void histogram_reset(struct histogram *h);
+
+/**
+ * Counts a reading in its bin.  HISTOGRAM_SOURCE_RATE histograms count
+ * the rate of change per second since the previous reading instead, so
+ * their first reading only primes them.
+ */
+void histogram_add(struct histogram *h, const struct histogram_config *cfg,
+                   const size_t tick, const float value);
+
+/**
+ * @return The share of readings in the bin in percent, 0 if the
+ * histogram holds no readings.
+ */
+float histogram_bin_percent(const struct histogram *h, const size_t bin);
+
+/**
+ * @return true if any enabled analog or IMU channel has a histogram.
+ */
+bool is_histogram_enabled(LoggerConfig *lc);
+
+/**
+ * @return The number of bin channels the histograms set up by
+ * init_histograms() add.
+ */
+size_t get_histogram_channel_count(void);
+
+/**
+ * Sets up the histograms of the config, forgetting all readings.  Only
+ * the logger task calls this, on a config change.
+ * @return The number of histograms.
+ */
+size_t init_histograms(LoggerConfig *lc);
+
+/**
+ * @return The number of histograms set up by init_histograms().
+ */
+size_t get_histogram_count(void);
+
+/**
+ * @return The number of bins of the histogram.
+ */
+size_t get_histogram_bins(const size_t histogram);
+
+/**
+ * @return The channel config of a bin channel of the histogram.
+ */
+ChannelConfig* get_histogram_bin_config(const size_t histogram,
+                                        const size_t bin);
+
+/**
+ * Feeds the latest background readings into the histograms.
+ */
+void histogram_channel_samples(const size_t tick);
+
+/**
+ * @param id histogram * HISTOGRAM_BINS_MAX + bin
+ * @return The share of readings in the bin in percent.
+ */
+float get_histogram_bin(int id);
+
+CPP_GUARD_END
+
+#endif /* _HISTOGRAM_H_ */
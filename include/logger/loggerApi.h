@@ -104,10 +104,12 @@ CPP_GUARD_BEGIN
 #endif
 
 #if IMU_CHANNELS > 0
-#define IMU_API_METHODS                             \
-        API_METHOD("calImu", api_calibrateImu)      \
-        API_METHOD("getImuCfg", api_getImuConfig)   \
-        API_METHOD("setImuCfg", api_setImuConfig)
+#define IMU_API_METHODS                               \
+        API_METHOD("calImu", api_calibrateImu)        \
+        API_METHOD("getImuCfg", api_getImuConfig)     \
+        API_METHOD("setImuCfg", api_setImuConfig)     \
+        API_METHOD("getImuMount", api_getImuMounting) \
+        API_METHOD("setImuMount", api_setImuMounting)
 #else
 #define IMU_API_METHODS
 #endif
@@ -220,6 +222,8 @@ int api_getAnalogConfig(struct Serial *serial, const jsmntok_t *json);
 int api_setAnalogConfig(struct Serial *serial, const jsmntok_t *json);
 int api_getImuConfig(struct Serial *serial, const jsmntok_t *json);
 int api_setImuConfig(struct Serial *serial, const jsmntok_t *json);
+int api_getImuMounting(struct Serial *serial, const jsmntok_t *json);
+int api_setImuMounting(struct Serial *serial, const jsmntok_t *json);
 int api_calibrateImu(struct Serial *serial, const jsmntok_t *json);
 int api_getPwmConfig(struct Serial *serial, const jsmntok_t *json);
 int api_setPwmConfig(struct Serial *serial, const jsmntok_t *json);
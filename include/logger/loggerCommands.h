@@ -32,8 +32,15 @@ CPP_GUARD_BEGIN
 #define TEST_SD_COMMAND SYSTEM_COMMAND("testSD", "Test Write to SD card.",\
                 "<lineWrites> <periodicFlush> <quietMode>",               \
                 TestSD)
+#define LOG_FILE_COMMANDS SYSTEM_COMMAND("setLogFormat", "Sets the "   \
+                "SD card log file format (0 = CSV, 1 = Binary)",          \
+                "<0|1>", SetLogFormat)                                    \
+        SYSTEM_COMMAND("setLogCommit", "Sets the SD card log commit "   \
+                "size in bytes and max commit interval in ms",            \
+                "<bytes> <ms>", SetLogCommit)
 #else
 #define TEST_SD_COMMAND
+#define LOG_FILE_COMMANDS
 #endif
 
 
@@ -51,6 +58,10 @@ CPP_GUARD_BEGIN
         SYSTEM_COMMAND("setSerialLog", "Enables/disables logging of  "  \
                        "serial device for debug purposes",              \
                        "<port> <0|1>", SetSerialLog)                    \
+        LOG_FILE_COMMANDS                                              \
+        SYSTEM_COMMAND("showSampleStats", "Shows sample buffer usage "  \
+                       "and samples dropped per consumer", "",          \
+                       ShowSampleStats)                                 \
         SYSTEM_COMMAND("flashConfig", "Flashes the NVRAM with the "     \
                        "current configuration of the LoggerConfig",     \
                        "", FlashConfig)                                 \
@@ -63,6 +74,9 @@ void StartTerminal(struct Serial *serial, unsigned int argc, char **argv);
 void ViewLog(struct Serial *serial, unsigned int argc, char **argv);
 void SetLogLevel(struct Serial *serial, unsigned int argc, char **argv);
 void SetSerialLog(struct Serial *serial, unsigned int argc, char **argv);
+void SetLogFormat(struct Serial *serial, unsigned int argc, char **argv);
+void SetLogCommit(struct Serial *serial, unsigned int argc, char **argv);
+void ShowSampleStats(struct Serial *serial, unsigned int argc, char **argv);
 void FlashConfig(struct Serial *serial, unsigned int argc, char **argv);
 
 CPP_GUARD_END
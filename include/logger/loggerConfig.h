@@ -116,6 +116,66 @@ struct TimeConfig {
 #define DEFAULT_ANALOG_SCALING_PRECISION    2
 #define DEFAULT_VOLTAGE_SCALING_PRECISION   2
 
+/*
+ * How a channel reduces the readings taken between two of its log ticks.
+ * MIN_MAX logs the max on the channel itself and the min on a companion
+ * channel.  See sample_aggregate.h
+ */
+#define AGGREGATION_LAST                    0
+#define AGGREGATION_MEAN                    1
+#define AGGREGATION_MIN                     2
+#define AGGREGATION_MAX                     3
+#define AGGREGATION_MIN_MAX                 4
+#define DEFAULT_AGGREGATION                 AGGREGATION_LAST
+
+/*
+ * Analog and IMU channels can also feed a histogram of their readings, or
+ * of their rate of change, whose bins are logged as channels of their
+ * own.  LAP starts over with every lap, ROLLING fades out old readings.
+ * See histogram.h
+ */
+#define HISTOGRAM_MODE_DISABLED             0
+#define HISTOGRAM_MODE_LAP                  1
+#define HISTOGRAM_MODE_ROLLING              2
+#define HISTOGRAM_SOURCE_VALUE              0
+#define HISTOGRAM_SOURCE_RATE               1
+#define HISTOGRAM_BINS_MIN                  2
+#define HISTOGRAM_BINS_MAX                  8
+#define DEFAULT_HISTOGRAM_BINS              HISTOGRAM_BINS_MAX
+
+struct histogram_config {
+        unsigned char mode;
+        unsigned char source;
+        unsigned char bins;
+        float min;
+        float max;
+};
+
+#define DEFAULT_HISTOGRAM_CONFIG {HISTOGRAM_MODE_DISABLED, \
+                        HISTOGRAM_SOURCE_VALUE, DEFAULT_HISTOGRAM_BINS, 0, 0}
+
+/*
+ * Analog channels in the high rate lane and IMU channels can also be
+ * run through an FFT, which is logged on channels of their own as the
+ * RMS amplitude of each band between min_hz and max_hz, or as the peak
+ * frequency in that range.  See spectral.h
+ */
+#define SPECTRAL_MODE_DISABLED              0
+#define SPECTRAL_MODE_BANDS                 1
+#define SPECTRAL_MODE_PEAK                  2
+#define SPECTRAL_BANDS_MAX                  8
+#define DEFAULT_SPECTRAL_BANDS              4
+
+struct spectral_config {
+        unsigned char mode;
+        unsigned char bands;
+        float min_hz;
+        float max_hz;
+};
+
+#define DEFAULT_SPECTRAL_CONFIG {SPECTRAL_MODE_DISABLED, \
+                        DEFAULT_SPECTRAL_BANDS, 0, 0}
+
 typedef struct _ScalingMap {
         float rawValues[ANALOG_SCALING_BINS];
         float scaledValues[ANALOG_SCALING_BINS];
@@ -129,11 +189,31 @@ typedef struct _ADCConfig {
         float calibration;
         unsigned char scalingMode;
         ScalingMap scalingMap;
+        unsigned char aggregation;
+        unsigned char filterType;
+        float filterCutoff;
+        unsigned char highRate;
+        struct histogram_config histogram;
+        struct spectral_config spectral;
 } ADCConfig;
 
 #define DEFAULT_LINEAR_SCALING (1)
 #define DEFAULT_LINEAR_OFFSET (0)
 #define DEFAULT_FILTER_ALPHA (1.0f)
+/*
+ * Analog channels with a filterCutoff in Hz are filtered with filterType
+ * at that cutoff.  A cutoff of 0 uses an EMA with filterAlpha instead.
+ */
+#define ANALOG_FILTER_TYPE_EMA 0
+#define ANALOG_FILTER_TYPE_BIQUAD 1
+#define DEFAULT_ANALOG_FILTER_TYPE ANALOG_FILTER_TYPE_EMA
+#define DEFAULT_FILTER_CUTOFF (0.0f)
+#define FILTER_CUTOFF_PRECISION 2
+/*
+ * Analog channels with highRate set are also captured at the ADC scan
+ * rate by the high rate lane, as far as the lane has room.
+ */
+#define DEFAULT_ANALOG_HIGH_RATE 0
 #define DEFAULT_CALIBRATION (1.0f)
 #define DEFAULT_SCALING_MAP {{0,1.25,2.5,3.75,5.0},{0,1.25,2.5,3.75,5.0}}
 
@@ -149,7 +229,13 @@ typedef struct _ADCConfig {
          DEFAULT_FILTER_ALPHA,                  \
          DEFAULT_CALIBRATION,					\
          DEFAULT_SCALING_MODE,                  \
-         DEFAULT_SCALING_MAP                    \
+         DEFAULT_SCALING_MAP,                   \
+         DEFAULT_AGGREGATION,                   \
+         DEFAULT_ANALOG_FILTER_TYPE,            \
+         DEFAULT_FILTER_CUTOFF,                 \
+         DEFAULT_ANALOG_HIGH_RATE,              \
+         DEFAULT_HISTOGRAM_CONFIG,              \
+         DEFAULT_SPECTRAL_CONFIG                \
          }
 
 #define DEFAULT_ADC_CONFIG                      \
@@ -160,7 +246,13 @@ typedef struct _ADCConfig {
          DEFAULT_FILTER_ALPHA,                  \
          DEFAULT_CALIBRATION,					\
          DEFAULT_SCALING_MODE,                  \
-         DEFAULT_SCALING_MAP                    \
+         DEFAULT_SCALING_MAP,                   \
+         DEFAULT_AGGREGATION,                   \
+         DEFAULT_ANALOG_FILTER_TYPE,            \
+         DEFAULT_FILTER_CUTOFF,                 \
+         DEFAULT_ANALOG_HIGH_RATE,              \
+         DEFAULT_HISTOGRAM_CONFIG,              \
+         DEFAULT_SPECTRAL_CONFIG                \
          }
 
 typedef struct _GPIOConfig {
@@ -201,8 +293,25 @@ typedef struct _ImuConfig {
         enum imu_channel physicalChannel;
         signed short zeroValue;
         float filterAlpha;
+        unsigned char aggregation;
+        struct histogram_config histogram;
+        struct spectral_config spectral;
 } ImuConfig;
 
+/*
+ * How the unit is mounted in the vehicle, in degrees.  Readings are turned
+ * back into the vehicle frame before they are filtered.  The unit is taken
+ * to be yawed, then pitched, then rolled away from the vehicle axes.
+ */
+struct imu_mounting {
+        float roll;
+        float pitch;
+        float yaw;
+};
+
+#define DEFAULT_IMU_MOUNTING {0, 0, 0}
+#define IMU_MOUNTING_PRECISION 1
+
 /*
  * On InvenSense IMU 9150/9250 raw values are returned in 2's
  * compliment.  Hence they are already formed the way we want,
@@ -219,7 +328,10 @@ typedef struct _ImuConfig {
                         mode,                   \
                         chan,                   \
                         DEFAULT_ACCEL_ZERO,     \
-                        0.1F                    \
+                        0.1F,                   \
+                        DEFAULT_AGGREGATION,    \
+                        DEFAULT_HISTOGRAM_CONFIG, \
+                        DEFAULT_SPECTRAL_CONFIG \
                         }
 
 #define IMU_GYRO_CONFIG(name, mode, chan) {     \
@@ -227,7 +339,10 @@ typedef struct _ImuConfig {
                         mode,                   \
                         chan,                   \
                         DEFAULT_GYRO_ZERO,      \
-                        0.1F                    \
+                        0.1F,                   \
+                        DEFAULT_AGGREGATION,    \
+                        DEFAULT_HISTOGRAM_CONFIG, \
+                        DEFAULT_SPECTRAL_CONFIG \
                         }
 
 #define IMU_CONFIG_DEFAULTS {                                                 \
@@ -292,6 +407,8 @@ typedef struct _CANConfig {
 #if CAN_SW_TERMINATION == true
         bool termination[CONFIG_CAN_CHANNELS];
 #endif
+        /* derive the hardware receive filters from what is mapped */
+        bool auto_filter;
 } CANConfig;
 
 /* define max offsets and length for CAN mappings */
@@ -525,11 +642,35 @@ typedef struct _ConnectivityConfig {
         struct wifi_cfg wifi;
 } ConnectivityConfig;
 
+/**
+ * Formats that the file writer can produce on the SD card.
+ */
+enum log_file_format {
+        LOG_FILE_FORMAT_CSV = 0,
+        LOG_FILE_FORMAT_BINARY = 1,
+};
+
+/*
+ * SD card log file commit policy.  Rows are staged in RAM and committed
+ * to the card in whole sectors once the commit size is reached, or
+ * whatever is pending once the commit interval expires.
+ */
+#define LOG_FILE_SECTOR_SIZE			512
+#define LOG_FILE_COMMIT_SIZE_MIN		LOG_FILE_SECTOR_SIZE
+#define LOG_FILE_COMMIT_SIZE_MAX		(4 * LOG_FILE_SECTOR_SIZE)
+#define DEFAULT_LOG_FILE_COMMIT_SIZE		LOG_FILE_COMMIT_SIZE_MAX
+#define LOG_FILE_COMMIT_INTERVAL_MS_MIN		10
+#define LOG_FILE_COMMIT_INTERVAL_MS_MAX		5000
+#define DEFAULT_LOG_FILE_COMMIT_INTERVAL_MS	500
+
 /**
  * Configurations specific to our logging infrastructure.
  */
 struct logging_config {
         enum serial_log_type serial[__SERIAL_COUNT];
+        enum log_file_format file_format;
+        uint16_t file_commit_size;
+        uint16_t file_commit_interval_ms;
 };
 
 typedef struct _LoggerConfig {
@@ -567,6 +708,7 @@ typedef struct _LoggerConfig {
 #if IMU_CHANNELS > 0
         //IMU Configurations
         ImuConfig ImuConfigs[CONFIG_IMU_CHANNELS];
+        struct imu_mounting imu_mounting;
         ChannelConfig imu_gsum;
 #ifdef GSUMMAX
         ChannelConfig imu_gsummax;
@@ -619,6 +761,9 @@ int encodeSampleRate(int sampleRate);
 int decodeSampleRate(int sampleRateCode);
 
 uint8_t filter_background_streaming_mode(uint8_t mode);
+enum log_file_format filter_log_file_format(int format);
+uint16_t filter_log_file_commit_size(int size);
+uint16_t filter_log_file_commit_interval(int interval_ms);
 
 PWMConfig * getPwmConfigChannel(int channel);
 char filterPwmOutputMode(int config);
@@ -634,6 +779,13 @@ char filterTimerMode(int config);
 ADCConfig * getADCConfigChannel(int channel);
 #endif
 unsigned char filterAnalogScalingMode(unsigned char mode);
+unsigned char filterAggregation(unsigned char mode);
+unsigned char filterHistogramMode(unsigned char mode);
+unsigned char filterHistogramSource(unsigned char source);
+unsigned char filterHistogramBins(int bins);
+unsigned char filterSpectralMode(unsigned char mode);
+unsigned char filterSpectralBands(int bands);
+unsigned char filterAnalogFilterType(unsigned char type);
 
 GPIOConfig * getGPIOConfigChannel(int channel);
 char filterGpioMode(int config);
@@ -37,11 +37,38 @@ CPP_GUARD_BEGIN
  */
 int populate_sample_buffer(struct sample *s, size_t logTick);
 
+/**
+ * Fills in the shared channel descriptor table from the config and builds
+ * its sampling schedule.
+ */
 void init_channel_sample_buffer(LoggerConfig *loggerConfig,
-                                struct sample *s);
+                                struct sample_channels *sc);
+
+/* DEADBAND_KEYFRAME_MS in logger ticks */
+#define DEADBAND_KEYFRAME_TICKS	(DEADBAND_KEYFRAME_MS * TICK_RATE_HZ / 1000)
+
+/**
+ * Makes every channel emit on its next due tick regardless of its
+ * deadband.
+ */
+void force_channel_keyframe(struct sample_channels *sc);
+
+/**
+ * @return The first tick after the given tick at which any channel in the
+ * sample is due, or 0 if the sample has no channels.
+ */
+size_t get_next_sample_tick(const struct sample *s, const size_t tick);
 
 float get_mapped_value(float value, ScalingMap *scalingMap);
 
+#if ANALOG_CHANNELS > 0
+float get_analog_sample(int channelId);
+#endif
+
+#if IMU_CHANNELS > 0
+float get_imu_sample(int channelId);
+#endif
+
 typedef void logger_sample_cb_t(const struct sample* sample,
                                 const int ticks,
                                 void* data);
@@ -26,12 +26,18 @@
 #include "loggerNotifications.h"
 #include "sampleRecord.h"
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 CPP_GUARD_BEGIN
 
 struct sample * get_current_sample(void);
 
+/**
+ * @return The number of sample slots currently allocated to the ring.
+ */
+size_t get_sample_ring_size(void);
+
 void startLogging();
 void stopLogging();
 
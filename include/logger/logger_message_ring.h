@@ -0,0 +1,99 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _LOGGER_MESSAGE_RING_H_
+#define _LOGGER_MESSAGE_RING_H_
+
+#include "FreeRTOS.h"
+#include "capabilities.h"
+#include "cpp_guard.h"
+#include "sampleRecord.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+CPP_GUARD_BEGIN
+
+/*
+ * The logger task publishes every LoggerMessage once into a shared ring.
+ * Each subscriber reads it with its own cursor, so publishing costs the
+ * same no matter how many subscribers there are.  A subscriber only sees
+ * the messages addressed to it.
+ *
+ * A subscriber that falls more than the ring size behind is lapped: the
+ * publisher moves it past each entry it overwrites, releases the sample
+ * reference the subscriber held and counts an overrun against it.
+ *
+ * Start and Stop messages never go through the ring, so they can not be
+ * lapped.  Each subscriber queues them apart and gets them in order with
+ * the samples.
+ *
+ * The size must be a power of two so that the free running cursors stay
+ * valid when they wrap.
+ */
+#define LOGGER_MESSAGE_RING_SIZE	64
+#define LOGGER_MESSAGE_CONTROL_SLOTS	4
+
+#if LOGGER_MESSAGE_RING_SIZE & (LOGGER_MESSAGE_RING_SIZE - 1)
+#error "LOGGER_MESSAGE_RING_SIZE must be a power of two"
+#endif
+/* Lapping should be rarer than running out of sample slots */
+#if LOGGER_MESSAGE_RING_SIZE < 2 * LOGGER_MESSAGE_BUFFER_SIZE
+#error "LOGGER_MESSAGE_RING_SIZE must cover twice the sample slots"
+#endif
+
+/**
+ * Registers the consumer as a reader of the ring.  Messages published
+ * before this call are not seen.
+ * @return true if successful, false otherwise.
+ */
+bool logger_message_subscribe(const enum sample_consumer c);
+
+/**
+ * Publishes a message to the given consumers.  Every subscribed
+ * addressee gets a reference on the attached sample, if any, and blocked
+ * readers are woken.  Only the logger task may publish.
+ * @param msg The message to publish.
+ * @param consumers SAMPLE_CONSUMER_MASK bits of the addressees.
+ */
+void publish_logger_message(const LoggerMessage *msg,
+                            const uint16_t consumers);
+
+/**
+ * Receives the next valid message addressed to the consumer.  Messages
+ * whose sample was reclaimed before they were read are skipped.
+ * @param c The subscribed consumer.
+ * @param msg The LoggerMessage structure to populate.
+ * @param timeout The amount of time to wait for a message.
+ * @return pdTRUE if msg was populated, pdFALSE otherwise.
+ */
+portBASE_TYPE receive_logger_message(const enum sample_consumer c,
+                                     LoggerMessage *msg,
+                                     const portTickType timeout);
+
+/**
+ * Releases the sample reference carried by a received LoggerMessage.
+ */
+void release_logger_message(const LoggerMessage *msg,
+                            const enum sample_consumer c);
+
+CPP_GUARD_END
+
+#endif /* _LOGGER_MESSAGE_RING_H_ */
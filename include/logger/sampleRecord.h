@@ -24,6 +24,7 @@
 
 #include "FreeRTOS.h"
 #include "channel_config.h"
+#include "channel_pipeline.h"
 #include "cpp_guard.h"
 #include "dateTime.h"
 #include "loggerConfig.h"
@@ -32,6 +33,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 CPP_GUARD_BEGIN
 
@@ -58,13 +60,12 @@ enum SampleData {
         SampleData_Double,
 };
 
+/*
+ * Describes how to sample a channel and where its value lives in the
+ * value array of a struct sample.  A single table of these is shared by
+ * all of the sample buffers built from the same configuration.
+ */
 typedef struct _ChannelSample {
-        union {
-                int valueInt;
-                long long valueLongLong;
-                float valueFloat;
-                double valueDouble;
-        };
         ChannelConfig *cfg;
         union {
                 int (*get_int_sample)(int);
@@ -76,15 +77,105 @@ typedef struct _ChannelSample {
                 float (*get_float_sample_noarg)();
                 double (*get_double_sample_noarg)();
         };
+        uint16_t offset;
         uint8_t channelIndex;
-        bool populated;
         enum SampleData sampleData;
+        /*
+         * Set for channels that read a filter output straight through its
+         * compiled scaling.  These skip the getter, which stays set as the
+         * reference for what the pipeline computes.
+         */
+        struct channel_pipeline pipeline;
+        /* Deadband state; see DEADBAND_KEYFRAME_MS */
+        double emitted_value;
+        size_t keyframe_tick;
 }  __attribute__((__packed__,aligned(4))) ChannelSample;
 
+/*
+ * Upper bound on the number of distinct sample rates in a sample.  There
+ * are only 9 standard rates, so this leaves room to spare.
+ */
+#define SAMPLE_RATE_GROUPS_MAX	10
+
+struct sample_rate_group {
+        unsigned short rate;
+        unsigned short count;
+};
+
+/*
+ * Channels bucketed by their sample rate.  Built once when the channel
+ * table is initialized so that populating a sample only visits the
+ * channels that are due on a given tick.
+ */
+struct sample_schedule {
+        size_t last_tick;
+        size_t next_tick;
+        uint8_t group_count;
+        struct sample_rate_group groups[SAMPLE_RATE_GROUPS_MAX];
+        /*
+         * Channel indexes ordered by group, fastest group first, followed
+         * by the always_count ALWAYS_SAMPLED channels.
+         */
+        uint16_t *channel_index;
+        uint16_t always_count;
+};
+
+/*
+ * The shared channel descriptor table.  hash is an open addressing index
+ * of the channel labels holding channel index + 1, or 0 for an empty
+ * slot.  generation changes every time the table is rebuilt.
+ */
+struct sample_channels {
+        size_t count;
+        ChannelSample *samples;
+        size_t values_size;
+        struct sample_schedule schedule;
+        uint16_t generation;
+        uint16_t hash_size;
+        uint16_t *hash;
+};
+
+/*
+ * A channel resolved by name.  Only valid against the sample_channels
+ * table of the same generation; a zeroed handle is never valid.
+ */
+struct channel_handle {
+        uint16_t generation;
+        uint16_t index;
+};
+
+/*
+ * Consumers that may hold a reference on a sample while they process it.
+ * Each connectivity channel gets its own consumer id.
+ */
+enum sample_consumer {
+        SAMPLE_CONSUMER_FILE_WRITER,
+        SAMPLE_CONSUMER_TELEMETRY,
+        SAMPLE_CONSUMER_WIFI = SAMPLE_CONSUMER_TELEMETRY + CONNECTIVITY_CHANNELS,
+        SAMPLE_CONSUMER_USB,
+        SAMPLE_CONSUMER_COUNT,
+};
+
+#define SAMPLE_CONSUMER_MASK(c)		((uint16_t) (1 << (c)))
+#define SAMPLE_CONSUMERS_TELEMETRY	((uint16_t) \
+        (((1 << CONNECTIVITY_CHANNELS) - 1) << SAMPLE_CONSUMER_TELEMETRY))
+
+/*
+ * A single sample.  The channel descriptors point into the shared
+ * struct sample_channels; only the packed values and the populated
+ * bitmap (one bit per channel, LSB first) belong to the sample itself.
+ * refs has one bit per sample_consumer that still holds the sample.
+ */
 struct sample {
         size_t ticks;
         size_t channel_count;
         ChannelSample *channel_samples;
+        struct sample_channels *channels;
+        void *values;
+        uint32_t *populated;
+        /* High rate lane scans up to here belong ahead of this sample */
+        uint32_t high_rate_seq;
+        volatile uint16_t refs;
 };
 
 typedef struct _LoggerMessage {
@@ -95,22 +186,105 @@ typedef struct _LoggerMessage {
 } LoggerMessage;
 
 /**
- * Initializes the struct sample channel_sample buffer for use.  May be called
- * again to re-initialize the space.
- * @param s Pointer to the struct sample to initialize.
+ * Initializes the channel descriptor table shared by the sample buffers.
+ * May be called again to re-initialize the space.
+ * @param sc Pointer to the struct sample_channels to initialize.
  * @param count Number of channels that we are logging.
  * @return The amount of space allocated.
  */
-size_t init_sample_buffer(struct sample *s, const size_t count);
+size_t init_sample_channels(struct sample_channels *sc, const size_t count);
 
 /**
- * Frees the channel_sample buffer assocaited with the struct sample.  Also
+ * Frees the descriptor table associated with the struct sample_channels.
+ * Any sample buffers built from it must be freed first.
+ * @param sc Pointer to the struct sample_channels to reap.
+ */
+void free_sample_channels(struct sample_channels *sc);
+
+/**
+ * Initializes the struct sample value buffer for use with the given
+ * channel table.  May be called again to re-initialize the space.
+ * @param s Pointer to the struct sample to initialize.
+ * @param sc The channel table that describes the sample.
+ * @return The amount of space allocated.
+ */
+size_t init_sample_buffer(struct sample *s, struct sample_channels *sc);
+
+/**
+ * Frees the value buffer assocaited with the struct sample.  Also
  * clears out the struct sample buffer values to indicated that the buffer has
  * been released.  Call this like you would use a free method.
  * @param s Pointer to the struct sample to reap.
  */
 void free_sample_buffer(struct sample *s);
 
+/**
+ * @return true if the channel at the given index holds a value.
+ */
+bool sample_is_populated(const struct sample *s, const size_t index);
+
+void sample_set_populated(struct sample *s, const size_t index);
+
+/**
+ * Marks every channel of the sample as not populated.
+ */
+void sample_clear_populated(struct sample *s);
+
+/**
+ * @return Pointer to the storage of the channel at the given index.  Its
+ * type is given by the sampleData of the channel descriptor.
+ */
+void* sample_get_value(const struct sample *s, const size_t index);
+
+int sample_get_int(const struct sample *s, const size_t index);
+long long sample_get_longlong(const struct sample *s, const size_t index);
+float sample_get_float(const struct sample *s, const size_t index);
+double sample_get_double(const struct sample *s, const size_t index);
+
+/**
+ * Reads the captured value of the channel at the given index as a double.
+ * @return true if value was set, false if the type can not be represented.
+ */
+bool sample_get_captured_value(const struct sample *s, const size_t index,
+                               double *value);
+
+/**
+ * Marks the sample as held by the given consumer.  Only the logger task
+ * takes references, and only before it hands the sample off.
+ */
+void sample_ref(const struct sample *s, const enum sample_consumer c);
+
+/**
+ * Like #sample_ref, but for every consumer in the SAMPLE_CONSUMER_MASK
+ * bitmask at once.
+ */
+void sample_ref_consumers(const struct sample *s, const uint16_t consumers);
+
+/**
+ * Releases the reference the consumer took on the sample.  Does nothing if
+ * the slot was reclaimed and no longer holds the sample taken at ticks.
+ */
+void sample_unref(const struct sample *s, const size_t ticks,
+                  const enum sample_consumer c);
+
+/**
+ * @return true if any consumer still holds the sample.
+ */
+bool sample_is_referenced(const struct sample *s);
+
+/**
+ * Forcibly takes the sample back from every consumer still holding it,
+ * counting an overrun against each of them.
+ */
+void sample_reclaim(struct sample *s);
+
+void sample_count_overrun(const enum sample_consumer c);
+
+/**
+ * @return The number of samples the given consumer has lost because it
+ * fell behind.
+ */
+uint32_t sample_get_overruns(const enum sample_consumer c);
 
 /**
  * Gets a sample value by name for the specified sample.
@@ -124,48 +298,54 @@ bool get_sample_value_by_name(const struct sample *s, const char * name, double
 bool get_channel_value_by_name(const char * name, double *value, char ** units);
 
 /**
- * Creates a LoggerMessage for use in the messaging between threads.
- * @param t The messaget type.
- * @param ticks The logger tick value.
- * @param s The associated sample object (if any).
- * @param needs_meta true if metadata changed
+ * Resolves a channel name into a handle using the label index.
+ * @param h the handle to set.  Invalidated if the name is not found.
+ * @param sc the channel table to resolve against
+ * @param name the name of the channel
+ * @return true if the channel was found
  */
-LoggerMessage create_logger_message(const enum LoggerMessageType t,
-                                    const size_t ticks, struct sample *s,
-                                    const bool needs_meta);
+bool resolve_channel_handle(struct channel_handle *h,
+                            const struct sample_channels *sc,
+                            const char *name);
 
 /**
- * Receives and validates a LoggerMessage from the provided queue.  If the
- * LoggerMessage is invalid, then it is ignored.
- * @param queue The Queue containing the message
- * @param lm The LoggerMessage structure to populate.
- * @param timeout The amount of time to wait before timing out.
- * @return The return value of xQueueReceive.  This must be checked before
- * the LoggerMessage can be considered valid.
+ * @return true if the handle still refers to a channel of the table.
  */
-char receive_logger_message(xQueueHandle queue, LoggerMessage *lm,
-                            portTickType timeout);
+bool is_channel_handle_valid(const struct channel_handle *h,
+                             const struct sample_channels *sc);
 
-bool is_sample_data_valid(const LoggerMessage *lm);
+/**
+ * Gets a sample value by handle.  The value captured in the sample is
+ * used when the channel was populated in it, otherwise the channel is
+ * read directly.
+ * @return true if the handle is valid and the value was set
+ */
+bool get_sample_value_by_handle(const struct sample *s,
+                                const struct channel_handle *h,
+                                double *value, char **units);
 
 /**
- * Creates a brand new LoggerMessage queue.  This is useful for sending
- * LoggerMessage objects to all the little subscribers that need to get
- * them.  Its size is always equal to the number of sample buffers we
- * allocate.  This is because there is little point in allocating more
- * queue space than we have buffers.
- * @return A newly allocated queue.
+ * Like #get_sample_value_by_name, but keeps the resolved handle in h and
+ * only resolves the name again when the handle goes stale.  Meant for
+ * callers that read the same configured channel on every sample.
  */
-xQueueHandle create_logger_message_queue();
+bool get_sample_value_by_cached_name(const struct sample *s,
+                                     const char *name,
+                                     struct channel_handle *h,
+                                     double *value, char **units);
 
 /**
- * Enqueues a LoggerMessage onto a provided queue.
- * @param queue The queue to append the message to.
- * @param msg The message to put into the queue.
- * @return pdTRUE if successful, or an error code otherwise.
+ * Creates a LoggerMessage for use in the messaging between threads.
+ * @param t The messaget type.
+ * @param ticks The logger tick value.
+ * @param s The associated sample object (if any).
+ * @param needs_meta true if metadata changed
  */
-portBASE_TYPE send_logger_message(const xQueueHandle queue,
-                                  const LoggerMessage * const msg);
+LoggerMessage create_logger_message(const enum LoggerMessageType t,
+                                    const size_t ticks, struct sample *s,
+                                    const bool needs_meta);
+
+bool is_sample_data_valid(const LoggerMessage *lm);
 
 CPP_GUARD_END
 
@@ -0,0 +1,113 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SAMPLE_AGGREGATE_H_
+#define _SAMPLE_AGGREGATE_H_
+
+#include "channel_config.h"
+#include "cpp_guard.h"
+#include "loggerConfig.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+CPP_GUARD_BEGIN
+
+/*
+ * Channels that aggregate are read by the background sampler at
+ * AGGREGATE_SAMPLE_RATE and emit a summary of every reading taken since
+ * their previous log tick, so that peaks between log ticks are not lost.
+ *
+ * A window covers the ticks (n - 1) * rate + 1 through n * rate of the
+ * channel's own sample rate.  Windows are told apart by that number
+ * instead of being reset when read, so reading a channel outside of its
+ * log tick never shortens the window being logged.
+ */
+#define AGGREGATE_SAMPLE_RATE	SAMPLE_500Hz
+
+/* Label suffix of the companion channel that carries the min of a pair */
+#define AGGREGATE_MIN_SUFFIX	"Min"
+
+struct sample_aggregate {
+        size_t window;
+        uint16_t count;
+        float sum;
+        float min;
+        float max;
+};
+
+/**
+ * @return The number of the window the given tick belongs to.
+ */
+size_t sample_aggregate_window(const size_t tick, const int sample_rate);
+
+/**
+ * Adds a reading to the aggregate, starting over if it belongs to a new
+ * window.
+ */
+void sample_aggregate_add(struct sample_aggregate *a, const size_t window,
+                          const float value);
+
+/**
+ * Reduces the current window to a single value.  AGGREGATION_MIN_MAX
+ * reduces to the max; the min goes out on the companion channel.
+ * @return true if value was set, false if the window holds no readings.
+ */
+bool sample_aggregate_value(const struct sample_aggregate *a,
+                            const unsigned char mode, float *value);
+
+/**
+ * @return true if any enabled analog or IMU channel aggregates.
+ */
+bool is_channel_aggregation_enabled(LoggerConfig *lc);
+
+/**
+ * Forgets all readings.  Call whenever the logger tick count restarts.
+ */
+void reset_channel_aggregates(void);
+
+/**
+ * Feeds the latest background readings into the aggregating channels.
+ */
+void aggregate_channel_samples(LoggerConfig *lc, const size_t tick);
+
+/**
+ * Fills in the companion channel config of a min/max pair from the config
+ * of the channel that carries the max.
+ */
+void init_aggregate_min_config(ChannelConfig *min_cfg,
+                               const ChannelConfig *cfg);
+
+#if ANALOG_CHANNELS > 0
+float get_analog_aggregate(int channelId);
+float get_analog_aggregate_min(int channelId);
+ChannelConfig* get_analog_aggregate_min_config(const size_t channelId);
+#endif
+
+#if IMU_CHANNELS > 0
+float get_imu_aggregate(int channelId);
+float get_imu_aggregate_min(int channelId);
+ChannelConfig* get_imu_aggregate_min_config(const size_t channelId);
+#endif
+
+CPP_GUARD_END
+
+#endif /* _SAMPLE_AGGREGATE_H_ */
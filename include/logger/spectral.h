@@ -0,0 +1,131 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SPECTRAL_H_
+#define _SPECTRAL_H_
+
+#include "channel_config.h"
+#include "cpp_guard.h"
+#include "fft.h"
+#include "loggerConfig.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+CPP_GUARD_BEGIN
+
+/*
+ * Channels with spectral analysis collect blocks of FFT_POINTS raw
+ * readings at the rate of their source: the high rate lane for analog
+ * channels, so those must be marked highRate, and every device reading
+ * for IMU channels.  Each full block goes through the fixed point FFT,
+ * and the result is logged at the channel's own sample rate on generated
+ * channels:
+ *
+ *   SPECTRAL_MODE_BANDS  "<label>F<band>", the RMS amplitude in channel
+ *                        units of each of the equal width bands between
+ *                        min_hz and max_hz
+ *   SPECTRAL_MODE_PEAK   "<label>Pk", the frequency in Hz of the
+ *                        strongest bin between min_hz and max_hz
+ *
+ * The outputs hold the last complete block and read 0 until the first
+ * block completes.  Only the first SPECTRAL_CHANNELS_MAX spectral
+ * channels, analog channels first, are kept and a warning is logged for
+ * the rest.  Band amplitudes need a linear scale, so analog channels with
+ * mapped scaling are left out of SPECTRAL_MODE_BANDS with a warning.
+ */
+#define SPECTRAL_CHANNELS_MAX	2
+
+/* Label suffixes of the generated channels */
+#define SPECTRAL_BAND_PREFIX	"F"
+#define SPECTRAL_PEAK_SUFFIX	"Pk"
+
+/**
+ * @return true if the config describes an analysis that can be run.
+ */
+bool is_spectral_config_valid(const struct spectral_config *cfg);
+
+/**
+ * @return The number of channels the analysis logs.
+ */
+size_t get_spectral_outputs(const struct spectral_config *cfg);
+
+/**
+ * Runs the analysis over one block of raw readings.
+ * @param samples FFT_POINTS raw readings.
+ * @param rate_hz The rate the readings were taken at.
+ * @param units_per_count Channel units of one raw count.
+ * @param outputs Receives get_spectral_outputs() values.
+ */
+void spectral_analyze(const struct spectral_config *cfg,
+                      const int32_t *samples, float rate_hz,
+                      float units_per_count, float *outputs);
+
+/**
+ * @return The number of channels the spectral channels set up by
+ * init_spectral_channels() add.
+ */
+size_t get_spectral_channel_count(void);
+
+/**
+ * Sets up the spectral channels of the config, dropping all readings.
+ * Only the logger task calls this, on a config change.
+ * @return The number of spectral channels.
+ */
+size_t init_spectral_channels(LoggerConfig *lc);
+
+/**
+ * @return The number of spectral channels set up by
+ * init_spectral_channels().
+ */
+size_t get_spectral_count(void);
+
+/**
+ * @return The channel config of an output of the spectral channel.
+ */
+ChannelConfig* get_spectral_output_config(const size_t channel,
+                                          const size_t output);
+
+/**
+ * @return The number of outputs of the spectral channel.
+ */
+size_t get_spectral_channel_outputs(const size_t channel);
+
+/**
+ * Collects one IMU device reading.  Called by the IMU sampler.
+ * @param axis The raw reading, indexed by enum imu_channel.
+ */
+void spectral_add_imu_reading(const int32_t *axis);
+
+/**
+ * Collects the scans the high rate lane took since the previous call.
+ */
+void spectral_channel_samples(void);
+
+/**
+ * @param id channel * SPECTRAL_BANDS_MAX + output
+ * @return The output value from the last complete block.
+ */
+float get_spectral_value(int id);
+
+CPP_GUARD_END
+
+#endif /* _SPECTRAL_H_ */
@@ -22,9 +22,11 @@
 #ifndef TIMER_H_
 #define TIMER_H_
 
+#include "channel_pipeline.h"
 #include "cpp_guard.h"
 #include "loggerConfig.h"
 
+#include <stdbool.h>
 #include <stdint.h>
 
 CPP_GUARD_BEGIN
@@ -37,8 +39,26 @@ uint32_t timer_get_rpm(size_t channel);
 uint32_t timer_get_hz(size_t channel);
 uint32_t timer_get_count(size_t channel);
 void timer_reset_count(size_t channel);
+
+/**
+ * Reads the channel in the units of its mode, using the scaling compiled
+ * by timer_init.
+ */
 float timer_get_sample(const int cid);
 
+/**
+ * Resolves the channel to its filter output and compiled scaling.
+ * @return false if there is no such channel.
+ */
+bool timer_get_pipeline(const size_t channel, struct channel_pipeline *p);
+
+/**
+ * Feeds the periods captured since the last call into the timer filters.
+ * Called at the fixed background sample rate so that the filters do not
+ * depend on how often, or by how many, the timer values are read.
+ */
+void timer_sample_all(void);
+
 unsigned int timerPeriodToUs(unsigned int ticks, unsigned int scaling);
 unsigned int timerPeriodToMs(unsigned int ticks, unsigned int scaling);
 unsigned int timerPeriodToHz(unsigned int ticks, unsigned int scaling);
@@ -0,0 +1,74 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _TIMER_CAPTURE_H_
+#define _TIMER_CAPTURE_H_
+
+#include "cpp_guard.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+CPP_GUARD_BEGIN
+
+/*
+ * Periods captured by a timer ISR are pushed into a small per channel
+ * ring and drained by the timer sampler at a fixed cadence.  The ISR is
+ * the only writer of head and the sampler the only writer of tail, so no
+ * locking is needed.  If the sampler falls more than the ring size behind,
+ * it only sees the newest captures.
+ *
+ * The size must be a power of two so that the free running cursors stay
+ * valid when they wrap.
+ */
+#define TIMER_CAPTURE_RING_SIZE	16
+
+#if TIMER_CAPTURE_RING_SIZE & (TIMER_CAPTURE_RING_SIZE - 1)
+#error "TIMER_CAPTURE_RING_SIZE must be a power of two"
+#endif
+
+struct timer_capture_ring {
+        volatile uint32_t head;
+        uint32_t tail;
+        uint32_t period_us[TIMER_CAPTURE_RING_SIZE];
+};
+
+/**
+ * Drops all captures in the ring, as when its channel is reconfigured.
+ */
+void timer_capture_reset(struct timer_capture_ring *ring);
+
+/**
+ * Pushes a captured period.  Only the ISR of the channel may push.
+ */
+void timer_capture_push(struct timer_capture_ring *ring,
+                        const uint32_t period_us);
+
+/**
+ * Drains the ring and averages the periods captured since the last call.
+ * @param avg_us Set to the average period if any were captured.
+ * @return true if a period was captured since the last call.
+ */
+bool timer_capture_average(struct timer_capture_ring *ring,
+                           uint32_t *avg_us);
+
+CPP_GUARD_END
+
+#endif /* _TIMER_CAPTURE_H_ */
@@ -42,6 +42,15 @@ bool timer_device_init(const size_t channel, const uint32_t speed,
                        const enum timer_edge edge);
 uint32_t timer_device_get_period(size_t channel);
 uint32_t timer_device_get_usec(size_t channel);
+
+/**
+ * Averages the periods the channel captured since the last call.  Meant
+ * to be called by the timer sampler only, since each call drains the
+ * captures.
+ * @param avg_us Set to the average period in us if any were captured.
+ * @return true if a period was captured since the last call.
+ */
+bool timer_device_get_capture_average(size_t channel, uint32_t *avg_us);
 uint32_t timer_device_get_count(size_t channel);
 void timer_device_reset_count(size_t channel);
 
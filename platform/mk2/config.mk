@@ -82,6 +82,8 @@ $(RCP_SRC)/CAN/CAN_task.c \
 $(RCP_SRC)/CAN/CAN_dispatcher.c \
 $(RCP_SRC)/CAN/CAN_aux_queue.c \
 $(RCP_SRC)/CAN/CAN_aux_filterqueue.c \
+$(RCP_SRC)/CAN/CAN_filter.c \
+$(RCP_SRC)/CAN/CAN_rx_ring.c \
 $(RCP_SRC)/CAN/can_mapping.c \
 $(RCP_SRC)/CAN/can_channels.c \
 $(RCP_SRC)/GPIO/GPIO.c \
@@ -106,6 +108,7 @@ $(RCP_SRC)/devices/gps_skytraq_s1216_sup500f8.c \
 $(RCP_SRC)/drivers/esp8266_drv.c \
 $(RCP_SRC)/drivers/shiftx_drv.c \
 $(RCP_SRC)/drivers/alertmsg_can_drv.c \
+$(RCP_SRC)/filter/fft.c \
 $(RCP_SRC)/filter/filter.c \
 $(RCP_SRC)/gps/dateTime.c \
 $(RCP_SRC)/gps/geoCircle.c \
@@ -116,15 +119,21 @@ $(RCP_SRC)/gps/gpsTask.c \
 $(RCP_SRC)/gsm/gsm.c \
 $(RCP_SRC)/imu/imu.c \
 $(RCP_SRC)/imu/imu_gsum.c \
+$(RCP_SRC)/imu/imu_sample_ring.c \
 $(RCP_SRC)/jsmn/jsmn.c \
 $(RCP_SRC)/lap_stats/lap_stats.c \
 $(RCP_SRC)/launch_control.c \
 $(RCP_SRC)/logger/auto_control.c \
 $(RCP_SRC)/logger/auto_logger.c \
+$(RCP_SRC)/logger/binary_log.c \
 $(RCP_SRC)/logger/channel_config.c \
+$(RCP_SRC)/logger/channel_pipeline.c \
 $(RCP_SRC)/logger/connectivityTask.c \
 $(RCP_SRC)/logger/fileWriter.c \
+$(RCP_SRC)/logger/high_rate_lane.c \
+$(RCP_SRC)/logger/histogram.c \
 $(RCP_SRC)/logger/logger.c \
+$(RCP_SRC)/logger/logger_message_ring.c \
 $(RCP_SRC)/logger/api_event.c \
 $(RCP_SRC)/logger/loggerApi.c \
 $(RCP_SRC)/logger/loggerCommands.c \
@@ -134,6 +143,8 @@ $(RCP_SRC)/logger/loggerHardware.c \
 $(RCP_SRC)/logger/loggerSampleData.c \
 $(RCP_SRC)/logger/loggerTaskEx.c \
 $(RCP_SRC)/logger/sampleRecord.c \
+$(RCP_SRC)/logger/sample_aggregate.c \
+$(RCP_SRC)/logger/spectral.c \
 $(RCP_SRC)/logger/versionInfo.c \
 $(RCP_SRC)/logging/printk.c \
 $(RCP_SRC)/lua/luaBaseBinding.c \
@@ -153,6 +164,7 @@ $(RCP_SRC)/serial/serial_buffer.c \
 $(RCP_SRC)/system/flags.c \
 $(RCP_SRC)/tasks/wifi.c \
 $(RCP_SRC)/timer/timer.c \
+$(RCP_SRC)/timer/timer_capture.c \
 $(RCP_SRC)/timer/timer_config.c \
 $(RCP_SRC)/tracks/tracks.c \
 $(RCP_SRC)/units/units.c \
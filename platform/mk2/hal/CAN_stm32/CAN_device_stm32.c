@@ -20,9 +20,10 @@
  */
 
 #include "CAN_device.h"
+#include "CAN_rx_ring.h"
 #include "FreeRTOS.h"
+#include "cpu_device.h"
 #include "printk.h"
-#include "queue.h"
 #include "stm32f4xx_can.h"
 #include "stm32f4xx_gpio.h"
 #include "stm32f4xx_misc.h"
@@ -35,12 +36,9 @@
 
 #define _LOG_PFX  "[CAN device] "
 
-static xQueueHandle can_rx_queue = NULL;
-
 #define CAN_FILTER_COUNT    13
 #define CAN_IRQ_PRIORITY    5
 #define CAN_IRQ_SUB_PRIORITY    0
-#define CAN_QUEUE_LENGTH    10
 
 //For 168MHz clock
 /*       BS1 BS2 SJW Pre
@@ -63,13 +61,6 @@ static const u8 can_baud_sjw[] =
 static const u8 can_baud_pre[] = { 20, 16, 12, 6, 2 };
 static const u32 can_baud_rate[] = { 100000, 125000, 250000, 500000, 1000000 };
 
-static bool init_queue()
-{
-        if (!can_rx_queue)
-                can_rx_queue = xQueueCreate(CAN_QUEUE_LENGTH, sizeof(CAN_msg));
-        return can_rx_queue != NULL;
-}
-
 static void init_GPIO_CAN(GPIO_TypeDef * GPIOx, uint32_t gpio_pins)
 {
         /* Configure CAN RX and TX pins */
@@ -211,8 +202,8 @@ int CAN_device_init(const uint8_t channel, const uint32_t baud, const bool termi
         pr_info_int(channel);
         pr_info_int_msg(" with baud rate ", baud);
 
-        if (!init_queue()) {
-                pr_info(_LOG_PFX "CAN init queue failed\r\n");
+        if (!CAN_rx_ring_init()) {
+                pr_info(_LOG_PFX "CAN init rx ring failed\r\n");
                 return 0;
         }
 
@@ -266,8 +257,51 @@ int CAN_device_set_filter(const uint8_t channel, const uint8_t id, const uint8_t
         const size_t shift = extended ? 3 : 21;
         CAN_filter_init_structure.CAN_FilterIdHigh = (filter << shift) >> 16;
         CAN_filter_init_structure.CAN_FilterMaskIdHigh = (mask << shift) >> 16;
-        CAN_filter_init_structure.CAN_FilterIdLow = (uint16_t) filter;
-        CAN_filter_init_structure.CAN_FilterMaskIdLow = (uint16_t) mask;
+        CAN_filter_init_structure.CAN_FilterIdLow = (uint16_t) (filter << shift);
+        CAN_filter_init_structure.CAN_FilterMaskIdLow = (uint16_t) (mask << shift);
+
+        CAN_FilterInit(&CAN_filter_init_structure);
+
+        return 1;
+}
+
+int CAN_device_set_filter_list(const uint8_t channel, const uint8_t id, const uint8_t extended,
+                               const uint32_t *ids, const size_t count)
+{
+        if (channel > 1 || id > 13 || count == 0)
+                return 0;
+
+        CAN_FilterInitTypeDef CAN_filter_init_structure;
+        CAN_filter_init_structure.CAN_FilterNumber = (channel == 1) ? id + 14 : id;
+        CAN_filter_init_structure.CAN_FilterMode = CAN_FilterMode_IdList;
+        CAN_filter_init_structure.CAN_FilterFIFOAssignment =
+                (channel == 0 ? CAN_FIFO0 : CAN_FIFO1);
+        CAN_filter_init_structure.CAN_FilterActivation = ENABLE;
+
+        /* Unused slots repeat the first ID */
+        if (extended) {
+                /* Two 32 bit entries, EXT CAN ID -> Bits [31:03] plus IDE */
+                const uint32_t first = ids[0] << 3 | CAN_ID_EXT;
+                const uint32_t second = (count > 1 ? ids[1] : ids[0]) << 3 |
+                        CAN_ID_EXT;
+
+                CAN_filter_init_structure.CAN_FilterScale = CAN_FilterScale_32bit;
+                CAN_filter_init_structure.CAN_FilterIdHigh = first >> 16;
+                CAN_filter_init_structure.CAN_FilterIdLow = (uint16_t) first;
+                CAN_filter_init_structure.CAN_FilterMaskIdHigh = second >> 16;
+                CAN_filter_init_structure.CAN_FilterMaskIdLow = (uint16_t) second;
+        } else {
+                /* Four 16 bit entries, STD CAN ID -> Bits [15:05] */
+                uint16_t entries[4];
+                for (size_t i = 0; i < 4; i++)
+                        entries[i] = ids[i < count ? i : 0] << 5;
+
+                CAN_filter_init_structure.CAN_FilterScale = CAN_FilterScale_16bit;
+                CAN_filter_init_structure.CAN_FilterIdLow = entries[0];
+                CAN_filter_init_structure.CAN_FilterIdHigh = entries[1];
+                CAN_filter_init_structure.CAN_FilterMaskIdLow = entries[2];
+                CAN_filter_init_structure.CAN_FilterMaskIdHigh = entries[3];
+        }
 
         CAN_FilterInit(&CAN_filter_init_structure);
 
@@ -327,14 +361,10 @@ int CAN_device_tx_msg(const uint8_t channel, const CAN_msg * msg, const unsigned
         return status == CAN_TxStatus_Ok;
 }
 
-int CAN_device_rx_msg(CAN_msg * msg, const unsigned int timeout_ms)
+size_t CAN_device_rx_msgs(CAN_msg *msgs, const size_t count,
+                         const unsigned int timeout_ms)
 {
-        if (pdTRUE == xQueueReceive(can_rx_queue, msg, msToTicks(timeout_ms))) {
-                return 1;
-        } else {
-                pr_debug(_LOG_PFX "timeout rx CAN msg\r\n");
-                return 0;
-        }
+        return CAN_rx_ring_get(msgs, count, timeout_ms);
 }
 
 static void process_can_irq_rx(uint8_t can_bus, CAN_TypeDef* can_x, uint8_t fifo_number)
@@ -350,8 +380,9 @@ static void process_can_irq_rx(uint8_t can_bus, CAN_TypeDef* can_x, uint8_t fifo
         can_msg.addressValue = can_msg.isExtendedAddress ? rx_msg.ExtId : rx_msg.StdId;
         memcpy(can_msg.data, rx_msg.Data, rx_msg.DLC);
         can_msg.dataLength = rx_msg.DLC;
+        can_msg.timestamp = cpu_device_get_usec();
 
-        xQueueSendFromISR(can_rx_queue, &can_msg, &task_woken_by_rx);
+        CAN_rx_ring_put_from_isr(&can_msg, &task_woken_by_rx);
         portEND_SWITCHING_ISR(task_woken_by_rx);
 }
 
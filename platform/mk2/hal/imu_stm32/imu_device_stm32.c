@@ -5,9 +5,12 @@
 #include <string.h>
 #include <stdbool.h>
 #include "imu_device.h"
+#include "imu_sample_ring.h"
 #include "loggerConfig.h"
+#include "macros.h"
 #include "printk.h"
 #include "modp_numtoa.h"
+#include "taskUtil.h"
 #include <i2c_device_stm32.h>
 #include <invensense_9150.h>
 
@@ -17,18 +20,46 @@
 #define ACCEL_MAX_RANGE 	ACCEL_COUNTS_PER_G * 4
 #define IMU_TASK_PRIORITY	(tskIDLE_PRIORITY + 2)
 #define IS_9150_ADDR            0x68
+#define IMU_SAMPLE_RATE_HZ	IS_FIFO_SAMPLE_RATE_HZ
+#define IMU_FIFO_POLL_MS	10
 
-static struct is9150_all_sensor_data sensor_data[2];
-static struct is9150_all_sensor_data *read_buf = &sensor_data[0];
-static struct is9150_all_sensor_data *fill_buf = &sensor_data[1];
+static struct imu_sample_ring samples;
 static enum imu_init_status init_status;
 
-static void imu_update_buf_ptrs(void)
+static void push_sensor_data(const struct is9150_all_sensor_data *data)
 {
-        static struct is9150_all_sensor_data *tmp;
-        tmp = read_buf;
-        read_buf = fill_buf;
-        fill_buf = tmp;
+        /*
+         * NOTE: The mappings here allow us to correct the orientation
+         * of the IMU unit relative to the orientation of the RaceCapture.
+         * We use the SAE J670E standard for orientation. See
+         * https://www.autosportlabs.net/RaceCapturePro2_Hardware_Install#Orientation
+         * for the definition of the MK2 orientation.
+         */
+        struct imu_sample sample;
+        sample.axis[IMU_CHANNEL_X] = -data->accel.accel_y;
+        sample.axis[IMU_CHANNEL_Y] = -data->accel.accel_x;
+        sample.axis[IMU_CHANNEL_Z] = data->accel.accel_z;
+        sample.axis[IMU_CHANNEL_ROLL] = data->gyro.gyro_y;
+        sample.axis[IMU_CHANNEL_PITCH] = data->gyro.gyro_x;
+        sample.axis[IMU_CHANNEL_YAW] = -data->gyro.gyro_z;
+
+        imu_sample_ring_push(&samples, &sample);
+}
+
+/*
+ * Drains everything the sensor queued since the last poll, a burst of
+ * all axes of several readings per bus transaction.
+ */
+static void drain_fifo(void)
+{
+        static struct is9150_all_sensor_data data[IS_FIFO_BURST_FRAMES];
+        int count;
+
+        do {
+                count = is9150_read_fifo(data, ARRAY_LEN(data));
+                for (int i = 0; i < count; ++i)
+                        push_sensor_data(data + i);
+        } while (count == (int) ARRAY_LEN(data));
 }
 
 static void imu_update_task(void *params)
@@ -46,15 +77,24 @@ static void imu_update_task(void *params)
         pr_info("\r\n");
         (void)res;
 
-        /* Clear the sensor data structures */
-        memset(sensor_data, 0x00, sizeof(struct is9150_all_sensor_data) * 2);
         init_status = 0 == res ? IMU_INIT_STATUS_SUCCESS : IMU_INIT_STATUS_FAILED;
 
+        /* Older parts without a usable FIFO get polled at the same rate */
+        const bool fifo = 0 == res && 0 == is9150_enable_fifo();
+        if (0 == res && !fifo)
+                pr_warning("IMU: FIFO unavailable, polling\r\n");
+
         while(1) {
-                res = is9150_read_all_sensors(fill_buf);
-                if (!res)
-                        imu_update_buf_ptrs();
-                vTaskDelay(1);
+                if (fifo) {
+                        drain_fifo();
+                        vTaskDelay(msToTicks(IMU_FIFO_POLL_MS));
+                        continue;
+                }
+
+                struct is9150_all_sensor_data data;
+                if (!is9150_read_all_sensors(&data))
+                        push_sensor_data(&data);
+                vTaskDelay(msToTicks(1000 / IMU_SAMPLE_RATE_HZ));
         }
 }
 
@@ -73,29 +113,21 @@ enum imu_init_status imu_device_init_status()
 
 int imu_device_read(enum imu_channel channel)
 {
-        /*
-         * NOTE: The mappings here allow us to correct the orientation
-         * of the IMU unit relative to the orientation of the RaceCapture.
-         * We use the SAE J670E standard for orientation. See
-         * https://www.autosportlabs.net/RaceCapturePro2_Hardware_Install#Orientation
-         * for the definition of the MK2 orientation.
-         */
-        switch(channel) {
-        case IMU_CHANNEL_X:
-                return -read_buf->accel.accel_y;
-        case IMU_CHANNEL_Y:
-                return -read_buf->accel.accel_x;
-        case IMU_CHANNEL_Z:
-                return read_buf->accel.accel_z;
-        case IMU_CHANNEL_ROLL:
-                return read_buf->gyro.gyro_y;
-        case IMU_CHANNEL_PITCH:
-                return read_buf->gyro.gyro_x;
-        case IMU_CHANNEL_YAW:
-                return -read_buf->gyro.gyro_z;
-        default:
+        const struct imu_sample *sample = imu_sample_ring_newest(&samples);
+        if (!sample || channel >= IMU_DEVICE_AXES)
                 return 0;
-        }
+
+        return sample->axis[channel];
+}
+
+size_t imu_device_read_samples(struct imu_sample *buf, size_t max)
+{
+        return imu_sample_ring_read(&samples, buf, max);
+}
+
+float imu_device_sample_rate()
+{
+        return IMU_SAMPLE_RATE_HZ;
 }
 
 float imu_device_counts_per_unit(enum imu_channel channel)
@@ -4,6 +4,7 @@
 
 /* RETURN CODES */
 #define IS_9150_ERR_INIT -1
+#define IS_9150_ERR_READ -2
 
 /* REGISTER DEFINITIONS */
 #define IS_REG_PWR_MGMT_1	0x6B
@@ -37,6 +38,14 @@
 #define IS_TEMP_MEAS_HI		0x41
 #define IS_TEMP_MEAS_LO		0x42
 
+/* FIFO registers */
+#define IS_REG_SMPLRT_DIV	0x19
+#define IS_REG_CONFIG		0x1A
+#define IS_REG_FIFO_EN		0x23
+#define IS_REG_USER_CTRL	0x6A
+#define IS_REG_FIFO_COUNT_H	0x72
+#define IS_REG_FIFO_R_W		0x74
+
 
 /* Power management related */
 #define IS_POWER_SLEEP_POS	6
@@ -57,6 +66,19 @@
 #define IS_GYRO_SCALE_1000	0x02
 #define IS_GYRO_SCALE_2000	0x03
 
+/* FIFO related */
+#define IS_DLPF_POS		0
+#define IS_DLPF_NUM_BITS	3
+#define IS_DLPF_184HZ		0x01	/* 1kHz internal sample rate */
+#define IS_FIFO_EN_ACCEL_GYRO	0x78	/* XG, YG, ZG and ACCEL */
+#define IS_USER_FIFO_EN_POS	6
+#define IS_USER_FIFO_RESET_POS	2
+#define IS_FIFO_SIZE		512	/* Smallest among the supported parts */
+#define IS_FIFO_FRAME_SIZE	(IS_ACCEL_MEAS_COUNT + IS_GYRO_MEAS_COUNT)
+#define IS_FIFO_BURST_FRAMES	16
+#define IS_FIFO_SAMPLE_RATE_HZ	500
+#define IS_FIFO_SMPLRT_DIV	(1000 / IS_FIFO_SAMPLE_RATE_HZ - 1)
+
 /*  Clock settings */
 #define IS_CLOCK_POS            0
 #define IS_CLOCK_NUM_BITS       3
@@ -97,5 +119,7 @@ int is9150_read_gyro(struct is9150_gyro_data *data);
 int is9150_read_accel(struct is9150_accel_data *data);
 int is9150_read_temp(uint16_t *temp);
 int is9150_read_all_sensors(struct is9150_all_sensor_data *data);
+int is9150_enable_fifo(void);
+int is9150_read_fifo(struct is9150_all_sensor_data *data, size_t max);
 
 #endif
@@ -39,7 +39,7 @@
 #define configUSE_PREEMPTION		1
 #define configUSE_IDLE_HOOK		0
 #define configUSE_TICKLESS_IDLE		0
-#define configUSE_TICK_HOOK		1
+#define configUSE_TICK_HOOK		0
 #define configCPU_CLOCK_HZ		( SystemCoreClock )
 #define configTICK_RATE_HZ		1000
 #define configMAX_PRIORITIES		((unsigned portBASE_TYPE) 5)
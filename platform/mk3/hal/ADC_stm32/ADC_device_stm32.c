@@ -20,13 +20,16 @@
  */
 
 #include "ADC_device.h"
-#include "mem_mang.h"
-#include <string.h>
+#include "FreeRTOS.h"
+#include "high_rate_lane.h"
+#include "task.h"
 #include "stm32f4xx.h"
 #include "stm32f4xx_adc.h"
 #include "stm32f4xx_dma.h"
 #include "stm32f4xx_gpio.h"
+#include "stm32f4xx_misc.h"
 #include "stm32f4xx_rcc.h"
+#include "stm32f4xx_tim.h"
 #include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
@@ -49,7 +52,32 @@
 #define SCALING_BATTERYV	0.00465f
 #define TOTAL_ADC_CHANNELS	9
 
-static uint16_t *ADCConvertedValues;
+/*
+ * TIM8 triggers a scan of all channels ADC_SCAN_RATE_HZ times a second
+ * and DMA streams the scans into a circular buffer made of two halves.
+ * Whenever a half completes, the DMA interrupt adds its scans to the
+ * running sums while the other half fills.  ADC_device_sample_all()
+ * averages the sums collected since its last call.  That stands in for
+ * the hardware oversampling this ADC lacks and keeps conversion waits
+ * off the logger task.
+ */
+#define ADC_SCAN_RATE_HZ	4000
+#define ADC_SCAN_TIMER_HZ	1000000
+#define ADC_SCANS_PER_HALF	4
+#define ADC_SCAN_BUFFER_LEN	(2 * ADC_SCANS_PER_HALF * TOTAL_ADC_CHANNELS)
+/* Keeps the 32 bit sums from overflowing if nobody drains them */
+#define ADC_MAX_SUMMED_SCANS	65536
+#define ADC_DMA_IRQ_PRIORITY	5
+#define ADC_DMA_IRQ_SUB_PRIORITY	0
+
+static volatile uint16_t scan_buffer[ADC_SCAN_BUFFER_LEN];
+
+static struct {
+        uint32_t sum[TOTAL_ADC_CHANNELS];
+        uint32_t scans;
+} scan_sums;
+
+static uint16_t averages[TOTAL_ADC_CHANNELS];
 
 static void ADC_GPIO_Configuration(void)
 {
@@ -87,13 +115,31 @@ static void ADC_GPIO_Configuration(void)
         }
 }
 
+static void init_scan_timer(void)
+{
+        RCC_APB2PeriphClockCmd(RCC_APB2Periph_TIM8, ENABLE);
+
+        /* APB2 timers are clocked at the core clock */
+        TIM_TimeBaseInitTypeDef TIM_TimeBaseInitStructure;
+        TIM_TimeBaseInitStructure.TIM_Prescaler =
+                SystemCoreClock / ADC_SCAN_TIMER_HZ - 1;
+        TIM_TimeBaseInitStructure.TIM_CounterMode = TIM_CounterMode_Up;
+        TIM_TimeBaseInitStructure.TIM_Period =
+                ADC_SCAN_TIMER_HZ / ADC_SCAN_RATE_HZ - 1;
+        TIM_TimeBaseInitStructure.TIM_ClockDivision = TIM_CKD_DIV1;
+        TIM_TimeBaseInitStructure.TIM_RepetitionCounter = 0;
+        TIM_TimeBaseInit(TIM8, &TIM_TimeBaseInitStructure);
+
+        /* Every update event starts a scan */
+        TIM_SelectOutputTrigger(TIM8, TIM_TRGOSource_Update);
+        TIM_Cmd(TIM8, ENABLE);
+}
+
 //******************************************************************************
 int ADC_device_init(void)
 {
-        /* TODO: Ditch malloc here, this can be done statically */
-        size_t adcBufferSize = sizeof(uint16_t) * TOTAL_ADC_CHANNELS;
-        ADCConvertedValues = portMalloc(adcBufferSize);
-        memset(ADCConvertedValues, 0, adcBufferSize);
+        memset(&scan_sums, 0, sizeof(scan_sums));
+        memset(averages, 0, sizeof(averages));
 
         ADC_InitTypeDef ADC_InitStructure;
         ADC_CommonInitTypeDef ADC_CommonInitStructure;
@@ -112,9 +158,9 @@ int ADC_device_init(void)
         DMA_InitStructure.DMA_PeripheralBaseAddr =
                 (uint32_t)&ADC2->DR;
         DMA_InitStructure.DMA_Memory0BaseAddr =
-                (uint32_t)&ADCConvertedValues[0];
+                (uint32_t)&scan_buffer[0];
         DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralToMemory;
-        DMA_InitStructure.DMA_BufferSize = 9;
+        DMA_InitStructure.DMA_BufferSize = ADC_SCAN_BUFFER_LEN;
         DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
         DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
         DMA_InitStructure.DMA_PeripheralDataSize =
@@ -128,6 +174,18 @@ int ADC_device_init(void)
         DMA_InitStructure.DMA_MemoryBurst = DMA_MemoryBurst_Single;
         DMA_InitStructure.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
         DMA_Init(DMA2_Stream2, &DMA_InitStructure);
+
+        /* Interrupt as each half of the buffer completes */
+        NVIC_InitTypeDef NVIC_InitStructure;
+        NVIC_InitStructure.NVIC_IRQChannel = DMA2_Stream2_IRQn;
+        NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority =
+                ADC_DMA_IRQ_PRIORITY;
+        NVIC_InitStructure.NVIC_IRQChannelSubPriority =
+                ADC_DMA_IRQ_SUB_PRIORITY;
+        NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+        NVIC_Init(&NVIC_InitStructure);
+        DMA_ITConfig(DMA2_Stream2, DMA_IT_HT | DMA_IT_TC, ENABLE);
+
         /* DMA2_Stream0 enable */
         DMA_Cmd(DMA2_Stream2, ENABLE);
 
@@ -142,11 +200,11 @@ int ADC_device_init(void)
         /* ADC2 Init */
         ADC_InitStructure.ADC_Resolution = ADC_Resolution_12b;
         ADC_InitStructure.ADC_ScanConvMode = ENABLE;
-        ADC_InitStructure.ADC_ContinuousConvMode = ENABLE;
+        ADC_InitStructure.ADC_ContinuousConvMode = DISABLE;
         ADC_InitStructure.ADC_ExternalTrigConvEdge =
-                ADC_ExternalTrigConvEdge_None;
+                ADC_ExternalTrigConvEdge_Rising;
         ADC_InitStructure.ADC_ExternalTrigConv =
-                ADC_ExternalTrigConv_T1_CC1;
+                ADC_ExternalTrigConv_T8_TRGO;
         ADC_InitStructure.ADC_DataAlign = ADC_DataAlign_Right;
         ADC_InitStructure.ADC_NbrOfConversion = 9;
         ADC_Init(ADC2, &ADC_InitStructure);
@@ -180,8 +238,8 @@ int ADC_device_init(void)
         /* Enable ADC2 */
         ADC_Cmd(ADC2, ENABLE);
 
-        /* Start ADC2 Software Conversion */
-        ADC_SoftwareStartConv(ADC2);
+        /* Start the scans */
+        init_scan_timer();
 
         return 1;
 }
@@ -193,8 +251,31 @@ static bool channel_in_bounds(const size_t channel)
 
 int ADC_device_sample(const size_t channel)
 {
-        return channel_in_bounds(channel) ?
-               ADCConvertedValues[channel] : -1;
+        return channel_in_bounds(channel) ? averages[channel] : -1;
+}
+
+size_t ADC_device_sample_all(int32_t *values, const size_t count)
+{
+        uint32_t sum[TOTAL_ADC_CHANNELS];
+        uint32_t scans;
+
+        taskENTER_CRITICAL();
+        memcpy(sum, scan_sums.sum, sizeof(sum));
+        scans = scan_sums.scans;
+        memset(&scan_sums, 0, sizeof(scan_sums));
+        taskEXIT_CRITICAL();
+
+        const size_t n = count < TOTAL_ADC_CHANNELS ?
+                count : TOTAL_ADC_CHANNELS;
+        for (size_t i = 0; i < n; ++i) {
+                /* No half completed since the last call holds the average */
+                if (scans)
+                        averages[i] = (sum[i] + scans / 2) / scans;
+
+                values[i] = averages[i];
+        }
+
+        return n;
 }
 
 float ADC_device_get_voltage_range(const size_t channel)
@@ -216,3 +297,44 @@ float ADC_device_get_channel_scaling(const size_t channel)
                 return SCALING_5V;
         }
 }
+
+uint32_t ADC_device_get_scan_rate(void)
+{
+        return ADC_SCAN_RATE_HZ;
+}
+
+/*
+ * = = = IRQ methods below this point = = =
+ */
+
+static void sum_scans(const volatile uint16_t *half)
+{
+        if (scan_sums.scans >= ADC_MAX_SUMMED_SCANS)
+                return;
+
+        for (size_t scan = 0; scan < ADC_SCANS_PER_HALF; ++scan)
+                for (size_t i = 0; i < TOTAL_ADC_CHANNELS; ++i)
+                        scan_sums.sum[i] += *half++;
+
+        scan_sums.scans += ADC_SCANS_PER_HALF;
+}
+
+static void complete_half(const volatile uint16_t *half)
+{
+        sum_scans(half);
+        high_rate_lane_push_scans(half, ADC_SCANS_PER_HALF,
+                                  TOTAL_ADC_CHANNELS);
+}
+
+void DMA2_Stream2_IRQHandler(void)
+{
+        if (DMA_GetITStatus(DMA2_Stream2, DMA_IT_HTIF2) != RESET) {
+                DMA_ClearITPendingBit(DMA2_Stream2, DMA_IT_HTIF2);
+                complete_half(scan_buffer);
+        }
+
+        if (DMA_GetITStatus(DMA2_Stream2, DMA_IT_TCIF2) != RESET) {
+                DMA_ClearITPendingBit(DMA2_Stream2, DMA_IT_TCIF2);
+                complete_half(scan_buffer + ADC_SCAN_BUFFER_LEN / 2);
+        }
+}
@@ -26,6 +26,7 @@
 #include "stm32f4xx_misc.h"
 #include "stm32f4xx_rcc.h"
 #include "stm32f4xx_tim.h"
+#include "timer_capture.h"
 #include "timer_config.h"
 #include "timer_device.h"
 
@@ -57,6 +58,9 @@ static struct config {
         enum timer_edge edge;
 } g_config[MK3_TIMER_CHANNELS];
 
+/* Periods captured past the quiet period, drained by the timer sampler */
+static struct timer_capture_ring g_captures[MK3_TIMER_CHANNELS];
+
 static uint16_t get_polarity(const enum timer_edge edge)
 {
         switch(edge) {
@@ -372,6 +376,7 @@ bool timer_device_init(const size_t chan, const uint32_t speed,
         c->edge = edge;
 
         reset_device_state(chan);
+        timer_capture_reset(g_captures + chan);
 
         switch (chan) {
         case 0:
@@ -423,6 +428,14 @@ uint32_t timer_device_get_period(size_t chan)
         return chan < MK3_TIMER_CHANNELS ? g_state[chan].period : 0;
 }
 
+bool timer_device_get_capture_average(size_t chan, uint32_t *avg_us)
+{
+        if (chan >= MK3_TIMER_CHANNELS)
+                return false;
+
+        return timer_capture_average(g_captures + chan, avg_us);
+}
+
 
 /*
  * = = = IRQ methods below this point = = =
@@ -463,6 +476,8 @@ static void update_device_state(const size_t chan, const uint16_t p_ticks,
         s->duty_cycle = 100 * (uint32_t) (h_ticks / total_ticks);
         s->q_period_ticks = 0;
         s->pulse_count++;
+
+        timer_capture_push(g_captures + chan, us);
 }
 
 /* Logical Timer 0 IRQ Handler */
@@ -85,7 +85,7 @@ extern uint32_t SystemCoreClock;
 
 #define configUSE_PREEMPTION				1
 #define configUSE_IDLE_HOOK				0
-#define configUSE_TICK_HOOK				1
+#define configUSE_TICK_HOOK				0
 #define configCPU_CLOCK_HZ				(SystemCoreClock)
 #define configTICK_RATE_HZ				((portTickType) 1000)
 #define configMAX_PRIORITIES				((unsigned portBASE_TYPE) 5)
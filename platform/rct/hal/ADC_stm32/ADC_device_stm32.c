@@ -146,6 +146,17 @@ int ADC_device_sample(const size_t channel)
         return channel_in_bounds(channel) ? ADC_Val[channel] : -1;
 }
 
+size_t ADC_device_sample_all(int32_t *values, const size_t count)
+{
+        const size_t n = count < TOTAL_ADC_CHANNELS ?
+                count : TOTAL_ADC_CHANNELS;
+
+        for (size_t i = 0; i < n; ++i)
+                values[i] = ADC_Val[i];
+
+        return n;
+}
+
 float ADC_device_get_voltage_range(const size_t channel)
 {
         return ADC_SYSTEM_VOLTAGE_RANGE;
@@ -155,3 +166,9 @@ float ADC_device_get_channel_scaling(const size_t channel)
 {
         return SCALING_BATTERYV;
 }
+
+uint32_t ADC_device_get_scan_rate(void)
+{
+        /* Converts continuously, not from a timer */
+        return 0;
+}
@@ -20,11 +20,12 @@
  */
 
 #include "CAN_device.h"
+#include "CAN_rx_ring.h"
 #include "FreeRTOS.h"
+#include "cpu_device.h"
 #include "led.h"
 #include "mod_string.h"
 #include "printk.h"
-#include "queue.h"
 #include "stm32f30x.h"
 #include "stm32f30x_can.h"
 #include "stm32f30x_gpio.h"
@@ -36,12 +37,9 @@
 
 #define _LOG_PFX  "[CAN device] "
 
-static xQueueHandle can_rx_queue;
-
 #define CAN_FILTER_COUNT	13
 #define CAN_IRQ_PRIORITY 	5
 #define CAN_IRQ_SUB_PRIORITY 	0
-#define CAN_QUEUE_LENGTH	10
 
 //For 36MHz clock
 /*       BS1 BS2 SJW Pre
@@ -64,15 +62,6 @@ static const u8 can_baud_sjw[] =
 static const u8 can_baud_pre[] = { 20, 18, 9, 9, 2 };
 static const u32 can_baud_rate[] = { 100000, 125000, 250000, 500000, 1000000 };
 
-static bool init_queue()
-{
-        if (!can_rx_queue)
-                can_rx_queue = xQueueCreate(CAN_QUEUE_LENGTH,
-                                            (unsigned portBASE_TYPE)
-                                            sizeof(CAN_msg));
-        return can_rx_queue != NULL;
-}
-
 static void initGPIO(GPIO_TypeDef * GPIOx, uint32_t gpioPins)
 {
         /* Configure CAN RX and TX pins */
@@ -163,8 +152,8 @@ int CAN_device_init(const uint8_t channel, const uint32_t baud, const bool termi
         pr_info_int(channel);
         pr_info_int_msg(" with baud rate ", baud);
 
-        if (!init_queue()) {
-                pr_info(_LOG_PFX "CAN init queues failed\r\n");
+        if (!CAN_rx_ring_init()) {
+                pr_info(_LOG_PFX "CAN init rx ring failed\r\n");
                 return 0;
         }
 
@@ -216,8 +205,51 @@ int CAN_device_set_filter(const uint8_t channel, const uint8_t id, const uint8_t
         const size_t shift = extended ? 3 : 21;
         CAN_FilterInitStructure.CAN_FilterIdHigh = (filter << shift) >> 16;
         CAN_FilterInitStructure.CAN_FilterMaskIdHigh = (mask << shift) >> 16;
-        CAN_FilterInitStructure.CAN_FilterIdLow = (uint16_t) filter;
-        CAN_FilterInitStructure.CAN_FilterMaskIdLow = (uint16_t) mask;
+        CAN_FilterInitStructure.CAN_FilterIdLow = (uint16_t) (filter << shift);
+        CAN_FilterInitStructure.CAN_FilterMaskIdLow = (uint16_t) (mask << shift);
+
+        CAN_FilterInit(&CAN_FilterInitStructure);
+
+        return 1;
+}
+
+int CAN_device_set_filter_list(const uint8_t channel, const uint8_t id, const uint8_t extended,
+                               const uint32_t *ids, const size_t count)
+{
+        if (channel > 1 || id > 13 || count == 0)
+                return 0;
+
+        CAN_FilterInitTypeDef CAN_FilterInitStructure;
+        CAN_FilterInitStructure.CAN_FilterNumber = id;
+        CAN_FilterInitStructure.CAN_FilterMode = CAN_FilterMode_IdList;
+        CAN_FilterInitStructure.CAN_FilterFIFOAssignment =
+                (channel == 0 ? CAN_FIFO0 : CAN_FIFO1);
+        CAN_FilterInitStructure.CAN_FilterActivation = ENABLE;
+
+        /* Unused slots repeat the first ID */
+        if (extended) {
+                /* Two 32 bit entries, EXT CAN ID -> Bits [31:03] plus IDE */
+                const uint32_t first = ids[0] << 3 | CAN_ID_EXT;
+                const uint32_t second = (count > 1 ? ids[1] : ids[0]) << 3 |
+                        CAN_ID_EXT;
+
+                CAN_FilterInitStructure.CAN_FilterScale = CAN_FilterScale_32bit;
+                CAN_FilterInitStructure.CAN_FilterIdHigh = first >> 16;
+                CAN_FilterInitStructure.CAN_FilterIdLow = (uint16_t) first;
+                CAN_FilterInitStructure.CAN_FilterMaskIdHigh = second >> 16;
+                CAN_FilterInitStructure.CAN_FilterMaskIdLow = (uint16_t) second;
+        } else {
+                /* Four 16 bit entries, STD CAN ID -> Bits [15:05] */
+                uint16_t entries[4];
+                for (size_t i = 0; i < 4; i++)
+                        entries[i] = ids[i < count ? i : 0] << 5;
+
+                CAN_FilterInitStructure.CAN_FilterScale = CAN_FilterScale_16bit;
+                CAN_FilterInitStructure.CAN_FilterIdLow = entries[0];
+                CAN_FilterInitStructure.CAN_FilterIdHigh = entries[1];
+                CAN_FilterInitStructure.CAN_FilterMaskIdLow = entries[2];
+                CAN_FilterInitStructure.CAN_FilterMaskIdHigh = entries[3];
+        }
 
         CAN_FilterInit(&CAN_FilterInitStructure);
 
@@ -279,14 +311,10 @@ int CAN_device_tx_msg(const uint8_t channel, const CAN_msg * msg, const unsigned
 
 }
 
-int CAN_device_rx_msg(CAN_msg * msg, const unsigned int timeoutMs)
+size_t CAN_device_rx_msgs(CAN_msg *msgs, const size_t count,
+                         const unsigned int timeoutMs)
 {
-        if (pdTRUE == xQueueReceive(can_rx_queue, msg, msToTicks(timeoutMs))) {
-                return 1;
-        } else {
-                pr_debug(_LOG_PFX "timeout rx CAN msg\r\n");
-                return 0;
-        }
+        return CAN_rx_ring_get(msgs, count, timeoutMs);
 }
 
 void CAN_device_isr(void)
@@ -304,8 +332,9 @@ void CAN_device_isr(void)
                 can_msg.addressValue = can_msg.isExtendedAddress ? rx_msg.ExtId : rx_msg.StdId;
                 memcpy(can_msg.data, rx_msg.Data, rx_msg.DLC);
                 can_msg.dataLength = rx_msg.DLC;
+                can_msg.timestamp = cpu_device_get_usec();
 
-                xQueueSendFromISR(can_rx_queue, &can_msg, &task_woken_by_rx);
+                CAN_rx_ring_put_from_isr(&can_msg, &task_woken_by_rx);
                 portEND_SWITCHING_ISR(task_woken_by_rx);
         }
 }
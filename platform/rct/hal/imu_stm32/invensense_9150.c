@@ -188,3 +188,109 @@ int is9150_read_all_sensors(struct is9150_all_sensor_data *data)
 
         return res;
 }
+
+static int is9150_reset_fifo(void)
+{
+        return is9150_write_reg_bits(IS_REG_USER_CTRL, IS_USER_FIFO_RESET_POS,
+                                     1, 1);
+}
+
+/**
+ * Sets the sensor up to queue accel and gyro readings in its FIFO at
+ * IS_FIFO_SAMPLE_RATE_HZ.
+ */
+int is9150_enable_fifo(void)
+{
+        int res;
+
+        res = is9150_write_reg_bits(IS_REG_CONFIG, IS_DLPF_POS,
+                                    IS_DLPF_NUM_BITS, IS_DLPF_184HZ);
+        if (res) {
+                pr_error("IMU: failed low pass filter setup\r\n");
+                return IS_9150_ERR_INIT;
+        }
+
+        res = i2c_write_reg8(is9150_dev.i2c, is9150_dev.addr,
+                             IS_REG_SMPLRT_DIV, IS_FIFO_SMPLRT_DIV);
+        if (res) {
+                pr_error("IMU: failed sample rate setup\r\n");
+                return IS_9150_ERR_INIT;
+        }
+
+        res = i2c_write_reg8(is9150_dev.i2c, is9150_dev.addr,
+                             IS_REG_FIFO_EN, IS_FIFO_EN_ACCEL_GYRO);
+        if (res) {
+                pr_error("IMU: failed FIFO source setup\r\n");
+                return IS_9150_ERR_INIT;
+        }
+
+        res = is9150_reset_fifo();
+        if (res) {
+                pr_error("IMU: failed FIFO reset\r\n");
+                return IS_9150_ERR_INIT;
+        }
+
+        res = is9150_write_reg_bits(IS_REG_USER_CTRL, IS_USER_FIFO_EN_POS,
+                                    1, 1);
+        if (res) {
+                pr_error("IMU: failed FIFO enable\r\n");
+                return IS_9150_ERR_INIT;
+        }
+
+        return 0;
+}
+
+/**
+ * Reads up to max queued readings out of the FIFO in one bus transaction.
+ * Temperature is not queued and reads as 0.
+ * @return the number of readings read, or IS_9150_ERR_READ.
+ */
+int is9150_read_fifo(struct is9150_all_sensor_data *data, size_t max)
+{
+        static uint8_t reg_res[IS_FIFO_BURST_FRAMES * IS_FIFO_FRAME_SIZE];
+        uint8_t count_res[2] = {0};
+        int res;
+
+        res = is9150_read_reg_block(IS_REG_FIFO_COUNT_H, 2, count_res);
+        if (res)
+                return IS_9150_ERR_READ;
+
+        /*
+         * Once the FIFO fills up the sensor drops readings and may split
+         * one, so the frame boundaries can no longer be trusted.
+         */
+        const size_t bytes = count_res[0] << 8 | count_res[1];
+        if (bytes > IS_FIFO_SIZE - IS_FIFO_FRAME_SIZE) {
+                pr_warning("IMU: FIFO overflow\r\n");
+                return is9150_reset_fifo() ? IS_9150_ERR_READ : 0;
+        }
+
+        size_t frames = bytes / IS_FIFO_FRAME_SIZE;
+        if (frames > max)
+                frames = max;
+        if (frames > IS_FIFO_BURST_FRAMES)
+                frames = IS_FIFO_BURST_FRAMES;
+        if (!frames)
+                return 0;
+
+        res = is9150_read_reg_block(IS_REG_FIFO_R_W,
+                                    frames * IS_FIFO_FRAME_SIZE, reg_res);
+        if (res)
+                return IS_9150_ERR_READ;
+
+        for (size_t i = 0; i < frames; ++i) {
+                const uint8_t *frame = reg_res + i * IS_FIFO_FRAME_SIZE;
+
+                data[i].accel.accel_x = frame[0] << 8 | frame[1];
+                data[i].accel.accel_y = frame[2] << 8 | frame[3];
+                data[i].accel.accel_z = frame[4] << 8 | frame[5];
+
+                data[i].temp = 0;
+
+                data[i].gyro.gyro_x = frame[6] << 8 | frame[7];
+                data[i].gyro.gyro_y = frame[8] << 8 | frame[9];
+                data[i].gyro.gyro_z = frame[10] << 8 | frame[11];
+        }
+
+        return frames;
+}
@@ -30,7 +30,7 @@
 #define MAX_TRACKS	0
 #define MAX_SECTORS	20
 #define MAX_VIRTUAL_CHANNELS	100
-#define LOGGER_MESSAGE_BUFFER_SIZE	10
+#define LOGGER_MESSAGE_BUFFER_SIZE	30
 /*
  * What is the maximum number of samples available per predictive time
  * buffer.  More samples == better resolution. Each slot is 12 bytes.
@@ -89,6 +89,8 @@
 #define MAX_SENSOR_SAMPLE_RATE	50
 #define MAX_GPS_SAMPLE_RATE		50
 #define MAX_OBD2_SAMPLE_RATE	50
+/* Analog scans buffered by the high rate lane.  A power of two, or 0 */
+#define HIGH_RATE_LANE_SCANS	1024
 
 // support GSUMMAX
 #define GSUMMAX
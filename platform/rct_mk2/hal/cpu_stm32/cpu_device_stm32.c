@@ -19,9 +19,11 @@
  * this code. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "FreeRTOS.h"
 #include "cpu_device.h"
 #include "portmacro.h"
 #include "printk.h"
+#include "task.h"
 #include <app_info.h>
 #include <core_cm4.h>
 #include <stdint.h>
@@ -100,3 +102,27 @@ void cpu_device_spin(uint32_t ms)
         while(ms-- > 0)
                 for (volatile size_t i = 0; i < iterations; ++i);
 }
+
+/**
+ * Returns the microseconds since boot, built from the RTOS tick count and
+ * the SysTick down counter.  Masks the kernel interrupts while reading so
+ * that it is safe from both tasks and ISRs.
+ */
+uint32_t cpu_device_get_usec(void)
+{
+        const uint32_t usec_per_tick = 1000000 / configTICK_RATE_HZ;
+        const unsigned portBASE_TYPE mask = portSET_INTERRUPT_MASK_FROM_ISR();
+
+        uint32_t ticks = xTaskGetTickCountFromISR();
+        uint32_t elapsed = SysTick->LOAD - SysTick->VAL;
+        if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+                /* SysTick wrapped but its interrupt has not run yet */
+                elapsed = SysTick->LOAD - SysTick->VAL;
+                ++ticks;
+        }
+
+        portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+
+        return ticks * usec_per_tick +
+                elapsed * usec_per_tick / (SysTick->LOAD + 1);
+}
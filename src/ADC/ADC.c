@@ -21,37 +21,186 @@
 
 #include "ADC.h"
 #include "ADC_device.h"
+#include "channel_pipeline.h"
 #include "filter.h"
+#include "high_rate_lane.h"
 #include "loggerConfig.h"
 #include "printk.h"
 
+#include <string.h>
+
+/*
+ * Channel scaling compiled from the config when the ADC is initialized,
+ * so that reading a scaled value costs a multiply and an add, plus a
+ * short segment search for mapped channels.  Device scaling and
+ * calibration are folded into the linear scaling, which mapped channels
+ * use to get to volts, and mapped channels get the slope of each segment
+ * up front.
+ */
+struct adc_scaling {
+        unsigned char mode;
+        struct channel_scaling linear;
+        float raw[ANALOG_SCALING_BINS];
+        float scaled[ANALOG_SCALING_BINS];
+        float slope[ANALOG_SCALING_BINS - 1];
+};
+
 static Filter g_adc_filter[CONFIG_ADC_CHANNELS];
 static float g_adc_calibrations[CONFIG_ADC_CHANNELS];
+static struct adc_scaling g_adc_scaling[CONFIG_ADC_CHANNELS];
+static float g_adc_update_hz = ADC_DEFAULT_UPDATE_HZ;
+
+static void init_adc_filter(Filter *filter, const ADCConfig *config)
+{
+        if (config->filterCutoff <= 0) {
+                init_filter(filter, config->filterAlpha);
+                return;
+        }
+
+        switch (config->filterType) {
+        case ANALOG_FILTER_TYPE_BIQUAD:
+                init_biquad_filter(filter, config->filterCutoff,
+                                   g_adc_update_hz);
+                break;
+        case ANALOG_FILTER_TYPE_EMA:
+        default:
+                init_ema_filter(filter, config->filterCutoff,
+                                g_adc_update_hz);
+                break;
+        }
+}
+
+static void init_adc_filters(LoggerConfig *loggerConfig)
+{
+        for (size_t i = 0; i < CONFIG_ADC_CHANNELS; i++)
+                init_adc_filter(g_adc_filter + i, loggerConfig->ADCConfigs + i);
+}
+
+static void compile_adc_scaling(struct adc_scaling *s,
+                                const ADCConfig *config,
+                                const float volts_per_count)
+{
+        const ScalingMap *map = &config->scalingMap;
+
+        memset(s, 0, sizeof(*s));
+        s->mode = config->scalingMode;
+        s->linear.op = CHANNEL_SCALING_LINEAR;
+
+        switch (config->scalingMode) {
+        case SCALING_MODE_RAW:
+                s->linear.multiplier = volts_per_count;
+                break;
+        case SCALING_MODE_LINEAR:
+                s->linear.multiplier = config->linearScaling *
+                        volts_per_count;
+                s->linear.offset = config->linearOffset;
+                break;
+        case SCALING_MODE_MAP:
+                /* Segments stay in volts, counts are converted first */
+                s->linear.op = CHANNEL_SCALING_MAPPED;
+                s->linear.multiplier = volts_per_count;
+                memcpy(s->raw, map->rawValues, sizeof(s->raw));
+                memcpy(s->scaled, map->scaledValues, sizeof(s->scaled));
+                for (size_t i = 0; i < ANALOG_SCALING_BINS - 1; i++) {
+                        const float dx = s->raw[i + 1] - s->raw[i];
+                        const float dy = s->scaled[i + 1] - s->scaled[i];
+                        s->slope[i] = dx ? dy / dx : 0;
+                }
+                break;
+        default:
+                /* Unknown modes read as -1 */
+                s->linear.offset = -1;
+                break;
+        }
+}
+
+/*
+ * Same lookup as get_mapped_value, searching from the top bin down so
+ * that oddly ordered maps resolve the same way.
+ */
+static float apply_mapped_scaling(const struct adc_scaling *s,
+                                  const float value)
+{
+        size_t bin = ANALOG_SCALING_BINS - 1;
+        while (bin > 0 && value < s->raw[bin])
+                --bin;
+
+        if (bin == ANALOG_SCALING_BINS - 1)
+                return s->scaled[bin];
+
+        if (bin == 0 && value < s->raw[0])
+                return s->scaled[0];
+
+        return s->scaled[bin] + s->slope[bin] * (value - s->raw[bin]);
+}
+
+/*
+ * Hands the analog channels marked highRate to the high rate lane, which
+ * captures raw scans and needs a linear scaling to describe them.
+ * @return false if the lane turned down any of them.
+ */
+static bool configure_high_rate_lane(LoggerConfig *loggerConfig)
+{
+        struct high_rate_lane_channel channels[CONFIG_ADC_CHANNELS];
+        size_t count = 0;
+
+        for (size_t i = 0; i < CONFIG_ADC_CHANNELS; i++) {
+                ADCConfig *config = loggerConfig->ADCConfigs + i;
+                if (!config->highRate)
+                        continue;
+
+                if (SCALING_MODE_MAP == g_adc_scaling[i].mode) {
+                        pr_warning_str_msg("[ADC] No high rate for mapped "
+                                           "channel ", config->cfg.label);
+                        continue;
+                }
+
+                channels[count].cfg = &config->cfg;
+                channels[count].scaling = &g_adc_scaling[i].linear;
+                channels[count].source = i;
+                ++count;
+        }
+
+        return count == high_rate_lane_configure(channels, count,
+                                                 ADC_device_get_scan_rate());
+}
 
 int ADC_init(LoggerConfig *loggerConfig)
 {
+        init_adc_filters(loggerConfig);
         for (size_t i = 0; i < CONFIG_ADC_CHANNELS; i++) {
                 ADCConfig *config = loggerConfig->ADCConfigs + i;
-                init_filter(g_adc_filter + i, config->filterAlpha);
                 g_adc_calibrations[i] = config->calibration;
+
+                const float volts_per_count = config->calibration *
+                        ADC_device_get_channel_scaling(i);
+                compile_adc_scaling(g_adc_scaling + i, config,
+                                    volts_per_count);
         }
+        const bool lane_ok = configure_high_rate_lane(loggerConfig);
 
-        return ADC_device_init();
+        return ADC_device_init() && lane_ok;
 }
 
-void ADC_sample_all(void)
+void ADC_set_update_rate(LoggerConfig *loggerConfig, const float update_hz)
 {
-        for (int i = 0; i < CONFIG_ADC_CHANNELS; ++i) {
-                const int val = ADC_device_sample(i);
+        g_adc_update_hz = update_hz;
+        init_adc_filters(loggerConfig);
+}
 
-                if (val < 0) {
-                        /* Should never get here */
-                        pr_error_int_msg("Sampled non-existant channel: ", i);
-                        continue;
-                }
+void ADC_sample_all(void)
+{
+        int32_t values[CONFIG_ADC_CHANNELS];
+        const size_t count = ADC_device_sample_all(values,
+                                                   CONFIG_ADC_CHANNELS);
 
-                update_filter(g_adc_filter + i, val);
+        for (size_t i = count; i < CONFIG_ADC_CHANNELS; ++i) {
+                /* Should never get here */
+                pr_error_int_msg("Sampled non-existant channel: ", i);
+                values[i] = g_adc_filter[i].current_value;
         }
+
+        update_filters(g_adc_filter, values, CONFIG_ADC_CHANNELS);
 }
 
 float ADC_read(const size_t channel)
@@ -60,3 +209,24 @@ float ADC_read(const size_t channel)
                ADC_device_get_channel_scaling(channel) *
                g_adc_calibrations[channel];
 }
+
+float ADC_read_scaled(const size_t channel)
+{
+        const struct adc_scaling *s = g_adc_scaling + channel;
+        const float value = channel_scaling_apply(
+                &s->linear, g_adc_filter[channel].current_value);
+
+        if (SCALING_MODE_MAP == s->mode)
+                return apply_mapped_scaling(s, value);
+
+        return value;
+}
+
+bool ADC_get_pipeline(const size_t channel, struct channel_pipeline *p)
+{
+        const struct adc_scaling *s = g_adc_scaling + channel;
+
+        p->raw = &g_adc_filter[channel].current_value;
+        p->scaling = &s->linear;
+        return true;
+}
@@ -22,6 +22,7 @@
 
 #include "CAN.h"
 #include "CAN_device.h"
+#include "CAN_filter.h"
 #include "loggerConfig.h"
 #include "printk.h"
 #include "led.h"
@@ -39,6 +40,9 @@ int CAN_init(LoggerConfig *loggerConfig)
                 if (!CAN_init_port(i, canConfig->baud[i], termination))
                         return 0;
         }
+
+        /* Initializing a port opens its filters back up */
+        CAN_filter_apply(loggerConfig);
         return 1;
 }
 
@@ -62,10 +66,20 @@ int CAN_tx_msg(const uint8_t channel, const CAN_msg *msg, const unsigned int tim
         return rc;
 }
 
-int CAN_rx_msg(CAN_msg *msg, const unsigned int timeoutMs)
+size_t CAN_rx_msgs(CAN_msg *msgs, const size_t count,
+                   const unsigned int timeoutMs)
 {
-        const int rc = CAN_device_rx_msg(msg, timeoutMs);
-        if (rc)
+        const size_t received = CAN_device_rx_msgs(msgs, count, timeoutMs);
+        if (received)
                 led_toggle(LED_CAN);
-        return rc;
+
+        for (size_t i = 0; i < received; i++)
+                CAN_filter_count_rx(msgs + i);
+
+        return received;
+}
+
+int CAN_rx_msg(CAN_msg *msg, const unsigned int timeoutMs)
+{
+        return CAN_rx_msgs(msg, 1, timeoutMs);
 }
@@ -47,6 +47,14 @@ void CAN_aux_filterqueue_configure(uint8_t new_can_bus, uint32_t new_low_id_rang
         high_id_range = new_high_id_range;
 }
 
+bool CAN_aux_filterqueue_get_range(uint8_t *bus, uint32_t *low, uint32_t *high)
+{
+        *bus = can_bus;
+        *low = low_id_range;
+        *high = high_id_range;
+        return low_id_range && high_id_range;
+}
+
 bool CAN_aux_filterqueue_put_msg(CAN_msg * can_msg)
 {
         /* match on configured CAN bus */
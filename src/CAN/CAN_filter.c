@@ -0,0 +1,396 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CAN_aux_filterqueue.h"
+#include "CAN_device.h"
+#include "CAN_filter.h"
+#include "capabilities.h"
+#include "cpu.h"
+#include "mem_mang.h"
+#include "printk.h"
+#include "shiftx_drv.h"
+#include "stdutil.h"
+#include <string.h>
+
+#define _LOG_PFX "[CAN filter] "
+
+/* The rules one bus can have: mappings, PIDs, ShiftX and the aux range */
+#define CAN_FILTER_RULES_MAX	(CONFIG_CAN_MAPPINGS + CONFIG_OBD2_CHANNELS + \
+                                 SHIFTX_RX_IDS + 1)
+
+/* Kept off the CAN task stack */
+struct can_filter_work {
+        struct can_filter_plan plan;
+        struct can_filter_rule rules[CAN_FILTER_RULES_MAX];
+};
+
+static struct can_filter_status filter_status[CAN_CHANNELS];
+/* Set while the banks of the bus hold filters we planned */
+static bool auto_filtered[CAN_CHANNELS];
+
+static uint32_t id_width_mask(const bool extended)
+{
+        return extended ? CAN_EXT_ID_MASK : CAN_STD_ID_MASK;
+}
+
+static bool is_exact(const struct can_filter_rule *rule)
+{
+        return rule->mask == id_width_mask(rule->extended);
+}
+
+/* True if a accepts every ID that b accepts */
+static bool covers(const struct can_filter_rule *a,
+                   const struct can_filter_rule *b)
+{
+        return a->extended == b->extended &&
+                (b->mask & a->mask) == a->mask &&
+                (b->id & a->mask) == a->id;
+}
+
+static size_t list_banks(const size_t ids, const size_t per_bank)
+{
+        return (ids + per_bank - 1) / per_bank;
+}
+
+static size_t count_banks(const struct can_filter_rule *rules,
+                          const size_t count)
+{
+        size_t std = 0;
+        size_t ext = 0;
+        size_t masks = 0;
+
+        for (size_t i = 0; i < count; i++) {
+                if (!is_exact(rules + i))
+                        masks++;
+                else if (rules[i].extended)
+                        ext++;
+                else
+                        std++;
+        }
+
+        return masks + list_banks(std, CAN_FILTER_LIST_STD) +
+                list_banks(ext, CAN_FILTER_LIST_EXT);
+}
+
+/* Drops the rules that another rule already covers */
+static size_t remove_covered(struct can_filter_rule *rules,
+                             const size_t count)
+{
+        size_t kept = 0;
+
+        for (size_t i = 0; i < count; i++) {
+                bool covered = false;
+                for (size_t j = 0; j < kept && !covered; j++)
+                        covered = covers(rules + j, rules + i);
+
+                if (covered)
+                        continue;
+
+                size_t k = 0;
+                for (size_t j = 0; j < kept; j++) {
+                        if (!covers(rules + i, rules + j))
+                                rules[k++] = rules[j];
+                }
+                rules[k++] = rules[i];
+                kept = k;
+        }
+
+        return kept;
+}
+
+static struct can_filter_rule merge_rules(const struct can_filter_rule *a,
+                                          const struct can_filter_rule *b)
+{
+        struct can_filter_rule merged = *a;
+
+        merged.mask = a->mask & b->mask & ~(a->id ^ b->id);
+        merged.id = a->id & merged.mask;
+        return merged;
+}
+
+/*
+ * Merges the pair of rules that keeps the most ID bits.
+ * @return the new rule count, or 0 if no pair can be merged.
+ */
+static size_t merge_closest(struct can_filter_rule *rules, size_t count)
+{
+        int best_bits = -1;
+        size_t best_a = 0;
+        size_t best_b = 0;
+
+        for (size_t a = 0; a < count; a++) {
+                for (size_t b = a + 1; b < count; b++) {
+                        if (rules[a].extended != rules[b].extended)
+                                continue;
+
+                        const struct can_filter_rule merged =
+                                merge_rules(rules + a, rules + b);
+                        const int bits = __builtin_popcount(merged.mask);
+                        if (bits > best_bits) {
+                                best_bits = bits;
+                                best_a = a;
+                                best_b = b;
+                        }
+                }
+        }
+
+        if (best_bits < 0)
+                return 0;
+
+        rules[best_a] = merge_rules(rules + best_a, rules + best_b);
+        rules[best_b] = rules[--count];
+        return remove_covered(rules, count);
+}
+
+static void add_list_banks(struct can_filter_plan *plan, const bool extended,
+                          const struct can_filter_rule *rules,
+                          const size_t count)
+{
+        const size_t per_bank = extended ?
+                CAN_FILTER_LIST_EXT : CAN_FILTER_LIST_STD;
+        struct can_filter_bank *bank = NULL;
+
+        for (size_t i = 0; i < count; i++) {
+                if (!is_exact(rules + i) || rules[i].extended != extended)
+                        continue;
+
+                if (!bank || bank->count == per_bank) {
+                        bank = plan->banks + plan->bank_count++;
+                        bank->mode = CAN_FILTER_MODE_LIST;
+                        bank->extended = extended;
+                        bank->mask = 0;
+                        bank->count = 0;
+                }
+                bank->ids[bank->count++] = rules[i].id;
+        }
+}
+
+void CAN_filter_plan(struct can_filter_plan *plan,
+                     struct can_filter_rule *rules, size_t count)
+{
+        memset(plan, 0, sizeof(*plan));
+
+        for (size_t i = 0; i < count; i++) {
+                if (rules[i].mask == 0) {
+                        plan->accept_all = true;
+                        return;
+                }
+        }
+
+        count = remove_covered(rules, count);
+        while (count_banks(rules, count) > CAN_FILTER_BANKS) {
+                count = merge_closest(rules, count);
+                if (!count) {
+                        plan->accept_all = true;
+                        return;
+                }
+        }
+
+        for (size_t i = 0; i < count; i++) {
+                if (is_exact(rules + i))
+                        continue;
+
+                struct can_filter_bank *bank =
+                        plan->banks + plan->bank_count++;
+                bank->mode = CAN_FILTER_MODE_MASK;
+                bank->extended = rules[i].extended;
+                bank->ids[0] = rules[i].id;
+                bank->mask = rules[i].mask;
+                bank->count = 1;
+        }
+
+        add_list_banks(plan, false, rules, count);
+        add_list_banks(plan, true, rules, count);
+}
+
+/*
+ * CAN mappings do not say which ID width they expect, so IDs that fit in
+ * 11 bits are taken as standard IDs.
+ */
+static size_t add_rule(struct can_filter_rule *rules, const size_t count,
+                       const uint32_t id, const uint32_t mask)
+{
+        struct can_filter_rule *rule = rules + count;
+
+        rule->extended = id > CAN_STD_ID_MASK;
+        rule->mask = mask & id_width_mask(rule->extended);
+        rule->id = id & rule->mask;
+        return count + 1;
+}
+
+static size_t add_mapping_rule(struct can_filter_rule *rules,
+                               const size_t count,
+                               const CANMapping *mapping)
+{
+        /* A CAN ID of 0 is a wildcard; no mask means the exact ID */
+        if (mapping->can_id == 0)
+                return add_rule(rules, count, 0, 0);
+
+        return add_rule(rules, count, mapping->can_id,
+                        mapping->can_mask ? mapping->can_mask : UINT32_MAX);
+}
+
+/* Covers the inclusive range with the one mask sharing its leading bits */
+static size_t add_range_rule(struct can_filter_rule *rules,
+                             const size_t count,
+                             const uint32_t low, const uint32_t high)
+{
+        uint32_t mask = UINT32_MAX;
+        for (uint32_t span = low ^ high; span; span >>= 1)
+                mask <<= 1;
+
+        return add_rule(rules, count, high, mask);
+}
+
+static size_t collect_rules(LoggerConfig *lc, const uint8_t can_bus,
+                            struct can_filter_rule *rules)
+{
+        size_t count = 0;
+
+        const CANChannelConfig *ccc = &lc->can_channel_cfg;
+        if (ccc->enabled) {
+                const size_t mappings = MIN(ccc->enabled_mappings,
+                                            CONFIG_CAN_MAPPINGS);
+                for (size_t i = 0; i < mappings; i++) {
+                        const CANMapping *mapping =
+                                &ccc->can_channels[i].mapping;
+                        if (mapping->can_channel == can_bus)
+                                count = add_mapping_rule(rules, count,
+                                                         mapping);
+                }
+        }
+
+        const OBD2Config *oc = &lc->OBD2Configs;
+        if (oc->enabled) {
+                const size_t pids = MIN(oc->enabledPids,
+                                        CONFIG_OBD2_CHANNELS);
+                for (size_t i = 0; i < pids; i++) {
+                        const CANMapping *mapping = &oc->pids[i].mapping;
+                        if (mapping->can_channel == can_bus)
+                                count = add_mapping_rule(rules, count,
+                                                         mapping);
+                }
+        }
+
+        if (shiftx_get_config()->can_bus == can_bus) {
+                uint32_t ids[SHIFTX_RX_IDS];
+                const size_t shiftx_ids = shiftx_get_rx_ids(ids);
+                for (size_t i = 0; i < shiftx_ids; i++)
+                        count = add_rule(rules, count, ids[i], UINT32_MAX);
+        }
+
+        uint8_t aux_bus;
+        uint32_t low;
+        uint32_t high;
+        if (CAN_aux_filterqueue_get_range(&aux_bus, &low, &high) &&
+            aux_bus == can_bus)
+                count = add_range_rule(rules, count, low, high);
+
+        return count;
+}
+
+static void program_filters(const uint8_t can_bus,
+                            const struct can_filter_plan *plan)
+{
+        size_t bank = 0;
+
+        if (plan->accept_all) {
+                CAN_device_set_filter(can_bus, bank++, 1, 0, 0, true);
+        } else {
+                for (; bank < plan->bank_count; bank++) {
+                        const struct can_filter_bank *b = plan->banks + bank;
+
+                        if (b->mode == CAN_FILTER_MODE_MASK)
+                                CAN_device_set_filter(can_bus, bank,
+                                                      b->extended, b->ids[0],
+                                                      b->mask, true);
+                        else
+                                CAN_device_set_filter_list(can_bus, bank,
+                                                           b->extended,
+                                                           b->ids, b->count);
+                }
+        }
+
+        for (; bank < CAN_FILTER_BANKS; bank++)
+                CAN_device_set_filter(can_bus, bank, 0, 0, 0, false);
+
+        filter_status[can_bus].accept_all = plan->accept_all;
+        filter_status[can_bus].bank_count = plan->accept_all ?
+                1 : plan->bank_count;
+}
+
+void CAN_filter_apply(LoggerConfig *lc)
+{
+        struct can_filter_work *work = portMalloc(sizeof(*work));
+        if (!work) {
+                pr_error(_LOG_PFX "Failed to alloc filter plan\r\n");
+                return;
+        }
+
+        for (size_t bus = 0; bus < CAN_CHANNELS; bus++) {
+                if (lc->CanConfig.auto_filter) {
+                        const size_t count =
+                                collect_rules(lc, bus, work->rules);
+                        CAN_filter_plan(&work->plan, work->rules, count);
+                        auto_filtered[bus] = true;
+                } else if (auto_filtered[bus]) {
+                        /* Turned off, so open the bus back up once */
+                        memset(&work->plan, 0, sizeof(work->plan));
+                        work->plan.accept_all = true;
+                        auto_filtered[bus] = false;
+                } else {
+                        /*
+                         * The banks are the driver defaults or were set
+                         * by a script with CAN_set_filter.  Keep them.
+                         */
+                        filter_status[bus].accept_all = true;
+                        filter_status[bus].bank_count = 1;
+                        continue;
+                }
+
+                program_filters(bus, &work->plan);
+                pr_info_int_msg(_LOG_PFX "Filter banks in use: ",
+                                filter_status[bus].bank_count);
+        }
+
+        portFree(work);
+}
+
+void CAN_filter_count_rx(const CAN_msg *msg)
+{
+        if (msg->can_bus >= CAN_CHANNELS)
+                return;
+
+        struct can_filter_status *status = filter_status + msg->can_bus;
+        const uint32_t latency = cpu_get_usec() - msg->timestamp;
+
+        status->accepted++;
+        status->max_latency_us = MAX(status->max_latency_us, latency);
+}
+
+void CAN_filter_get_status(const uint8_t can_bus,
+                           struct can_filter_status *status)
+{
+        if (can_bus < CAN_CHANNELS)
+                *status = filter_status[can_bus];
+        else
+                memset(status, 0, sizeof(*status));
+}
@@ -0,0 +1,123 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CAN_rx_ring.h"
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "stdutil.h"
+#include "taskUtil.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Keeps the compiler from moving memory accesses across this point */
+#define compiler_barrier()	__asm__ volatile("" ::: "memory")
+
+static struct {
+        CAN_msg msgs[CAN_RX_RING_SIZE];
+        volatile uint32_t head;
+        volatile uint32_t tail;
+        volatile bool waiting;
+        xSemaphoreHandle wake;
+        struct can_rx_stats stats;
+} ring;
+
+bool CAN_rx_ring_init(void)
+{
+        if (!ring.wake)
+                ring.wake = xSemaphoreCreateBinary();
+
+        return ring.wake != NULL;
+}
+
+bool CAN_rx_ring_put_from_isr(const CAN_msg *msg,
+                              signed portBASE_TYPE *task_woken)
+{
+        const uint32_t head = ring.head;
+        const uint32_t used = head - ring.tail;
+
+        if (used >= CAN_RX_RING_SIZE) {
+                ring.stats.dropped++;
+                return false;
+        }
+
+        ring.msgs[head % CAN_RX_RING_SIZE] = *msg;
+
+        /* The task must never see the new head before the frame */
+        compiler_barrier();
+        ring.head = head + 1;
+
+        ring.stats.received++;
+        ring.stats.high_water = MAX(ring.stats.high_water, used + 1);
+
+        /* Only wake the task once per burst */
+        if (ring.waiting && ring.wake) {
+                ring.waiting = false;
+                xSemaphoreGiveFromISR(ring.wake, task_woken);
+        }
+
+        return true;
+}
+
+static size_t read_msgs(CAN_msg *msgs, const size_t count)
+{
+        const uint32_t tail = ring.tail;
+        const size_t available = MIN(ring.head - tail, count);
+
+        compiler_barrier();
+        for (size_t i = 0; i < available; i++)
+                msgs[i] = ring.msgs[(tail + i) % CAN_RX_RING_SIZE];
+
+        /* The slots must be copied out before they are handed back */
+        compiler_barrier();
+        ring.tail = tail + available;
+
+        return available;
+}
+
+size_t CAN_rx_ring_get(CAN_msg *msgs, const size_t count,
+                       const unsigned int timeout_ms)
+{
+        size_t received = read_msgs(msgs, count);
+        if (received || 0 == timeout_ms || !ring.wake)
+                return received;
+
+        /*
+         * Check again after raising the flag so that a frame put in
+         * between still wakes us.  A stale wakeup left over in the
+         * semaphore only costs an early return.
+         */
+        ring.waiting = true;
+        compiler_barrier();
+        received = read_msgs(msgs, count);
+        if (!received) {
+                xSemaphoreTake(ring.wake, msToTicks(timeout_ms));
+                received = read_msgs(msgs, count);
+        }
+        ring.waiting = false;
+
+        return received;
+}
+
+void CAN_rx_ring_get_stats(struct can_rx_stats *stats)
+{
+        *stats = ring.stats;
+}
@@ -38,12 +38,35 @@
 #include "CAN_aux_queue.h"
 #include "CAN_aux_filterqueue.h"
 #include "CAN_dispatcher.h"
+#include "CAN_filter.h"
 
 #define _LOG_PFX                        "[CAN_Task] "
 
 #define CAN_TASK_STACK                  128
 #define CAN_TASK_FEATURED_DISABLED_MS   2000
 #define CAN_RX_DELAY                    50
+#define CAN_RX_BATCH                    8
+
+/* Kept off the CAN task stack */
+static CAN_msg rx_batch[CAN_RX_BATCH];
+
+static void process_can_msg(CAN_msg *msg, CANChannelConfig *ccc,
+                            OBD2Config *oc,
+                            const uint16_t enabled_mapping_count)
+{
+        if (ccc->enabled)
+                update_can_channels(msg, ccc, enabled_mapping_count);
+
+        if (oc->enabled)
+                update_obd2_channels(msg, oc);
+
+        can_dispatch_message(msg);
+
+#if CAN_AUX_QUEUE_SUPPORT == 1
+        CAN_aux_queue_put_msg(msg);
+#endif
+        CAN_aux_filterqueue_put_msg(msg);
+}
 
 static void CAN_task(void *parameters)
 {
@@ -61,7 +84,8 @@ static void CAN_task(void *parameters)
                 bool success;
 
                 uint16_t new_enabled_mapping_count = ccc->enabled_mappings;
-                success = CAN_init_current_values(new_enabled_mapping_count);
+                success = CAN_init_current_values(new_enabled_mapping_count) &&
+                        CAN_init_mapping_index(ccc, new_enabled_mapping_count);
                 enabled_mapping_count = success ? new_enabled_mapping_count : 0;
                 if (!success)
                         pr_error_int_msg("Failed to create buffer for CAN channels; size ", new_enabled_mapping_count);
@@ -72,24 +96,17 @@ static void CAN_task(void *parameters)
                 if (!success)
                         pr_error_int_msg("Failed to create buffer for OBD2 channels; size ", new_enabled_obd2_pids_count);
 
-                while(! (CAN_is_state_stale() || OBD2_is_state_stale())) {
-                        CAN_msg msg;
-                        int result = CAN_rx_msg(&msg, CAN_RX_DELAY );
-
-                        if (result) {
-                                if (ccc->enabled)
-                                        update_can_channels(&msg, ccc, enabled_mapping_count);
+                CAN_filter_apply(lc);
 
-                                if (oc->enabled)
-                                        update_obd2_channels(&msg, oc);
+                while(! (CAN_is_state_stale() || OBD2_is_state_stale())) {
+                        /* drain every frame that arrived since the last wake */
+                        const size_t count = CAN_rx_msgs(rx_batch, CAN_RX_BATCH,
+                                                         CAN_RX_DELAY);
 
-                                can_dispatch_message(&msg);
+                        for (size_t i = 0; i < count; i++)
+                                process_can_msg(rx_batch + i, ccc, oc,
+                                                enabled_mapping_count);
 
-#if CAN_AUX_QUEUE_SUPPORT == 1
-                                CAN_aux_queue_put_msg(&msg);
-#endif
-                                CAN_aux_filterqueue_put_msg(&msg);
-                        }
                         if (oc->enabled)
                                 sequence_next_obd2_query(oc, enabled_obd2_pids_count);
 
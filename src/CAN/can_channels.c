@@ -27,10 +27,34 @@
 #include <string.h>
 
 
+/* the latest value of a channel and when its frame was received */
+struct can_current_value {
+        float value;
+        uint32_t timestamp;
+};
+
+/* where a mapping is found in the index */
+struct can_mapping_key {
+        uint32_t can_id;
+        uint16_t mapping;
+        uint8_t can_bus;
+};
+
 /* manages the running state of the CAN channels*/
 struct CANState {
         /* CAN bus channels current channel values */
-        float * CAN_current_values;
+        struct can_current_value * CAN_current_values;
+
+        /*
+         * Index of the enabled mappings.  Mappings matched on their exact
+         * CAN ID come first, sorted by bus and then ID.  Mappings with an
+         * ID mask or a wildcard ID follow in config order.
+         */
+        struct can_mapping_key *mapping_keys;
+        /* The mappings compiled, in config order */
+        struct can_extractor *extractors;
+        uint16_t exact_mappings;
+        uint16_t indexed_mappings;
 
         /* flag to indicate if state is stale */
         bool stale;
@@ -54,7 +78,7 @@ bool CAN_init_current_values(size_t values)
                 portFree(can_state.CAN_current_values);
 
         values = MAX(1, values);
-        size_t size = sizeof(float[values]);
+        size_t size = sizeof(struct can_current_value[values]);
         can_state.CAN_current_values = portMalloc(size);
 
         if (can_state.CAN_current_values != NULL)
@@ -68,31 +92,156 @@ float CAN_get_current_channel_value(int index)
 {
         if (can_state.CAN_current_values == NULL)
                 return 0;
-        return can_state.CAN_current_values[index];
+        return can_state.CAN_current_values[index].value;
 }
 
-void CAN_set_current_channel_value(int index, float value)
+uint32_t CAN_get_current_channel_timestamp(int index)
+{
+        if (can_state.CAN_current_values == NULL)
+                return 0;
+        return can_state.CAN_current_values[index].timestamp;
+}
+
+void CAN_set_current_channel_value(int index, float value, uint32_t timestamp)
 {
         if (can_state.CAN_current_values == NULL)
                 return;
-        can_state.CAN_current_values[index] = value;
+        can_state.CAN_current_values[index].value = value;
+        can_state.CAN_current_values[index].timestamp = timestamp;
 }
 
-void update_can_channels(CAN_msg *msg, CANChannelConfig *cfg, uint16_t enabled_mapping_count)
+static bool is_exact_mapping(const CANMapping *mapping)
 {
-        for (size_t i = 0; i < enabled_mapping_count; i++) {
-                CANMapping *mapping = &cfg->can_channels[i].mapping;
+        return mapping->can_id != 0 && mapping->can_mask == 0;
+}
 
-                /* only process the mapping for the bus we're handling messages for */
-                if (msg->can_bus != mapping->can_channel)
-                        continue;
+static bool key_before(const struct can_mapping_key *key,
+                       const uint8_t can_bus, const uint32_t can_id)
+{
+        return key->can_bus < can_bus ||
+                (key->can_bus == can_bus && key->can_id < can_id);
+}
+
+static void set_mapping_key(struct can_mapping_key *key,
+                            const CANMapping *mapping, const uint16_t index)
+{
+        key->can_id = mapping->can_id;
+        key->mapping = index;
+        key->can_bus = mapping->can_channel;
+}
 
-                float value;
-                /* map the CAN message to the value */
-                bool result = canmapping_map_value(&value, msg, mapping);
-                if (!result)
+bool CAN_init_mapping_index(const CANChannelConfig *cfg, uint16_t count)
+{
+        if (can_state.mapping_keys != NULL)
+                portFree(can_state.mapping_keys);
+        if (can_state.extractors != NULL)
+                portFree(can_state.extractors);
+
+        can_state.exact_mappings = 0;
+        can_state.indexed_mappings = 0;
+        can_state.mapping_keys =
+                portMalloc(sizeof(struct can_mapping_key[MAX(1, count)]));
+        can_state.extractors =
+                portMalloc(sizeof(struct can_extractor[MAX(1, count)]));
+        if (can_state.mapping_keys == NULL || can_state.extractors == NULL)
+                return false;
+
+        for (size_t i = 0; i < count; i++)
+                canmapping_compile(can_state.extractors + i,
+                                   &cfg->can_channels[i].mapping);
+
+        struct can_mapping_key *keys = can_state.mapping_keys;
+        size_t exact = 0;
+
+        /* Insertion sort is enough, this only runs when the config changes */
+        for (size_t i = 0; i < count; i++) {
+                const CANMapping *mapping = &cfg->can_channels[i].mapping;
+                if (!is_exact_mapping(mapping))
                         continue;
 
-                CAN_set_current_channel_value(i, value);
+                struct can_mapping_key key;
+                set_mapping_key(&key, mapping, i);
+
+                size_t pos = exact++;
+                while (pos > 0 && key_before(&key, keys[pos - 1].can_bus,
+                                             keys[pos - 1].can_id)) {
+                        keys[pos] = keys[pos - 1];
+                        pos--;
+                }
+                keys[pos] = key;
+        }
+
+        size_t masked = exact;
+        for (size_t i = 0; i < count; i++) {
+                const CANMapping *mapping = &cfg->can_channels[i].mapping;
+                if (!is_exact_mapping(mapping))
+                        set_mapping_key(keys + masked++, mapping, i);
+        }
+
+        can_state.exact_mappings = exact;
+        can_state.indexed_mappings = count;
+        return true;
+}
+
+/* Finds the first exact key at or after the bus and ID */
+static size_t find_exact_key(const uint8_t can_bus, const uint32_t can_id)
+{
+        const struct can_mapping_key *keys = can_state.mapping_keys;
+        size_t low = 0;
+        size_t high = can_state.exact_mappings;
+
+        while (low < high) {
+                const size_t mid = low + (high - low) / 2;
+
+                if (key_before(keys + mid, can_bus, can_id))
+                        low = mid + 1;
+                else
+                        high = mid;
+        }
+
+        return low;
+}
+
+static void map_can_channel(CAN_msg *msg, const uint64_t frame,
+                            CANChannelConfig *cfg, const uint16_t index)
+{
+        if (!canmapping_match_id(msg, &cfg->can_channels[index].mapping))
+                return;
+
+        /* map the CAN message to the value */
+        const float value = canmapping_extract(can_state.extractors + index,
+                                               frame);
+        CAN_set_current_channel_value(index, value, msg->timestamp);
+}
+
+void update_can_channels(CAN_msg *msg, CANChannelConfig *cfg, uint16_t enabled_mapping_count)
+{
+        const struct can_mapping_key *keys = can_state.mapping_keys;
+        if (keys == NULL)
+                return;
+
+        const uint8_t can_bus = msg->can_bus;
+        const uint32_t can_id = msg->addressValue;
+        const uint64_t frame = canmapping_frame_bits(msg);
+
+        for (size_t i = find_exact_key(can_bus, can_id);
+             i < can_state.exact_mappings; i++) {
+                const struct can_mapping_key *key = keys + i;
+
+                if (key->can_bus != can_bus || key->can_id != can_id)
+                        break;
+                if (key->mapping < enabled_mapping_count)
+                        map_can_channel(msg, frame, cfg, key->mapping);
+        }
+
+        for (size_t i = can_state.exact_mappings;
+             i < can_state.indexed_mappings; i++) {
+                const struct can_mapping_key *key = keys + i;
+
+                /* only process the mapping for the bus we're handling messages for */
+                if (key->can_bus != can_bus)
+                        continue;
+                if (key->mapping < enabled_mapping_count)
+                        map_can_channel(msg, frame, cfg, key->mapping);
         }
 }
@@ -20,56 +20,86 @@
  */
 #include "can_mapping.h"
 #include "byteswap.h"
-#include "units_conversion.h"
 #include "panic.h"
+#include "stdutil.h"
+#include "units_conversion.h"
+#include <string.h>
 
-float canmapping_extract_value(uint64_t raw_data, const CANMapping *mapping)
+uint64_t canmapping_frame_bits(const CAN_msg *can_msg)
 {
 #if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
-        raw_data = swap_uint64(raw_data);
+        return swap_uint64(can_msg->data64);
+#else
+        return can_msg->data64;
 #endif
+}
 
+void canmapping_compile(struct can_extractor *ex, const CANMapping *mapping)
+{
         uint8_t offset = mapping->offset;
         uint8_t length = mapping->length;
         if (! mapping->bit_mode) {
                 length *= 8;
                 offset *= 8;
         }
-        /* create the bitmask of the appropriate length */
-        uint32_t bitmask = (1UL << length) - 1;
+        length = MIN(length, 32);
+
+        ex->type = mapping->type;
+        ex->mask = length < 32 ? (1UL << length) - 1 : UINT32_MAX;
+        ex->shift = offset + length < 64 ? 64 - offset - length : 0;
 
-        /* extract the raw value from the 64 bit representation of the CAN message */
-        uint32_t raw_value = (raw_data >> (64 - offset - length)) & bitmask;
+        /* little endian values are swapped within the whole bytes they span */
+        const uint8_t bytes_bits = length <= 8 ? 8 : length <= 16 ? 16 :
+                length <= 24 ? 24 : 32;
+        ex->swap = !mapping->big_endian && bytes_bits > 8;
+        ex->swap_shift = 32 - bytes_bits;
+
+        /* signed values take their sign from bit 7, 15 or 31 */
+        ex->sign_shift = bytes_bits == 24 ? 0 : 32 - bytes_bits;
+        ex->sign = length ? 1UL << (length - 1) : 0;
+
+        /* fold the formula and the units conversion into one multiply-add */
+        float units_scale;
+        float units_offset;
+        units_conversion_linear(mapping->conversion_filter_id, &units_scale,
+                                &units_offset);
+
+        float scale = mapping->multiplier;
+        if (mapping->divider)
+                scale /= mapping->divider;
+        ex->scale = scale * units_scale;
+        ex->offset = mapping->adder * units_scale + units_offset;
+}
+
+float canmapping_extract_raw(const struct can_extractor *ex,
+                             const uint64_t frame)
+{
+        uint32_t raw_value = (uint32_t) (frame >> ex->shift) & ex->mask;
 
         /* normalize endian */
-        if (!mapping->big_endian) {
-                raw_value = swap_uint_length(raw_value, length);
-        }
+        if (ex->swap)
+                raw_value = swap_uint32(raw_value) >> ex->swap_shift;
 
         /* convert type */
-        switch (mapping->type) {
+        switch (ex->type) {
         case CANMappingType_unsigned:
-                return (float)raw_value;
+                return (float) raw_value;
         case CANMappingType_signed:
-                if (length <= 8) {
-                        return (float)*((int8_t*)&raw_value);
-                }
-                if (length <= 16) {
-                        return (float)*((int16_t*)&raw_value);
-                }
-                return (float)*((int32_t*)&raw_value);
-        case CANMappingType_IEEE754:
-                return *((float*)&raw_value);
+                return (float) ((int32_t) (raw_value << ex->sign_shift) >>
+                                ex->sign_shift);
+        case CANMappingType_IEEE754: {
+                float value;
+                memcpy(&value, &raw_value, sizeof(value));
+                return value;
+        }
         case CANMappingType_sign_magnitude:
                 /**
                  *  sign-magnitude is used in cases where there's a sign bit
                  *  and an absolute value indicating magnitude.
                  *  e.g. BMW E46 steering angle sensor
                  **/
-        {
-                uint32_t sign = 1 << (length - 1);
-                return raw_value < sign ? (float)raw_value : -(float)(raw_value & (sign - 1));
-        }
+                return raw_value < ex->sign ? (float) raw_value :
+                        -(float) (raw_value & (ex->sign - 1));
         default:
                 /* We reached an invalid enum */
                 panic(PANIC_CAUSE_UNREACHABLE);
@@ -77,6 +107,22 @@ float canmapping_extract_value(uint64_t raw_data, const CANMapping *mapping)
         }
 }
 
+float canmapping_extract(const struct can_extractor *ex, const uint64_t frame)
+{
+        return canmapping_extract_raw(ex, frame) * ex->scale + ex->offset;
+}
+
+float canmapping_extract_value(uint64_t raw_data, const CANMapping *mapping)
+{
+        struct can_extractor ex;
+        canmapping_compile(&ex, mapping);
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        raw_data = swap_uint64(raw_data);
+#endif
+        return canmapping_extract_raw(&ex, raw_data);
+}
+
 float canmapping_apply_formula(float value, const CANMapping *mapping)
 {
         value *= mapping->multiplier;
@@ -108,9 +154,8 @@ bool canmapping_map_value(float *value, const CAN_msg *can_msg, const CANMapping
         if (! canmapping_match_id(can_msg, mapping))
                 return false;
 
-        uint64_t raw_data = can_msg->data64;
-        *value = canmapping_extract_value(raw_data, mapping);
-        *value = canmapping_apply_formula(*value, mapping);
-        *value = convert_units(mapping->conversion_filter_id, *value);
+        struct can_extractor ex;
+        canmapping_compile(&ex, mapping);
+        *value = canmapping_extract(&ex, canmapping_frame_bits(can_msg));
         return true;
 }
@@ -37,3 +37,8 @@ const char * cpu_get_serialnumber(void)
 {
         return cpu_device_get_serialnumber();
 }
+
+uint32_t cpu_get_usec(void)
+{
+        return cpu_device_get_usec();
+}
@@ -58,6 +58,13 @@ struct shiftx_configuration * shiftx_get_config(void)
         return &shiftx_config;
 }
 
+size_t shiftx_get_rx_ids(uint32_t *ids)
+{
+        ids[0] = shiftx_config.base_address + ANNOUNCEMENT_OFFSET;
+        ids[1] = shiftx_config.base_address + NOTIFICATION_BUTTON_STATE_OFFSET;
+        return SHIFTX_RX_IDS;
+}
+
 void shiftx_handle_can_rx_msg(const CAN_msg *msg)
 {
         if (msg == NULL) return;
@@ -0,0 +1,164 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fft.h"
+#include <math.h>
+#include <stdbool.h>
+
+#define Q15_ONE		(1 << 15)
+#define Q15_MAX		(Q15_ONE - 1)
+#define PI		3.14159265f
+
+static struct {
+        bool ready;
+        int16_t cos[FFT_BINS];
+        int16_t sin[FFT_BINS];
+        int16_t window[FFT_POINTS];
+} tables;
+
+static int16_t to_q15(const float value)
+{
+        const int32_t q = (int32_t) roundf(value * Q15_ONE);
+
+        return q > Q15_MAX ? Q15_MAX : q;
+}
+
+void fft_init(void)
+{
+        if (tables.ready)
+                return;
+
+        for (size_t i = 0; i < FFT_BINS; ++i) {
+                const float angle = 2 * PI * i / FFT_POINTS;
+                tables.cos[i] = to_q15(cosf(angle));
+                tables.sin[i] = to_q15(sinf(angle));
+        }
+
+        for (size_t i = 0; i < FFT_POINTS; ++i)
+                tables.window[i] = to_q15(0.5f - 0.5f *
+                                          cosf(2 * PI * i / FFT_POINTS));
+
+        tables.ready = true;
+}
+
+void fft_load(struct fft_block *b, const int32_t *samples)
+{
+        int64_t sum = 0;
+        for (size_t i = 0; i < FFT_POINTS; ++i)
+                sum += samples[i];
+
+        const int32_t mean = sum / FFT_POINTS;
+        uint32_t peak = 0;
+        for (size_t i = 0; i < FFT_POINTS; ++i) {
+                const int32_t dev = samples[i] - mean;
+                const uint32_t mag = dev < 0 ? -dev : dev;
+                if (mag > peak)
+                        peak = mag;
+        }
+
+        /* Use as many of the input bits as the peak allows */
+        int shift = 0;
+        if (peak) {
+                while ((peak << shift) < (1u << (FFT_INPUT_BITS - 1)))
+                        ++shift;
+                while ((peak >> -shift) >= (1u << FFT_INPUT_BITS))
+                        --shift;
+        }
+        b->shift = shift;
+
+        for (size_t i = 0; i < FFT_POINTS; ++i) {
+                const int32_t dev = samples[i] - mean;
+                const int32_t x = shift >= 0 ? dev * (1 << shift) : dev >> -shift;
+
+                b->re[i] = (x * tables.window[i]) >> 15;
+                b->im[i] = 0;
+        }
+}
+
+static size_t reverse_bits(size_t i)
+{
+        size_t r = 0;
+
+        for (size_t bit = 0; bit < FFT_LOG2_POINTS; ++bit, i >>= 1)
+                r = (r << 1) | (i & 1);
+
+        return r;
+}
+
+void fft_transform(struct fft_block *b)
+{
+        for (size_t i = 0; i < FFT_POINTS; ++i) {
+                const size_t j = reverse_bits(i);
+                if (j <= i)
+                        continue;
+
+                const int16_t re = b->re[i];
+                b->re[i] = b->re[j];
+                b->re[j] = re;
+        }
+
+        for (size_t len = 2; len <= FFT_POINTS; len <<= 1) {
+                const size_t half = len / 2;
+                const size_t step = FFT_POINTS / len;
+
+                for (size_t i = 0; i < FFT_POINTS; i += len) {
+                        for (size_t j = 0; j < half; ++j) {
+                                const int32_t wr = tables.cos[j * step];
+                                const int32_t wi = -tables.sin[j * step];
+                                int16_t *ur = b->re + i + j;
+                                int16_t *ui = b->im + i + j;
+                                int16_t *vr = ur + half;
+                                int16_t *vi = ui + half;
+
+                                const int32_t tr = (wr * *vr - wi * *vi) >> 15;
+                                const int32_t ti = (wr * *vi + wi * *vr) >> 15;
+
+                                *vr = (*ur - tr) >> 1;
+                                *vi = (*ui - ti) >> 1;
+                                *ur = (*ur + tr) >> 1;
+                                *ui = (*ui + ti) >> 1;
+                        }
+                }
+        }
+}
+
+uint32_t fft_bin_power(const struct fft_block *b, const size_t bin)
+{
+        const int32_t re = b->re[bin];
+        const int32_t im = b->im[bin];
+
+        return re * re + im * im;
+}
+
+float fft_band_power(const struct fft_block *b, size_t first, size_t last)
+{
+        if (first < 1)
+                first = 1;
+        if (last > FFT_BINS - 1)
+                last = FFT_BINS - 1;
+
+        uint64_t power = 0;
+        for (size_t bin = first; bin <= last; ++bin)
+                power += fft_bin_power(b, bin);
+
+        /* Fold in the negative frequencies and undo the window and shift */
+        return 2.0f * power / FFT_WINDOW_POWER / ldexpf(1, 2 * b->shift);
+}
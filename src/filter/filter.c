@@ -23,24 +23,150 @@
 #include "filter.h"
 #include "math.h"
 
-//Implements a fast Exponential Moving Average filter
-#define MIN_ALPHA 0.0001
-void init_filter(Filter *filter, const float alpha)
+#define MIN_ALPHA	0.0001f
+#define Q15_ONE		(1 << 15)
+#define BIQUAD_ONE	(1 << FILTER_BIQUAD_SHIFT)
+#define BUTTERWORTH_Q	0.70710678f
+#define PI		3.14159265f
+
+static int32_t clamp_input(const int32_t value)
 {
-        filter->max_samples = (1 / fmaxf(alpha, MIN_ALPHA));
+        if (value > FILTER_INPUT_MAX)
+                return FILTER_INPUT_MAX;
+        if (value < -FILTER_INPUT_MAX)
+                return -FILTER_INPUT_MAX;
+        return value;
+}
+
+static int32_t to_biquad_coef(const float value)
+{
+        return (int32_t) roundf(value * BIQUAD_ONE);
+}
+
+float filter_cutoff_to_alpha(const float cutoff_hz, const float update_hz)
+{
+        if (cutoff_hz <= 0 || update_hz <= 0)
+                return 1;
+
+        return 1 - expf(-2 * PI * cutoff_hz / update_hz);
+}
+
+void reset_filter(Filter *filter)
+{
+        filter->primed = false;
         filter->current_value = 0;
-        filter->total = 0;
-        filter->count = 0;
 }
 
-int32_t update_filter(Filter *filter, const int32_t value)
+void init_filter(Filter *filter, const float alpha)
+{
+        const float a = fminf(fmaxf(alpha, MIN_ALPHA), 1);
+
+        filter->type = FILTER_TYPE_EMA;
+        filter->ema.alpha = (int32_t) roundf(a * Q15_ONE);
+        filter->ema.state = 0;
+        reset_filter(filter);
+}
+
+void init_ema_filter(Filter *filter, const float cutoff_hz,
+                     const float update_hz)
+{
+        init_filter(filter, filter_cutoff_to_alpha(cutoff_hz, update_hz));
+}
+
+void init_biquad_filter(Filter *filter, const float cutoff_hz,
+                        const float update_hz)
+{
+        if (cutoff_hz <= 0 || cutoff_hz >= update_hz / 2) {
+                init_filter(filter, 1);
+                return;
+        }
+
+        /* Low pass section from the Audio EQ Cookbook */
+        const float w0 = 2 * PI * cutoff_hz / update_hz;
+        const float cos_w0 = cosf(w0);
+        const float alpha = sinf(w0) / (2 * BUTTERWORTH_Q);
+        const float a0 = 1 + alpha;
+        struct biquad_filter *bq = &filter->biquad;
+
+        filter->type = FILTER_TYPE_BIQUAD;
+        bq->b0 = to_biquad_coef((1 - cos_w0) / 2 / a0);
+        bq->b1 = to_biquad_coef((1 - cos_w0) / a0);
+        bq->b2 = bq->b0;
+        bq->a1 = to_biquad_coef(-2 * cos_w0 / a0);
+        bq->a2 = to_biquad_coef((1 - alpha) / a0);
+        reset_filter(filter);
+}
+
+static int32_t update_ema(Filter *filter, const int32_t value)
 {
-        filter->total += value;
-        if (filter->count >= filter->max_samples) {
-                filter->total -= filter->current_value;
-        } else {
-                filter->count++;
+        struct ema_filter *ema = &filter->ema;
+        const int64_t target = (int64_t) value << FILTER_EMA_SHIFT;
+
+        if (!filter->primed) {
+                ema->state = target;
+                filter->primed = true;
+                return value;
         }
-        filter->current_value = filter->total / filter->count;
+
+        ema->state += ((target - ema->state) * ema->alpha) >> 15;
+        return (int32_t) ((ema->state + (1 << (FILTER_EMA_SHIFT - 1))) >>
+                          FILTER_EMA_SHIFT);
+}
+
+static int32_t update_biquad(Filter *filter, const int32_t value)
+{
+        struct biquad_filter *bq = &filter->biquad;
+
+        if (!filter->primed) {
+                bq->x1 = bq->x2 = value;
+                bq->y1 = bq->y2 = value;
+                bq->error = 0;
+                filter->primed = true;
+                return value;
+        }
+
+        const int64_t acc = (int64_t) bq->b0 * value +
+                (int64_t) bq->b1 * bq->x1 +
+                (int64_t) bq->b2 * bq->x2 -
+                (int64_t) bq->a1 * bq->y1 -
+                (int64_t) bq->a2 * bq->y2 +
+                bq->error;
+        const int32_t y = (int32_t) (acc >> FILTER_BIQUAD_SHIFT);
+
+        bq->error = acc - ((int64_t) y << FILTER_BIQUAD_SHIFT);
+        bq->x2 = bq->x1;
+        bq->x1 = value;
+        bq->y2 = bq->y1;
+        bq->y1 = y;
+
+        return y;
+}
+
+static inline int32_t update_one(Filter *filter, const int32_t value)
+{
+        const int32_t v = clamp_input(value);
+
+        switch (filter->type) {
+        case FILTER_TYPE_BIQUAD:
+                filter->current_value = update_biquad(filter, v);
+                break;
+        case FILTER_TYPE_EMA:
+        default:
+                filter->current_value = update_ema(filter, v);
+                break;
+        }
+
         return filter->current_value;
 }
+
+int32_t update_filter(Filter *filter, const int32_t value)
+{
+        return update_one(filter, value);
+}
+
+void update_filters(Filter *filters, const int32_t *values,
+                    const size_t count)
+{
+        for (size_t i = 0; i < count; ++i)
+                update_one(filters + i, values[i]);
+}
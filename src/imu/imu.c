@@ -20,6 +20,7 @@
  */
 
 
+#include "channel_pipeline.h"
 #include "imu.h"
 #include "imu_device.h"
 #include "loggerConfig.h"
@@ -27,6 +28,60 @@
 #include "stddef.h"
 #include "printk.h"
 #include "capabilities.h"
+#include "macros.h"
+#include "spectral.h"
+#include "taskUtil.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/*
+ * Filter alphas are configured for updates at the default background
+ * rate.  The filters now see every device reading instead, so the alpha
+ * is rescaled to keep the same time constant.
+ */
+#define IMU_FILTER_REFERENCE_HZ	50
+
+/* Readings drained from the device per batch */
+#define IMU_SAMPLE_BURST	16
+
+/* Calibration averages the device readings over this window */
+#define IMU_CALIBRATION_MS	1000
+/* How often to look for new readings while calibrating */
+#define IMU_CALIBRATION_POLL_MS	10
+
+/* Fraction bits of the mounting rotation, so 1.0 is 1 << 14 */
+#define IMU_ROTATION_SHIFT	14
+#define IMU_ROTATION_ONE	(1 << IMU_ROTATION_SHIFT)
+
+/* The axes of each sensor as x, y and z of a right handed frame */
+static const enum imu_channel imu_accel_axes[3] = {
+        IMU_CHANNEL_X, IMU_CHANNEL_Y, IMU_CHANNEL_Z,
+};
+static const enum imu_channel imu_gyro_axes[3] = {
+        IMU_CHANNEL_ROLL, IMU_CHANNEL_PITCH, IMU_CHANNEL_YAW,
+};
+
+/*
+ * Rotation from the unit frame into the vehicle frame, compiled from the
+ * mounting config.  Both sensors share it.
+ */
+static struct {
+        bool identity;
+        int32_t m[3][3];
+} g_imu_rotation = {
+        true,
+        {
+                {IMU_ROTATION_ONE, 0, 0},
+                {0, IMU_ROTATION_ONE, 0},
+                {0, 0, IMU_ROTATION_ONE},
+        },
+};
+
 //Channel Filters
 #if IMU_CHANNELS > 0
 #define IMU_INITIALIZER {0}
@@ -34,65 +89,260 @@
 #define IMU_INITIALIZER {}
 #endif
 
+/* Set while calibration takes the device readings for itself */
+static volatile bool g_imu_calibrating;
+
 static Filter g_imu_filter[CONFIG_IMU_CHANNELS] = IMU_INITIALIZER;
+/* Scaling of each logical channel, compiled from the working config */
+static struct channel_scaling g_imu_scaling[CONFIG_IMU_CHANNELS] =
+        IMU_INITIALIZER;
+
+static float device_rate_alpha(const float alpha)
+{
+        const float updates = imu_device_sample_rate() /
+                IMU_FILTER_REFERENCE_HZ;
+
+        if (alpha <= 0 || alpha >= 1 || updates <= 1)
+                return alpha;
+
+        return 1 - powf(1 - alpha, 1 / updates);
+}
 
 static void init_filters(LoggerConfig *loggerConfig)
 {
 #if IMU_CHANNELS > 0
         ImuConfig *config  = loggerConfig->ImuConfigs;
         for (size_t i = 0; i < CONFIG_IMU_CHANNELS; i++) {
-                float alpha = (config + i)->filterAlpha;
+                float alpha = device_rate_alpha((config + i)->filterAlpha);
                 init_filter(&g_imu_filter[i], alpha);
         }
 #endif
 }
 
-void imu_sample_all()
+static float to_radians(const float degrees)
 {
-        for (size_t i = 0; i < CONFIG_IMU_CHANNELS; i++) {
-                update_filter(&g_imu_filter[i], imu_read(i));
+        return degrees * ((float) M_PI / 180.0f);
+}
+
+static float to_degrees(const float radians)
+{
+        return radians * (180.0f / (float) M_PI);
+}
+
+/**
+ * Builds R = Rz(yaw) * Ry(pitch) * Rx(roll) in fixed point.  The unit
+ * reads R^T of a vehicle frame vector, so R turns it back.
+ */
+static void compile_imu_rotation(const struct imu_mounting *mounting)
+{
+        const float sr = sinf(to_radians(mounting->roll));
+        const float cr = cosf(to_radians(mounting->roll));
+        const float sp = sinf(to_radians(mounting->pitch));
+        const float cp = cosf(to_radians(mounting->pitch));
+        const float sy = sinf(to_radians(mounting->yaw));
+        const float cy = cosf(to_radians(mounting->yaw));
+        const float r[3][3] = {
+                {cy * cp, cy * sp * sr - sy * cr, cy * sp * cr + sy * sr},
+                {sy * cp, sy * sp * sr + cy * cr, sy * sp * cr - cy * sr},
+                {-sp, cp * sr, cp * cr},
+        };
+
+        g_imu_rotation.identity = true;
+        for (size_t row = 0; row < 3; row++) {
+                for (size_t col = 0; col < 3; col++) {
+                        const int32_t v = (int32_t)
+                                lroundf(r[row][col] * IMU_ROTATION_ONE);
+                        const int32_t unit = row == col ?
+                                IMU_ROTATION_ONE : 0;
+
+                        g_imu_rotation.m[row][col] = v;
+                        if (v != unit)
+                                g_imu_rotation.identity = false;
+                }
         }
 }
 
-float imu_read_value(enum imu_channel channel, ImuConfig *ac)
+static void rotate_axes(int32_t *axis, const enum imu_channel *axes)
 {
-        const size_t physicalChannel = ac->physicalChannel;
-        const int raw = g_imu_filter[physicalChannel].current_value;
-        const int zeroValue = ac->zeroValue;
-        const float countsPerUnit = imu_device_counts_per_unit(channel);
-        float scaledValue = ((float) (raw - zeroValue)) / countsPerUnit;
+        const int64_t x = axis[axes[0]];
+        const int64_t y = axis[axes[1]];
+        const int64_t z = axis[axes[2]];
+
+        for (size_t row = 0; row < 3; row++) {
+                const int32_t *m = g_imu_rotation.m[row];
+                const int64_t v = m[0] * x + m[1] * y + m[2] * z;
+
+                axis[axes[row]] = (int32_t)
+                        ((v + IMU_ROTATION_ONE / 2) >> IMU_ROTATION_SHIFT);
+        }
+}
+
+/**
+ * Turns a reading into the vehicle frame.  Counts per unit are the same on
+ * every axis of a sensor, so the raw counts can be rotated directly.
+ */
+static void rotate_sample(struct imu_sample *sample)
+{
+        if (g_imu_rotation.identity)
+                return;
+
+        rotate_axes(sample->axis, imu_accel_axes);
+        rotate_axes(sample->axis, imu_gyro_axes);
+}
+
+/**
+ * Runs every reading the device produced since the last call through the
+ * mounting rotation, the channel filters and the spectral analysis, so
+ * they all advance at the device rate no matter how often this is called.
+ */
+void imu_sample_all()
+{
+#if IMU_CHANNELS > 0
+        struct imu_sample samples[IMU_SAMPLE_BURST];
+        size_t count;
+
+        if (g_imu_calibrating)
+                return;
 
-        if (channel == IMU_CHANNEL_Z) {
-                scaledValue = scaledValue - 1.0f;
+        while ((count = imu_device_read_samples(samples,
+                                                ARRAY_LEN(samples)))) {
+                for (size_t s = 0; s < count; s++) {
+                        rotate_sample(samples + s);
+                        update_filters(g_imu_filter, samples[s].axis,
+                                       CONFIG_IMU_CHANNELS);
+                        spectral_add_imu_reading(samples[s].axis);
+                }
         }
+#endif
+}
+
+/**
+ * Folds the zero point, the device counts per unit, the gravity offset of
+ * the Z axis and the channel mode into a linear scaling.
+ */
+static void compile_imu_scaling(struct channel_scaling *s,
+                                const enum imu_channel channel,
+                                const ImuConfig *ac)
+{
+        const float units_per_count =
+                1.0f / imu_device_counts_per_unit(channel);
+        const float offset = channel == IMU_CHANNEL_Z ? -1.0f : 0;
+
+        s->op = CHANNEL_SCALING_LINEAR;
+        s->bias = ac->zeroValue;
 
-        /* now alter based on configuration */
         switch (ac->mode) {
         case IMU_MODE_NORMAL:
-                return scaledValue;
+                s->multiplier = units_per_count;
+                s->offset = offset;
+                break;
         case IMU_MODE_INVERTED:
-                return -scaledValue;
+                s->multiplier = -units_per_count;
+                s->offset = -offset;
+                break;
         case IMU_MODE_DISABLED:
         default:
-                return 0;
+                s->multiplier = 0;
+                s->offset = 0;
+                break;
         }
 }
 
-static void imu_flush_filter(size_t physicalChannel)
+static void compile_imu_scalings(LoggerConfig *loggerConfig)
+{
+        for (size_t i = 0; i < CONFIG_IMU_CHANNELS; i++)
+                compile_imu_scaling(g_imu_scaling + i, i,
+                                    loggerConfig->ImuConfigs + i);
+}
+
+float imu_read_value(enum imu_channel channel, ImuConfig *ac)
+{
+        struct channel_scaling s;
+        compile_imu_scaling(&s, channel, ac);
+
+        return channel_scaling_apply(
+                &s, g_imu_filter[ac->physicalChannel].current_value);
+}
+
+float imu_read_scaled(const size_t channel)
+{
+        const ImuConfig *ac = getImuConfigChannel(channel);
+
+        return channel_scaling_apply(
+                g_imu_scaling + channel,
+                g_imu_filter[ac->physicalChannel].current_value);
+}
+
+bool imu_get_pipeline(const size_t channel, struct channel_pipeline *p)
+{
+        const ImuConfig *ac = getImuConfigChannel(channel);
+
+        p->raw = &g_imu_filter[ac->physicalChannel].current_value;
+        p->scaling = g_imu_scaling + channel;
+        return true;
+}
+
+/**
+ * Averages the distinct readings the device produces over the calibration
+ * window, in the unit frame.  The sampler is held off meanwhile so that
+ * it does not drain the readings first.
+ * @return false if the device produced no readings.
+ */
+static bool average_readings(struct imu_sample *avg)
 {
-        for (size_t i = 0; i < 1000; i++) {
-                update_filter(&g_imu_filter[physicalChannel], imu_read(physicalChannel));
+        const size_t wanted = imu_device_sample_rate() *
+                IMU_CALIBRATION_MS / 1000;
+        /* Give a slow device twice the window before giving up */
+        size_t polls = 2 * IMU_CALIBRATION_MS / IMU_CALIBRATION_POLL_MS;
+        struct imu_sample samples[IMU_SAMPLE_BURST];
+        int64_t sum[IMU_DEVICE_AXES] = {0};
+        size_t readings = 0;
 
+        g_imu_calibrating = true;
+        while (readings < wanted && polls) {
+                const size_t count = imu_device_read_samples(
+                        samples, MIN(ARRAY_LEN(samples), wanted - readings));
+                if (!count) {
+                        delayMs(IMU_CALIBRATION_POLL_MS);
+                        --polls;
+                        continue;
+                }
+
+                for (size_t s = 0; s < count; s++)
+                        for (size_t a = 0; a < IMU_DEVICE_AXES; a++)
+                                sum[a] += samples[s].axis[a];
+
+                readings += count;
         }
+        g_imu_calibrating = false;
+
+        if (!readings) {
+                pr_warning("[imu] No readings to calibrate with\r\n");
+                return false;
+        }
+
+        const int64_t half = readings / 2;
+        for (size_t a = 0; a < IMU_DEVICE_AXES; a++)
+                avg->axis[a] = (sum[a] < 0 ? sum[a] - half : sum[a] + half) /
+                        (int64_t) readings;
+
+        return true;
 }
 
-void imu_calibrate_zero()
+/**
+ * Zeroes the channels at the average reading, and restarts the filters
+ * from it since the readings they missed went to the average.
+ */
+static void calibrate_zero(struct imu_sample *avg)
 {
+        LoggerConfig *lc = getWorkingLoggerConfig();
+
+        rotate_sample(avg);
+
         for (size_t logicalChannel = 0; logicalChannel < CONFIG_IMU_CHANNELS; logicalChannel++) {
                 ImuConfig * c = getImuConfigChannel(logicalChannel);
                 size_t physicalChannel = c->physicalChannel;
-                imu_flush_filter(physicalChannel);
-                int zeroValue = g_imu_filter[physicalChannel].current_value;
+                int zeroValue = avg->axis[physicalChannel];
                 float countsPerUnit = imu_device_counts_per_unit(physicalChannel);
                 if (logicalChannel == IMU_CHANNEL_Z) { //adjust for gravity
                         if (c->mode == IMU_MODE_INVERTED) {
@@ -102,20 +352,59 @@ void imu_calibrate_zero()
                 }
                 c->zeroValue = zeroValue;
         }
+
+        init_filters(lc);
+        update_filters(g_imu_filter, avg->axis, CONFIG_IMU_CHANNELS);
+        compile_imu_scalings(lc);
 }
 
+void imu_calibrate_zero()
+{
+        struct imu_sample avg;
+
+        if (average_readings(&avg))
+                calibrate_zero(&avg);
+}
+
+void imu_calibrate_mounting()
+{
+        struct imu_mounting *mounting =
+                &getWorkingLoggerConfig()->imu_mounting;
+        struct imu_sample avg;
+
+        if (!average_readings(&avg))
+                return;
+
+        const float g[3] = {
+                avg.axis[imu_accel_axes[0]],
+                avg.axis[imu_accel_axes[1]],
+                avg.axis[imu_accel_axes[2]],
+        };
+
+        /* At rest the unit reads R^T (0, 0, 1g), the last row of R */
+        mounting->roll = to_degrees(atan2f(g[1], g[2]));
+        mounting->pitch = to_degrees(atan2f(-g[0], sqrtf(g[1] * g[1] +
+                                                         g[2] * g[2])));
+        compile_imu_rotation(mounting);
+
+        calibrate_zero(&avg);
+}
 
 int imu_init(LoggerConfig *loggerConfig)
 {
         /* TODO BAP: IMU is unhappy */
         imu_device_init();
         init_filters(loggerConfig);
+        compile_imu_rotation(&loggerConfig->imu_mounting);
+        compile_imu_scalings(loggerConfig);
         return 1;
 }
 
 int imu_soft_init(LoggerConfig *loggerConfig)
 {
         init_filters(loggerConfig);
+        compile_imu_rotation(&loggerConfig->imu_mounting);
+        compile_imu_scalings(loggerConfig);
         return 1;
 }
 
@@ -0,0 +1,85 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "imu_sample_ring.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/* Keeps the compiler from moving memory accesses across this point */
+#define compiler_barrier()	__asm__ volatile("" ::: "memory")
+
+void imu_sample_ring_reset(struct imu_sample_ring *ring)
+{
+        ring->tail = ring->head;
+}
+
+void imu_sample_ring_push(struct imu_sample_ring *ring,
+                          const struct imu_sample *sample)
+{
+        ring->samples[ring->head % IMU_SAMPLE_RING_SIZE] = *sample;
+
+        /* The sampler must never see the new head before the sample */
+        compiler_barrier();
+        ++ring->head;
+}
+
+const struct imu_sample* imu_sample_ring_newest(
+        const struct imu_sample_ring *ring)
+{
+        const uint32_t head = ring->head;
+        if (!head)
+                return NULL;
+
+        return ring->samples + (head - 1) % IMU_SAMPLE_RING_SIZE;
+}
+
+/*
+ * Same scheme as the logger message ring: a copy is only trusted if the
+ * producer could not have started overwriting it, which it does once head
+ * reaches tail + IMU_SAMPLE_RING_SIZE.
+ */
+size_t imu_sample_ring_read(struct imu_sample_ring *ring,
+                            struct imu_sample *samples, const size_t max)
+{
+        size_t count = 0;
+
+        while (count < max) {
+                const uint32_t head = ring->head;
+                if (ring->tail == head)
+                        break;
+
+                if (head - ring->tail >= IMU_SAMPLE_RING_SIZE)
+                        ring->tail = head - IMU_SAMPLE_RING_SIZE + 1;
+
+                compiler_barrier();
+                samples[count] = ring->samples[ring->tail %
+                                               IMU_SAMPLE_RING_SIZE];
+                compiler_barrier();
+
+                if (ring->head - ring->tail >= IMU_SAMPLE_RING_SIZE)
+                        continue;
+
+                ++ring->tail;
+                ++count;
+        }
+
+        return count;
+}
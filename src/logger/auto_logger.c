@@ -46,6 +46,7 @@
 static struct {
         struct auto_logger_config *cfg;
         struct auto_control_state control_state;
+        struct channel_handle channel;
 } auto_logger_state;
 
 void auto_logger_reset_config(struct auto_logger_config* cfg)
@@ -85,7 +86,9 @@ static void auto_logger_sample_cb(const struct sample* sample,
 
         double value;
         char * units;
-        if (!get_sample_value_by_name(sample, auto_logger_state.cfg->channel, &value, &units))
+        if (!get_sample_value_by_cached_name(sample, auto_logger_state.cfg->channel,
+                                             &auto_logger_state.channel,
+                                             &value, &units))
                 return;
 
         enum auto_control_trigger_result res = auto_control_check_trigger(value,
@@ -0,0 +1,239 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "binary_log.h"
+#include "high_rate_lane.h"
+#include "loggerConfig.h"
+#include "sampleRecord.h"
+#include <stdint.h>
+#include <string.h>
+
+enum binary_log_type binary_log_get_type(const ChannelSample *cs)
+{
+        switch(cs->sampleData) {
+        case SampleData_LongLong:
+        case SampleData_LongLong_Noarg:
+                return BINARY_LOG_TYPE_INT64;
+        case SampleData_Float:
+        case SampleData_Float_Noarg:
+                return BINARY_LOG_TYPE_FLOAT;
+        case SampleData_Double:
+        case SampleData_Double_Noarg:
+                return BINARY_LOG_TYPE_DOUBLE;
+        case SampleData_Int:
+        case SampleData_Int_Noarg:
+        default:
+                return BINARY_LOG_TYPE_INT32;
+        }
+}
+
+size_t binary_log_type_size(const enum binary_log_type type)
+{
+        switch(type) {
+        case BINARY_LOG_TYPE_INT64:
+        case BINARY_LOG_TYPE_DOUBLE:
+                return 8;
+        case BINARY_LOG_TYPE_INT32:
+        case BINARY_LOG_TYPE_FLOAT:
+        default:
+                return 4;
+        }
+}
+
+static int write_channel_descriptor(const ChannelSample *cs,
+                                    binary_log_write_t *write)
+{
+        const ChannelConfig *cfg = cs->cfg;
+        const uint8_t type = (uint8_t) binary_log_get_type(cs);
+        const uint16_t rate = (uint16_t) decodeSampleRate(cfg->sampleRate);
+        int rc = 0;
+
+        rc = rc ? rc : write(&type, sizeof(type));
+        rc = rc ? rc : write(&cfg->precision, sizeof(cfg->precision));
+        rc = rc ? rc : write(&rate, sizeof(rate));
+        rc = rc ? rc : write(&cfg->min, sizeof(cfg->min));
+        rc = rc ? rc : write(&cfg->max, sizeof(cfg->max));
+        rc = rc ? rc : write(cfg->label, strlen(cfg->label) + 1);
+        rc = rc ? rc : write(cfg->units, strlen(cfg->units) + 1);
+
+        return rc;
+}
+
+static int write_lane_channel(const struct high_rate_lane_channel *ch,
+                              binary_log_write_t *write)
+{
+        const struct channel_scaling *scaling = ch->scaling;
+        int rc = 0;
+
+        rc = rc ? rc : write(&scaling->bias, sizeof(scaling->bias));
+        rc = rc ? rc : write(&scaling->multiplier,
+                             sizeof(scaling->multiplier));
+        rc = rc ? rc : write(&scaling->offset, sizeof(scaling->offset));
+        rc = rc ? rc : write(ch->cfg->label, strlen(ch->cfg->label) + 1);
+        rc = rc ? rc : write(ch->cfg->units, strlen(ch->cfg->units) + 1);
+
+        return rc;
+}
+
+static int write_lane_record(binary_log_write_t *write)
+{
+        const struct high_rate_lane_channel *channels;
+        const uint8_t count = high_rate_lane_get_channels(&channels);
+        const uint8_t record = BINARY_LOG_RECORD_LANE;
+        const uint32_t rate = high_rate_lane_get_rate();
+        int rc = 0;
+
+        if (!count)
+                return 0;
+
+        rc = rc ? rc : write(&record, sizeof(record));
+        rc = rc ? rc : write(&rate, sizeof(rate));
+        rc = rc ? rc : write(&count, sizeof(count));
+
+        for (size_t i = 0; i < count && !rc; ++i)
+                rc = write_lane_channel(channels + i, write);
+
+        return rc;
+}
+
+int binary_log_write_header(const struct sample *s,
+                            binary_log_write_t *write)
+{
+        const uint8_t version = BINARY_LOG_VERSION;
+        const uint16_t count = (uint16_t) s->channel_count;
+        int rc = 0;
+
+        rc = rc ? rc : write(BINARY_LOG_MAGIC, BINARY_LOG_MAGIC_LEN);
+        rc = rc ? rc : write(&version, sizeof(version));
+        rc = rc ? rc : write(&count, sizeof(count));
+
+        const ChannelSample *cs = s->channel_samples;
+        for (size_t i = 0; i < s->channel_count && !rc; ++i, ++cs)
+                rc = write_channel_descriptor(cs, write);
+
+        return rc ? rc : write_lane_record(write);
+}
+
+static int write_populated_bitmap(const struct sample *s,
+                                  binary_log_write_t *write)
+{
+        uint8_t bits = 0;
+        int rc = 0;
+        size_t i;
+
+        for (i = 0; i < s->channel_count && !rc; ++i) {
+                if (sample_is_populated(s, i))
+                        bits |= 1 << (i % 8);
+
+                if (7 == i % 8) {
+                        rc = write(&bits, sizeof(bits));
+                        bits = 0;
+                }
+        }
+
+        /* Write out the trailing partial byte, if any */
+        if (!rc && i % 8)
+                rc = write(&bits, sizeof(bits));
+
+        return rc;
+}
+
+static int write_value(const struct sample *s, const size_t index,
+                       binary_log_write_t *write)
+{
+        const ChannelSample *cs = s->channel_samples + index;
+        int32_t int_val;
+        int64_t longlong_val;
+        float float_val;
+        double double_val;
+
+        switch(binary_log_get_type(cs)) {
+        case BINARY_LOG_TYPE_INT64:
+                longlong_val = sample_get_longlong(s, index);
+                return write(&longlong_val, sizeof(longlong_val));
+        case BINARY_LOG_TYPE_FLOAT:
+                float_val = sample_get_float(s, index);
+                return write(&float_val, sizeof(float_val));
+        case BINARY_LOG_TYPE_DOUBLE:
+                double_val = sample_get_double(s, index);
+                return write(&double_val, sizeof(double_val));
+        case BINARY_LOG_TYPE_INT32:
+        default:
+                int_val = sample_get_int(s, index);
+                return write(&int_val, sizeof(int_val));
+        }
+}
+
+int binary_log_write_sample(const struct sample *s,
+                            binary_log_write_t *write)
+{
+        const uint8_t record = BINARY_LOG_RECORD_SAMPLE;
+        const uint32_t ticks = (uint32_t) s->ticks;
+        int rc = 0;
+
+        rc = rc ? rc : write(&record, sizeof(record));
+        rc = rc ? rc : write(&ticks, sizeof(ticks));
+        rc = rc ? rc : write_populated_bitmap(s, write);
+
+        for (size_t i = 0; i < s->channel_count && !rc; ++i) {
+                if (sample_is_populated(s, i))
+                        rc = write_value(s, i, write);
+        }
+
+        return rc;
+}
+
+int binary_log_write_high_rate(const struct sample *s, uint32_t *cursor,
+                               uint32_t *skipped, binary_log_write_t *write)
+{
+        const struct high_rate_lane_channel *channels;
+        const size_t count = high_rate_lane_get_channels(&channels);
+        const uint8_t record = BINARY_LOG_RECORD_BLOCK;
+        const uint32_t ticks = (uint32_t) s->ticks;
+        struct high_rate_block block;
+        int rc = 0;
+
+        if (!count) {
+                *cursor = s->high_rate_seq;
+                return 0;
+        }
+
+        uint32_t expected = *cursor;
+        while (!rc && high_rate_lane_read_block(cursor, s->high_rate_seq,
+                                                &block)) {
+                *skipped += block.seq - expected;
+                expected = *cursor;
+
+                rc = rc ? rc : write(&record, sizeof(record));
+                rc = rc ? rc : write(&ticks, sizeof(ticks));
+                rc = rc ? rc : write(&block.seq, sizeof(block.seq));
+                rc = rc ? rc : write(&block.scans, sizeof(block.scans));
+
+                for (size_t i = 0; i < block.scans && !rc; ++i)
+                        rc = write(block.values[i],
+                                   count * sizeof(block.values[i][0]));
+        }
+
+        /* The cursor may skip ahead without a block left to read */
+        *skipped += *cursor - expected;
+
+        return rc;
+}
@@ -36,6 +36,7 @@
 static struct {
         struct camera_control_config *cfg;
         struct auto_control_state control_state;
+        struct channel_handle channel;
 } camera_control_state;
 
 void camera_control_reset_config(struct camera_control_config* cfg)
@@ -78,7 +79,9 @@ static void camera_control_sample_cb(const struct sample* sample,
 
         double value;
         char * units;
-        if (!get_sample_value_by_name(sample, camera_control_state.cfg->channel, &value, &units))
+        if (!get_sample_value_by_cached_name(sample, camera_control_state.cfg->channel,
+                                             &camera_control_state.channel,
+                                             &value, &units))
                 return;
 
         enum auto_control_trigger_result res = auto_control_check_trigger(value,
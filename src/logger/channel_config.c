@@ -104,6 +104,9 @@ enum chan_cfg_status validate_channel_config(const ChannelConfig *cc)
         if (cc->flags & ~valid_flags)
                 return CHAN_CFG_STATUS_INVALID_FLAG;
 
+        if (cc->deadband < 0)
+                return CHAN_CFG_STATUS_NEGATIVE_DEADBAND;
+
         return CHAN_CFG_STATUS_OK;
 }
 
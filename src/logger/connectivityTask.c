@@ -22,6 +22,7 @@
 
 #include "FreeRTOS.h"
 #include "led.h"
+#include "logger_message_ring.h"
 #include "api.h"
 #include "bluetooth.h"
 #include "capabilities.h"
@@ -46,14 +47,6 @@
 #include "gps_device.h"
 #include "api_event.h"
 
-#if (CONNECTIVITY_CHANNELS == 1)
-#define CONNECTIVITY_TASK_INIT {NULL}
-#elif (CONNECTIVITY_CHANNELS == 2)
-#define CONNECTIVITY_TASK_INIT {NULL, NULL}
-#else
-#error "invalid connectivity task count"
-#endif
-
 #define _LOG_PFX "[Conn task] "
 
 /*wait time for sample queue. can be portMAX_DELAY to wait forever, or zero to not wait at all */
@@ -78,8 +71,6 @@
 #define BUFFERED_CHUNK_WAIT 1000
 #define BUFFERED_MAX_SIZE 1024 * 1000
 
-static xQueueHandle g_sampleQueue[CONNECTIVITY_CHANNELS] = CONNECTIVITY_TASK_INIT;
-
 #if BLUETOOTH_SUPPORT
 static char bluetooth_buffer[BUFFER_SIZE];
 #endif
@@ -201,16 +192,19 @@ int process_rx_buffer(struct Serial *serial, char *buffer, size_t *rxCount)
         return processMsg;
 }
 
-void queueTelemetryRecord(const LoggerMessage *msg)
+/*
+ * Channels only subscribe to the logger messages when they have a task
+ * reading them.  A subscriber nobody drains would hold its samples.
+ */
+static bool subscribe_channel(const size_t channel)
 {
-        for (size_t i = 0; i < CONNECTIVITY_CHANNELS; i++)
-                send_logger_message(g_sampleQueue[i], msg);
+        return logger_message_subscribe(SAMPLE_CONSUMER_TELEMETRY + channel);
 }
 
 #if BLUETOOTH_SUPPORT
 
 static void create_bluetooth_connection_task(int16_t priority,
-                xQueueHandle sampleQueue,
+                enum sample_consumer consumer,
                 enum led activity_led)
 {
         ConnParams *params = portMalloc(sizeof(ConnParams));
@@ -221,7 +215,7 @@ static void create_bluetooth_connection_task(int16_t priority,
         params->disconnect = &bt_disconnect;
         params->init_connection = &bt_init_connection;
         params->serial = SERIAL_BLUETOOTH;
-        params->sampleQueue = sampleQueue;
+        params->consumer = consumer;
         params->always_streaming = true;
         params->max_sample_rate = SAMPLE_50Hz;
         params->activity_led = activity_led;
@@ -235,7 +229,7 @@ static void create_bluetooth_connection_task(int16_t priority,
 
 #if CELLULAR_SUPPORT
 static void create_cellular_connection_tasks(int16_t priority,
-                xQueueHandle sampleQueue,
+                enum sample_consumer consumer,
                 enum led activity_led)
 {
         cellular_state.buffer_file = pvPortMalloc(sizeof(FIL));
@@ -245,7 +239,7 @@ static void create_cellular_connection_tasks(int16_t priority,
                 BufferingTaskParams * params = (BufferingTaskParams *)portMalloc(sizeof(BufferingTaskParams));
                 params->connectionName = "TelemBuffer";
                 params->periodicMeta = 0;
-                params->sampleQueue = sampleQueue;
+                params->consumer = consumer;
                 params->always_streaming = false;
                 params->max_sample_rate = SAMPLE_10Hz;
 
@@ -265,6 +259,7 @@ static void create_cellular_connection_tasks(int16_t priority,
                 params->init_connection = &cellular_init_connection;
                 params->serial = SERIAL_TELEMETRY;
                 params->sampleQueue = cellular_state.buffer_queue;
+                params->consumer = consumer;
                 params->always_streaming = false;
                 params->max_sample_rate = SAMPLE_10Hz;
                 params->activity_led = activity_led;
@@ -282,15 +277,6 @@ static void create_cellular_connection_tasks(int16_t priority,
 
 void startConnectivityTask(int16_t priority)
 {
-        for (size_t i = 0; i < CONNECTIVITY_CHANNELS; i++) {
-                g_sampleQueue[i] = create_logger_message_queue();
-
-                if (NULL == g_sampleQueue[i]) {
-                        pr_error(_LOG_PFX "err sample queue\r\n");
-                        return;
-                }
-        }
-
         switch (CONNECTIVITY_CHANNELS) {
         case 2: {
                 /*
@@ -301,22 +287,24 @@ void startConnectivityTask(int16_t priority)
 
 #if CELLULAR_SUPPORT
                 const uint8_t cellEnabled = getWorkingLoggerConfig()->ConnectivityConfigs.cellularConfig.cellEnabled;
-                if (cellEnabled)
+                if (cellEnabled && subscribe_channel(1))
                         create_cellular_connection_tasks(priority,
-                                                         g_sampleQueue[1], LED_TELEMETRY);
+                                                         SAMPLE_CONSUMER_TELEMETRY + 1,
+                                                         LED_TELEMETRY);
 #else
 #if BLUETOOTH_SUPPORT
                 const uint8_t cellEnabled = false;
 #endif
 #endif
 #if BLUETOOTH_SUPPORT
-                if (getWorkingLoggerConfig()->ConnectivityConfigs.bluetoothConfig.btEnabled) {
+                if (getWorkingLoggerConfig()->ConnectivityConfigs.bluetoothConfig.btEnabled &&
+                    subscribe_channel(0)) {
                         /* Pick the bluetooth LED if available */
                         enum led activity_led = led_available(LED_BLUETOOTH) ? LED_BLUETOOTH : LED_TELEMETRY;
                         activity_led = cellEnabled && activity_led == LED_TELEMETRY ? LED_UNKNOWN : activity_led;
 
                         create_bluetooth_connection_task(priority,
-                                                         g_sampleQueue[0],
+                                                         SAMPLE_CONSUMER_TELEMETRY,
                                                          activity_led);
 
                 }
@@ -349,7 +337,6 @@ void bluetooth_connectivity_task(void *params)
 
         struct Serial *serial = serial_device_get(connParams->serial);
 
-        xQueueHandle sampleQueue = connParams->sampleQueue;
         uint32_t connection_timeout = connParams->connection_timeout;
         const size_t max_telem_rate = connParams->max_sample_rate;
 
@@ -403,8 +390,8 @@ void bluetooth_connectivity_task(void *params)
                                 connParams->always_streaming ||
                                 logger_config->ConnectivityConfigs.telemetryConfig.backgroundStreaming;
 
-                        const char res = receive_logger_message(sampleQueue, &msg,
-                                                                IDLE_TIMEOUT);
+                        const portBASE_TYPE res = receive_logger_message(
+                                connParams->consumer, &msg, IDLE_TIMEOUT);
 
                         /*///////////////////////////////////////////////////////////
                         // Process a pending message from logger task, if exists
@@ -450,6 +437,8 @@ void bluetooth_connectivity_task(void *params)
                                         pr_info_int_msg(_LOG_PFX "Unknown logger message type ", msg.type);
                                         break;
                                 }
+
+                                release_logger_message(&msg, connParams->consumer);
                         }
                         /*//////////////////////////////////////////////////////////
                         // Process any pending API events
@@ -513,7 +502,6 @@ void cellular_buffering_task(void *params)
         BufferingTaskParams *connParams = (BufferingTaskParams*)params;
         LoggerMessage msg;
 
-        xQueueHandle sampleQueue = connParams->sampleQueue;
         const size_t max_telem_rate = connParams->max_sample_rate;
 
         size_t tick = 0;
@@ -585,12 +573,15 @@ void cellular_buffering_task(void *params)
                                 connParams->always_streaming ||
                                 logger_config->ConnectivityConfigs.telemetryConfig.backgroundStreaming;
 
-                        const char res = receive_logger_message(sampleQueue, &msg, IDLE_TIMEOUT);
+                        const portBASE_TYPE res = receive_logger_message(
+                                connParams->consumer, &msg, IDLE_TIMEOUT);
 
                         /*///////////////////////////////////////////////////////////
                         // Process a pending message from logger task, if exists
                         ////////////////////////////////////////////////////////////*/
                         if (pdFALSE != res) {
+                                bool forwarded = false;
+
                                 switch(msg.type) {
                                 case LoggerMessageType_Start: {
                                         logging_enabled = true;
@@ -659,7 +650,12 @@ BUFFER_DONE:
                                         buffer_msg.sample = msg.sample;
                                         buffer_msg.ticks = msg.ticks;
                                         buffer_msg.needs_meta = msg.needs_meta;
-                                        xQueueSend(cellular_state.buffer_queue, &buffer_msg, 0);
+
+                                        /* Our sample reference travels with the message */
+                                        forwarded = pdTRUE == xQueueSend(cellular_state.buffer_queue,
+                                                                         &buffer_msg, 0);
+                                        if (!forwarded)
+                                                sample_count_overrun(connParams->consumer);
 
                                         tick++;
                                         break;
@@ -668,6 +664,9 @@ BUFFER_DONE:
                                         pr_info_int_msg(_LOG_PFX "Unknown logger message type ", msg.type);
                                         break;
                                 }
+
+                                if (!forwarded)
+                                        release_logger_message(&msg, connParams->consumer);
                         }
                 }
         }
@@ -783,6 +782,12 @@ void cellular_connectivity_task(void *params)
                                                 needs_meta = false;
                                                 put_crlf(serial);
                                         } else {
+                                                /*
+                                                 * The buffer file already has the sample; let it go
+                                                 * before any catch up delays.
+                                                 */
+                                                sample_unref(msg.sample, msg.ticks, connParams->consumer);
+
                                                 /* Stream buffered samples, catching up with the tail of the file as needed */
                                                 int32_t start_index = cellular_state.read_index;
                                                 while (true) {
@@ -821,6 +826,9 @@ void cellular_connectivity_task(void *params)
                                                 }
                                         }
                                 }
+
+                                /* No-op if already released above */
+                                sample_unref(msg.sample, msg.ticks, connParams->consumer);
                         }
 
                         /*//////////////////////////////////////////////////////////
@@ -20,14 +20,15 @@
  */
 
 
+#include "binary_log.h"
 #include "fileWriter.h"
 #include "led.h"
+#include "logger_message_ring.h"
 #include "loggerHardware.h"
 #include "macros.h"
 #include "mem_mang.h"
 #include "modp_numtoa.h"
 #include "printk.h"
-#include "ring_buffer.h"
 #include "sampleRecord.h"
 #include "sdcard.h"
 #include "task.h"
@@ -40,44 +41,124 @@
 
 #define _LOG_PFX "[fileWriter] "
 #define ERROR_SLEEP_DELAY_MS	500
-#define FILE_BUFFER_SIZE	1024
 #define FILE_WRITER_STACK_SIZE	512
 #define LOG_PFX	"[fileWriter] "
 #define MAX_LOG_FILE_INDEX	99999
 #define WRITE_FAIL	EOF
 
 static FIL *g_logfile;
-static xQueueHandle g_LoggerMessage_queue;
-static struct ring_buff *file_buff;
+static struct file_writer_stats g_stats;
+
+/*
+ * Staging buffer for rows headed to the SD card.  Rows are committed
+ * in a single f_write once the buffer reaches the commit limit, which
+ * is chosen so that every commit ends on a sector boundary of the file.
+ * That lets FatFs write whole sectors straight to the card rather than
+ * doing a read-modify-write through its sector window.
+ */
+static struct {
+        char *data;
+        size_t used;
+        portTickType commit_tick;
+        FRESULT error;
+} file_buff;
 
 static void error_led(const bool on)
 {
         led_set(LED_ERROR, on);
 }
 
-static FRESULT flush_file_buffer(void)
+/**
+ * @return The number of staged bytes at which we commit.  Sized so that
+ * the commit ends on a sector boundary of the file.
+ */
+static size_t file_buffer_limit(void)
 {
-        while(true) {
-                size_t available = 0;
-                const void* buff =
-                        ring_buffer_dma_read_init(file_buff, &available);
+        const size_t commit_size = filter_log_file_commit_size(
+                getWorkingLoggerConfig()->logging_cfg.file_commit_size);
 
-                /* If nothing to write, we are done. */
-                if (!available)
-                        return FR_OK;
+        return commit_size - f_tell(g_logfile) % LOG_FILE_SECTOR_SIZE;
+}
 
-                unsigned int written = 0;
-                fs_lock();
-                const FRESULT res = f_write(g_logfile, buff, available, &written);
-                fs_unlock();
-                ring_buffer_dma_read_fini(file_buff, written);
-                if (FR_OK != res) {
-                        pr_debug_int_msg("[FileWriter] f_write failed "
-                                         "with status: ", (int) res);
-                        error_led(true);
-                        return res;
+static void update_write_stats(const size_t bytes, const portTickType ticks)
+{
+        const uint32_t latency_ms = ticksToMs(ticks);
+
+        g_stats.writes++;
+        g_stats.bytes += bytes;
+        g_stats.latency_ms += latency_ms;
+        g_stats.max_latency_ms = MAX(g_stats.max_latency_ms, latency_ms);
+}
+
+static FRESULT commit_file_buffer(void)
+{
+        file_buff.commit_tick = xTaskGetTickCount();
+
+        if (!file_buff.used)
+                return FR_OK;
+
+        unsigned int written = 0;
+        fs_lock();
+        const FRESULT res = f_write(g_logfile, file_buff.data,
+                                    file_buff.used, &written);
+        fs_unlock();
+        update_write_stats(written, xTaskGetTickCount() -
+                           file_buff.commit_tick);
+
+        /* Keep anything that didn't make it so it can be retried */
+        file_buff.used -= written;
+        if (file_buff.used)
+                memmove(file_buff.data, file_buff.data + written,
+                        file_buff.used);
+
+        if (FR_OK != res) {
+                pr_debug_int_msg("[FileWriter] f_write failed "
+                                 "with status: ", (int) res);
+                error_led(true);
+                file_buff.error = res;
+        }
+
+        return res;
+}
+
+static bool is_commit_due(void)
+{
+        const uint16_t interval_ms = filter_log_file_commit_interval(
+                getWorkingLoggerConfig()->logging_cfg.file_commit_interval_ms);
+
+        return file_buff.used &&
+                isTimeoutMs(file_buff.commit_tick, interval_ms);
+}
+
+static int append_file_buffer_bytes(const void *data, size_t len)
+{
+        const char *bytes = data;
+
+        /* Don't stage more data behind a failed commit */
+        if (FR_OK != file_buff.error)
+                return file_buff.error;
+
+        while(len) {
+                const size_t limit = file_buffer_limit();
+
+                if (file_buff.used < limit) {
+                        const size_t write_len =
+                                MIN(limit - file_buff.used, len);
+                        memcpy(file_buff.data + file_buff.used, bytes,
+                               write_len);
+                        file_buff.used += write_len;
+                        bytes += write_len;
+                        len -= write_len;
+                }
+
+                if (file_buff.used >= limit) {
+                        const FRESULT res = commit_file_buffer();
+                        if (FR_OK != res)
+                                return res;
                 }
         }
+
+        return FR_OK;
 }
 
 static FRESULT append_file_buffer(const char *str)
@@ -85,26 +166,12 @@ static FRESULT append_file_buffer(const char *str)
         if (!str)
                 return FR_OK;
 
-        FRESULT res = FR_OK;
-        size_t len = strlen(str);
-        while(len) {
-                const size_t write_len =
-                        MIN(ring_buffer_bytes_free(file_buff), len);
-                ring_buffer_put(file_buff, str, write_len);
-                str += write_len;
-                len -= write_len;
-
-                /* If not at end of string, more to write.  Flush */
-                if (len > 0)
-                        res = flush_file_buffer();
-        }
-
-        return res;
+        return append_file_buffer_bytes(str, strlen(str));
 }
 
-portBASE_TYPE queue_logfile_record(const LoggerMessage * const msg)
+const struct file_writer_stats* file_writer_get_stats(void)
 {
-        return send_logger_message(g_LoggerMessage_queue, msg);
+        return &g_stats;
 }
 
 static void appendQuotedString(const char *s)
@@ -168,25 +235,24 @@ static int write_samples_header(const LoggerMessage *msg)
         }
 
         append_file_buffer("\n");
-        return flush_file_buffer();
+        return file_buff.error;
 }
 
 
 static int write_samples_data(const LoggerMessage *msg)
 {
-        const ChannelSample *sample = msg->sample->channel_samples;
-        size_t count = msg->sample->channel_count;
+        const struct sample *s = msg->sample;
+        const ChannelSample *sample = s->channel_samples;
 
         if (NULL == sample) {
                 pr_warning(_LOG_PFX "null sample record\r\n");
                 return WRITE_FAIL;
         }
 
-        int i;
-        for (i = 0; 0 < count; count--, sample++, i++) {
+        for (size_t i = 0; i < s->channel_count; i++, sample++) {
                 append_file_buffer(0 == i ? "" : ",");
 
-                if (!sample->populated)
+                if (!sample_is_populated(s, i))
                         continue;
 
                 const int precision = sample->cfg->precision;
@@ -194,19 +260,19 @@ static int write_samples_data(const LoggerMessage *msg)
                 switch(sample->sampleData) {
                 case SampleData_Float:
                 case SampleData_Float_Noarg:
-                        appendFloat(sample->valueFloat, precision);
+                        appendFloat(sample_get_float(s, i), precision);
                         break;
                 case SampleData_Int:
                 case SampleData_Int_Noarg:
-                        appendInt(sample->valueInt);
+                        appendInt(sample_get_int(s, i));
                         break;
                 case SampleData_LongLong:
                 case SampleData_LongLong_Noarg:
-                        appendLongLong(sample->valueLongLong);
+                        appendLongLong(sample_get_longlong(s, i));
                         break;
                 case SampleData_Double:
                 case SampleData_Double_Noarg:
-                        appendDouble(sample->valueDouble, precision);
+                        appendDouble(sample_get_double(s, i), precision);
                         break;
                 default:
                         pr_warning(_LOG_PFX "Unknown channel "
@@ -215,7 +281,40 @@ static int write_samples_data(const LoggerMessage *msg)
         }
 
         append_file_buffer("\n");
-        return flush_file_buffer();
+        return file_buff.error;
+}
+
+static int write_binary_samples_header(const LoggerMessage *msg)
+{
+        return binary_log_write_header(msg->sample,
+                                       append_file_buffer_bytes);
+}
+
+static int write_binary_samples_data(struct logging_status *ls,
+                                     const LoggerMessage *msg)
+{
+        if (NULL == msg->sample->channel_samples) {
+                pr_warning(_LOG_PFX "null sample record\r\n");
+                return WRITE_FAIL;
+        }
+
+        uint32_t skipped = 0;
+        const int rc = binary_log_write_high_rate(msg->sample,
+                                                  &ls->high_rate_seq,
+                                                  &skipped,
+                                                  append_file_buffer_bytes);
+
+        /* Lost scans get reported like lost samples */
+        if (skipped) {
+                pr_debug_int_msg(_LOG_PFX "High rate scans lost: ", skipped);
+                sample_count_overrun(SAMPLE_CONSUMER_FILE_WRITER);
+        }
+
+        if (rc)
+                return rc;
+
+        return binary_log_write_sample(msg->sample,
+                                       append_file_buffer_bytes);
 }
 
 static enum writing_status open_existing_log_file(struct logging_status *ls)
@@ -241,6 +340,8 @@ static enum writing_status open_new_log_file(struct logging_status *ls)
 {
         pr_debug(_LOG_PFX "Opening new log file\r\n");
 
+        const char *ext = LOG_FILE_FORMAT_BINARY == ls->file_format ?
+                ".rcb" : ".log";
         int i;
 
         for (i = 0; i < MAX_LOG_FILE_INDEX; i++) {
@@ -249,7 +350,7 @@ static enum writing_status open_new_log_file(struct logging_status *ls)
 
                 strcpy(ls->name, "rc_");
                 strcat(ls->name, buf);
-                strcat(ls->name, ".log");
+                strcat(ls->name, ext);
 
                 fs_lock();
                 const FRESULT res = f_open(g_logfile, ls->name, FA_WRITE | FA_CREATE_NEW);
@@ -323,6 +424,8 @@ static void open_log_file(struct logging_status *ls)
         }
 
         pr_info_str_msg(_LOG_PFX "Opened ", ls->name);
+        file_buff.error = FR_OK;
+        file_buff.commit_tick = xTaskGetTickCount();
         ls->flush_tick = xTaskGetTickCount();
         ls->last_sample_tick = 0;
 }
@@ -334,23 +437,51 @@ TESTABLE_STATIC int logging_start(struct logging_status *ls)
 
         /* Set this here because this is the start of the log stream */
         ls->rows_written = 0;
+        ls->write_error = false;
+        memset(&g_stats, 0, sizeof(g_stats));
 
         logging_led_toggle();
         return 0;
 }
 
+static void log_write_stats(void)
+{
+        if (!g_stats.writes)
+                return;
+
+        pr_info_int_msg(_LOG_PFX "SD writes: ", g_stats.writes);
+        pr_info_int_msg(_LOG_PFX "Avg write bytes: ",
+                        g_stats.bytes / g_stats.writes);
+        pr_info_int_msg(_LOG_PFX "Avg write ms: ",
+                        g_stats.latency_ms / g_stats.writes);
+        pr_info_int_msg(_LOG_PFX "Max write ms: ", g_stats.max_latency_ms);
+}
+
 TESTABLE_STATIC int logging_stop(struct logging_status *ls)
 {
         pr_debug(_LOG_PFX "End\r\n");
         ls->logging = false;
 
+        /* Commit whatever is staged before we let go of the file */
+        int rc = 0;
+        if (WRITING_ACTIVE == ls->writing_status)
+                rc = commit_file_buffer();
+
+        /* The staged rows are dropped either way, so own up to it */
+        if (rc) {
+                pr_error_int_msg(_LOG_PFX "Failed to commit log end: ", rc);
+                ls->write_error = true;
+        }
+
+        file_buff.used = 0;
         close_log_file(ls);
+        log_write_stats();
 
         /* Prevent log file from being re-opened */
         ls->name[0] = '\0';
 
         logging_led_off();
-        return 0;
+        return rc;
 }
 
 static int write_samples(struct logging_status *ls, const LoggerMessage *msg)
@@ -368,22 +499,28 @@ static int write_samples(struct logging_status *ls, const LoggerMessage *msg)
         }
         ls->last_sample_tick = msg->ticks;
 
+        const bool binary = LOG_FILE_FORMAT_BINARY == ls->file_format;
         int rc = 0;
 
         /* If we haven't written to this file yet, start with the headers */
         if (0 == ls->rows_written) {
-                rc = write_samples_header(msg);
+                rc = binary ? write_binary_samples_header(msg) :
+                        write_samples_header(msg);
 
                 /* If headers written, then don't write them again */
                 if (0 == rc)
                         ls->rows_written++;
+
+                /* High rate scans start with the first sample in the file */
+                ls->high_rate_seq = msg->sample->high_rate_seq;
         }
 
         /* If the above write failed, then don't bother with the next */
         if (0 != rc)
                 return rc;
 
-        rc = write_samples_data(msg);
+        rc = binary ? write_binary_samples_data(ls, msg) :
+                write_samples_data(msg);
 
         if (0 == rc)
                 ls->rows_written++;
@@ -398,6 +535,14 @@ TESTABLE_STATIC int logging_sample(struct logging_status *ls,
         if (!ls->logging)
                 return 0;
 
+        /*
+         * Latch the file format at the start of each log stream so that
+         * a config change never mixes formats within a single file.
+         */
+        if (0 == ls->rows_written)
+                ls->file_format = filter_log_file_format(
+                        getWorkingLoggerConfig()->logging_cfg.file_format);
+
         int attempts = 2;
         int rc = WRITE_FAIL;
         while (attempts--) {
@@ -456,8 +601,13 @@ TESTABLE_STATIC int flush_logfile(struct logging_status *ls)
         return res;
 }
 
-static void update_logger_status(struct logging_status *ls)
+TESTABLE_STATIC void update_logger_status(struct logging_status *ls)
 {
+        if (ls->write_error) {
+                logging_set_status(LOGGING_STATUS_ERROR_WRITING);
+                return;
+        }
+
         switch(ls->writing_status) {
         case WRITING_INACTIVE:
                 logging_set_status(LOGGING_STATUS_IDLE);
@@ -473,6 +623,14 @@ static void update_logger_status(struct logging_status *ls)
         }
 }
 
+TESTABLE_STATIC int commit_logfile(struct logging_status *ls)
+{
+        if (WRITING_ACTIVE != ls->writing_status || !is_commit_due())
+                return 0;
+
+        return commit_file_buffer();
+}
+
 static void fileWriterTask(void *params)
 {
         LoggerMessage msg;
@@ -482,64 +640,81 @@ static void fileWriterTask(void *params)
         while(1) {
                 int rc = -1;
 
-                /* Get a sample. */
-                const char status = receive_logger_message(g_LoggerMessage_queue,
-                                    &msg, portMAX_DELAY);
-
-                /* If we fail to receive for any reason, keep trying */
-                if (pdPASS != status)
-                        continue;
-
-                switch (msg.type) {
-                case LoggerMessageType_Sample:
-                        rc = logging_sample(&ls, &msg);
-                        break;
-                case LoggerMessageType_Start:
-                        rc = logging_start(&ls);
-                        break;
-                case LoggerMessageType_Stop:
-                        rc = logging_stop(&ls);
-                        break;
-                default:
-                        pr_warning(_LOG_PFX "Unsupported message "
-                                   "type\r\n");
-                }
-
-                /* Turns the LED on if things are bad, off otherwise. */
-                error_led(rc);
-                if (rc) {
-                        pr_debug(_LOG_PFX "Msg type ");
-                        pr_debug_int(msg.type);
-                        pr_debug_int_msg(" failed with code ", rc);
+                /*
+                 * Get a sample.  Wake up at least once per commit interval
+                 * so staged data makes it to the card even if the samples
+                 * stop coming.
+                 */
+                const uint16_t interval_ms = filter_log_file_commit_interval(
+                        getWorkingLoggerConfig()->logging_cfg.file_commit_interval_ms);
+                const portBASE_TYPE status = receive_logger_message(
+                        SAMPLE_CONSUMER_FILE_WRITER, &msg,
+                        msToTicks(interval_ms));
+
+                if (pdPASS == status) {
+                        switch (msg.type) {
+                        case LoggerMessageType_Sample:
+                                rc = logging_sample(&ls, &msg);
+                                break;
+                        case LoggerMessageType_Start:
+                                rc = logging_start(&ls);
+                                break;
+                        case LoggerMessageType_Stop:
+                                rc = logging_stop(&ls);
+                                break;
+                        default:
+                                pr_warning(_LOG_PFX "Unsupported message "
+                                           "type\r\n");
+                        }
+
+                        /* Turns the LED on if things are bad, off otherwise. */
+                        error_led(rc);
+                        if (rc) {
+                                pr_debug(_LOG_PFX "Msg type ");
+                                pr_debug_int(msg.type);
+                                pr_debug_int_msg(" failed with code ", rc);
+                        }
+
+                        release_logger_message(&msg,
+                                               SAMPLE_CONSUMER_FILE_WRITER);
                 }
 
+                commit_logfile(&ls);
                 flush_logfile(&ls);
                 update_logger_status(&ls);
         }
 }
 
-void startFileWriterTask(int priority)
+TESTABLE_STATIC bool file_writer_init(void)
 {
-        g_LoggerMessage_queue = create_logger_message_queue();
-
-        if (NULL == g_LoggerMessage_queue) {
-                pr_error(_LOG_PFX "LoggerMessage Queue is null!\r\n");
-                return;
-        }
+        if (!logger_message_subscribe(SAMPLE_CONSUMER_FILE_WRITER))
+                return false;
 
-        g_logfile = (FIL *) portMalloc(sizeof(FIL));
+        if (!g_logfile)
+                g_logfile = (FIL *) portMalloc(sizeof(FIL));
         if (NULL == g_logfile) {
                 pr_error(_LOG_PFX "logfile sruct alloc err\r\n");
-                return;
+                return false;
         }
         memset(g_logfile, 0, sizeof(FIL));
 
-        file_buff = ring_buffer_create(FILE_BUFFER_SIZE);
-        if (!file_buff) {
-                pr_error(_LOG_PFX "Failed to alloc ring buffer.\r\n");
-                return;
+        if (!file_buff.data)
+                file_buff.data = (char *) portMalloc(LOG_FILE_COMMIT_SIZE_MAX);
+        if (!file_buff.data) {
+                pr_error(_LOG_PFX "Failed to alloc file buffer.\r\n");
+                return false;
         }
 
+        file_buff.used = 0;
+        file_buff.error = FR_OK;
+        return true;
+}
+
+void startFileWriterTask(int priority)
+{
+        if (!file_writer_init())
+                return;
+
         /* Make all task names 16 chars including NULL char */
         static const signed portCHAR task_name[] = "File Task       ";
         xTaskCreate(fileWriterTask, task_name, FILE_WRITER_STACK_SIZE,
@@ -0,0 +1,244 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "high_rate_lane.h"
+#include "loggerConfig.h"
+#include "mem_mang.h"
+#include "printk.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define LOG_PFX "[high rate] "
+
+/* Keeps the compiler from moving memory accesses across this point */
+#define compiler_barrier()	__asm__ volatile("" ::: "memory")
+
+#if HIGH_RATE_LANE_SCANS > 0
+
+#if HIGH_RATE_LANE_SCANS <= HIGH_RATE_LANE_BLOCK_SCANS
+#error "HIGH_RATE_LANE_SCANS must exceed HIGH_RATE_LANE_BLOCK_SCANS"
+#endif
+
+/*
+ * A lapped reader skips ahead to leave this many scans of room, so that
+ * the scans it copies next are not overwritten while it copies them.
+ */
+#define LAPPED_SKIP_DEPTH	(HIGH_RATE_LANE_SCANS - HIGH_RATE_LANE_BLOCK_SCANS)
+
+/*
+ * The log writer drains the lane once per logged sample, and may run a
+ * sample behind.  So the ring must hold this many sample intervals.
+ */
+#define DRAIN_INTERVALS		2
+
+typedef uint16_t lane_scan_t[HIGH_RATE_LANE_CHANNELS_MAX];
+
+static struct {
+        /* Allocated with the first channel, and kept for good after */
+        lane_scan_t *ring;
+        volatile uint32_t head;
+        volatile uint8_t count;
+        uint32_t rate_hz;
+        struct high_rate_lane_channel channels[HIGH_RATE_LANE_CHANNELS_MAX];
+} lane;
+
+/*
+ * A channel logged at a lower rate than this leaves the lane undrained
+ * for longer than the ring lasts.
+ */
+static bool is_drained_in_time(const ChannelConfig *cfg, const uint32_t rate_hz)
+{
+        const int sample_hz = decodeSampleRate(cfg->sampleRate);
+        if (SAMPLE_DISABLED == sample_hz)
+                return false;
+
+        return DRAIN_INTERVALS * rate_hz / sample_hz <= LAPPED_SKIP_DEPTH;
+}
+
+static bool alloc_ring(void)
+{
+        if (lane.ring)
+                return true;
+
+        lane.ring = portMalloc(sizeof(lane_scan_t[HIGH_RATE_LANE_SCANS]));
+        if (!lane.ring)
+                pr_error(LOG_PFX "Failed to allocate ring\r\n");
+
+        return lane.ring != NULL;
+}
+
+size_t high_rate_lane_configure(const struct high_rate_lane_channel *channels,
+                                const size_t count, const uint32_t rate_hz)
+{
+        /*
+         * The interrupt runs to completion before we get to go on, so
+         * once the count is 0 it no longer reads the channels.
+         */
+        lane.count = 0;
+        compiler_barrier();
+
+        size_t accepted = 0;
+        for (size_t i = 0; i < count && rate_hz; ++i) {
+                const struct high_rate_lane_channel *ch = channels + i;
+
+                if (accepted == HIGH_RATE_LANE_CHANNELS_MAX) {
+                        pr_warning_int_msg(LOG_PFX "Too many channels: ",
+                                           count);
+                        break;
+                }
+
+                if (!is_drained_in_time(ch->cfg, rate_hz)) {
+                        pr_warning_str_msg(LOG_PFX "Sample rate too low "
+                                           "for ", ch->cfg->label);
+                        continue;
+                }
+
+                lane.channels[accepted++] = *ch;
+        }
+
+        if (accepted && !alloc_ring())
+                accepted = 0;
+
+        lane.rate_hz = rate_hz;
+
+        compiler_barrier();
+        lane.count = accepted;
+
+        return accepted;
+}
+
+size_t high_rate_lane_get_channels(const struct high_rate_lane_channel **channels)
+{
+        *channels = lane.channels;
+        return lane.count;
+}
+
+uint32_t high_rate_lane_get_rate(void)
+{
+        return lane.rate_hz;
+}
+
+uint32_t high_rate_lane_get_seq(void)
+{
+        return lane.head;
+}
+
+void high_rate_lane_push_scans(const volatile uint16_t *scans,
+                               const size_t count, const size_t width)
+{
+        const size_t channels = lane.count;
+        if (!channels)
+                return;
+
+        uint32_t head = lane.head;
+        for (size_t s = 0; s < count; ++s, scans += width, ++head) {
+                uint16_t *slot = lane.ring[head % HIGH_RATE_LANE_SCANS];
+
+                for (size_t c = 0; c < channels; ++c)
+                        slot[c] = scans[lane.channels[c].source];
+        }
+
+        /* Readers must never see the new head before the scans */
+        compiler_barrier();
+        lane.head = head;
+}
+
+bool high_rate_lane_read_block(uint32_t *cursor, uint32_t end,
+                               struct high_rate_block *block)
+{
+        if (!lane.ring)
+                return false;
+
+        for (;;) {
+                const uint32_t head = lane.head;
+                uint32_t seq = *cursor;
+
+                if ((int32_t) (end - head) > 0)
+                        end = head;
+
+                if (head - seq > LAPPED_SKIP_DEPTH) {
+                        seq = head - LAPPED_SKIP_DEPTH;
+                        *cursor = seq;
+                }
+
+                if ((int32_t) (end - seq) <= 0)
+                        return false;
+
+                const uint32_t left = end - seq;
+                const size_t scans = left < HIGH_RATE_LANE_BLOCK_SCANS ?
+                        left : HIGH_RATE_LANE_BLOCK_SCANS;
+
+                compiler_barrier();
+                for (size_t i = 0; i < scans; ++i)
+                        memcpy(block->values[i],
+                               lane.ring[(seq + i) % HIGH_RATE_LANE_SCANS],
+                               sizeof(block->values[i]));
+                compiler_barrier();
+
+                /* The oldest scan was overwritten while we copied */
+                if (lane.head - seq > HIGH_RATE_LANE_SCANS)
+                        continue;
+
+                block->seq = seq;
+                block->scans = scans;
+                *cursor = seq + scans;
+                return true;
+        }
+}
+
+#else
+
+size_t high_rate_lane_configure(const struct high_rate_lane_channel *channels,
+                                size_t count, const uint32_t rate_hz)
+{
+        return 0;
+}
+
+size_t high_rate_lane_get_channels(const struct high_rate_lane_channel **channels)
+{
+        *channels = NULL;
+        return 0;
+}
+
+uint32_t high_rate_lane_get_rate(void)
+{
+        return 0;
+}
+
+uint32_t high_rate_lane_get_seq(void)
+{
+        return 0;
+}
+
+void high_rate_lane_push_scans(const volatile uint16_t *scans,
+                               const size_t count, const size_t width)
+{
+}
+
+bool high_rate_lane_read_block(uint32_t *cursor, uint32_t end,
+                               struct high_rate_block *block)
+{
+        return false;
+}
+
+#endif /* HIGH_RATE_LANE_SCANS > 0 */
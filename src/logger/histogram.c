@@ -0,0 +1,316 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "histogram.h"
+#include "lap_stats.h"
+#include "loggerSampleData.h"
+#include "macros.h"
+#include "printk.h"
+#include "test.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#define LOG_PFX "[histogram] "
+
+/*
+ * Built by the logger task on a config change.  The config is copied so
+ * the channel table others build from this stays in step with it until
+ * the next rebuild.
+ */
+struct histogram_channel {
+        struct histogram_config cfg;
+        float (*read)(int);
+        int channel;
+        struct histogram h;
+        /*
+         * A LAP histogram's distribution of the lap just completed, logged
+         * in place of the new lap's up to its first log tick.
+         */
+        struct histogram completed;
+        size_t completed_until;
+        bool show_completed;
+        ChannelConfig bin_cfgs[HISTOGRAM_BINS_MAX];
+};
+
+static struct histogram_channel g_histograms[HISTOGRAM_CHANNELS_MAX];
+static size_t g_histogram_count;
+
+bool is_histogram_config_valid(const struct histogram_config *cfg)
+{
+        return cfg->mode != HISTOGRAM_MODE_DISABLED &&
+                cfg->bins >= HISTOGRAM_BINS_MIN &&
+                cfg->bins <= HISTOGRAM_BINS_MAX &&
+                cfg->max > cfg->min;
+}
+
+void histogram_reset(struct histogram *h)
+{
+        memset(h, 0, sizeof(*h));
+}
+
+static void count_reading(struct histogram *h,
+                          const struct histogram_config *cfg,
+                          const float value)
+{
+        const float pos = (value - cfg->min) * cfg->bins /
+                (cfg->max - cfg->min);
+        size_t bin = 0;
+
+        if (pos >= cfg->bins)
+                bin = cfg->bins - 1;
+        else if (pos > 0)
+                bin = (size_t) pos;
+
+        ++h->counts[bin];
+        ++h->total;
+
+        if (HISTOGRAM_MODE_ROLLING != cfg->mode ||
+            h->total < HISTOGRAM_ROLLING_READINGS)
+                return;
+
+        h->total = 0;
+        for (size_t i = 0; i < cfg->bins; ++i) {
+                h->counts[i] /= 2;
+                h->total += h->counts[i];
+        }
+}
+
+void histogram_add(struct histogram *h, const struct histogram_config *cfg,
+                   const size_t tick, const float value)
+{
+        if (HISTOGRAM_SOURCE_VALUE == cfg->source) {
+                count_reading(h, cfg, value);
+                return;
+        }
+
+        const bool primed = h->primed && tick != h->last_tick;
+        const float rate = (value - h->last_value) * TICK_RATE_HZ /
+                (float) (tick - h->last_tick);
+
+        h->primed = true;
+        h->last_tick = tick;
+        h->last_value = value;
+
+        if (primed)
+                count_reading(h, cfg, rate);
+}
+
+float histogram_bin_percent(const struct histogram *h, const size_t bin)
+{
+        if (0 == h->total)
+                return 0;
+
+        return h->counts[bin] * 100.0f / h->total;
+}
+
+static bool has_histogram(const ChannelConfig *cfg,
+                          const struct histogram_config *hc)
+{
+        return cfg->sampleRate != SAMPLE_DISABLED &&
+                is_histogram_config_valid(hc);
+}
+
+static void init_bin_config(ChannelConfig *bin_cfg, const ChannelConfig *cfg,
+                            const size_t bin)
+{
+        const size_t prefix_len = sizeof(HISTOGRAM_BIN_PREFIX) - 1;
+        const size_t len = MIN(strlen(cfg->label),
+                               DEFAULT_LABEL_LENGTH - 2 - prefix_len);
+
+        memset(bin_cfg, 0, sizeof(*bin_cfg));
+        memcpy(bin_cfg->label, cfg->label, len);
+        memcpy(bin_cfg->label + len, HISTOGRAM_BIN_PREFIX, prefix_len);
+        bin_cfg->label[len + prefix_len] = '0' + bin;
+        strcpy(bin_cfg->units, "%");
+        bin_cfg->min = 0;
+        bin_cfg->max = 100;
+        bin_cfg->sampleRate = cfg->sampleRate;
+        bin_cfg->precision = 1;
+}
+
+/*
+ * Walks the channels with a histogram in the order they are kept in, and
+ * sets them up if hcs is given.
+ * @return The number of histograms, up to HISTOGRAM_CHANNELS_MAX.
+ */
+static size_t collect_histograms(LoggerConfig *lc,
+                                 struct histogram_channel *hcs,
+                                 size_t *bin_channels)
+{
+        struct {
+                const ChannelConfig *cfg;
+                const struct histogram_config *hc;
+                float (*read)(int);
+                int channel;
+        } candidates[CONFIG_ADC_CHANNELS + CONFIG_IMU_CHANNELS];
+        size_t count = 0;
+
+#if ANALOG_CHANNELS > 0
+        for (size_t i = 0; i < CONFIG_ADC_CHANNELS; ++i) {
+                const ADCConfig *c = lc->ADCConfigs + i;
+                if (!has_histogram(&c->cfg, &c->histogram))
+                        continue;
+
+                candidates[count].cfg = &c->cfg;
+                candidates[count].hc = &c->histogram;
+                candidates[count].read = get_analog_sample;
+                candidates[count].channel = i;
+                ++count;
+        }
+#endif
+
+#if IMU_CHANNELS > 0
+        for (size_t i = 0; i < CONFIG_IMU_CHANNELS; ++i) {
+                const ImuConfig *c = lc->ImuConfigs + i;
+                if (!has_histogram(&c->cfg, &c->histogram))
+                        continue;
+
+                candidates[count].cfg = &c->cfg;
+                candidates[count].hc = &c->histogram;
+                candidates[count].read = get_imu_sample;
+                candidates[count].channel = i;
+                ++count;
+        }
+#endif
+
+        if (count > HISTOGRAM_CHANNELS_MAX) {
+                if (hcs)
+                        pr_warning_int_msg(LOG_PFX "Too many histograms: ",
+                                           count);
+                count = HISTOGRAM_CHANNELS_MAX;
+        }
+        *bin_channels = 0;
+
+        for (size_t i = 0; i < count; ++i) {
+                const size_t bins = candidates[i].hc->bins;
+                *bin_channels += bins;
+                if (!hcs)
+                        continue;
+
+                struct histogram_channel *hc = hcs + i;
+                hc->cfg = *candidates[i].hc;
+                hc->read = candidates[i].read;
+                hc->channel = candidates[i].channel;
+                histogram_reset(&hc->h);
+                hc->h.lap = getLapCount();
+                hc->show_completed = false;
+
+                for (size_t b = 0; b < bins; ++b)
+                        init_bin_config(hc->bin_cfgs + b,
+                                        candidates[i].cfg, b);
+        }
+
+        return count;
+}
+
+bool is_histogram_enabled(LoggerConfig *lc)
+{
+        size_t bin_channels;
+
+        return collect_histograms(lc, NULL, &bin_channels) > 0;
+}
+
+size_t get_histogram_channel_count(void)
+{
+        size_t bin_channels = 0;
+
+        for (size_t i = 0; i < g_histogram_count; ++i)
+                bin_channels += g_histograms[i].cfg.bins;
+
+        return bin_channels;
+}
+
+size_t init_histograms(LoggerConfig *lc)
+{
+        size_t bin_channels;
+
+        g_histogram_count = 0;
+        g_histogram_count = collect_histograms(lc, g_histograms,
+                                               &bin_channels);
+        return g_histogram_count;
+}
+
+size_t get_histogram_count(void)
+{
+        return g_histogram_count;
+}
+
+size_t get_histogram_bins(const size_t histogram)
+{
+        return g_histograms[histogram].cfg.bins;
+}
+
+ChannelConfig* get_histogram_bin_config(const size_t histogram,
+                                        const size_t bin)
+{
+        return g_histograms[histogram].bin_cfgs + bin;
+}
+
+/*
+ * Starts a LAP histogram over, keeping the completed lap's distribution
+ * until the bins are next logged so the log holds every lap's share.
+ */
+static void start_lap(struct histogram_channel *hc, const size_t tick,
+                      const int lap)
+{
+        const size_t rate = hc->bin_cfgs[0].sampleRate;
+
+        hc->completed = hc->h;
+        hc->completed_until = (tick + rate - 1) / rate * rate;
+        hc->show_completed = true;
+
+        histogram_reset(&hc->h);
+        hc->h.lap = lap;
+}
+
+TESTABLE_STATIC void update_histograms(const size_t tick, const int lap)
+{
+        for (size_t i = 0; i < g_histogram_count; ++i) {
+                struct histogram_channel *hc = g_histograms + i;
+
+                if (hc->show_completed && tick > hc->completed_until)
+                        hc->show_completed = false;
+
+                if (HISTOGRAM_MODE_LAP == hc->cfg.mode && hc->h.lap != lap)
+                        start_lap(hc, tick, lap);
+
+                histogram_add(&hc->h, &hc->cfg, tick, hc->read(hc->channel));
+        }
+}
+
+void histogram_channel_samples(const size_t tick)
+{
+        update_histograms(tick, getLapCount());
+}
+
+float get_histogram_bin(int id)
+{
+        const size_t histogram = id / HISTOGRAM_BINS_MAX;
+
+        if (histogram >= g_histogram_count)
+                return 0;
+
+        const struct histogram_channel *hc = g_histograms + histogram;
+        return histogram_bin_percent(hc->show_completed ?
+                                     &hc->completed : &hc->h,
+                                     id % HISTOGRAM_BINS_MAX);
+}
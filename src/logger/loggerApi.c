@@ -27,6 +27,8 @@
 #include "cellular.h"
 #include "CAN.h"
 #include "CAN_aux_filterqueue.h"
+#include "CAN_filter.h"
+#include "CAN_rx_ring.h"
 #include "cellular_api_status_keys.h"
 #include "channel_config.h"
 #include "constants.h"
@@ -200,6 +202,33 @@ int api_getCapabilities(struct Serial *serial, const jsmntok_t *json)
         return API_SUCCESS_NO_RETURN;
 }
 
+static void get_can_status(struct Serial *serial, const bool more)
+{
+        struct can_rx_stats rx_stats;
+        CAN_rx_ring_get_stats(&rx_stats);
+
+        json_objStartString(serial, "can");
+        json_objStartString(serial, "ring");
+        json_uint(serial, "rx", rx_stats.received, true);
+        json_uint(serial, "drop", rx_stats.dropped, true);
+        json_uint(serial, "hw", rx_stats.high_water, false);
+        json_objEnd(serial, true);
+        json_arrayStart(serial, "filt");
+        for (size_t i = 0; i < CAN_CHANNELS; i++) {
+                struct can_filter_status status;
+                CAN_filter_get_status(i, &status);
+
+                json_objStart(serial);
+                json_bool(serial, "all", status.accept_all, true);
+                json_uint(serial, "banks", status.bank_count, true);
+                json_uint(serial, "rx", status.accepted, true);
+                json_uint(serial, "lat", status.max_latency_us, false);
+                json_objEnd(serial, i < CAN_CHANNELS - 1);
+        }
+        json_arrayEnd(serial, false);
+        json_objEnd(serial, more);
+}
+
 #if IMU_CHANNELS > 0
 static void get_imu_status(struct Serial *serial, const bool more)
 {
@@ -323,6 +352,8 @@ int api_getStatus(struct Serial *serial, const jsmntok_t *json)
         json_int(serial, "armed", lc_is_armed(), 0);
         json_objEnd(serial, true);
 
+        get_can_status(serial, true);
+
 #if IMU_CHANNELS > 0
         get_imu_status(serial, true);
 #endif
@@ -358,16 +389,23 @@ int api_sampleData(struct Serial *serial, const jsmntok_t *json)
         if (0 == channelCount)
                 return API_ERROR_SEVERE;
 
+        struct sample_channels sc;
         struct sample s;
+        memset(&sc, 0, sizeof(struct sample_channels));
         memset(&s, 0, sizeof(struct sample));
-        const size_t size = init_sample_buffer(&s, channelCount);
-        if (!size)
+        if (!init_sample_channels(&sc, channelCount))
                 return API_ERROR_SEVERE;
 
+        if (!init_sample_buffer(&s, &sc)) {
+                free_sample_channels(&sc);
+                return API_ERROR_SEVERE;
+        }
+
         populate_sample_buffer(&s, 0);
         api_send_sample_record(serial, &s, 0, sendMeta);
 
         free_sample_buffer(&s);
+        free_sample_channels(&sc);
         return API_SUCCESS_NO_RETURN;
 }
 
@@ -537,7 +575,13 @@ static void json_channelConfig(struct Serial *serial, const ChannelConfig *cfg,
         json_float(serial, "min", cfg->min, cfg->precision, 1);
         json_float(serial, "max", cfg->max, cfg->precision, 1);
         json_int(serial, "prec", (int) cfg->precision, 1);
-        json_int(serial, "sr", decodeSampleRate(cfg->sampleRate), more);
+
+        /* Only channels that use a deadband carry it */
+        const bool deadband = cfg->deadband > 0;
+        json_int(serial, "sr", decodeSampleRate(cfg->sampleRate),
+                 deadband || more);
+        if (deadband)
+                json_float(serial, "db", cfg->deadband, DEADBAND_PRECISION, more);
 }
 
 static void write_sample_meta(struct Serial *serial, const struct sample *sample,
@@ -568,15 +612,19 @@ int api_getMeta(struct Serial *serial, const jsmntok_t *json)
         if (0 == channelCount)
                 return API_ERROR_SEVERE;
 
-        struct sample s;
-        memset(&s, 0, sizeof(struct sample));
-        const size_t size = init_sample_buffer(&s, channelCount);
-        if (!size)
+        struct sample_channels sc;
+        memset(&sc, 0, sizeof(struct sample_channels));
+        if (!init_sample_channels(&sc, channelCount))
                 return API_ERROR_SEVERE;
 
+        /* Only the channel descriptors are needed for the meta data */
+        const struct sample s = {
+                .channel_count = sc.count,
+                .channel_samples = sc.samples,
+        };
         write_sample_meta(serial, &s, getConnectivitySampleRateLimit(), 0);
 
-        free_sample_buffer(&s);
+        free_sample_channels(&sc);
         json_objEnd(serial, 0);
         return API_SUCCESS_NO_RETURN;
 }
@@ -601,7 +649,7 @@ void api_send_sample_record(struct Serial *serial,
         memset(channelBitmask, 0, sizeof(channelBitmask));
 
         json_arrayStart(serial, "d");
-        ChannelSample *cs = sample->channel_samples;
+        const ChannelSample *cs = sample->channel_samples;
 
         size_t channelBitPosition = 0;
         for (size_t i = 0; i < sample->channel_count;
@@ -614,7 +662,7 @@ void api_send_sample_record(struct Serial *serial,
                                 break;
                 }
 
-                if (cs->populated) {
+                if (sample_is_populated(sample, i)) {
                         channelBitmask[channelBitmaskIndex] |=
                                 (1 << channelBitPosition);
 
@@ -622,19 +670,21 @@ void api_send_sample_record(struct Serial *serial,
                         switch(cs->sampleData) {
                         case SampleData_Float:
                         case SampleData_Float_Noarg:
-                                put_float(serial, cs->valueFloat, precision);
+                                put_float(serial, sample_get_float(sample, i),
+                                          precision);
                                 break;
                         case SampleData_Int:
                         case SampleData_Int_Noarg:
-                                put_int(serial, cs->valueInt);
+                                put_int(serial, sample_get_int(sample, i));
                                 break;
                         case SampleData_LongLong:
                         case SampleData_LongLong_Noarg:
-                                put_ll(serial, cs->valueLongLong);
+                                put_ll(serial, sample_get_longlong(sample, i));
                                 break;
                         case SampleData_Double:
                         case SampleData_Double_Noarg:
-                                put_double(serial, cs->valueDouble, precision);
+                                put_double(serial, sample_get_double(sample, i),
+                                           precision);
                                 break;
                         default:
                                 pr_warning_int_msg("[loggerApi] Unknown sample"
@@ -698,6 +748,8 @@ static const jsmntok_t * setChannelConfig(struct Serial *serial, const jsmntok_t
                         channelCfg->sampleRate = encodeSampleRate(atoi(value));
                 else if (STR_EQ("prec", name))
                         channelCfg->precision = (unsigned char) atoi(value);
+                else if (STR_EQ("db", name))
+                        channelCfg->deadband = MAX(0, atof(value));
                 else if (setExtField != NULL)
                         cfg = setExtField(valueTok, name, value, extCfg);
         }
@@ -779,6 +831,63 @@ static const jsmntok_t * setScalingRow(ADCConfig *adcCfg, const jsmntok_t *mapRo
         return mapRow;
 }
 
+static bool setHistogramField(struct histogram_config *hc, const char *name,
+                              const char *value)
+{
+        if (STR_EQ("hist", name))
+                hc->mode = filterHistogramMode(atoi(value));
+        else if (STR_EQ("hsrc", name))
+                hc->source = filterHistogramSource(atoi(value));
+        else if (STR_EQ("hbins", name))
+                hc->bins = filterHistogramBins(atoi(value));
+        else if (STR_EQ("hmin", name))
+                hc->min = atof(value);
+        else if (STR_EQ("hmax", name))
+                hc->max = atof(value);
+        else
+                return false;
+
+        return true;
+}
+
+static bool setSpectralField(struct spectral_config *sc, const char *name,
+                             const char *value)
+{
+        if (STR_EQ("spec", name))
+                sc->mode = filterSpectralMode(atoi(value));
+        else if (STR_EQ("sbands", name))
+                sc->bands = filterSpectralBands(atoi(value));
+        else if (STR_EQ("smin", name))
+                sc->min_hz = MAX(0, atof(value));
+        else if (STR_EQ("smax", name))
+                sc->max_hz = MAX(0, atof(value));
+        else
+                return false;
+
+        return true;
+}
+
+static void json_spectralConfig(struct Serial *serial,
+                                const struct spectral_config *sc,
+                                const int more)
+{
+        json_uint(serial, "spec", sc->mode, 1);
+        json_uint(serial, "sbands", sc->bands, 1);
+        json_float(serial, "smin", sc->min_hz, FILTER_CUTOFF_PRECISION, 1);
+        json_float(serial, "smax", sc->max_hz, FILTER_CUTOFF_PRECISION, more);
+}
+
+static void json_histogramConfig(struct Serial *serial,
+                                 const struct histogram_config *hc,
+                                 const int more)
+{
+        json_uint(serial, "hist", hc->mode, 1);
+        json_uint(serial, "hsrc", hc->source, 1);
+        json_uint(serial, "hbins", hc->bins, 1);
+        json_float(serial, "hmin", hc->min, DEFAULT_ANALOG_SCALING_PRECISION, 1);
+        json_float(serial, "hmax", hc->max, DEFAULT_ANALOG_SCALING_PRECISION, more);
+}
+
 static const jsmntok_t * setAnalogExtendedField(const jsmntok_t *valueTok, const char *name, const char *value, void *cfg)
 {
         ADCConfig *adcCfg = (ADCConfig *)cfg;
@@ -792,6 +901,14 @@ static const jsmntok_t * setAnalogExtendedField(const jsmntok_t *valueTok, const
                 adcCfg->filterAlpha = atof(value);
         else if (STR_EQ("cal", name))
                 adcCfg->calibration = atof(value);
+        else if (STR_EQ("agg", name))
+                adcCfg->aggregation = filterAggregation(atoi(value));
+        else if (STR_EQ("ftype", name))
+                adcCfg->filterType = filterAnalogFilterType(atoi(value));
+        else if (STR_EQ("cutoff", name))
+                adcCfg->filterCutoff = MAX(0, atof(value));
+        else if (STR_EQ("hr", name))
+                adcCfg->highRate = atoi(value) != 0;
         else if (STR_EQ("map", name)) {
                 if (valueTok->type == JSMN_OBJECT) {
                         valueTok++;
@@ -799,7 +916,8 @@ static const jsmntok_t * setAnalogExtendedField(const jsmntok_t *valueTok, const
                         valueTok = setScalingRow(adcCfg, valueTok);
                         valueTok--;
                 }
-        }
+        } else if (!setHistogramField(&adcCfg->histogram, name, value))
+                setSpectralField(&adcCfg->spectral, name, value);
         return valueTok + 1;
 }
 
@@ -837,6 +955,12 @@ static void sendAnalogConfig(struct Serial *serial, size_t startIndex, size_t en
                 json_float(serial, "offset", adcCfg->linearOffset, LINEAR_SCALING_PRECISION, 1);
                 json_float(serial, "alpha", adcCfg->filterAlpha, FILTER_ALPHA_PRECISION, 1);
                 json_float(serial, "cal", adcCfg->calibration, LINEAR_SCALING_PRECISION, 1);
+                json_uint(serial, "agg", adcCfg->aggregation, 1);
+                json_uint(serial, "ftype", adcCfg->filterType, 1);
+                json_float(serial, "cutoff", adcCfg->filterCutoff, FILTER_CUTOFF_PRECISION, 1);
+                json_uint(serial, "hr", adcCfg->highRate, 1);
+                json_histogramConfig(serial, &adcCfg->histogram, 1);
+                json_spectralConfig(serial, &adcCfg->spectral, 1);
 
                 json_objStartString(serial, "map");
                 json_arrayStart(serial, "raw");
@@ -900,6 +1024,10 @@ static const jsmntok_t * setImuExtendedField(const jsmntok_t *valueTok, const ch
                 imuCfg->zeroValue = atoi(value);
         else if (STR_EQ("alpha", name))
                 imuCfg->filterAlpha = atof(value);
+        else if (STR_EQ("agg", name))
+                imuCfg->aggregation = filterAggregation(atoi(value));
+        else if (!setHistogramField(&imuCfg->histogram, name, value))
+                setSpectralField(&imuCfg->spectral, name, value);
         return valueTok + 1;
 }
 
@@ -931,7 +1059,10 @@ static void sendImuConfig(struct Serial *serial, size_t startIndex, size_t endIn
                 json_uint(serial, "mode", cfg->mode, 1);
                 json_uint(serial, "chan", cfg->physicalChannel, 1);
                 json_int(serial, "zeroVal", cfg->zeroValue, 1);
-                json_float(serial, "alpha", cfg->filterAlpha, FILTER_ALPHA_PRECISION, 0 );
+                json_float(serial, "alpha", cfg->filterAlpha, FILTER_ALPHA_PRECISION, 1);
+                json_uint(serial, "agg", cfg->aggregation, 1);
+                json_histogramConfig(serial, &cfg->histogram, 1);
+                json_spectralConfig(serial, &cfg->spectral, 0);
                 json_objEnd(serial, i != endIndex); //index
         }
         json_objEnd(serial, 0);
@@ -958,6 +1089,43 @@ int api_getImuConfig(struct Serial *serial, const jsmntok_t *json)
                 return API_ERROR_PARAMETER;
         }
 }
+
+int api_getImuMounting(struct Serial *serial, const jsmntok_t *json)
+{
+        const struct imu_mounting *m =
+                &getWorkingLoggerConfig()->imu_mounting;
+
+        json_objStart(serial);
+        json_objStartString(serial, "imuMount");
+        json_float(serial, "roll", m->roll, IMU_MOUNTING_PRECISION, 1);
+        json_float(serial, "pitch", m->pitch, IMU_MOUNTING_PRECISION, 1);
+        json_float(serial, "yaw", m->yaw, IMU_MOUNTING_PRECISION, 0);
+        json_objEnd(serial, 0);
+        json_objEnd(serial, 0);
+        return API_SUCCESS_NO_RETURN;
+}
+
+/*
+ * Sets the mounting angles that are given.  With "cal" set, roll and pitch
+ * are instead measured from gravity by imu_calibrate_mounting.
+ */
+int api_setImuMounting(struct Serial *serial, const jsmntok_t *json)
+{
+        LoggerConfig *lc = getWorkingLoggerConfig();
+        struct imu_mounting *m = &lc->imu_mounting;
+        bool calibrate = false;
+
+        jsmn_exists_set_val_float(json, "roll", &m->roll);
+        jsmn_exists_set_val_float(json, "pitch", &m->pitch);
+        jsmn_exists_set_val_float(json, "yaw", &m->yaw);
+        jsmn_exists_set_val_bool(json, "cal", &calibrate);
+
+        imu_soft_init(lc);
+        if (calibrate)
+                imu_calibrate_mounting();
+
+        return API_SUCCESS;
+}
 #endif
 
 int api_getCellConfig(struct Serial *serial, const jsmntok_t *json)
@@ -1424,7 +1592,8 @@ int api_getCanConfig(struct Serial *serial, const jsmntok_t *json)
                 json_arrayElementInt(serial, canCfg->termination[i], i < CONFIG_CAN_CHANNELS - 1);
         }
 #endif
-        json_arrayEnd(serial, 0);
+        json_arrayEnd(serial, 1);
+        json_bool(serial, "filt", canCfg->auto_filter, 0);
         json_objEnd(serial, 0);
         json_objEnd(serial, 0);
         return API_SUCCESS_NO_RETURN;
@@ -1437,6 +1606,7 @@ int api_setCanConfig(struct Serial *serial, const jsmntok_t *json)
         LoggerConfig *lc = getWorkingLoggerConfig();
         CANConfig *canCfg = &lc->CanConfig;
         jsmn_exists_set_val_uint8( json, "en", &canCfg->enabled, NULL);
+        jsmn_exists_set_val_bool(json, "filt", &canCfg->auto_filter);
 
         {
                 const jsmntok_t *tok = jsmn_find_node(json, "baud");
@@ -2273,6 +2443,7 @@ int api_set_virtual_channel_value(struct Serial *serial, const jsmntok_t *json)
                         pr_error_str_msg(_LOG_PFX "Missing prec, using default", channel_name);
 
                 ChannelConfig cc;
+                channel_config_defaults(&cc);
                 strncpy(cc.label, channel_name, DEFAULT_LABEL_LENGTH);
                 strncpy(cc.units, units, DEFAULT_UNITS_LENGTH);
                 cc.min = minval;
@@ -2335,7 +2506,8 @@ int api_rx_can(struct Serial *serial, const jsmntok_t *json)
  * Receive CAN messages, or configure filter for receving
  * Configure filter: {"rxCan": {"bus": 1, "lowid": 41474, "highid": 41574}}
  * Poll available messages: {"rxCan": null}
- * Response: {"rxCan":{"msg":[{"bus":1,"id":41474,"data":[28,12,52,85,85,1,0,1]]}}
+ * Response: {"rxCan":{"msg":[{"bus":1,"id":41474,"ts":5120340,"data":[28,12,52,85,85,1,0,1]]}}
+ * ts is the receive time in microseconds, see cpu_get_usec().
  **/
 {
         uint8_t can_bus = 0;
@@ -2349,6 +2521,7 @@ int api_rx_can(struct Serial *serial, const jsmntok_t *json)
         /* perform configuration and exit */
         if (low_id_range && high_id_range) {
                 CAN_aux_filterqueue_configure(can_bus, low_id_range, high_id_range);
+                CAN_filter_apply(getWorkingLoggerConfig());
                 return API_SUCCESS;
         }
 
@@ -2364,6 +2537,7 @@ int api_rx_can(struct Serial *serial, const jsmntok_t *json)
                 json_objStart(serial);
                 json_uint(serial, "bus", can_msg.can_bus, true);
                 json_uint(serial, "id", can_msg.addressValue, true);
+                json_uint(serial, "ts", can_msg.timestamp, true);
                 json_arrayStart(serial, "data");
                 for (size_t i = 0; i < can_msg.dataLength; i++) {
                         json_arrayElementInt(serial, can_msg.data[i], i < can_msg.dataLength - 1);
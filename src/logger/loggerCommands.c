@@ -232,6 +232,57 @@ done:
         serial_flush(serial);
 }
 
+void SetLogFormat(struct Serial *serial, unsigned int argc, char **argv)
+{
+        if (argc != 2) {
+                put_commandError(serial, ERROR_CODE_INVALID_PARAM);
+                return;
+        }
+
+        const enum log_file_format format =
+                filter_log_file_format(atoi(argv[1]));
+        getWorkingLoggerConfig()->logging_cfg.file_format = format;
+
+        serial_write_s(serial, LOG_FILE_FORMAT_BINARY == format ?
+                       "Binary" : "CSV");
+        serial_write_s(serial, "\r\n");
+        put_commandOK(serial);
+}
+
+void SetLogCommit(struct Serial *serial, unsigned int argc, char **argv)
+{
+        if (argc != 3) {
+                put_commandError(serial, ERROR_CODE_INVALID_PARAM);
+                return;
+        }
+
+        struct logging_config *lc = &getWorkingLoggerConfig()->logging_cfg;
+        lc->file_commit_size = filter_log_file_commit_size(atoi(argv[1]));
+        lc->file_commit_interval_ms =
+                filter_log_file_commit_interval(atoi(argv[2]));
+
+        put_nameUint(serial, "bytes", lc->file_commit_size);
+        put_nameUint(serial, "ms", lc->file_commit_interval_ms);
+        put_commandOK(serial);
+}
+
+void ShowSampleStats(struct Serial *serial, unsigned int argc, char **argv)
+{
+        put_nameUint(serial, "slots", get_sample_ring_size());
+        put_nameUint(serial, "maxSlots", LOGGER_MESSAGE_BUFFER_SIZE);
+
+        put_nameUint(serial, "fileOverruns",
+                     sample_get_overruns(SAMPLE_CONSUMER_FILE_WRITER));
+        for (size_t i = 0; i < CONNECTIVITY_CHANNELS; ++i)
+                put_nameIndexUint(serial, "telemOverruns", i,
+                                  sample_get_overruns(SAMPLE_CONSUMER_TELEMETRY + i));
+        put_nameUint(serial, "wifiOverruns",
+                     sample_get_overruns(SAMPLE_CONSUMER_WIFI));
+        put_nameUint(serial, "usbOverruns",
+                     sample_get_overruns(SAMPLE_CONSUMER_USB));
+        put_commandOK(serial);
+}
+
 void FlashConfig(struct Serial *serial, unsigned int argc, char **argv)
 {
         const bool success = flashLoggerConfig() == 0;
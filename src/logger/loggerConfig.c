@@ -22,10 +22,12 @@
 #include "capabilities.h"
 #include "channel_config.h"
 #include "cpu.h"
+#include "histogram.h"
 #include "loggerConfig.h"
 #include "memory.h"
 #include "modp_numtoa.h"
 #include "printk.h"
+#include "spectral.h"
 #include "str_util.h"
 #include "timer_config.h"
 #include "units.h"
@@ -207,6 +209,7 @@ static void resetCanConfig(CANConfig *cfg)
                 cfg->termination[i] = true;
 #endif
         }
+        cfg->auto_filter = false;
 }
 
 uint8_t filter_can_bus_channel(uint8_t value)
@@ -321,6 +324,9 @@ static void resetConnectivityConfig(ConnectivityConfig *cfg)
 static void reset_logging_config(struct logging_config *lc)
 {
         memset(lc, 0, sizeof(struct logging_config));
+        lc->file_format = LOG_FILE_FORMAT_CSV;
+        lc->file_commit_size = DEFAULT_LOG_FILE_COMMIT_SIZE;
+        lc->file_commit_interval_ms = DEFAULT_LOG_FILE_COMMIT_INTERVAL_MS;
 }
 
 bool isHigherSampleRate(const int contender, const int champ)
@@ -393,6 +399,32 @@ uint8_t filter_background_streaming_mode(uint8_t mode)
         return mode == 0 ? 0 : 1;
 }
 
+enum log_file_format filter_log_file_format(int format)
+{
+        switch (format) {
+        case LOG_FILE_FORMAT_BINARY:
+                return LOG_FILE_FORMAT_BINARY;
+        case LOG_FILE_FORMAT_CSV:
+        default:
+                return LOG_FILE_FORMAT_CSV;
+        }
+}
+
+uint16_t filter_log_file_commit_size(int size)
+{
+        /* Only commit whole sectors */
+        size -= size % LOG_FILE_SECTOR_SIZE;
+        return (uint16_t) MAX(LOG_FILE_COMMIT_SIZE_MIN,
+                              MIN(LOG_FILE_COMMIT_SIZE_MAX, size));
+}
+
+uint16_t filter_log_file_commit_interval(int interval_ms)
+{
+        return (uint16_t) MAX(LOG_FILE_COMMIT_INTERVAL_MS_MIN,
+                              MIN(LOG_FILE_COMMIT_INTERVAL_MS_MAX,
+                                  interval_ms));
+}
+
 #if TIMER_CHANNELS > 0
 unsigned short filterTimerDivider(unsigned short speed)
 {
@@ -512,6 +544,83 @@ unsigned char filterAnalogScalingMode(unsigned char mode)
         }
 }
 
+unsigned char filterAnalogFilterType(unsigned char type)
+{
+        switch(type) {
+        case ANALOG_FILTER_TYPE_BIQUAD:
+                return ANALOG_FILTER_TYPE_BIQUAD;
+        default:
+        case ANALOG_FILTER_TYPE_EMA:
+                return ANALOG_FILTER_TYPE_EMA;
+        }
+}
+
+unsigned char filterAggregation(unsigned char mode)
+{
+        switch(mode) {
+        case AGGREGATION_MEAN:
+        case AGGREGATION_MIN:
+        case AGGREGATION_MAX:
+        case AGGREGATION_MIN_MAX:
+                return mode;
+        default:
+                return AGGREGATION_LAST;
+        }
+}
+
+unsigned char filterHistogramMode(unsigned char mode)
+{
+        switch(mode) {
+        case HISTOGRAM_MODE_LAP:
+        case HISTOGRAM_MODE_ROLLING:
+                return mode;
+        default:
+                return HISTOGRAM_MODE_DISABLED;
+        }
+}
+
+unsigned char filterHistogramSource(unsigned char source)
+{
+        switch(source) {
+        case HISTOGRAM_SOURCE_RATE:
+                return HISTOGRAM_SOURCE_RATE;
+        default:
+        case HISTOGRAM_SOURCE_VALUE:
+                return HISTOGRAM_SOURCE_VALUE;
+        }
+}
+
+unsigned char filterHistogramBins(int bins)
+{
+        if (bins < HISTOGRAM_BINS_MIN)
+                return HISTOGRAM_BINS_MIN;
+        if (bins > HISTOGRAM_BINS_MAX)
+                return HISTOGRAM_BINS_MAX;
+
+        return bins;
+}
+
+unsigned char filterSpectralMode(unsigned char mode)
+{
+        switch(mode) {
+        case SPECTRAL_MODE_BANDS:
+        case SPECTRAL_MODE_PEAK:
+                return mode;
+        default:
+                return SPECTRAL_MODE_DISABLED;
+        }
+}
+
+unsigned char filterSpectralBands(int bands)
+{
+        if (bands < 1)
+                return 1;
+        if (bands > SPECTRAL_BANDS_MAX)
+                return SPECTRAL_BANDS_MAX;
+
+        return bands;
+}
+
 unsigned int getHighestSampleRate(LoggerConfig *config)
 {
         int s = SAMPLE_DISABLED;
@@ -643,9 +752,16 @@ size_t get_enabled_channel_count(LoggerConfig *loggerConfig)
                 if (loggerConfig->TimeConfigs[i].cfg.sampleRate != SAMPLE_DISABLED)
                         ++channels;
 #if IMU_CHANNELS > 0
-        for (size_t i=0; i < CONFIG_IMU_CHANNELS; i++)
-                if (loggerConfig->ImuConfigs[i].cfg.sampleRate != SAMPLE_DISABLED)
+        for (size_t i=0; i < CONFIG_IMU_CHANNELS; i++) {
+                ImuConfig *c = &loggerConfig->ImuConfigs[i];
+                if (c->cfg.sampleRate == SAMPLE_DISABLED)
+                        continue;
+
+                ++channels;
+                /* The min of a min/max pair has its own channel */
+                if (c->aggregation == AGGREGATION_MIN_MAX)
                         ++channels;
+        }
 
         if (loggerConfig->imu_gsum.sampleRate != SAMPLE_DISABLED) channels++;
 #ifdef GSUMMAX
@@ -655,9 +771,15 @@ size_t get_enabled_channel_count(LoggerConfig *loggerConfig)
 #endif
 
 #if ANALOG_CHANNELS > 0
-        for (size_t i=0; i < CONFIG_ADC_CHANNELS; i++)
-                if (loggerConfig->ADCConfigs[i].cfg.sampleRate != SAMPLE_DISABLED)
+        for (size_t i=0; i < CONFIG_ADC_CHANNELS; i++) {
+                ADCConfig *c = &loggerConfig->ADCConfigs[i];
+                if (c->cfg.sampleRate == SAMPLE_DISABLED)
+                        continue;
+
+                ++channels;
+                if (c->aggregation == AGGREGATION_MIN_MAX)
                         ++channels;
+        }
 #endif
 
 #if TIMER_CHANNELS > 0
@@ -722,6 +844,9 @@ size_t get_enabled_channel_count(LoggerConfig *loggerConfig)
         channels += get_virtual_channel_count();
 #endif /* VIRTUAL_CHANNEL_SUPPORT */
 
+        channels += get_histogram_channel_count();
+        channels += get_spectral_channel_count();
+
         return channels;
 }
 
@@ -760,6 +885,9 @@ void reset_logger_config(void)
 #else
         resetImuConfig(lc->ImuConfigs, &lc->imu_gsum, NULL, NULL );
 #endif
+        static const struct imu_mounting default_mounting =
+                DEFAULT_IMU_MOUNTING;
+        lc->imu_mounting = default_mounting;
 #endif
 
         resetCanConfig(&lc->CanConfig);
@@ -29,6 +29,7 @@
 #include "predictive_timer_2.h"
 #include "filter.h"
 #include "lap_stats.h"
+#include "timer.h"
 void init_logger_data()
 {
 }
@@ -37,5 +38,8 @@ void doBackgroundSampling()
 {
         imu_sample_all();
         ADC_sample_all();
+#if TIMER_CHANNELS > 0
+        timer_sample_all();
+#endif
         lapstats_update_distance();
 }
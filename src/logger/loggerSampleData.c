@@ -30,6 +30,8 @@
 #include "geopoint.h"
 #include "gps.h"
 #include "gps_device.h"
+#include "high_rate_lane.h"
+#include "histogram.h"
 #include "imu.h"
 #include "imu_gsum.h"
 #include "lap_stats.h"
@@ -41,6 +43,8 @@
 #include "macros.h"
 #include "predictive_timer_2.h"
 #include "printk.h"
+#include "sample_aggregate.h"
+#include "spectral.h"
 #include "sampleRecord.h"
 #include "taskUtil.h"
 #include "timer.h"
@@ -48,6 +52,7 @@
 #include "virtual_channel.h"
 #include <math.h>
 #include <stdbool.h>
+#include <string.h>
 
 #define SAMPLE_CB_REGISTRY_SIZE	8
 
@@ -91,6 +96,26 @@ static ChannelSample* processChannelSampleWithIntGetter(ChannelSample *s,
 }
 #endif
 
+/**
+ * Like processChannelSampleWithFloatGetter, but also resolves the channel
+ * down to a pipeline if its module can provide one.
+ */
+static ChannelSample* processChannelSampleWithPipeline(ChannelSample *s,
+                ChannelConfig *cfg,
+                const size_t index,
+                float (*getter)(int),
+                bool (*get_pipeline)(size_t, struct channel_pipeline *))
+{
+        ChannelSample *next =
+                processChannelSampleWithFloatGetter(s, cfg, index, getter);
+        struct channel_pipeline pipeline;
+
+        if (next != s && get_pipeline(index, &pipeline))
+                s->pipeline = pipeline;
+
+        return next;
+}
+
 static ChannelSample* processChannelSampleWithFloatGetterNoarg(ChannelSample *s,
                 ChannelConfig *cfg,
                 float (*getter)())
@@ -168,25 +193,7 @@ float get_mapped_value(float value, ScalingMap *scalingMap)
 #if ANALOG_CHANNELS > 0
 float get_analog_sample(int channelId)
 {
-        LoggerConfig * loggerConfig = getWorkingLoggerConfig();
-        ADCConfig *ac = &(loggerConfig->ADCConfigs[channelId]);
-        float value = ADC_read(channelId);
-        float analogValue = 0;
-        switch(ac->scalingMode) {
-        case SCALING_MODE_RAW:
-                analogValue = value;
-                break;
-        case SCALING_MODE_LINEAR:
-                analogValue = (ac->linearScaling * (float)value) + ac->linearOffset;
-                break;
-        case SCALING_MODE_MAP:
-                analogValue = get_mapped_value((float)value,&(ac->scalingMap));
-                break;
-        default:
-                analogValue = -1;
-                break;
-        }
-        return analogValue;
+        return ADC_read_scaled(channelId);
 }
 #endif
 
@@ -217,10 +224,7 @@ float get_pwm_sample(int channelId)
 #if IMU_CHANNELS > 0
 float get_imu_sample(int channelId)
 {
-        LoggerConfig *config = getWorkingLoggerConfig();
-        ImuConfig *c = &(config->ImuConfigs[channelId]);
-        float value = imu_read_value(channelId, c);
-        return value;
+        return imu_read_scaled(channelId);
 }
 #endif
 
@@ -249,10 +253,98 @@ static long long get_utc_time_helper(void)
         return (long long)GPS_get_UTC_time();
 }
 
-void init_channel_sample_buffer(LoggerConfig *loggerConfig, struct sample *buff)
+static bool is_always_sampled(const ChannelSample *cs)
+{
+        return cs->cfg->flags & ALWAYS_SAMPLED;
+}
+
+/**
+ * Finds the group for the given rate, inserting it in fastest first
+ * order if it does not exist yet.
+ * @return The group, or NULL if there are too many distinct rates.
+ */
+static struct sample_rate_group* get_rate_group(struct sample_schedule *ss,
+                                                const unsigned short rate)
+{
+        struct sample_rate_group *group = ss->groups;
+        struct sample_rate_group * const end = group + ss->group_count;
+
+        for (; group < end && group->rate < rate; ++group);
+
+        if (group < end && group->rate == rate)
+                return group;
+
+        if (ss->group_count == SAMPLE_RATE_GROUPS_MAX)
+                return NULL;
+
+        memmove(group + 1, group, (end - group) * sizeof(*group));
+        group->rate = rate;
+        group->count = 0;
+        ++ss->group_count;
+
+        return group;
+}
+
+/**
+ * Buckets the channels of the sample by sample rate.  ALWAYS_SAMPLED
+ * channels still contribute their rate so that they trigger a sample,
+ * but are kept in their own list since they are taken with every sample.
+ */
+static void init_sample_schedule(struct sample_channels *sc)
+{
+        struct sample_schedule *ss = &sc->schedule;
+        const ChannelSample *cs = sc->samples;
+        const size_t count = sc->count;
+        uint16_t offsets[SAMPLE_RATE_GROUPS_MAX];
+        uint16_t always_offset = 0;
+
+        ss->last_tick = 0;
+        ss->next_tick = 0;
+        ss->group_count = 0;
+        ss->always_count = 0;
+
+        for (size_t i = 0; i < count; ++i) {
+                struct sample_rate_group *group =
+                        get_rate_group(ss, cs[i].cfg->sampleRate);
+
+                if (!group) {
+                        pr_warning_str_msg("Too many sample rates. Dropping ",
+                                           cs[i].cfg->label);
+                        continue;
+                }
+
+                if (is_always_sampled(cs + i)) {
+                        ++ss->always_count;
+                } else {
+                        ++group->count;
+                }
+        }
+
+        for (size_t g = 0; g < ss->group_count; ++g) {
+                offsets[g] = always_offset;
+                always_offset += ss->groups[g].count;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+                if (is_always_sampled(cs + i)) {
+                        ss->channel_index[always_offset++] = i;
+                        continue;
+                }
+
+                for (size_t g = 0; g < ss->group_count; ++g) {
+                        if (ss->groups[g].rate != cs[i].cfg->sampleRate)
+                                continue;
+
+                        ss->channel_index[offsets[g]++] = i;
+                        break;
+                }
+        }
+}
+
+void init_channel_sample_buffer(LoggerConfig *loggerConfig,
+                                struct sample_channels *sc)
 {
-        buff->ticks = 0;
-        ChannelSample *sample = buff->channel_samples;
+        ChannelSample *sample = sc->samples;
         ChannelConfig *chanCfg;
 
         /*
@@ -281,7 +373,18 @@ void init_channel_sample_buffer(LoggerConfig *loggerConfig, struct sample *buff)
         for (int i=0; i < CONFIG_ADC_CHANNELS; i++) {
                 ADCConfig *config = &(loggerConfig->ADCConfigs[i]);
                 chanCfg = &(config->cfg);
-                sample = processChannelSampleWithFloatGetter(sample, chanCfg, i, get_analog_sample);
+                if (config->aggregation == AGGREGATION_LAST) {
+                        sample = processChannelSampleWithPipeline(sample, chanCfg, i,
+                                        get_analog_sample, ADC_get_pipeline);
+                        continue;
+                }
+
+                sample = processChannelSampleWithFloatGetter(sample, chanCfg, i, get_analog_aggregate);
+                if (config->aggregation == AGGREGATION_MIN_MAX) {
+                        chanCfg = get_analog_aggregate_min_config(i);
+                        init_aggregate_min_config(chanCfg, &config->cfg);
+                        sample = processChannelSampleWithFloatGetter(sample, chanCfg, i, get_analog_aggregate_min);
+                }
         }
 #endif
 
@@ -289,7 +392,18 @@ void init_channel_sample_buffer(LoggerConfig *loggerConfig, struct sample *buff)
         for (int i = 0; i < CONFIG_IMU_CHANNELS; i++) {
                 ImuConfig *config = &(loggerConfig->ImuConfigs[i]);
                 chanCfg = &(config->cfg);
-                sample = processChannelSampleWithFloatGetter(sample, chanCfg, i, get_imu_sample);
+                if (config->aggregation == AGGREGATION_LAST) {
+                        sample = processChannelSampleWithPipeline(sample, chanCfg, i,
+                                        get_imu_sample, imu_get_pipeline);
+                        continue;
+                }
+
+                sample = processChannelSampleWithFloatGetter(sample, chanCfg, i, get_imu_aggregate);
+                if (config->aggregation == AGGREGATION_MIN_MAX) {
+                        chanCfg = get_imu_aggregate_min_config(i);
+                        init_aggregate_min_config(chanCfg, &config->cfg);
+                        sample = processChannelSampleWithFloatGetter(sample, chanCfg, i, get_imu_aggregate_min);
+                }
         }
         sample = processChannelSampleWithFloatGetterNoarg(sample, &loggerConfig->imu_gsum, get_imu_gsum);
 #ifdef GSUMMAX
@@ -298,11 +412,30 @@ void init_channel_sample_buffer(LoggerConfig *loggerConfig, struct sample *buff)
 #endif
 #endif
 
+        const size_t histograms = get_histogram_count();
+        for (size_t h = 0; h < histograms; h++) {
+                for (size_t b = 0; b < get_histogram_bins(h); b++) {
+                        chanCfg = get_histogram_bin_config(h, b);
+                        sample = processChannelSampleWithFloatGetter(sample, chanCfg,
+                                        h * HISTOGRAM_BINS_MAX + b, get_histogram_bin);
+                }
+        }
+
+        const size_t spectral_channels = get_spectral_count();
+        for (size_t c = 0; c < spectral_channels; c++) {
+                for (size_t o = 0; o < get_spectral_channel_outputs(c); o++) {
+                        chanCfg = get_spectral_output_config(c, o);
+                        sample = processChannelSampleWithFloatGetter(sample, chanCfg,
+                                        c * SPECTRAL_BANDS_MAX + o, get_spectral_value);
+                }
+        }
+
 #if TIMER_CHANNELS > 0
         for (int i=0; i < CONFIG_TIMER_CHANNELS; i++) {
                 TimerConfig *config = &(loggerConfig->TimerConfigs[i]);
                 chanCfg = &(config->cfg);
-                sample = processChannelSampleWithFloatGetter(sample, chanCfg, i, timer_get_sample);
+                sample = processChannelSampleWithPipeline(sample, chanCfg, i,
+                                timer_get_sample, timer_get_pipeline);
         }
 #endif
 
@@ -385,78 +518,159 @@ void init_channel_sample_buffer(LoggerConfig *loggerConfig, struct sample *buff)
                         get_distance_getter(chanCfg));
         chanCfg = &(trackConfig->session_time_cfg);
         sample = processChannelSampleWithFloatGetterNoarg(sample, chanCfg, lapstats_session_time_minutes);
+
+        init_sample_schedule(sc);
+}
+
+/**
+ * Decides whether a freshly captured value should be emitted, and if so
+ * remembers it as the last emitted value of its channel.
+ */
+static bool is_outside_deadband(const struct sample *s, const size_t index)
+{
+        ChannelSample *cs = s->channel_samples + index;
+        const ChannelConfig *cfg = cs->cfg;
+        double value;
+
+        if (cfg->deadband <= 0 || (cfg->flags & ALWAYS_SAMPLED) ||
+            !sample_get_captured_value(s, index, &value))
+                return true;
+
+        if (s->ticks < cs->keyframe_tick &&
+            fabs(value - cs->emitted_value) <= cfg->deadband)
+                return false;
+
+        cs->emitted_value = value;
+        cs->keyframe_tick = s->ticks + DEADBAND_KEYFRAME_TICKS;
+        return true;
+}
+
+void force_channel_keyframe(struct sample_channels *sc)
+{
+        for (size_t i = 0; i < sc->count; ++i)
+                sc->samples[i].keyframe_tick = 0;
 }
 
-static void populate_channel_sample(ChannelSample *sample)
+static void read_channel_getter(const ChannelSample *sample, void *value)
 {
-        size_t channelIndex = sample->channelIndex;
+        const size_t channelIndex = sample->channelIndex;
 
         switch(sample->sampleData) {
         case SampleData_Int_Noarg:
-                sample->valueInt = sample->get_int_sample_noarg();
+                *(int *) value = sample->get_int_sample_noarg();
                 break;
         case SampleData_Int:
-                sample->valueInt = sample->get_int_sample(channelIndex);
+                *(int *) value = sample->get_int_sample(channelIndex);
                 break;
         case SampleData_LongLong_Noarg:
-                sample->valueLongLong = sample->get_longlong_sample_noarg();
+                *(long long *) value = sample->get_longlong_sample_noarg();
                 break;
         case SampleData_LongLong:
-                sample->valueLongLong = sample->get_longlong_sample(channelIndex);
+                *(long long *) value = sample->get_longlong_sample(channelIndex);
                 break;
         case SampleData_Float_Noarg:
-                sample->valueFloat = sample->get_float_sample_noarg();
+                *(float *) value = sample->get_float_sample_noarg();
                 break;
         case SampleData_Float:
-                sample->valueFloat = sample->get_float_sample(channelIndex);
+                *(float *) value = sample->get_float_sample(channelIndex);
                 break;
         case SampleData_Double_Noarg:
-                sample->valueDouble = sample->get_double_sample_noarg();
+                *(double *) value = sample->get_double_sample_noarg();
                 break;
         case SampleData_Double:
-                sample->valueDouble = sample->get_double_sample(channelIndex);
+                *(double *) value = sample->get_double_sample(channelIndex);
                 break;
         default:
                 pr_warning("populate channel sample: unknown sample type");
-                sample->valueLongLong = -1;
+                *(int *) value = -1;
                 break;
         }
 }
 
+static void populate_channel_sample(struct sample *s, const size_t index)
+{
+        const ChannelSample *sample = s->channel_samples + index;
+        void *value = sample_get_value(s, index);
+
+        /*
+         * The scaling mode can change under the pipeline, so a mapped
+         * one is only spotted here.
+         */
+        const struct channel_pipeline p = sample->pipeline;
+        if (p.raw && CHANNEL_SCALING_MAPPED != p.scaling->op) {
+                *(float *) value = channel_scaling_apply(p.scaling, *p.raw);
+        } else {
+                read_channel_getter(sample, value);
+        }
+
+        if (is_outside_deadband(s, index))
+                sample_set_populated(s, index);
+}
+
+static size_t get_next_due_tick(const struct sample_schedule *ss,
+                                const size_t tick)
+{
+        size_t next = 0;
+
+        for (size_t g = 0; g < ss->group_count; ++g) {
+                const size_t rate = ss->groups[g].rate;
+                const size_t due = (tick / rate + 1) * rate;
+
+                if (!next || due < next)
+                        next = due;
+        }
+
+        return next;
+}
+
+static void populate_channel_samples(struct sample *s, const uint16_t *index,
+                                     const size_t count)
+{
+        for (size_t i = 0; i < count; ++i)
+                populate_channel_sample(s, index[i]);
+}
+
+size_t get_next_sample_tick(const struct sample *s, const size_t tick)
+{
+        return get_next_due_tick(&s->channels->schedule, tick);
+}
+
 int populate_sample_buffer(struct sample *s, size_t logTick)
 {
+        struct sample_schedule *ss = &s->channels->schedule;
         unsigned short highestRate = SAMPLE_DISABLED;
-        ChannelSample *samples = s->channel_samples;
-        const size_t count = s->channel_count;
+        const uint16_t *index = ss->channel_index;
         s->ticks = logTick;
 
-        for (size_t i = 0; i < count; i++, samples++) {
-                const unsigned short sampleRate = samples->cfg->sampleRate;
+        /* Nothing can be due until the precomputed next due tick. */
+        if (ss->last_tick < logTick && logTick < ss->next_tick)
+                return SAMPLE_DISABLED;
 
-                if (logTick % sampleRate != 0) {
-                        samples->populated = false;
-                        continue;
+        ss->last_tick = logTick;
+        ss->next_tick = get_next_due_tick(ss, logTick);
+        sample_clear_populated(s);
+
+        /* Visit only the groups that are due */
+        for (size_t g = 0; g < ss->group_count; ++g) {
+                const struct sample_rate_group *group = ss->groups + g;
+
+                if (logTick % group->rate == 0) {
+                        highestRate = getHigherSampleRate(group->rate,
+                                                          highestRate);
+                        populate_channel_samples(s, index, group->count);
                 }
 
-                highestRate = getHigherSampleRate(sampleRate, highestRate);
-                samples->populated = true;
-                populate_channel_sample(samples);
+                index += group->count;
         }
 
         // Check if we got a sample.  If not, then bypass the rest as we are done.
         if (highestRate == SAMPLE_DISABLED)
                 return SAMPLE_DISABLED;
 
-        // If there was a sample taken, now we fill in the always sampled fields.
-        samples = s->channel_samples;
-        for (size_t i = 0; i < count; i++, samples++) {
-                const int isAlwaysSampled = samples->cfg->flags & ALWAYS_SAMPLED;
-                if (!isAlwaysSampled)
-                        continue;
+        s->high_rate_seq = high_rate_lane_get_seq();
 
-                samples->populated = true;
-                populate_channel_sample(samples);
-        }
+        /* The always sampled fields go along with every sample taken. */
+        populate_channel_samples(s, index, ss->always_count);
 
         return highestRate;
 }
@@ -19,15 +19,18 @@
  * this code. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "ADC.h"
 #include "FreeRTOS.h"
 #include "led.h"
 #include "capabilities.h"
 #include "connectivityTask.h"
 #include "fileWriter.h"
 #include "gps.h"
+#include "histogram.h"
 #include "imu.h"
 #include "lap_stats.h"
 #include "logger.h"
+#include "logger_message_ring.h"
 #include "loggerConfig.h"
 #include "loggerData.h"
 #include "loggerHardware.h"
@@ -38,7 +41,8 @@
 #include "panic.h"
 #include "printk.h"
 #include "sampleRecord.h"
-#include "semphr.h"
+#include "sample_aggregate.h"
+#include "spectral.h"
 #include "serial.h"
 #include "task.h"
 #include "taskUtil.h"
@@ -50,15 +54,27 @@
 
 #define BACKGROUND_SAMPLE_RATE	SAMPLE_50Hz
 
+/*
+ * Sample slots allocated up front.  The ring grows on demand up to
+ * LOGGER_MESSAGE_BUFFER_SIZE slots when consumers fall behind.
+ */
+#define SAMPLE_RING_MIN_SIZE	(LOGGER_MESSAGE_BUFFER_SIZE / 3 + 1)
+
+#if SDCARD_SUPPORT
+#define LOG_FILE_CONSUMERS	SAMPLE_CONSUMER_MASK(SAMPLE_CONSUMER_FILE_WRITER)
+#else
+#define LOG_FILE_CONSUMERS	0
+#endif
+
 int g_loggingShouldRun;
 bool g_config_changed;
 int g_telemetryBackgroundStreaming;
 struct sample * current_sample = NULL;
 
-xSemaphoreHandle onTick;
-
 /* This should be 0'd out accroding to C standards */
 static struct sample g_sample_buffer[LOGGER_MESSAGE_BUFFER_SIZE] = {0};
+static size_t g_sample_ring_size;
+static struct sample_channels g_sample_channels = {0};
 
 struct sample * get_current_sample(void)
 {
@@ -75,15 +91,6 @@ static LoggerMessage getLogStopMessage()
         return create_logger_message(LoggerMessageType_Stop, 0, NULL, false);
 }
 
-/**
- * Called into by FreeRTOS during the ISR that handles the tick timer.
- */
-void vApplicationTickHook(void)
-{
-        if (onTick)
-                xSemaphoreGiveFromISR(onTick, pdFALSE);
-}
-
 void configChanged()
 {
         g_config_changed = true;
@@ -129,10 +136,20 @@ static int init_sample_ring_buffer(LoggerConfig *loggerConfig)
         const size_t channel_count = get_enabled_channel_count(loggerConfig);
         struct sample *s = g_sample_buffer;
         const struct sample * const end = s + LOGGER_MESSAGE_BUFFER_SIZE;
-        int i;
 
-        for (i = 0; s < end; ++s, ++i) {
-                const size_t bytes = init_sample_buffer(s, channel_count);
+        /* Release the old buffers before the table they point into */
+        for (; s < end; ++s)
+                free_sample_buffer(s);
+
+        g_sample_ring_size = 0;
+        if (!init_sample_channels(&g_sample_channels, channel_count)) {
+                pr_error("Failed to allocate memory for sample channels\r\n");
+                return 0;
+        }
+
+        for (s = g_sample_buffer; g_sample_ring_size < SAMPLE_RING_MIN_SIZE;
+             ++s, ++g_sample_ring_size) {
+                const size_t bytes = init_sample_buffer(s, &g_sample_channels);
                 if (0 == bytes) {
                         /* If here, then can't alloc memory for buffers */
                         pr_error("Failed to allocate memory for sample buffers\r\n");
@@ -140,8 +157,47 @@ static int init_sample_ring_buffer(LoggerConfig *loggerConfig)
                 }
         }
 
-        pr_debug_int_msg("Sample buffers allocated: ", i);
-        return i;
+        pr_debug_int_msg("Sample buffers allocated: ", g_sample_ring_size);
+        return g_sample_ring_size;
+}
+
+/**
+ * Picks the slot for the next sample.  Slots still held by a consumer are
+ * never overwritten while there is a free one or room to grow the ring.
+ * Failing that, the oldest slot is reclaimed and every consumer still
+ * holding it is charged an overrun.
+ */
+static struct sample* get_next_sample_slot(const struct sample *current)
+{
+        const size_t start = current - g_sample_buffer + 1;
+        struct sample *oldest = NULL;
+
+        for (size_t i = 0; i < g_sample_ring_size; ++i) {
+                struct sample *s = g_sample_buffer +
+                        (start + i) % g_sample_ring_size;
+
+                if (!sample_is_referenced(s))
+                        return s;
+
+                if (!oldest || s->ticks < oldest->ticks)
+                        oldest = s;
+        }
+
+        if (g_sample_ring_size < LOGGER_MESSAGE_BUFFER_SIZE) {
+                struct sample *s = g_sample_buffer + g_sample_ring_size;
+                if (init_sample_buffer(s, &g_sample_channels)) {
+                        ++g_sample_ring_size;
+                        return s;
+                }
+        }
+
+        sample_reclaim(oldest);
+        return oldest;
+}
+
+size_t get_sample_ring_size(void)
+{
+        return g_sample_ring_size;
 }
 
 static int calcTelemetrySampleRate(LoggerConfig *config, int desiredSampleRate)
@@ -167,18 +223,59 @@ void updateSampleRates(LoggerConfig *loggerConfig, int *loggingSampleRate,
         pr_info("\r\n");
 }
 
+/**
+ * Works out the next logger tick at which there is work to do; either a
+ * channel in the sample is due or background sampling is due.  Sample
+ * callbacks only run on sample ticks so the channels cover them.
+ */
+static size_t get_next_wake_tick(const struct sample *s, const size_t tick,
+                                 const int background_rate)
+{
+        const size_t background = (tick / background_rate + 1) *
+                background_rate;
+        const size_t sample = s->channel_samples ?
+                get_next_sample_tick(s, tick) : 0;
+
+        return sample && sample < background ? sample : background;
+}
+
+/**
+ * Works out how often to refresh the internal sensors.  Aggregating
+ * channels and histograms need readings between their log ticks, and a
+ * log needs fresh readings for every sample.  Otherwise the background
+ * rate will do, which saves power when idle.  The ADC filter cutoffs
+ * follow the rate picked.
+ */
+static int update_background_sample_rate(LoggerConfig *loggerConfig,
+                                         const int loggingSampleRate,
+                                         const bool logging)
+{
+        int rate = BACKGROUND_SAMPLE_RATE;
+
+        if (is_channel_aggregation_enabled(loggerConfig))
+                rate = getHigherSampleRate(rate, AGGREGATE_SAMPLE_RATE);
+        if (is_histogram_enabled(loggerConfig))
+                rate = getHigherSampleRate(rate, HISTOGRAM_SAMPLE_RATE);
+        if (logging)
+                rate = getHigherSampleRate(loggingSampleRate, rate);
+
+        ADC_set_update_rate(loggerConfig, decodeSampleRate(rate));
+        return rate;
+}
+
 void loggerTaskEx(void *params)
 {
         LoggerConfig *loggerConfig = getWorkingLoggerConfig();
-        size_t bufferIndex = 0;
+        struct sample *sample = g_sample_buffer;
         size_t currentTicks = 0;
-        int buffer_size = 0;
         int loggingSampleRate = SAMPLE_DISABLED;
         int sampleRateTimebase = SAMPLE_DISABLED;
         int telemetrySampleRate = SAMPLE_DISABLED;
+        int backgroundSampleRate = BACKGROUND_SAMPLE_RATE;
+        uint32_t file_overruns = 0;
+        portTickType wake_time = xTaskGetTickCount();
 
         g_loggingShouldRun = 0;
-        vSemaphoreCreateBinary(onTick);
         logging_set_status(LOGGING_STATUS_IDLE);
         logging_set_logging_start(0);
         g_config_changed = true;
@@ -192,12 +289,23 @@ void loggerTaskEx(void *params)
 #endif
 
         while (1) {
-                xSemaphoreTake(onTick, portMAX_DELAY);
-                ++currentTicks;
+                /*
+                 * Sleep until the next tick with work to do instead of
+                 * waking on every OS tick.  Delaying until an absolute
+                 * time keeps currentTicks in step with the OS tick count.
+                 */
+                const size_t next_tick = g_config_changed ?
+                        currentTicks + 1 :
+                        get_next_wake_tick(sample, currentTicks,
+                                           backgroundSampleRate);
+                vTaskDelayUntil(&wake_time, next_tick - currentTicks);
+                currentTicks = next_tick;
 
                 if (g_config_changed) {
-                        buffer_size = init_sample_ring_buffer(loggerConfig);
-                        if (!buffer_size) {
+                        sample = g_sample_buffer;
+                        init_histograms(loggerConfig);
+                        init_spectral_channels(loggerConfig);
+                        if (!init_sample_ring_buffer(loggerConfig)) {
                                 pr_error("Failed to allocate any buffers!\r\n");
                                 led_enable(LED_ERROR);
 
@@ -214,9 +322,16 @@ void loggerTaskEx(void *params)
                         updateSampleRates(loggerConfig, &loggingSampleRate,
                                           &telemetrySampleRate,
                                           &sampleRateTimebase);
+
+                        backgroundSampleRate =
+                                update_background_sample_rate(
+                                        loggerConfig, loggingSampleRate,
+                                        logging_is_active());
+                        reset_channel_aggregates();
                         resetLapCount();
                         lapstats_reset_distance();
                         currentTicks = 0;
+                        wake_time = xTaskGetTickCount();
                 }
 
                 /* Only reset the watchdog when we are configured and ready to rock */
@@ -225,35 +340,43 @@ void loggerTaskEx(void *params)
                 const bool is_logging = logging_is_active();
 
                 /**
-                 * Ensure we refresh the internal sensors at either the
-                 * logging rate or at least at background sample rate
+                 * Refresh the internal sensors at the background sample
+                 * rate, which is at least the logging rate while logging.
                  */
-                if ((is_logging && should_sample(currentTicks, loggingSampleRate)) ||
-                    (currentTicks % BACKGROUND_SAMPLE_RATE == 0))
+                if (currentTicks % backgroundSampleRate == 0) {
                         doBackgroundSampling();
+                        aggregate_channel_samples(loggerConfig, currentTicks);
+                        histogram_channel_samples(currentTicks);
+                        spectral_channel_samples();
+                }
 
                 if (g_loggingShouldRun && !is_logging) {
                         logging_started();
+                        backgroundSampleRate =
+                                update_background_sample_rate(
+                                        loggerConfig, loggingSampleRate,
+                                        true);
+                        /* A new log must not start with blank channels */
+                        force_channel_keyframe(&g_sample_channels);
                         const LoggerMessage logStartMsg = getLogStartMessage();
-#if SDCARD_SUPPORT
-                        queue_logfile_record(&logStartMsg);
-#endif
-                        queueTelemetryRecord(&logStartMsg);
+                        publish_logger_message(&logStartMsg,
+                                               LOG_FILE_CONSUMERS |
+                                               SAMPLE_CONSUMERS_TELEMETRY);
                 }
 
                 if (!g_loggingShouldRun && is_logging) {
                         logging_stopped();
+                        backgroundSampleRate =
+                                update_background_sample_rate(
+                                        loggerConfig, loggingSampleRate,
+                                        false);
                         const LoggerMessage logStopMsg = getLogStopMessage();
-#if SDCARD_SUPPORT
-                        queue_logfile_record(&logStopMsg);
-#endif
-                        queueTelemetryRecord(&logStopMsg);
+                        publish_logger_message(&logStopMsg,
+                                               LOG_FILE_CONSUMERS |
+                                               SAMPLE_CONSUMERS_TELEMETRY);
                         logging_set_status(LOGGING_STATUS_IDLE);
                 }
 
-                /* Prepare a Sample */
-                struct sample *sample = g_sample_buffer + bufferIndex;
-
                 /* Check if we need to actually populate the buffer. */
                 const int sampledRate = populate_sample_buffer(sample,
                                         currentTicks);
@@ -266,32 +389,31 @@ void loggerTaskEx(void *params)
 
                 /*
                  * We only log to file if the user has manually pushed the
-                 * logging button.
+                 * logging button.  The telemetry tasks are responsible for
+                 * determining if they should use the sample or if they
+                 * should drop it due to rate limitations.
                  */
-#if SDCARD_SUPPORT
-                if (is_logging && should_sample(currentTicks, loggingSampleRate)) {
-                        /* XXX Move this to file writer? */
-                        const portBASE_TYPE res = queue_logfile_record(&msg);
-                        if (pdTRUE != res) {
-                                logging_set_status(LOGGING_STATUS_OVERFLOW);
-                        }
-                }
-#endif
+                uint16_t consumers = SAMPLE_CONSUMERS_TELEMETRY;
+                if (is_logging && should_sample(currentTicks, loggingSampleRate))
+                        consumers |= LOG_FILE_CONSUMERS;
 
-                /*
-                 * The task is responsible for determining if it should use the
-                 * sample or if it should drop it due to rate limitations.
-                 */
-                queueTelemetryRecord(&msg);
+                publish_logger_message(&msg, consumers);
 
 
                 /* Process callback handlers for the samples */
                 logger_sample_process_callbacks(currentTicks, sample);
 
-                ++bufferIndex;
-                bufferIndex %= buffer_size;
-
                 current_sample = sample;
+                sample = get_next_sample_slot(sample);
+
+                /* The file writer lost a sample it was sent */
+                if (file_overruns !=
+                    sample_get_overruns(SAMPLE_CONSUMER_FILE_WRITER)) {
+                        file_overruns =
+                                sample_get_overruns(SAMPLE_CONSUMER_FILE_WRITER);
+                        if (is_logging)
+                                logging_set_status(LOGGING_STATUS_OVERFLOW);
+                }
                 g_config_changed = false;
         }
 
@@ -0,0 +1,298 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FreeRTOS.h"
+#include "logger_message_ring.h"
+#include "printk.h"
+#include "semphr.h"
+#include "task.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define LOG_PFX "[msg ring] "
+
+/* Keeps the compiler from moving memory accesses across this point */
+#define compiler_barrier()	__asm__ volatile("" ::: "memory")
+
+struct ring_entry {
+        LoggerMessage msg;
+        uint16_t consumers;
+};
+
+/* A Start or Stop message, delivered once the reader reaches seq */
+struct ring_control {
+        LoggerMessage msg;
+        uint32_t seq;
+};
+
+struct ring_reader {
+        uint32_t tail;
+        volatile bool waiting;
+        xSemaphoreHandle wake;
+        struct ring_control controls[LOGGER_MESSAGE_CONTROL_SLOTS];
+        uint8_t control_head;
+        uint8_t control_tail;
+};
+
+static struct {
+        struct ring_entry entries[LOGGER_MESSAGE_RING_SIZE];
+        volatile uint32_t head;
+        volatile uint16_t subscribed;
+        struct ring_reader readers[SAMPLE_CONSUMER_COUNT];
+} ring;
+
+bool logger_message_subscribe(const enum sample_consumer c)
+{
+        struct ring_reader *r = ring.readers + c;
+
+        if (!r->wake) {
+                r->wake = xSemaphoreCreateBinary();
+                if (!r->wake) {
+                        pr_error(LOG_PFX "Failed to create reader\r\n");
+                        return false;
+                }
+        }
+
+        taskENTER_CRITICAL();
+        r->tail = ring.head;
+        r->control_head = r->control_tail = 0;
+        taskEXIT_CRITICAL();
+        r->waiting = false;
+        ring.subscribed |= SAMPLE_CONSUMER_MASK(c);
+
+        return true;
+}
+
+/*
+ * Queues a Start or Stop for the reader.  The logger alternates them, so
+ * a full queue ends with a pair that cancels out.  Dropping that pair
+ * keeps the state the reader ends up in, and is counted as an overrun.
+ */
+static void queue_control(const enum sample_consumer c,
+                          const LoggerMessage *msg)
+{
+        struct ring_reader *r = ring.readers + c;
+        bool dropped = false;
+
+        taskENTER_CRITICAL();
+        if ((uint8_t) (r->control_head - r->control_tail) ==
+            LOGGER_MESSAGE_CONTROL_SLOTS) {
+                r->control_head -= 2;
+                dropped = true;
+        }
+
+        struct ring_control *rc = r->controls +
+                r->control_head % LOGGER_MESSAGE_CONTROL_SLOTS;
+        rc->msg = *msg;
+        rc->seq = ring.head;
+        ++r->control_head;
+        taskEXIT_CRITICAL();
+
+        if (dropped)
+                sample_count_overrun(c);
+}
+
+/*
+ * The entry about to be overwritten was never read by the readers still
+ * behind it.  Move them past it and give back their reference.
+ */
+static void lap_readers(const struct ring_entry *e, const uint32_t seq)
+{
+        for (size_t c = 0; c < SAMPLE_CONSUMER_COUNT; ++c) {
+                if (!(e->consumers & SAMPLE_CONSUMER_MASK(c)))
+                        continue;
+
+                struct ring_reader *r = ring.readers + c;
+                bool lapped = false;
+
+                taskENTER_CRITICAL();
+                if ((int32_t) (r->tail - seq) <= 0) {
+                        r->tail = seq + 1;
+                        lapped = true;
+                }
+                taskEXIT_CRITICAL();
+
+                if (!lapped)
+                        continue;
+
+                if (e->msg.sample)
+                        sample_unref(e->msg.sample, e->msg.ticks, c);
+                sample_count_overrun(c);
+        }
+}
+
+static void wake_readers(const uint16_t to)
+{
+        for (size_t c = 0; c < SAMPLE_CONSUMER_COUNT; ++c) {
+                struct ring_reader *r = ring.readers + c;
+
+                if ((to & SAMPLE_CONSUMER_MASK(c)) && r->waiting)
+                        xSemaphoreGive(r->wake);
+        }
+}
+
+void publish_logger_message(const LoggerMessage *msg,
+                            const uint16_t consumers)
+{
+        const uint16_t to = consumers & ring.subscribed;
+        if (!to)
+                return;
+
+        if (LoggerMessageType_Sample != msg->type) {
+                for (size_t c = 0; c < SAMPLE_CONSUMER_COUNT; ++c)
+                        if (to & SAMPLE_CONSUMER_MASK(c))
+                                queue_control(c, msg);
+
+                wake_readers(to);
+                return;
+        }
+
+        if (msg->sample)
+                sample_ref_consumers(msg->sample, to);
+
+        const uint32_t head = ring.head;
+        struct ring_entry *e = ring.entries + head % LOGGER_MESSAGE_RING_SIZE;
+        if (e->consumers)
+                lap_readers(e, head - LOGGER_MESSAGE_RING_SIZE);
+
+        e->msg = *msg;
+        e->consumers = to;
+
+        /* Readers must never see the new head before the entry */
+        compiler_barrier();
+        ring.head = head + 1;
+
+        wake_readers(to);
+}
+
+/*
+ * Takes the next Start or Stop if every message published before it was
+ * read or lapped.
+ */
+static bool read_control(struct ring_reader *r, LoggerMessage *msg)
+{
+        bool found = false;
+
+        taskENTER_CRITICAL();
+        if (r->control_tail != r->control_head) {
+                const struct ring_control *rc = r->controls +
+                        r->control_tail % LOGGER_MESSAGE_CONTROL_SLOTS;
+
+                if ((int32_t) (r->tail - rc->seq) >= 0) {
+                        *msg = rc->msg;
+                        ++r->control_tail;
+                        found = true;
+                }
+        }
+        taskEXIT_CRITICAL();
+
+        return found;
+}
+
+/*
+ * Copies out the next entry for the reader without locking, then claims
+ * it.  The claim fails if the publisher lapped the reader meanwhile, in
+ * which case the copy may be torn and is thrown away.
+ */
+static bool read_entry(struct ring_reader *r, struct ring_entry *e)
+{
+        for (;;) {
+                const uint32_t tail = r->tail;
+                if (tail == ring.head)
+                        return false;
+
+                compiler_barrier();
+                *e = ring.entries[tail % LOGGER_MESSAGE_RING_SIZE];
+                compiler_barrier();
+
+                bool claimed = false;
+                taskENTER_CRITICAL();
+                if (r->tail == tail) {
+                        r->tail = tail + 1;
+                        claimed = true;
+                }
+                taskEXIT_CRITICAL();
+
+                if (claimed)
+                        return true;
+        }
+}
+
+static bool read_message(const enum sample_consumer c, LoggerMessage *msg)
+{
+        struct ring_reader *r = ring.readers + c;
+        struct ring_entry e;
+
+        for (;;) {
+                if (read_control(r, msg))
+                        return true;
+
+                if (!read_entry(r, &e))
+                        return false;
+
+                if (!(e.consumers & SAMPLE_CONSUMER_MASK(c)))
+                        continue;
+
+                /* A reclaimed sample was already counted as an overrun */
+                if (!is_sample_data_valid(&e.msg))
+                        continue;
+
+                *msg = e.msg;
+                return true;
+        }
+}
+
+portBASE_TYPE receive_logger_message(const enum sample_consumer c,
+                                     LoggerMessage *msg,
+                                     const portTickType timeout)
+{
+        struct ring_reader *r = ring.readers + c;
+
+        if (read_message(c, msg))
+                return pdTRUE;
+
+        if (0 == timeout)
+                return pdFALSE;
+
+        /*
+         * Check again after raising the flag so that a message published
+         * in between still wakes us.  A stale wakeup left over in the
+         * semaphore only costs an early return.
+         */
+        r->waiting = true;
+        compiler_barrier();
+        bool received = read_message(c, msg);
+        if (!received) {
+                xSemaphoreTake(r->wake, timeout);
+                received = read_message(c, msg);
+        }
+        r->waiting = false;
+
+        return received ? pdTRUE : pdFALSE;
+}
+
+void release_logger_message(const LoggerMessage *msg,
+                            const enum sample_consumer c)
+{
+        if (msg->sample)
+                sample_unref(msg->sample, msg->ticks, c);
+}
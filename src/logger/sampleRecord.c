@@ -27,34 +27,287 @@
 #include "loggerTaskEx.h"
 #include "mem_mang.h"
 #include "sampleRecord.h"
+#include "task.h"
 #include "taskUtil.h"
 #include "macros.h"
 #include <stdbool.h>
+#include <string.h>
 #include "printk.h"
 
 #define LOG_PFX "[sampleRecord] "
-size_t init_sample_buffer(struct sample *s, const size_t count)
+#define POPULATED_WORD_BITS	32
+#define CHANNEL_HASH_MIN_SIZE	8
+
+static uint16_t g_channels_generation;
+
+static size_t get_populated_words(const size_t count)
+{
+        return (count + POPULATED_WORD_BITS - 1) / POPULATED_WORD_BITS;
+}
+
+static size_t get_value_size(const ChannelSample *cs)
+{
+        switch(cs->sampleData) {
+        case SampleData_LongLong:
+        case SampleData_LongLong_Noarg:
+        case SampleData_Double:
+        case SampleData_Double_Noarg:
+                return 8;
+        default:
+                return 4;
+        }
+}
+
+/**
+ * Packs the channel values back to back.  The 8 byte values go first so
+ * that every value ends up naturally aligned.
+ * @return The size of the packed value array.
+ */
+static size_t init_value_offsets(struct sample_channels *sc)
+{
+        size_t offset = 0;
+
+        for (size_t size = 8; size >= 4; size -= 4) {
+                for (size_t i = 0; i < sc->count; ++i) {
+                        ChannelSample *cs = sc->samples + i;
+                        if (get_value_size(cs) != size)
+                                continue;
+
+                        cs->offset = offset;
+                        offset += size;
+                }
+        }
+
+        return offset;
+}
+
+/* FNV-1a */
+static uint32_t hash_label(const char *label)
+{
+        uint32_t hash = 2166136261u;
+
+        while (*label) {
+                hash ^= (uint8_t) *label++;
+                hash *= 16777619u;
+        }
+
+        return hash;
+}
+
+/*
+ * Keeps the index at most half full so probe runs stay short and every
+ * lookup ends on an empty slot.
+ */
+static uint16_t get_hash_size(const size_t count)
+{
+        uint16_t size = CHANNEL_HASH_MIN_SIZE;
+
+        while (size < 2 * count)
+                size <<= 1;
+
+        return size;
+}
+
+/*
+ * Channels are inserted in order, so with duplicate labels the lowest
+ * channel index is found first, same as a linear scan.
+ */
+static void init_channel_hash(struct sample_channels *sc)
 {
-        if (s->channel_samples)
+        const uint16_t mask = sc->hash_size - 1;
+
+        memset(sc->hash, 0, sizeof(uint16_t[sc->hash_size]));
+        for (size_t i = 0; i < sc->count; ++i) {
+                uint32_t slot = hash_label(sc->samples[i].cfg->label) & mask;
+
+                while (sc->hash[slot])
+                        slot = (slot + 1) & mask;
+
+                sc->hash[slot] = i + 1;
+        }
+}
+
+size_t init_sample_channels(struct sample_channels *sc, const size_t count)
+{
+        if (sc->samples)
+                free_sample_channels(sc);
+
+        /*
+         * Schedule index and label hash live in the same block, after the
+         * descriptors.
+         */
+        const uint16_t hash_size = get_hash_size(count);
+        const size_t size = sizeof(ChannelSample[count]) +
+                sizeof(uint16_t[count]) + sizeof(uint16_t[hash_size]);
+        sc->samples = (ChannelSample *) portMalloc(size);
+
+        if (NULL == sc->samples)
+                return 0;
+
+        memset(sc->samples, 0, size);
+        sc->count = count;
+        sc->schedule.channel_index = (uint16_t *) (sc->samples + count);
+        sc->hash = sc->schedule.channel_index + count;
+        sc->hash_size = hash_size;
+        init_channel_sample_buffer(getWorkingLoggerConfig(), sc);
+        sc->values_size = init_value_offsets(sc);
+        init_channel_hash(sc);
+
+        /* Zero is reserved for handles that never resolved */
+        if (0 == ++g_channels_generation)
+                ++g_channels_generation;
+        sc->generation = g_channels_generation;
+
+        return size;
+}
+
+void free_sample_channels(struct sample_channels *sc)
+{
+        portFree(sc->samples);
+        sc->samples = NULL;
+        sc->count = 0;
+        sc->schedule.channel_index = NULL;
+        sc->hash = NULL;
+        sc->hash_size = 0;
+        sc->generation = 0;
+}
+
+size_t init_sample_buffer(struct sample *s, struct sample_channels *sc)
+{
+        if (s->values)
                 free_sample_buffer(s);
 
-        const size_t size = sizeof(ChannelSample[count]);
-        s->channel_samples = (ChannelSample *) portMalloc(size);
+        /* Populated bitmap lives in the same block, after the values */
+        const size_t size = sc->values_size +
+                sizeof(uint32_t[get_populated_words(sc->count)]);
+        s->values = portMalloc(size);
 
-        if (NULL == s->channel_samples)
+        if (NULL == s->values)
                 return 0;
 
         s->ticks = 0;
-        s->channel_count = count;
-        init_channel_sample_buffer(getWorkingLoggerConfig(), s);
+        s->channel_count = sc->count;
+        s->channel_samples = sc->samples;
+        s->channels = sc;
+        s->populated = (uint32_t *) ((char *) s->values + sc->values_size);
+        s->refs = 0;
+        sample_clear_populated(s);
 
         return size;
 }
 
 void free_sample_buffer(struct sample *s)
 {
-        portFree(s->channel_samples);
+        portFree(s->values);
+        s->values = NULL;
+        s->populated = NULL;
+        s->channel_count = 0;
         s->channel_samples = NULL;
+        s->channels = NULL;
+}
+
+bool sample_is_populated(const struct sample *s, const size_t index)
+{
+        return s->populated[index / POPULATED_WORD_BITS] &
+                (1u << (index % POPULATED_WORD_BITS));
+}
+
+void sample_set_populated(struct sample *s, const size_t index)
+{
+        s->populated[index / POPULATED_WORD_BITS] |=
+                1u << (index % POPULATED_WORD_BITS);
+}
+
+void sample_clear_populated(struct sample *s)
+{
+        memset(s->populated, 0,
+               sizeof(uint32_t[get_populated_words(s->channel_count)]));
+}
+
+void* sample_get_value(const struct sample *s, const size_t index)
+{
+        return (char *) s->values + s->channel_samples[index].offset;
+}
+
+int sample_get_int(const struct sample *s, const size_t index)
+{
+        return *(int *) sample_get_value(s, index);
+}
+
+long long sample_get_longlong(const struct sample *s, const size_t index)
+{
+        return *(long long *) sample_get_value(s, index);
+}
+
+float sample_get_float(const struct sample *s, const size_t index)
+{
+        return *(float *) sample_get_value(s, index);
+}
+
+double sample_get_double(const struct sample *s, const size_t index)
+{
+        return *(double *) sample_get_value(s, index);
+}
+
+static uint32_t overruns[SAMPLE_CONSUMER_COUNT];
+
+/*
+ * The reference bits are bookkeeping and not part of the sample data, so
+ * consumers holding a const sample may still release them.
+ */
+static volatile uint16_t* get_refs(const struct sample *s)
+{
+        return &((struct sample *) s)->refs;
+}
+
+void sample_ref_consumers(const struct sample *s, const uint16_t consumers)
+{
+        taskENTER_CRITICAL();
+        *get_refs(s) |= consumers;
+        taskEXIT_CRITICAL();
+}
+
+void sample_ref(const struct sample *s, const enum sample_consumer c)
+{
+        sample_ref_consumers(s, SAMPLE_CONSUMER_MASK(c));
+}
+
+void sample_unref(const struct sample *s, const size_t ticks,
+                  const enum sample_consumer c)
+{
+        taskENTER_CRITICAL();
+        if (s->ticks == ticks)
+                *get_refs(s) &= ~SAMPLE_CONSUMER_MASK(c);
+        taskEXIT_CRITICAL();
+}
+
+bool sample_is_referenced(const struct sample *s)
+{
+        return 0 != s->refs;
+}
+
+void sample_reclaim(struct sample *s)
+{
+        taskENTER_CRITICAL();
+        const uint16_t refs = s->refs;
+        s->refs = 0;
+        taskEXIT_CRITICAL();
+
+        for (size_t c = 0; c < SAMPLE_CONSUMER_COUNT; ++c)
+                if (refs & SAMPLE_CONSUMER_MASK(c))
+                        sample_count_overrun(c);
+}
+
+void sample_count_overrun(const enum sample_consumer c)
+{
+        taskENTER_CRITICAL();
+        ++overruns[c];
+        taskEXIT_CRITICAL();
+}
+
+uint32_t sample_get_overruns(const enum sample_consumer c)
+{
+        return overruns[c];
 }
 
 bool get_channel_value_by_name(const char * name, double *value, char ** units)
@@ -63,50 +316,142 @@ bool get_channel_value_by_name(const char * name, double *value, char ** units)
         return get_sample_value_by_name( s, name, value, units );
 }
 
-bool get_sample_value_by_name(const struct sample *s, const char * name, double *value, char ** units)
+/*
+ * Reads the channel directly.  Used when the sample did not capture it.
+ */
+static bool get_live_value(const ChannelSample *cs, double *value)
 {
-        if (!s || !value || !name) return false;
-
-        for (size_t i = 0; i < s->channel_count; i++) {
-                ChannelSample *sam = (s->channel_samples + i);
-                if (!STR_EQ(name, sam->cfg->label)) continue;
-
-                int channelIndex = sam->channelIndex;
-                *units = sam->cfg->units;
-                switch(sam->sampleData) {
-                case SampleData_Float:
-                        *value = (double) sam->get_float_sample(channelIndex);
-                        return true;
-                case SampleData_Float_Noarg:
-                        *value = (double) sam->get_float_sample_noarg();
-                        return true;
-                case SampleData_Int:
-                        *value = (double) sam->get_int_sample(channelIndex);
-                        return true;
-                case SampleData_Int_Noarg:
-                        *value = (double) sam->get_int_sample_noarg();
-                        return true;
-                case SampleData_Double:
-                        *value = sam->get_double_sample(channelIndex);
-                        return true;
-                case SampleData_Double_Noarg:
-                        *value = sam->get_double_sample_noarg();
-                        return true;
-                case SampleData_LongLong:
-                case SampleData_LongLong_Noarg:
-                        /* risk of overflow here - specifically pertains to the UTC milliseconds channel */
-                        pr_warning_str_msg(LOG_PFX "Data type not supported for channel: ", name);
-                        return false;
-                default:
-                        pr_warning_int_msg(LOG_PFX "Unknown channel sample type", sam->sampleData);
-                        return false;
-                }
+        const int channelIndex = cs->channelIndex;
+
+        switch(cs->sampleData) {
+        case SampleData_Float:
+                *value = (double) cs->get_float_sample(channelIndex);
+                return true;
+        case SampleData_Float_Noarg:
+                *value = (double) cs->get_float_sample_noarg();
+                return true;
+        case SampleData_Int:
+                *value = (double) cs->get_int_sample(channelIndex);
+                return true;
+        case SampleData_Int_Noarg:
+                *value = (double) cs->get_int_sample_noarg();
+                return true;
+        case SampleData_Double:
+                *value = cs->get_double_sample(channelIndex);
+                return true;
+        case SampleData_Double_Noarg:
+                *value = cs->get_double_sample_noarg();
+                return true;
+        default:
+                return false;
+        }
+}
 
+bool sample_get_captured_value(const struct sample *s, const size_t index,
+                               double *value)
+{
+        switch(s->channel_samples[index].sampleData) {
+        case SampleData_Float:
+        case SampleData_Float_Noarg:
+                *value = (double) sample_get_float(s, index);
+                return true;
+        case SampleData_Int:
+        case SampleData_Int_Noarg:
+                *value = (double) sample_get_int(s, index);
+                return true;
+        case SampleData_Double:
+        case SampleData_Double_Noarg:
+                *value = sample_get_double(s, index);
+                return true;
+        default:
+                return false;
         }
-        pr_trace_str_msg(LOG_PFX "Unknown channel name: ", name);
+}
+
+bool resolve_channel_handle(struct channel_handle *h,
+                            const struct sample_channels *sc,
+                            const char *name)
+{
+        h->generation = 0;
+        if (!sc || !sc->hash || !name)
+                return false;
+
+        const uint16_t mask = sc->hash_size - 1;
+        for (uint32_t slot = hash_label(name) & mask; sc->hash[slot];
+             slot = (slot + 1) & mask) {
+                const uint16_t index = sc->hash[slot] - 1;
+                if (!STR_EQ(name, sc->samples[index].cfg->label))
+                        continue;
+
+                h->generation = sc->generation;
+                h->index = index;
+                return true;
+        }
+
         return false;
 }
 
+bool is_channel_handle_valid(const struct channel_handle *h,
+                             const struct sample_channels *sc)
+{
+        return sc && 0 != h->generation && sc->generation == h->generation;
+}
+
+bool get_sample_value_by_handle(const struct sample *s,
+                                const struct channel_handle *h,
+                                double *value, char **units)
+{
+        if (!s || !value || !is_channel_handle_valid(h, s->channels))
+                return false;
+
+        const ChannelSample *cs = s->channel_samples + h->index;
+        *units = cs->cfg->units;
+
+        switch(cs->sampleData) {
+        case SampleData_LongLong:
+        case SampleData_LongLong_Noarg:
+                /* risk of overflow here - specifically pertains to the UTC milliseconds channel */
+                pr_warning_str_msg(LOG_PFX "Data type not supported for channel: ", cs->cfg->label);
+                return false;
+        default:
+                break;
+        }
+
+        const bool res = sample_is_populated(s, h->index) ?
+                sample_get_captured_value(s, h->index, value) :
+                get_live_value(cs, value);
+        if (!res)
+                pr_warning_int_msg(LOG_PFX "Unknown channel sample type", cs->sampleData);
+
+        return res;
+}
+
+bool get_sample_value_by_cached_name(const struct sample *s,
+                                     const char *name,
+                                     struct channel_handle *h,
+                                     double *value, char **units)
+{
+        if (!s || !name)
+                return false;
+
+        /* The configured name may have changed without a table rebuild */
+        const bool cached = is_channel_handle_valid(h, s->channels) &&
+                STR_EQ(name, s->channel_samples[h->index].cfg->label);
+
+        if (!cached && !resolve_channel_handle(h, s->channels, name)) {
+                pr_trace_str_msg(LOG_PFX "Unknown channel name: ", name);
+                return false;
+        }
+
+        return get_sample_value_by_handle(s, h, value, units);
+}
+
+bool get_sample_value_by_name(const struct sample *s, const char * name, double *value, char ** units)
+{
+        struct channel_handle h = {0};
+        return get_sample_value_by_cached_name(s, name, &h, value, units);
+}
+
 /**
  * Checks to ensure that the LoggerMessage object is pointing to a
  * usable data_sample structure.  This is needed because while the
@@ -123,30 +468,6 @@ bool is_sample_data_valid(const LoggerMessage *lm)
         return NULL == lm->sample ? true : lm->ticks == lm->sample->ticks;
 }
 
-portBASE_TYPE send_logger_message(const xQueueHandle queue,
-                                  const LoggerMessage * const msg)
-{
-        return NULL == queue ? errQUEUE_EMPTY : xQueueSend(queue, msg, 0);
-}
-
-
-char receive_logger_message(xQueueHandle queue, LoggerMessage *lm,
-                            portTickType timeout)
-{
-        char res;
-
-        do {
-                res = xQueueReceive(queue, lm, timeout);
-        } while (pdTRUE == res && !is_sample_data_valid(lm));
-
-        return res;
-}
-
-xQueueHandle create_logger_message_queue()
-{
-        return xQueueCreate(LOGGER_MESSAGE_BUFFER_SIZE, sizeof(LoggerMessage));
-}
-
 LoggerMessage create_logger_message(const enum LoggerMessageType t,
                                     const size_t ticks, struct sample *s,
                                     bool needs_meta)
@@ -0,0 +1,223 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "loggerSampleData.h"
+#include "macros.h"
+#include "sample_aggregate.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#if ANALOG_CHANNELS > 0
+static struct sample_aggregate g_analog_aggregates[CONFIG_ADC_CHANNELS];
+static ChannelConfig g_analog_min_configs[CONFIG_ADC_CHANNELS];
+#endif
+
+#if IMU_CHANNELS > 0
+static struct sample_aggregate g_imu_aggregates[CONFIG_IMU_CHANNELS];
+static ChannelConfig g_imu_min_configs[CONFIG_IMU_CHANNELS];
+#endif
+
+size_t sample_aggregate_window(const size_t tick, const int sample_rate)
+{
+        return (tick + sample_rate - 1) / sample_rate;
+}
+
+void sample_aggregate_add(struct sample_aggregate *a, const size_t window,
+                          const float value)
+{
+        if (0 == a->count || a->window != window) {
+                a->window = window;
+                a->count = 0;
+                a->sum = 0;
+                a->min = value;
+                a->max = value;
+        }
+
+        /* Saturate rather than wrap on very long windows */
+        if (a->count == UINT16_MAX)
+                return;
+
+        ++a->count;
+        a->sum += value;
+        a->min = MIN(a->min, value);
+        a->max = MAX(a->max, value);
+}
+
+bool sample_aggregate_value(const struct sample_aggregate *a,
+                            const unsigned char mode, float *value)
+{
+        if (0 == a->count)
+                return false;
+
+        switch (mode) {
+        case AGGREGATION_MEAN:
+                *value = a->sum / a->count;
+                return true;
+        case AGGREGATION_MIN:
+                *value = a->min;
+                return true;
+        case AGGREGATION_MAX:
+        case AGGREGATION_MIN_MAX:
+                *value = a->max;
+                return true;
+        default:
+                return false;
+        }
+}
+
+static bool is_aggregating(const ChannelConfig *cfg,
+                           const unsigned char aggregation)
+{
+        return cfg->sampleRate != SAMPLE_DISABLED &&
+                aggregation != AGGREGATION_LAST;
+}
+
+bool is_channel_aggregation_enabled(LoggerConfig *lc)
+{
+#if ANALOG_CHANNELS > 0
+        for (size_t i = 0; i < CONFIG_ADC_CHANNELS; ++i) {
+                const ADCConfig *c = lc->ADCConfigs + i;
+                if (is_aggregating(&c->cfg, c->aggregation))
+                        return true;
+        }
+#endif
+
+#if IMU_CHANNELS > 0
+        for (size_t i = 0; i < CONFIG_IMU_CHANNELS; ++i) {
+                const ImuConfig *c = lc->ImuConfigs + i;
+                if (is_aggregating(&c->cfg, c->aggregation))
+                        return true;
+        }
+#endif
+
+        return false;
+}
+
+void reset_channel_aggregates(void)
+{
+#if ANALOG_CHANNELS > 0
+        memset(g_analog_aggregates, 0, sizeof(g_analog_aggregates));
+#endif
+#if IMU_CHANNELS > 0
+        memset(g_imu_aggregates, 0, sizeof(g_imu_aggregates));
+#endif
+}
+
+void aggregate_channel_samples(LoggerConfig *lc, const size_t tick)
+{
+#if ANALOG_CHANNELS > 0
+        for (size_t i = 0; i < CONFIG_ADC_CHANNELS; ++i) {
+                const ADCConfig *c = lc->ADCConfigs + i;
+                if (!is_aggregating(&c->cfg, c->aggregation))
+                        continue;
+
+                const size_t window =
+                        sample_aggregate_window(tick, c->cfg.sampleRate);
+                sample_aggregate_add(g_analog_aggregates + i, window,
+                                     get_analog_sample(i));
+        }
+#endif
+
+#if IMU_CHANNELS > 0
+        for (size_t i = 0; i < CONFIG_IMU_CHANNELS; ++i) {
+                const ImuConfig *c = lc->ImuConfigs + i;
+                if (!is_aggregating(&c->cfg, c->aggregation))
+                        continue;
+
+                const size_t window =
+                        sample_aggregate_window(tick, c->cfg.sampleRate);
+                sample_aggregate_add(g_imu_aggregates + i, window,
+                                     get_imu_sample(i));
+        }
+#endif
+}
+
+void init_aggregate_min_config(ChannelConfig *min_cfg,
+                               const ChannelConfig *cfg)
+{
+        const size_t suffix_len = sizeof(AGGREGATE_MIN_SUFFIX) - 1;
+        const size_t len = MIN(strlen(cfg->label),
+                               DEFAULT_LABEL_LENGTH - 1 - suffix_len);
+
+        *min_cfg = *cfg;
+        memcpy(min_cfg->label + len, AGGREGATE_MIN_SUFFIX, suffix_len + 1);
+}
+
+#if ANALOG_CHANNELS > 0
+float get_analog_aggregate(int channelId)
+{
+        const ADCConfig *c = getWorkingLoggerConfig()->ADCConfigs + channelId;
+        float value;
+
+        if (!sample_aggregate_value(g_analog_aggregates + channelId,
+                                    c->aggregation, &value))
+                value = get_analog_sample(channelId);
+
+        return value;
+}
+
+float get_analog_aggregate_min(int channelId)
+{
+        float value;
+
+        if (!sample_aggregate_value(g_analog_aggregates + channelId,
+                                    AGGREGATION_MIN, &value))
+                value = get_analog_sample(channelId);
+
+        return value;
+}
+
+ChannelConfig* get_analog_aggregate_min_config(const size_t channelId)
+{
+        return g_analog_min_configs + channelId;
+}
+#endif
+
+#if IMU_CHANNELS > 0
+float get_imu_aggregate(int channelId)
+{
+        const ImuConfig *c = getWorkingLoggerConfig()->ImuConfigs + channelId;
+        float value;
+
+        if (!sample_aggregate_value(g_imu_aggregates + channelId,
+                                    c->aggregation, &value))
+                value = get_imu_sample(channelId);
+
+        return value;
+}
+
+float get_imu_aggregate_min(int channelId)
+{
+        float value;
+
+        if (!sample_aggregate_value(g_imu_aggregates + channelId,
+                                    AGGREGATION_MIN, &value))
+                value = get_imu_sample(channelId);
+
+        return value;
+}
+
+ChannelConfig* get_imu_aggregate_min_config(const size_t channelId)
+{
+        return g_imu_min_configs + channelId;
+}
+#endif
@@ -0,0 +1,425 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ADC.h"
+#include "channel_pipeline.h"
+#include "high_rate_lane.h"
+#include "imu.h"
+#include "imu_device.h"
+#include "macros.h"
+#include "printk.h"
+#include "spectral.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#define LOG_PFX "[spectral] "
+
+/*
+ * Built by the logger task on a config change.  The config is copied so
+ * the channel table others build from this stays in step with it until
+ * the next rebuild.
+ */
+struct spectral_channel {
+        struct spectral_config cfg;
+        bool imu;
+        size_t channel;
+        /* Physical axis of IMU channels */
+        size_t axis;
+        int32_t samples[FFT_POINTS];
+        size_t count;
+        float outputs[SPECTRAL_BANDS_MAX];
+        ChannelConfig output_cfgs[SPECTRAL_BANDS_MAX];
+};
+
+static struct spectral_channel g_spectral[SPECTRAL_CHANNELS_MAX];
+static size_t g_spectral_count;
+static struct fft_block g_block;
+
+/* Next high rate lane scan to collect */
+static uint32_t g_lane_cursor;
+
+bool is_spectral_config_valid(const struct spectral_config *cfg)
+{
+        return cfg->mode != SPECTRAL_MODE_DISABLED &&
+                cfg->bands >= 1 && cfg->bands <= SPECTRAL_BANDS_MAX &&
+                cfg->min_hz >= 0 && cfg->max_hz > cfg->min_hz;
+}
+
+size_t get_spectral_outputs(const struct spectral_config *cfg)
+{
+        return SPECTRAL_MODE_BANDS == cfg->mode ? cfg->bands : 1;
+}
+
+static size_t to_bin(const float hz, const float bin_hz)
+{
+        const float bin = ceilf(hz / bin_hz);
+
+        return bin > FFT_BINS ? FFT_BINS : (size_t) bin;
+}
+
+static float peak_frequency(const struct spectral_config *cfg,
+                            const float bin_hz)
+{
+        const size_t first = MAX(1, to_bin(cfg->min_hz, bin_hz));
+        const size_t last = MIN(FFT_BINS - 1, to_bin(cfg->max_hz, bin_hz));
+        uint32_t peak_power = 0;
+        size_t peak = 0;
+
+        for (size_t bin = first; bin <= last; ++bin) {
+                const uint32_t power = fft_bin_power(&g_block, bin);
+                if (power > peak_power) {
+                        peak_power = power;
+                        peak = bin;
+                }
+        }
+
+        if (!peak)
+                return 0;
+
+        /* Fit a parabola through the peak and its neighbours */
+        const float a = sqrtf(fft_bin_power(&g_block, peak - 1));
+        const float b = sqrtf(peak_power);
+        const float c = peak + 1 < FFT_BINS ?
+                sqrtf(fft_bin_power(&g_block, peak + 1)) : 0;
+        const float curve = a - 2 * b + c;
+        const float offset = curve < 0 ? 0.5f * (a - c) / curve : 0;
+
+        return (peak + offset) * bin_hz;
+}
+
+void spectral_analyze(const struct spectral_config *cfg,
+                      const int32_t *samples, const float rate_hz,
+                      const float units_per_count, float *outputs)
+{
+        const float bin_hz = rate_hz / FFT_POINTS;
+
+        fft_init();
+        fft_load(&g_block, samples);
+        fft_transform(&g_block);
+
+        if (SPECTRAL_MODE_PEAK == cfg->mode) {
+                *outputs = peak_frequency(cfg, bin_hz);
+                return;
+        }
+
+        const float width = (cfg->max_hz - cfg->min_hz) / cfg->bands;
+        for (size_t band = 0; band < cfg->bands; ++band) {
+                const float lo = cfg->min_hz + band * width;
+                const size_t first = to_bin(lo, bin_hz);
+                size_t last = to_bin(lo + width, bin_hz);
+
+                /* Bands narrower than a bin still get the bin they are in */
+                last = last > first ? last - 1 : first;
+
+                const float power = first < FFT_BINS ?
+                        fft_band_power(&g_block, first, last) : 0;
+                outputs[band] = sqrtf(power) * fabsf(units_per_count);
+        }
+}
+
+static bool has_spectral(const ChannelConfig *cfg,
+                         const struct spectral_config *sc)
+{
+        return cfg->sampleRate != SAMPLE_DISABLED &&
+                is_spectral_config_valid(sc);
+}
+
+#if ANALOG_CHANNELS > 0
+/*
+ * Band amplitudes are the raw amplitudes times the channel's units per
+ * count, which mapped analog channels don't have.
+ */
+static bool has_amplitude_units(const ADCConfig *c)
+{
+        return SPECTRAL_MODE_BANDS != c->spectral.mode ||
+                SCALING_MODE_MAP != c->scalingMode;
+}
+#endif
+
+static void init_output_config(ChannelConfig *out_cfg,
+                               const ChannelConfig *cfg,
+                               const struct spectral_config *sc,
+                               const size_t output)
+{
+        const bool peak = SPECTRAL_MODE_PEAK == sc->mode;
+        const char *suffix = peak ? SPECTRAL_PEAK_SUFFIX : SPECTRAL_BAND_PREFIX;
+        const size_t suffix_len = strlen(suffix) + (peak ? 0 : 1);
+        const size_t len = MIN(strlen(cfg->label),
+                               DEFAULT_LABEL_LENGTH - 1 - suffix_len);
+
+        memset(out_cfg, 0, sizeof(*out_cfg));
+        memcpy(out_cfg->label, cfg->label, len);
+        strcpy(out_cfg->label + len, suffix);
+        if (!peak)
+                out_cfg->label[len + suffix_len - 1] = '0' + output;
+
+        if (peak) {
+                strcpy(out_cfg->units, "Hz");
+                out_cfg->max = sc->max_hz;
+                out_cfg->precision = 1;
+        } else {
+                strcpy(out_cfg->units, cfg->units);
+                out_cfg->max = cfg->max - cfg->min;
+                out_cfg->precision = cfg->precision;
+        }
+        out_cfg->sampleRate = cfg->sampleRate;
+}
+
+/*
+ * Walks the spectral channels in the order they are kept in, and sets
+ * them up if scs is given.
+ * @return The number of spectral channels, up to SPECTRAL_CHANNELS_MAX.
+ */
+static size_t collect_spectral(LoggerConfig *lc,
+                               struct spectral_channel *scs,
+                               size_t *outputs)
+{
+        struct {
+                const ChannelConfig *cfg;
+                const struct spectral_config *sc;
+                bool imu;
+                size_t channel;
+                size_t axis;
+        } candidates[CONFIG_ADC_CHANNELS + CONFIG_IMU_CHANNELS];
+        size_t count = 0;
+
+#if ANALOG_CHANNELS > 0
+        for (size_t i = 0; i < CONFIG_ADC_CHANNELS; ++i) {
+                const ADCConfig *c = lc->ADCConfigs + i;
+                if (!has_spectral(&c->cfg, &c->spectral))
+                        continue;
+
+                if (!has_amplitude_units(c)) {
+                        if (scs)
+                                pr_warning_str_msg(LOG_PFX "Bands need "
+                                                   "linear scaling: ",
+                                                   c->cfg.label);
+                        continue;
+                }
+
+                candidates[count].cfg = &c->cfg;
+                candidates[count].sc = &c->spectral;
+                candidates[count].imu = false;
+                candidates[count].channel = i;
+                candidates[count].axis = 0;
+                ++count;
+        }
+#endif
+
+#if IMU_CHANNELS > 0
+        for (size_t i = 0; i < CONFIG_IMU_CHANNELS; ++i) {
+                const ImuConfig *c = lc->ImuConfigs + i;
+                if (!has_spectral(&c->cfg, &c->spectral))
+                        continue;
+
+                candidates[count].cfg = &c->cfg;
+                candidates[count].sc = &c->spectral;
+                candidates[count].imu = true;
+                candidates[count].channel = i;
+                candidates[count].axis = c->physicalChannel;
+                ++count;
+        }
+#endif
+
+        if (count > SPECTRAL_CHANNELS_MAX) {
+                if (scs)
+                        pr_warning_int_msg(LOG_PFX "Too many channels: ",
+                                           count);
+                count = SPECTRAL_CHANNELS_MAX;
+        }
+        *outputs = 0;
+
+        for (size_t i = 0; i < count; ++i) {
+                const size_t outs = get_spectral_outputs(candidates[i].sc);
+                *outputs += outs;
+                if (!scs)
+                        continue;
+
+                struct spectral_channel *sc = scs + i;
+                sc->cfg = *candidates[i].sc;
+                sc->imu = candidates[i].imu;
+                sc->channel = candidates[i].channel;
+                sc->axis = candidates[i].axis;
+                sc->count = 0;
+                memset(sc->outputs, 0, sizeof(sc->outputs));
+
+                for (size_t o = 0; o < outs; ++o)
+                        init_output_config(sc->output_cfgs + o,
+                                           candidates[i].cfg,
+                                           candidates[i].sc, o);
+
+#if ANALOG_CHANNELS > 0
+                if (!sc->imu && !lc->ADCConfigs[sc->channel].highRate)
+                        pr_warning_str_msg(LOG_PFX "Not in high rate lane: ",
+                                           candidates[i].cfg->label);
+#endif
+        }
+
+        return count;
+}
+
+size_t get_spectral_channel_count(void)
+{
+        size_t outputs = 0;
+
+        for (size_t i = 0; i < g_spectral_count; ++i)
+                outputs += get_spectral_outputs(&g_spectral[i].cfg);
+
+        return outputs;
+}
+
+size_t init_spectral_channels(LoggerConfig *lc)
+{
+        size_t outputs;
+
+        g_spectral_count = 0;
+        g_spectral_count = collect_spectral(lc, g_spectral, &outputs);
+        g_lane_cursor = high_rate_lane_get_seq();
+        fft_init();
+
+        return g_spectral_count;
+}
+
+size_t get_spectral_count(void)
+{
+        return g_spectral_count;
+}
+
+ChannelConfig* get_spectral_output_config(const size_t channel,
+                                          const size_t output)
+{
+        return g_spectral[channel].output_cfgs + output;
+}
+
+size_t get_spectral_channel_outputs(const size_t channel)
+{
+        return get_spectral_outputs(&g_spectral[channel].cfg);
+}
+
+static float get_units_per_count(const struct spectral_channel *sc)
+{
+        struct channel_pipeline p;
+        bool scaled = false;
+
+#if IMU_CHANNELS > 0
+        if (sc->imu)
+                scaled = imu_get_pipeline(sc->channel, &p);
+#endif
+#if ANALOG_CHANNELS > 0
+        if (!sc->imu)
+                scaled = ADC_get_pipeline(sc->channel, &p);
+#endif
+
+        return scaled && CHANNEL_SCALING_LINEAR == p.scaling->op ?
+                p.scaling->multiplier : 0;
+}
+
+static float get_rate(const struct spectral_channel *sc)
+{
+#if IMU_CHANNELS > 0
+        if (sc->imu)
+                return imu_device_sample_rate();
+#endif
+        return high_rate_lane_get_rate();
+}
+
+static void add_reading(struct spectral_channel *sc, const int32_t value)
+{
+        sc->samples[sc->count++] = value;
+        if (sc->count < FFT_POINTS)
+                return;
+
+        sc->count = 0;
+        spectral_analyze(&sc->cfg, sc->samples, get_rate(sc),
+                         get_units_per_count(sc), sc->outputs);
+}
+
+void spectral_add_imu_reading(const int32_t *axis)
+{
+        for (size_t i = 0; i < g_spectral_count; ++i) {
+                struct spectral_channel *sc = g_spectral + i;
+                if (sc->imu)
+                        add_reading(sc, axis[sc->axis]);
+        }
+}
+
+/* @return The position of the ADC channel in the lane scans, or -1 */
+static int get_lane_column(const size_t channel)
+{
+        const struct high_rate_lane_channel *channels;
+        const size_t count = high_rate_lane_get_channels(&channels);
+
+        for (size_t i = 0; i < count; ++i)
+                if (channels[i].source == channel)
+                        return i;
+
+        return -1;
+}
+
+void spectral_channel_samples(void)
+{
+        int columns[SPECTRAL_CHANNELS_MAX];
+        bool any = false;
+
+        for (size_t i = 0; i < g_spectral_count; ++i) {
+                const struct spectral_channel *sc = g_spectral + i;
+                columns[i] = sc->imu ? -1 : get_lane_column(sc->channel);
+                any |= columns[i] >= 0;
+        }
+
+        const uint32_t end = high_rate_lane_get_seq();
+        if (!any) {
+                g_lane_cursor = end;
+                return;
+        }
+
+        struct high_rate_block block;
+        uint32_t expected = g_lane_cursor;
+        while (high_rate_lane_read_block(&g_lane_cursor, end, &block)) {
+                /* A block of readings must not span dropped scans */
+                const bool dropped = block.seq != expected;
+                expected = g_lane_cursor;
+
+                for (size_t i = 0; i < g_spectral_count; ++i) {
+                        struct spectral_channel *sc = g_spectral + i;
+                        if (columns[i] < 0)
+                                continue;
+
+                        if (dropped)
+                                sc->count = 0;
+
+                        for (size_t s = 0; s < block.scans; ++s)
+                                add_reading(sc, block.values[s][columns[i]]);
+                }
+        }
+}
+
+float get_spectral_value(int id)
+{
+        const size_t channel = id / SPECTRAL_BANDS_MAX;
+
+        if (channel >= g_spectral_count)
+                return 0;
+
+        return g_spectral[channel].outputs[id % SPECTRAL_BANDS_MAX];
+}
@@ -22,6 +22,7 @@
 #include "ADC.h"
 #include "CAN.h"
 #include "CAN_aux_queue.h"
+#include "CAN_filter.h"
 #include "FreeRTOS.h"
 #include "GPIO.h"
 #include "OBD2.h"
@@ -222,22 +223,8 @@ static int lua_get_analog(lua_State *L)
         unsigned int channel = (unsigned int) val;
         ADCConfig *ac = getADCConfigChannel(val);
 
-        /* TODO: Move this into ADC code where it should be */
-        if (NULL != ac) {
-                float adcRaw = ADC_read(channel);
-                switch(ac->scalingMode) {
-                case SCALING_MODE_RAW:
-                        analogValue = adcRaw;
-                        break;
-                case SCALING_MODE_LINEAR:
-                        analogValue = (ac->linearScaling * (float) adcRaw) + ac->linearOffset;
-                        break;
-                case SCALING_MODE_MAP:
-                        analogValue = get_mapped_value((float) adcRaw,
-                                                       &(ac->scalingMap));
-                        break;
-                }
-        }
+        if (NULL != ac)
+                analogValue = ADC_read_scaled(channel);
 #endif
 
         lua_pushnumber(L, analogValue);
@@ -785,7 +772,9 @@ static int lua_rx_can_msg(lua_State *L)
                 lua_pushnumber(L, can_msg.data[i - 1]);
                 lua_rawset(L, -3);
         }
-        return 3;
+
+        lua_pushnumber(L, can_msg.timestamp);
+        return 4;
 }
 
 static int lua_obd2_read(lua_State *L)
@@ -1334,6 +1323,7 @@ static int lua_sx_set_config(lua_State *L)
                 lua_validate_arg_number(L, 1);
                 shiftx_config->orientation_inverted = lua_tointeger(L, 1);
         }
+        CAN_filter_apply(getWorkingLoggerConfig());
         delayMs(500);
         lua_pushinteger(L, shiftx_update_config());
         return 1;
@@ -329,7 +329,7 @@ void fs_write_sample_record(FIL *buffer_file,
         memset(channelBitmask, 0, sizeof(channelBitmask));
 
         f_puts("\"d\":[", buffer_file);
-        ChannelSample *cs = sample->channel_samples;
+        const ChannelSample *cs = sample->channel_samples;
 
         size_t channelBitPosition = 0;
         for (size_t i = 0; i < sample->channel_count;
@@ -342,7 +342,7 @@ void fs_write_sample_record(FIL *buffer_file,
                                 break;
                 }
 
-                if (cs->populated) {
+                if (sample_is_populated(sample, i)) {
                         channelBitmask[channelBitmaskIndex] |=
                                 (1 << channelBitPosition);
 
@@ -350,22 +350,24 @@ void fs_write_sample_record(FIL *buffer_file,
                         switch(cs->sampleData) {
                         case SampleData_Float:
                         case SampleData_Float_Noarg:
-                                modp_ftoa(cs->valueFloat, buf, precision);
+                                modp_ftoa(sample_get_float(sample, i), buf,
+                                          precision);
                                 f_puts(buf, buffer_file);
                                 break;
                         case SampleData_Int:
                         case SampleData_Int_Noarg:
-                                modp_itoa10(cs->valueInt, buf);
+                                modp_itoa10(sample_get_int(sample, i), buf);
                                 f_puts(buf, buffer_file);
                                 break;
                         case SampleData_LongLong:
                         case SampleData_LongLong_Noarg:
-                                modp_ltoa10(cs->valueLongLong, buf);
+                                modp_ltoa10(sample_get_longlong(sample, i), buf);
                                 f_puts(buf, buffer_file);
                                 break;
                         case SampleData_Double:
                         case SampleData_Double_Noarg:
-                                modp_dtoa(cs->valueDouble, buf, precision);
+                                modp_dtoa(sample_get_double(sample, i), buf,
+                                          precision);
                                 f_puts(buf, buffer_file);
                                 break;
                         default:
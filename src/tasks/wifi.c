@@ -232,8 +232,14 @@ static void wifi_sample_cb(const struct sample* sample,
                 .data.sample = data_sample,
         };
 
+        /* Hold the sample until the task is done with it */
+        sample_ref(sample, SAMPLE_CONSUMER_WIFI);
+
         /* Send the message here to wake the timer */
-        send_event(&event, "Sample CB", false);
+        if (!send_event(&event, "Sample CB", false)) {
+                sample_unref(sample, tick, SAMPLE_CONSUMER_WIFI);
+                sample_count_overrun(SAMPLE_CONSUMER_WIFI);
+        }
 }
 
 void wifi_trigger_camera(bool enabled, uint8_t make_model)
@@ -674,7 +680,7 @@ static void process_sample(struct wifi_sample_data* data)
         const bool meta = ticks == 0;
 
         if (ticks != sample->ticks) {
-                /* Then the sample has changed underneath us */
+                /* Then the sample was reclaimed underneath us */
                 pr_debug(LOG_PFX "Stale sample.  Dropping \r\n");
                 return;
         }
@@ -684,6 +690,8 @@ static void process_sample(struct wifi_sample_data* data)
                 api_send_sample_record(serial, sample, ticks, meta);
                 put_crlf(serial);
         }
+
+        sample_unref(sample, ticks, SAMPLE_CONSUMER_WIFI);
 }
 
 static void process_wifi_api_event(struct wifi_api_event * data)
@@ -20,6 +20,7 @@
  */
 
 
+#include "channel_pipeline.h"
 #include "timer.h"
 #include "timer_config.h"
 #include "timer_device.h"
@@ -33,6 +34,9 @@
 #define US_IN_A_SEC	1000000
 
 static Filter g_timer_filter[CONFIG_TIMER_CHANNELS];
+/* Average period last fed into each filter */
+static uint32_t g_timer_usec[CONFIG_TIMER_CHANNELS];
+static struct channel_scaling g_timer_scaling[CONFIG_TIMER_CHANNELS];
 
 /**
  * Calculates the highest quiet period usable based on the timer
@@ -69,6 +73,44 @@ static uint32_t get_quiet_period(const TimerConfig *tc)
         }
 }
 
+/**
+ * Compiles the conversion of the filtered period in microseconds into the
+ * units of the channel mode, pulses per revolution included.
+ */
+static void compile_timer_scaling(struct channel_scaling *s,
+                                  const TimerConfig *tc)
+{
+        const float ppr = tc->pulsePerRevolution;
+
+        s->op = CHANNEL_SCALING_LINEAR;
+        s->bias = 0;
+        s->multiplier = 0;
+        s->offset = 0;
+
+        if (0 == ppr)
+                return;
+
+        switch (tc->mode) {
+        case MODE_LOGGING_TIMER_RPM:
+                s->op = CHANNEL_SCALING_RECIPROCAL;
+                s->multiplier = US_IN_A_SEC * SEC_IN_A_MIN / ppr;
+                break;
+        case MODE_LOGGING_TIMER_FREQUENCY:
+                s->op = CHANNEL_SCALING_RECIPROCAL;
+                s->multiplier = US_IN_A_SEC / ppr;
+                break;
+        case MODE_LOGGING_TIMER_PERIOD_MS:
+                s->multiplier = ppr / 1000;
+                break;
+        case MODE_LOGGING_TIMER_PERIOD_USEC:
+                s->multiplier = ppr;
+                break;
+        default:
+                s->offset = -1;
+                break;
+        }
+}
+
 int timer_init(LoggerConfig *loggerConfig)
 {
         for (size_t i = 0; i < CONFIG_TIMER_CHANNELS; i++) {
@@ -77,6 +119,8 @@ int timer_init(LoggerConfig *loggerConfig)
 
                 timer_device_init(i, tc->timerSpeed, qp_us, tc->edge);
                 init_filter(&g_timer_filter[i], tc->filterAlpha);
+                g_timer_usec[i] = 0;
+                compile_timer_scaling(g_timer_scaling + i, tc);
         }
 
         return 1;
@@ -105,10 +149,24 @@ uint32_t timer_get_rpm(size_t channel)
 
 uint32_t timer_get_usec(size_t channel)
 {
-        Filter *filter = &g_timer_filter[channel];
-        unsigned int period = timer_device_get_usec(channel);
-        update_filter(filter, period);
-        return filter->current_value;
+        return g_timer_filter[channel].current_value;
+}
+
+void timer_sample_all(void)
+{
+        for (size_t i = 0; i < CONFIG_TIMER_CHANNELS; i++) {
+                /*
+                 * Without a new capture keep feeding the last average,
+                 * unless the device dropped its period because the timer
+                 * overflowed on a stalled input.
+                 */
+                uint32_t usec;
+                if (!timer_device_get_capture_average(i, &usec))
+                        usec = timer_device_get_usec(i) ? g_timer_usec[i] : 0;
+
+                g_timer_usec[i] = usec;
+                update_filter(&g_timer_filter[i], usec);
+        }
 }
 
 uint32_t timer_get_count(size_t channel)
@@ -126,21 +184,16 @@ float timer_get_sample(const int cid)
         if (cid >= TIMER_CHANNELS)
                 return -1;
 
-        TimerConfig *c = getWorkingLoggerConfig()->TimerConfigs + cid;
-        const float ppr = c->pulsePerRevolution;
-        if (0 == ppr)
-                return 0;
+        return channel_scaling_apply(g_timer_scaling + cid,
+                                     g_timer_filter[cid].current_value);
+}
 
-        switch (c->mode) {
-        case MODE_LOGGING_TIMER_RPM:
-                return timer_get_rpm(cid) / ppr;
-        case MODE_LOGGING_TIMER_FREQUENCY:
-                return timer_get_hz(cid) / ppr;
-        case MODE_LOGGING_TIMER_PERIOD_MS:
-                return timer_get_ms(cid) * ppr;
-        case MODE_LOGGING_TIMER_PERIOD_USEC:
-                return timer_get_usec(cid) * ppr;
-        default:
-                return -1;
-        }
+bool timer_get_pipeline(const size_t channel, struct channel_pipeline *p)
+{
+        if (channel >= TIMER_CHANNELS)
+                return false;
+
+        p->raw = &g_timer_filter[channel].current_value;
+        p->scaling = g_timer_scaling + channel;
+        return true;
 }
@@ -0,0 +1,71 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "timer_capture.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Keeps the compiler from moving memory accesses across this point */
+#define compiler_barrier()	__asm__ volatile("" ::: "memory")
+
+void timer_capture_reset(struct timer_capture_ring *ring)
+{
+        ring->tail = ring->head;
+}
+
+void timer_capture_push(struct timer_capture_ring *ring,
+                        const uint32_t period_us)
+{
+        ring->period_us[ring->head % TIMER_CAPTURE_RING_SIZE] = period_us;
+
+        /* The sampler must never see the new head before the entry */
+        compiler_barrier();
+        ++ring->head;
+}
+
+bool timer_capture_average(struct timer_capture_ring *ring,
+                           uint32_t *avg_us)
+{
+        for (;;) {
+                const uint32_t head = ring->head;
+                uint32_t tail = ring->tail;
+
+                if (head == tail)
+                        return false;
+
+                if (head - tail > TIMER_CAPTURE_RING_SIZE)
+                        tail = head - TIMER_CAPTURE_RING_SIZE;
+
+                compiler_barrier();
+                uint64_t sum = 0;
+                for (uint32_t i = tail; i != head; ++i)
+                        sum += ring->period_us[i % TIMER_CAPTURE_RING_SIZE];
+                compiler_barrier();
+
+                /* Retry if the ISR started overwriting what we summed */
+                if (ring->head - tail > TIMER_CAPTURE_RING_SIZE)
+                        continue;
+
+                ring->tail = head;
+                *avg_us = sum / (head - tail);
+                return true;
+        }
+}
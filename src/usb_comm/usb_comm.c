@@ -103,9 +103,15 @@ static void usb_sample_cb(const struct sample* sample,
                 .data.sample = sample_data,
         };
 
+        /* Hold the sample until the task is done with it */
+        sample_ref(sample, SAMPLE_CONSUMER_USB);
+
         /* Send the message here to wake the timer */
-        if (!xQueueSend(usb_state.event_queue, &event, 0))
+        if (!xQueueSend(usb_state.event_queue, &event, 0)) {
                 log_event_overflow("Sample CB");
+                sample_unref(sample, tick, SAMPLE_CONSUMER_USB);
+                sample_count_overrun(SAMPLE_CONSUMER_USB);
+        }
 }
 
 static void usb_api_event_cb(const struct api_event *api_event, void* data)
@@ -217,13 +223,14 @@ static void process_sample(struct usb_sample_data* data)
         const bool meta = ticks == 0;
 
         if (ticks != sample->ticks) {
-                /* Then the sample has changed underneath us */
+                /* Then the sample was reclaimed underneath us */
                 pr_warning(LOG_PFX "Stale sample.  Dropping \r\n");
                 return;
         }
 
         api_send_sample_record(serial, sample, ticks, meta);
         put_crlf(serial);
+        sample_unref(sample, ticks, SAMPLE_CONSUMER_USB);
 }
 
 static void process_usb_api_event(const struct api_event *event)
@@ -114,4 +114,9 @@ void ChannelConfigTest::test_validate()
         cc.flags = 2;
         CPPUNIT_ASSERT_EQUAL(CHAN_CFG_STATUS_INVALID_FLAG,
                              validate_channel_config(ccp));
+
+        cc.flags = 0;
+        cc.deadband = -0.5;
+        CPPUNIT_ASSERT_EQUAL(CHAN_CFG_STATUS_NEGATIVE_DEADBAND,
+                             validate_channel_config(ccp));
 }
@@ -0,0 +1,43 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _FF_TESTING_H_
+#define _FF_TESTING_H_
+
+#include "cpp_guard.h"
+#include "ff.h"
+
+CPP_GUARD_BEGIN
+
+/* Forgets the writes so far and lets f_write succeed again */
+void ff_testing_reset(void);
+
+/* Makes f_write fail with res, without writing anything */
+void ff_testing_set_write_result(FRESULT res);
+
+unsigned int ff_testing_get_writes(void);
+
+unsigned int ff_testing_get_bytes_written(void);
+
+CPP_GUARD_END
+
+#endif /* _FF_TESTING_H_ */
@@ -21,6 +21,35 @@
 
 
 #include "ff.h"
+#include "ff_testing.h"
+
+static struct {
+        FRESULT result;
+        unsigned int writes;
+        unsigned int bytes;
+} write_stub;
+
+void ff_testing_reset(void)
+{
+        write_stub.result = FR_OK;
+        write_stub.writes = 0;
+        write_stub.bytes = 0;
+}
+
+void ff_testing_set_write_result(FRESULT res)
+{
+        write_stub.result = res;
+}
+
+unsigned int ff_testing_get_writes(void)
+{
+        return write_stub.writes;
+}
+
+unsigned int ff_testing_get_bytes_written(void)
+{
+        return write_stub.bytes;
+}
 
 
 FRESULT f_sync (FIL* fp)
@@ -37,6 +66,7 @@ FRESULT f_open(FIL* fp,
                const TCHAR* path,
                BYTE mode)
 {
+        fp->fptr = 0;
         return FR_OK;
 }
 
@@ -53,6 +83,14 @@ FRESULT f_write (
         UINT* bw			/* Pointer to number of bytes written */
 )
 {
+        *bw = 0;
+        if (FR_OK != write_stub.result)
+                return write_stub.result;
+
+        *bw = btw;
+        fp->fptr += btw;
+        write_stub.writes++;
+        write_stub.bytes += btw;
         return FR_OK;
 }
 
@@ -61,6 +99,7 @@ FRESULT f_lseek (
         DWORD ofs		/* File pointer from top of file */
 )
 {
+        fp->fptr = ofs;
         return FR_OK;
 }
 
@@ -52,6 +52,21 @@ void vTaskDelay(portTickType xTicksToDelay)
         usleep((useconds_t)xTicksToDelay * 1000);
 }
 
+void vPortEnterCritical(void)
+{
+}
+
+void vPortExitCritical(void)
+{
+}
+
+void vTaskDelayUntil(portTickType * const pxPreviousWakeTime,
+                     portTickType xTimeIncrement)
+{
+        *pxPreviousWakeTime += xTimeIncrement;
+        usleep((useconds_t)xTimeIncrement * 1000);
+}
+
 signed portBASE_TYPE xTaskGenericCreate(
         pdTASK_CODE pvTaskCode,
         const signed char * const pcName,
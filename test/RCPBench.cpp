@@ -0,0 +1,378 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Host benchmarks.  Populates the same sample through the fused channel
+ * pipelines, and again through the config reading getters and the sample
+ * type switch the channels used before, then reports the cost per channel
+ * of each.  Also times the spectral analysis of one block, to gauge its
+ * cost before enabling it on a logger, and the CAN mapping of each type
+ * compiled and as it was before.
+ *
+ * Built with the test flags, so absolute numbers mean little.  Compare the
+ * runs with each other.
+ */
+
+#include "ADC.h"
+#include "ADC_mock.h"
+#include "byteswap.h"
+#include "can_mapping.h"
+#include "capabilities.h"
+#include "imu.h"
+#include "imu_mock.h"
+#include "loggerConfig.h"
+#include "loggerSampleData.h"
+#include "sampleRecord.h"
+#include "spectral.h"
+#include "timer.h"
+#include "timer_mock.h"
+#include "units_conversion.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_ROUNDS	200000
+#define SPECTRAL_ROUNDS	20000
+#define SPECTRAL_RATE_HZ	4000.0f
+#define CAN_MAPPING_ROUNDS	2000000
+
+static struct sample_channels sc;
+static struct sample s;
+
+/* The getters as they were, reading the config on every call */
+static float legacy_analog_sample(int channelId)
+{
+        LoggerConfig *loggerConfig = getWorkingLoggerConfig();
+        ADCConfig *ac = &(loggerConfig->ADCConfigs[channelId]);
+        float value = ADC_read(channelId);
+
+        switch (ac->scalingMode) {
+        case SCALING_MODE_RAW:
+                return value;
+        case SCALING_MODE_LINEAR:
+                return ac->linearScaling * value + ac->linearOffset;
+        case SCALING_MODE_MAP:
+                return get_mapped_value(value, &(ac->scalingMap));
+        default:
+                return -1;
+        }
+}
+
+static float legacy_imu_sample(int channelId)
+{
+        LoggerConfig *config = getWorkingLoggerConfig();
+        ImuConfig *c = &(config->ImuConfigs[channelId]);
+        return imu_read_value((enum imu_channel) channelId, c);
+}
+
+static float legacy_timer_sample(int cid)
+{
+        TimerConfig *c = getWorkingLoggerConfig()->TimerConfigs + cid;
+        const float ppr = c->pulsePerRevolution;
+        if (0 == ppr)
+                return 0;
+
+        switch (c->mode) {
+        case MODE_LOGGING_TIMER_RPM:
+                return timer_get_rpm(cid) / ppr;
+        case MODE_LOGGING_TIMER_FREQUENCY:
+                return timer_get_hz(cid) / ppr;
+        case MODE_LOGGING_TIMER_PERIOD_MS:
+                return timer_get_ms(cid) * ppr;
+        case MODE_LOGGING_TIMER_PERIOD_USEC:
+                return timer_get_usec(cid) * ppr;
+        default:
+                return -1;
+        }
+}
+
+static float (*legacy_getter(const ChannelSample *cs))(int)
+{
+        if ((void *) cs->get_float_sample == (void *) get_analog_sample)
+                return legacy_analog_sample;
+        if ((void *) cs->get_float_sample == (void *) get_imu_sample)
+                return legacy_imu_sample;
+        if ((void *) cs->get_float_sample == (void *) timer_get_sample)
+                return legacy_timer_sample;
+
+        return NULL;
+}
+
+static void build_channels(LoggerConfig *lc)
+{
+        init_sample_channels(&sc, get_enabled_channel_count(lc));
+        init_sample_buffer(&s, &sc);
+}
+
+static double elapsed_ns(const struct timespec *start,
+                         const struct timespec *end)
+{
+        return (end->tv_sec - start->tv_sec) * 1e9 +
+                (end->tv_nsec - start->tv_nsec);
+}
+
+/* @return The time in ns to populate one sample */
+static double time_populate(void)
+{
+        struct timespec start, end;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (size_t i = 0; i < BENCH_ROUNDS; ++i)
+                populate_sample_buffer(&s, 0);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        return elapsed_ns(&start, &end) / BENCH_ROUNDS;
+}
+
+static void setup_channels(LoggerConfig *lc)
+{
+        for (size_t i = 0; i < CONFIG_ADC_CHANNELS; ++i) {
+                ADCConfig *ac = lc->ADCConfigs + i;
+                ac->cfg.sampleRate = encodeSampleRate(50);
+                ac->scalingMode = SCALING_MODE_LINEAR;
+                ac->linearScaling = 2;
+                ac->linearOffset = 1;
+                ADC_mock_set_value(i, 100 + i);
+        }
+
+        for (size_t i = 0; i < CONFIG_IMU_CHANNELS; ++i)
+                lc->ImuConfigs[i].cfg.sampleRate = encodeSampleRate(50);
+
+        for (size_t i = 0; i < CONFIG_TIMER_CHANNELS; ++i) {
+                TimerConfig *tc = lc->TimerConfigs + i;
+                tc->cfg.sampleRate = encodeSampleRate(50);
+                tc->mode = MODE_LOGGING_TIMER_RPM;
+                tc->pulsePerRevolution = 1;
+                timer_mock_capture(i, 10000 + i);
+        }
+
+        ADC_init(lc);
+        imu_init(lc);
+        timer_init(lc);
+        ADC_sample_all();
+        imu_mock_push_sample();
+        imu_sample_all();
+        timer_sample_all();
+
+        /* Only keep the channels under test, and the time channels */
+        build_channels(lc);
+        for (size_t i = 0; i < sc.count; ++i) {
+                ChannelSample *cs = sc.samples + i;
+                if (!cs->pipeline.raw && !(cs->cfg->flags & ALWAYS_SAMPLED))
+                        cs->cfg->sampleRate = SAMPLE_DISABLED;
+        }
+        build_channels(lc);
+}
+
+/* Times one block of a spectral analysis and the bare transform */
+static void bench_spectral(void)
+{
+        static int32_t samples[FFT_POINTS];
+        struct spectral_config sc = {
+                SPECTRAL_MODE_BANDS, SPECTRAL_BANDS_MAX, 0,
+                SPECTRAL_RATE_HZ / 2,
+        };
+        static struct fft_block b;
+        float outputs[SPECTRAL_BANDS_MAX];
+        struct timespec start, end;
+
+        for (size_t i = 0; i < FFT_POINTS; ++i)
+                samples[i] = 2048 + 1000 * sinf(i * 0.3f) +
+                        300 * sinf(i * 1.7f);
+
+        fft_init();
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (size_t i = 0; i < SPECTRAL_ROUNDS; ++i) {
+                fft_load(&b, samples);
+                fft_transform(&b);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        const double fft_ns = elapsed_ns(&start, &end) / SPECTRAL_ROUNDS;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (size_t i = 0; i < SPECTRAL_ROUNDS; ++i)
+                spectral_analyze(&sc, samples, SPECTRAL_RATE_HZ, 0.01f,
+                                 outputs);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        const double bands_ns = elapsed_ns(&start, &end) / SPECTRAL_ROUNDS;
+
+        sc.mode = SPECTRAL_MODE_PEAK;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (size_t i = 0; i < SPECTRAL_ROUNDS; ++i)
+                spectral_analyze(&sc, samples, SPECTRAL_RATE_HZ, 0.01f,
+                                 outputs);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        const double peak_ns = elapsed_ns(&start, &end) / SPECTRAL_ROUNDS;
+
+        const double blocks = SPECTRAL_RATE_HZ / FFT_POINTS;
+        printf("fft points:         %d\n", FFT_POINTS);
+        printf("window + fft:       %.2f us/block\n", fft_ns / 1000);
+        printf("%d bands:            %.2f us/block\n", SPECTRAL_BANDS_MAX,
+               bands_ns / 1000);
+        printf("peak frequency:     %.2f us/block\n", peak_ns / 1000);
+        printf("bands at %.0fHz:    %.3f%% cpu\n", SPECTRAL_RATE_HZ,
+               bands_ns * blocks / 1e7);
+}
+
+/* The CAN mapping as it was, working everything out on every value */
+static float legacy_can_extract(uint64_t raw_data, const CANMapping *mapping)
+{
+        raw_data = swap_uint64(raw_data);
+
+        uint8_t offset = mapping->offset;
+        uint8_t length = mapping->length;
+        if (! mapping->bit_mode) {
+                length *= 8;
+                offset *= 8;
+        }
+        uint32_t bitmask = (1UL << length) - 1;
+        uint32_t raw_value = (raw_data >> (64 - offset - length)) & bitmask;
+
+        if (!mapping->big_endian)
+                raw_value = swap_uint_length(raw_value, length);
+
+        switch (mapping->type) {
+        case CANMappingType_unsigned:
+                return (float)raw_value;
+        case CANMappingType_signed:
+                if (length <= 8)
+                        return (float)*((int8_t*)&raw_value);
+                if (length <= 16)
+                        return (float)*((int16_t*)&raw_value);
+                return (float)*((int32_t*)&raw_value);
+        case CANMappingType_IEEE754:
+                return *((float*)&raw_value);
+        case CANMappingType_sign_magnitude: {
+                uint32_t sign = 1 << (length - 1);
+                return raw_value < sign ? (float)raw_value :
+                        -(float)(raw_value & (sign - 1));
+        }
+        default:
+                return 0;
+        }
+}
+
+static float legacy_can_map(const CAN_msg *msg, const CANMapping *mapping)
+{
+        float value = legacy_can_extract(msg->data64, mapping);
+        value = canmapping_apply_formula(value, mapping);
+        return convert_units((enum unit_conversions)
+                             mapping->conversion_filter_id, value);
+}
+
+/* Times one mapped value of each type, compiled and as it was */
+static void bench_can_mapping(void)
+{
+        static const char *names[CANMappingType_ENUM_COUNT] = {
+                "unsigned", "signed", "IEEE754", "sign-magnitude",
+        };
+        CAN_msg msg;
+        CANMapping mapping;
+        struct can_extractor ex;
+        struct timespec start, end;
+        volatile float sink = 0;
+
+        memset(&msg, 0, sizeof(msg));
+        for (size_t i = 0; i < CAN_MSG_SIZE; ++i)
+                msg.data[i] = 0x11 * (i + 1);
+
+        memset(&mapping, 0, sizeof(mapping));
+        mapping.offset = 2;
+        mapping.length = 4;
+        mapping.multiplier = 3;
+        mapping.divider = 2;
+        mapping.adder = 1;
+        mapping.conversion_filter_id = UNIT_CONVERSION_PRESSURE_BAR_TO_PSI;
+
+        for (size_t t = 0; t < CANMappingType_ENUM_COUNT; ++t) {
+                mapping.type = (enum CANMappingType) t;
+
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                for (size_t i = 0; i < CAN_MAPPING_ROUNDS; ++i)
+                        sink = sink + legacy_can_map(&msg, &mapping);
+                clock_gettime(CLOCK_MONOTONIC, &end);
+                const double legacy_ns =
+                        elapsed_ns(&start, &end) / CAN_MAPPING_ROUNDS;
+
+                /* The frame bits are shared by every mapping of a frame */
+                canmapping_compile(&ex, &mapping);
+                const uint64_t frame = canmapping_frame_bits(&msg);
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                for (size_t i = 0; i < CAN_MAPPING_ROUNDS; ++i)
+                        sink = sink + canmapping_extract(&ex, frame);
+                clock_gettime(CLOCK_MONOTONIC, &end);
+                const double compiled_ns =
+                        elapsed_ns(&start, &end) / CAN_MAPPING_ROUNDS;
+
+                printf("CAN %-15s %.1f ns as was, %.1f ns compiled\n",
+                       names[t], legacy_ns, compiled_ns);
+        }
+}
+
+int main(int argc, char* argv[])
+{
+        LoggerConfig *lc = getWorkingLoggerConfig();
+        initialize_logger_config();
+        setup_channels(lc);
+
+        size_t fused = 0;
+        for (size_t i = 0; i < sc.count; ++i)
+                if (sc.samples[i].pipeline.raw)
+                        ++fused;
+
+        const double t_fused = time_populate();
+
+        for (size_t i = 0; i < sc.count; ++i) {
+                ChannelSample *cs = sc.samples + i;
+                if (!cs->pipeline.raw)
+                        continue;
+
+                cs->pipeline.raw = NULL;
+                cs->get_float_sample = legacy_getter(cs);
+        }
+        const double t_legacy = time_populate();
+
+        /* What is left is the cost of the sample itself */
+        for (size_t i = 0; i < sc.count; ++i) {
+                ChannelSample *cs = sc.samples + i;
+                if (!(cs->cfg->flags & ALWAYS_SAMPLED))
+                        cs->cfg->sampleRate = SAMPLE_DISABLED;
+        }
+        build_channels(lc);
+        const double t_base = time_populate();
+
+        const double fused_ns = (t_fused - t_base) / fused;
+        const double legacy_ns = (t_legacy - t_base) / fused;
+
+        printf("channels:           %zu\n", fused);
+        printf("getter and switch:  %.1f ns/channel\n", legacy_ns);
+        printf("fused pipeline:     %.1f ns/channel\n", fused_ns);
+        printf("speedup:            %.2fx\n", legacy_ns / fused_ns);
+
+        bench_spectral();
+        bench_can_mapping();
+
+        free_sample_buffer(&s);
+        free_sample_channels(&sc);
+        return 0;
+}
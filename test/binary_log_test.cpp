@@ -0,0 +1,278 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "binary_log.h"
+#include "binary_log_test.h"
+#include "high_rate_lane.h"
+#include "loggerConfig.h"
+#include "sampleRecord.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( BinaryLogTest );
+
+#define TEST_CHANNELS 10
+
+static std::string out;
+static int write_fail_after;
+
+static int capture_write(const void *data, size_t len)
+{
+        if (write_fail_after >= 0 && (int) out.size() >= write_fail_after)
+                return -1;
+
+        out.append((const char *) data, len);
+        return 0;
+}
+
+static ChannelConfig cfgs[TEST_CHANNELS];
+static ChannelSample samples[TEST_CHANNELS];
+static double values[TEST_CHANNELS];
+static uint32_t populated;
+static struct sample s;
+
+void BinaryLogTest::setUp()
+{
+        out.clear();
+        write_fail_after = -1;
+        memset(cfgs, 0, sizeof(cfgs));
+        memset(samples, 0, sizeof(samples));
+        memset(values, 0, sizeof(values));
+        populated = 0;
+
+        for (int i = 0; i < TEST_CHANNELS; ++i) {
+                ChannelConfig *cc = cfgs + i;
+                strcpy(cc->label, "Chan");
+                strcpy(cc->units, "U");
+                cc->min = -1.0f;
+                cc->max = 1.0f;
+                cc->sampleRate = SAMPLE_10Hz;
+                cc->precision = 2;
+
+                samples[i].cfg = cc;
+                samples[i].sampleData = SampleData_Float;
+                samples[i].offset = i * sizeof(values[0]);
+        }
+
+        samples[0].sampleData = SampleData_Int_Noarg;
+        samples[1].sampleData = SampleData_LongLong_Noarg;
+        samples[2].sampleData = SampleData_Double;
+
+        s.ticks = 1234;
+        s.channel_count = TEST_CHANNELS;
+        s.channel_samples = samples;
+        s.values = values;
+        s.populated = &populated;
+}
+
+void BinaryLogTest::tearDown()
+{
+        high_rate_lane_configure(NULL, 0, 0);
+}
+
+void BinaryLogTest::test_type_mapping()
+{
+        CPPUNIT_ASSERT_EQUAL(BINARY_LOG_TYPE_INT32,
+                             binary_log_get_type(samples + 0));
+        CPPUNIT_ASSERT_EQUAL(BINARY_LOG_TYPE_INT64,
+                             binary_log_get_type(samples + 1));
+        CPPUNIT_ASSERT_EQUAL(BINARY_LOG_TYPE_DOUBLE,
+                             binary_log_get_type(samples + 2));
+        CPPUNIT_ASSERT_EQUAL(BINARY_LOG_TYPE_FLOAT,
+                             binary_log_get_type(samples + 3));
+
+        CPPUNIT_ASSERT_EQUAL((size_t) 4,
+                             binary_log_type_size(BINARY_LOG_TYPE_INT32));
+        CPPUNIT_ASSERT_EQUAL((size_t) 8,
+                             binary_log_type_size(BINARY_LOG_TYPE_INT64));
+        CPPUNIT_ASSERT_EQUAL((size_t) 4,
+                             binary_log_type_size(BINARY_LOG_TYPE_FLOAT));
+        CPPUNIT_ASSERT_EQUAL((size_t) 8,
+                             binary_log_type_size(BINARY_LOG_TYPE_DOUBLE));
+}
+
+void BinaryLogTest::test_write_header()
+{
+        CPPUNIT_ASSERT_EQUAL(0, binary_log_write_header(&s, capture_write));
+
+        /* magic + version + count, then 14 fixed + "Chan\0" + "U\0" each */
+        const size_t desc_len = 1 + 1 + 2 + 4 + 4 + 5 + 2;
+        CPPUNIT_ASSERT_EQUAL((size_t) (4 + 1 + 2 + TEST_CHANNELS * desc_len),
+                             out.size());
+        CPPUNIT_ASSERT_EQUAL(std::string(BINARY_LOG_MAGIC), out.substr(0, 4));
+        CPPUNIT_ASSERT_EQUAL(BINARY_LOG_VERSION, (int) out[4]);
+
+        uint16_t count;
+        memcpy(&count, out.data() + 5, sizeof(count));
+        CPPUNIT_ASSERT_EQUAL((uint16_t) TEST_CHANNELS, count);
+
+        /* Third channel descriptor is the double */
+        const char *desc = out.data() + 7 + 2 * desc_len;
+        CPPUNIT_ASSERT_EQUAL((int) BINARY_LOG_TYPE_DOUBLE, (int) desc[0]);
+        CPPUNIT_ASSERT_EQUAL(2, (int) desc[1]);
+
+        uint16_t rate;
+        memcpy(&rate, desc + 2, sizeof(rate));
+        CPPUNIT_ASSERT_EQUAL((uint16_t) 10, rate);
+
+        float max;
+        memcpy(&max, desc + 8, sizeof(max));
+        CPPUNIT_ASSERT_EQUAL(1.0f, max);
+        CPPUNIT_ASSERT_EQUAL(std::string("Chan"), std::string(desc + 12));
+        CPPUNIT_ASSERT_EQUAL(std::string("U"), std::string(desc + 17));
+}
+
+void BinaryLogTest::test_write_sample()
+{
+        sample_set_populated(&s, 0);
+        *(int *) sample_get_value(&s, 0) = -42;
+        sample_set_populated(&s, 1);
+        *(long long *) sample_get_value(&s, 1) = 1500000000000ll;
+        sample_set_populated(&s, 9);
+        *(float *) sample_get_value(&s, 9) = 3.25f;
+
+        CPPUNIT_ASSERT_EQUAL(0, binary_log_write_sample(&s, capture_write));
+
+        /* record + ticks + 2 bitmap bytes + int32 + int64 + float */
+        CPPUNIT_ASSERT_EQUAL((size_t) (1 + 4 + 2 + 4 + 8 + 4), out.size());
+        CPPUNIT_ASSERT_EQUAL((int) BINARY_LOG_RECORD_SAMPLE, (int) out[0]);
+
+        uint32_t ticks;
+        memcpy(&ticks, out.data() + 1, sizeof(ticks));
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 1234, ticks);
+
+        CPPUNIT_ASSERT_EQUAL(0x03, (int) (uint8_t) out[5]);
+        CPPUNIT_ASSERT_EQUAL(0x02, (int) (uint8_t) out[6]);
+
+        int32_t int_val;
+        int64_t longlong_val;
+        float float_val;
+        memcpy(&int_val, out.data() + 7, sizeof(int_val));
+        memcpy(&longlong_val, out.data() + 11, sizeof(longlong_val));
+        memcpy(&float_val, out.data() + 19, sizeof(float_val));
+        CPPUNIT_ASSERT_EQUAL((int32_t) -42, int_val);
+        CPPUNIT_ASSERT_EQUAL((int64_t) 1500000000000ll, longlong_val);
+        CPPUNIT_ASSERT_EQUAL(3.25f, float_val);
+}
+
+void BinaryLogTest::test_write_sample_none_populated()
+{
+        CPPUNIT_ASSERT_EQUAL(0, binary_log_write_sample(&s, capture_write));
+        CPPUNIT_ASSERT_EQUAL((size_t) (1 + 4 + 2), out.size());
+        CPPUNIT_ASSERT_EQUAL(0, (int) out[5]);
+        CPPUNIT_ASSERT_EQUAL(0, (int) out[6]);
+}
+
+void BinaryLogTest::test_write_error_propagates()
+{
+        write_fail_after = 5;
+        CPPUNIT_ASSERT_EQUAL(-1, binary_log_write_sample(&s, capture_write));
+        CPPUNIT_ASSERT_EQUAL((size_t) 5, out.size());
+}
+
+void BinaryLogTest::test_write_high_rate()
+{
+        const struct channel_scaling scaling = {
+                CHANNEL_SCALING_LINEAR, 2048, 0.5f, -1.0f,
+        };
+        struct high_rate_lane_channel lane = { cfgs + 0, &scaling, 1 };
+        high_rate_lane_configure(&lane, 1, 4000);
+
+        CPPUNIT_ASSERT_EQUAL(0, binary_log_write_header(&s, capture_write));
+
+        /* Lane record follows the channel descriptors */
+        const size_t desc_len = 1 + 1 + 2 + 4 + 4 + 5 + 2;
+        const char *rec = out.data() + 7 + TEST_CHANNELS * desc_len;
+        CPPUNIT_ASSERT_EQUAL((size_t) (rec - out.data()) + 1 + 4 + 1 +
+                             12 + 5 + 2, out.size());
+        CPPUNIT_ASSERT_EQUAL((int) BINARY_LOG_RECORD_LANE, (int) rec[0]);
+
+        uint32_t rate;
+        memcpy(&rate, rec + 1, sizeof(rate));
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 4000, rate);
+        CPPUNIT_ASSERT_EQUAL(1, (int) rec[5]);
+
+        int32_t bias;
+        memcpy(&bias, rec + 6, sizeof(bias));
+        CPPUNIT_ASSERT_EQUAL((int32_t) 2048, bias);
+        CPPUNIT_ASSERT_EQUAL(std::string("Chan"), std::string(rec + 18));
+
+        uint32_t cursor = high_rate_lane_get_seq();
+        uint32_t skipped = 0;
+        const uint16_t scans[3][2] = {{1, 10}, {2, 20}, {3, 30}};
+        high_rate_lane_push_scans(&scans[0][0], 3, 2);
+        s.high_rate_seq = high_rate_lane_get_seq();
+
+        out.clear();
+        CPPUNIT_ASSERT_EQUAL(0, binary_log_write_high_rate(&s, &cursor,
+                                                           &skipped,
+                                                           capture_write));
+        CPPUNIT_ASSERT_EQUAL(s.high_rate_seq, cursor);
+
+        /* record + ticks + seq + scan count + one channel per scan */
+        CPPUNIT_ASSERT_EQUAL((size_t) (1 + 4 + 4 + 2 + 3 * 2), out.size());
+        CPPUNIT_ASSERT_EQUAL((int) BINARY_LOG_RECORD_BLOCK, (int) out[0]);
+
+        uint32_t ticks;
+        uint16_t count, last;
+        memcpy(&ticks, out.data() + 1, sizeof(ticks));
+        memcpy(&count, out.data() + 9, sizeof(count));
+        memcpy(&last, out.data() + 15, sizeof(last));
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 1234, ticks);
+        CPPUNIT_ASSERT_EQUAL((uint16_t) 3, count);
+        CPPUNIT_ASSERT_EQUAL((uint16_t) 30, last);
+
+        /* Nothing new since the cursor */
+        out.clear();
+        CPPUNIT_ASSERT_EQUAL(0, binary_log_write_high_rate(&s, &cursor,
+                                                           &skipped,
+                                                           capture_write));
+        CPPUNIT_ASSERT(out.empty());
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 0, skipped);
+}
+
+void BinaryLogTest::test_write_high_rate_counts_skipped()
+{
+        const struct channel_scaling scaling = {
+                CHANNEL_SCALING_LINEAR, 2048, 0.5f, -1.0f,
+        };
+        struct high_rate_lane_channel lane = { cfgs + 0, &scaling, 0 };
+        high_rate_lane_configure(&lane, 1, 4000);
+
+        uint32_t cursor = high_rate_lane_get_seq();
+        uint32_t skipped = 0;
+        const uint16_t scan = 7;
+
+        /* Twice what the ring holds goes by before the writer gets to it */
+        for (size_t i = 0; i < 2 * HIGH_RATE_LANE_SCANS; ++i)
+                high_rate_lane_push_scans(&scan, 1, 1);
+        s.high_rate_seq = high_rate_lane_get_seq();
+
+        CPPUNIT_ASSERT_EQUAL(0, binary_log_write_high_rate(&s, &cursor,
+                                                           &skipped,
+                                                           capture_write));
+        CPPUNIT_ASSERT_EQUAL(s.high_rate_seq, cursor);
+        CPPUNIT_ASSERT_EQUAL((uint32_t) (HIGH_RATE_LANE_SCANS +
+                                         HIGH_RATE_LANE_BLOCK_SCANS),
+                             skipped);
+}
@@ -0,0 +1,52 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _BINARY_LOG_TEST_H_
+#define _BINARY_LOG_TEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class BinaryLogTest : public CppUnit::TestFixture
+{
+        CPPUNIT_TEST_SUITE( BinaryLogTest );
+        CPPUNIT_TEST( test_type_mapping );
+        CPPUNIT_TEST( test_write_header );
+        CPPUNIT_TEST( test_write_sample );
+        CPPUNIT_TEST( test_write_sample_none_populated );
+        CPPUNIT_TEST( test_write_error_propagates );
+        CPPUNIT_TEST( test_write_high_rate );
+        CPPUNIT_TEST( test_write_high_rate_counts_skipped );
+        CPPUNIT_TEST_SUITE_END();
+
+public:
+        void setUp();
+        void tearDown();
+
+        void test_type_mapping();
+        void test_write_header();
+        void test_write_sample();
+        void test_write_sample_none_populated();
+        void test_write_error_propagates();
+        void test_write_high_rate();
+        void test_write_high_rate_counts_skipped();
+};
+
+#endif /* _BINARY_LOG_TEST_H_ */
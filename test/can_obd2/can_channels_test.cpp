@@ -0,0 +1,168 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "can_channels.h"
+#include "can_channels_test.h"
+#include "loggerConfig.h"
+#include <string.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CANChannelsTest );
+
+static CANChannelConfig cfg;
+
+static void set_mapping(const size_t index, const uint8_t can_bus,
+                        const uint32_t can_id, const uint32_t can_mask)
+{
+        CANMapping *mapping = &cfg.can_channels[index].mapping;
+
+        memset(mapping, 0, sizeof(*mapping));
+        mapping->can_channel = can_bus;
+        mapping->can_id = can_id;
+        mapping->can_mask = can_mask;
+        mapping->sub_id = -1;
+        mapping->offset = index % CAN_MSG_SIZE;
+        mapping->length = 1;
+        mapping->multiplier = 1;
+        mapping->divider = 1;
+}
+
+static void receive(const uint8_t can_bus, const uint32_t can_id,
+                    const uint32_t timestamp = 0)
+{
+        CAN_msg msg;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.can_bus = can_bus;
+        msg.addressValue = can_id;
+        msg.timestamp = timestamp;
+        for (size_t i = 0; i < CAN_MSG_SIZE; i++)
+                msg.data[i] = i + 1;
+
+        update_can_channels(&msg, &cfg, cfg.enabled_mappings);
+}
+
+static void index_mappings(const uint16_t count)
+{
+        cfg.enabled_mappings = count;
+        CAN_init_current_values(count);
+        CAN_init_mapping_index(&cfg, count);
+}
+
+void CANChannelsTest::setUp()
+{
+        memset(&cfg, 0, sizeof(cfg));
+}
+
+void CANChannelsTest::tearDown()
+{
+        index_mappings(0);
+}
+
+void CANChannelsTest::exact_id_test(void)
+{
+        set_mapping(0, 0, 0x200, 0);
+        set_mapping(1, 0, 0x100, 0);
+        set_mapping(2, 1, 0x100, 0);
+        set_mapping(3, 0, 0x300, 0);
+        index_mappings(4);
+
+        receive(0, 0x100);
+        CPPUNIT_ASSERT_EQUAL(0.0f, CAN_get_current_channel_value(0));
+        CPPUNIT_ASSERT_EQUAL(2.0f, CAN_get_current_channel_value(1));
+        CPPUNIT_ASSERT_EQUAL(0.0f, CAN_get_current_channel_value(2));
+        CPPUNIT_ASSERT_EQUAL(0.0f, CAN_get_current_channel_value(3));
+
+        receive(1, 0x100);
+        CPPUNIT_ASSERT_EQUAL(3.0f, CAN_get_current_channel_value(2));
+
+        /* IDs without a mapping leave every value alone */
+        receive(0, 0x150);
+        receive(2, 0x100);
+        CPPUNIT_ASSERT_EQUAL(0.0f, CAN_get_current_channel_value(0));
+        CPPUNIT_ASSERT_EQUAL(0.0f, CAN_get_current_channel_value(3));
+
+        receive(0, 0x300);
+        receive(0, 0x200);
+        CPPUNIT_ASSERT_EQUAL(1.0f, CAN_get_current_channel_value(0));
+        CPPUNIT_ASSERT_EQUAL(4.0f, CAN_get_current_channel_value(3));
+}
+
+void CANChannelsTest::masked_id_test(void)
+{
+        set_mapping(0, 0, 0x100, 0);
+        set_mapping(1, 0, 0x600, 0xF00);
+        set_mapping(2, 0, 0, 0);
+        set_mapping(3, 1, 0, 0);
+        index_mappings(4);
+
+        receive(0, 0x6AB);
+        CPPUNIT_ASSERT_EQUAL(0.0f, CAN_get_current_channel_value(0));
+        CPPUNIT_ASSERT_EQUAL(2.0f, CAN_get_current_channel_value(1));
+        CPPUNIT_ASSERT_EQUAL(3.0f, CAN_get_current_channel_value(2));
+        CPPUNIT_ASSERT_EQUAL(0.0f, CAN_get_current_channel_value(3));
+
+        receive(0, 0x100);
+        CPPUNIT_ASSERT_EQUAL(1.0f, CAN_get_current_channel_value(0));
+}
+
+void CANChannelsTest::shared_id_test(void)
+{
+        for (size_t i = 0; i < 6; i++)
+                set_mapping(i, 0, i % 2 ? 0x100 : 0x200, 0);
+        index_mappings(6);
+
+        receive(0, 0x100);
+        for (size_t i = 0; i < 6; i++)
+                CPPUNIT_ASSERT_EQUAL(i % 2 ? i + 1.0f : 0.0f,
+                                     CAN_get_current_channel_value(i));
+}
+
+void CANChannelsTest::reindex_test(void)
+{
+        set_mapping(0, 0, 0x100, 0);
+        index_mappings(1);
+
+        set_mapping(0, 0, 0x200, 0);
+        index_mappings(1);
+
+        receive(0, 0x100);
+        CPPUNIT_ASSERT_EQUAL(0.0f, CAN_get_current_channel_value(0));
+        receive(0, 0x200);
+        CPPUNIT_ASSERT_EQUAL(1.0f, CAN_get_current_channel_value(0));
+}
+
+void CANChannelsTest::timestamp_test(void)
+{
+        set_mapping(0, 0, 0x100, 0);
+        set_mapping(1, 0, 0x200, 0);
+        index_mappings(2);
+
+        CPPUNIT_ASSERT_EQUAL(0u, CAN_get_current_channel_timestamp(0));
+
+        receive(0, 0x100, 1500);
+        receive(0, 0x200, 2750);
+        CPPUNIT_ASSERT_EQUAL(1500u, CAN_get_current_channel_timestamp(0));
+        CPPUNIT_ASSERT_EQUAL(2750u, CAN_get_current_channel_timestamp(1));
+
+        receive(0, 0x100, 4000);
+        CPPUNIT_ASSERT_EQUAL(4000u, CAN_get_current_channel_timestamp(0));
+        CPPUNIT_ASSERT_EQUAL(2750u, CAN_get_current_channel_timestamp(1));
+}
@@ -0,0 +1,244 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CAN.h"
+#include "CAN_device_mock.h"
+#include "CAN_filter.h"
+#include "can_filter_test.h"
+#include "loggerConfig.h"
+#include "shiftx_drv.h"
+#include "stdutil.h"
+#include "taskUtil.h"
+#include "task_testing.h"
+#include <string.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CANFilterTest );
+
+static struct can_filter_rule std_rule(const uint32_t id)
+{
+        struct can_filter_rule rule = {id, CAN_STD_ID_MASK, false};
+        return rule;
+}
+
+static struct can_filter_rule ext_rule(const uint32_t id)
+{
+        struct can_filter_rule rule = {id, CAN_EXT_ID_MASK, true};
+        return rule;
+}
+
+/* Checks what the planned hardware filters would let through */
+static bool accepts(const struct can_filter_plan *plan, const uint32_t id,
+                    const bool extended)
+{
+        if (plan->accept_all)
+                return true;
+
+        for (size_t i = 0; i < plan->bank_count; i++) {
+                const struct can_filter_bank *bank = plan->banks + i;
+                if (bank->extended != extended)
+                        continue;
+
+                if (bank->mode == CAN_FILTER_MODE_MASK) {
+                        if ((id & bank->mask) == bank->ids[0])
+                                return true;
+                        continue;
+                }
+
+                for (size_t j = 0; j < bank->count; j++) {
+                        if (bank->ids[j] == id)
+                                return true;
+                }
+        }
+
+        return false;
+}
+
+void CANFilterTest::setUp()
+{
+        initialize_logger_config();
+}
+
+void CANFilterTest::tearDown()
+{
+        initialize_logger_config();
+}
+
+void CANFilterTest::wildcard_test(void)
+{
+        struct can_filter_rule rules[] = {
+                std_rule(0x100), {0, 0, false}, ext_rule(0x18DAF110),
+        };
+        struct can_filter_plan plan;
+
+        CAN_filter_plan(&plan, rules, 3);
+        CPPUNIT_ASSERT(plan.accept_all);
+}
+
+void CANFilterTest::list_packing_test(void)
+{
+        struct can_filter_rule rules[] = {
+                std_rule(0x100), std_rule(0x101), std_rule(0x102),
+                std_rule(0x103), std_rule(0x104),
+                ext_rule(0x18DAF110), ext_rule(0x18DAF111),
+                ext_rule(0x18DAF112),
+                {0x600, 0x700, false},
+        };
+        struct can_filter_plan plan;
+
+        CAN_filter_plan(&plan, rules, 9);
+        CPPUNIT_ASSERT(!plan.accept_all);
+
+        /* 1 mask bank, 2 banks for 5 std IDs and 2 for 3 ext IDs */
+        CPPUNIT_ASSERT_EQUAL(5, (int) plan.bank_count);
+        CPPUNIT_ASSERT_EQUAL(CAN_FILTER_MODE_MASK, plan.banks[0].mode);
+        CPPUNIT_ASSERT_EQUAL(4, (int) plan.banks[1].count);
+        CPPUNIT_ASSERT_EQUAL(1, (int) plan.banks[2].count);
+        CPPUNIT_ASSERT(plan.banks[3].extended);
+        CPPUNIT_ASSERT_EQUAL(2, (int) plan.banks[3].count);
+
+        CPPUNIT_ASSERT(accepts(&plan, 0x104, false));
+        CPPUNIT_ASSERT(accepts(&plan, 0x6AB, false));
+        CPPUNIT_ASSERT(accepts(&plan, 0x18DAF112, true));
+        CPPUNIT_ASSERT(!accepts(&plan, 0x105, false));
+        CPPUNIT_ASSERT(!accepts(&plan, 0x18DAF113, true));
+        CPPUNIT_ASSERT(!accepts(&plan, 0x104, true));
+}
+
+void CANFilterTest::covered_rule_test(void)
+{
+        struct can_filter_rule rules[] = {
+                std_rule(0x610), std_rule(0x100), std_rule(0x100),
+                {0x600, 0x700, false},
+        };
+        struct can_filter_plan plan;
+
+        /* 0x610 falls within the mask and 0x100 is listed once */
+        CAN_filter_plan(&plan, rules, 4);
+        CPPUNIT_ASSERT_EQUAL(2, (int) plan.bank_count);
+        CPPUNIT_ASSERT_EQUAL(1, (int) plan.banks[1].count);
+        CPPUNIT_ASSERT(accepts(&plan, 0x610, false));
+        CPPUNIT_ASSERT(accepts(&plan, 0x100, false));
+}
+
+void CANFilterTest::merge_test(void)
+{
+        const size_t count = 100;
+        struct can_filter_rule rules[count];
+        uint32_t ids[count];
+
+        for (size_t i = 0; i < count; i++) {
+                ids[i] = 0x100 + i * 7;
+                rules[i] = std_rule(ids[i]);
+        }
+
+        struct can_filter_plan plan;
+        CAN_filter_plan(&plan, rules, count);
+
+        CPPUNIT_ASSERT(!plan.accept_all);
+        CPPUNIT_ASSERT(plan.bank_count <= CAN_FILTER_BANKS);
+        for (size_t i = 0; i < count; i++)
+                CPPUNIT_ASSERT(accepts(&plan, ids[i], false));
+
+        /* Merging only widens the filters as far as it has to */
+        CPPUNIT_ASSERT(!accepts(&plan, 0x7FF, false));
+}
+
+void CANFilterTest::apply_test(void)
+{
+        LoggerConfig *lc = getWorkingLoggerConfig();
+        struct can_filter_status status;
+
+        CAN_filter_apply(lc);
+        CAN_filter_get_status(0, &status);
+        CPPUNIT_ASSERT(status.accept_all);
+
+        CANChannelConfig *ccc = &lc->can_channel_cfg;
+        ccc->enabled = true;
+        ccc->enabled_mappings = 2;
+        ccc->can_channels[0].mapping.can_channel = 0;
+        ccc->can_channels[0].mapping.can_id = 0x100;
+        ccc->can_channels[1].mapping.can_channel = 1;
+        ccc->can_channels[1].mapping.can_id = 0x200;
+        lc->OBD2Configs.enabled = false;
+        shiftx_get_config()->can_bus = 1;
+        lc->CanConfig.auto_filter = true;
+
+        CAN_filter_apply(lc);
+        CAN_filter_get_status(0, &status);
+        CPPUNIT_ASSERT(!status.accept_all);
+        CPPUNIT_ASSERT_EQUAL(1, (int) status.bank_count);
+
+        /* A wildcard mapping needs every frame */
+        ccc->can_channels[0].mapping.can_id = 0;
+        CAN_filter_apply(lc);
+        CAN_filter_get_status(0, &status);
+        CPPUNIT_ASSERT(status.accept_all);
+}
+
+void CANFilterTest::script_filter_kept_test(void)
+{
+        LoggerConfig *lc = getWorkingLoggerConfig();
+        uint32_t filter;
+        uint32_t mask;
+
+        /* Starts out with the driver defaults */
+        CAN_filter_apply(lc);
+        CPPUNIT_ASSERT(!lc->CanConfig.auto_filter);
+
+        CAN_set_filter(0, 3, 0, 0x123, 0x7FF, true);
+        CAN_filter_apply(lc);
+        CPPUNIT_ASSERT(CAN_device_mock_get_filter(0, 3, &filter, &mask));
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 0x123, filter);
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 0x7FF, mask);
+
+        /* Turning auto filtering off again opens the bus back up */
+        lc->CanConfig.auto_filter = true;
+        CAN_filter_apply(lc);
+        lc->CanConfig.auto_filter = false;
+        CAN_filter_apply(lc);
+        CPPUNIT_ASSERT(!CAN_device_mock_get_filter(0, 3, &filter, &mask));
+        CPPUNIT_ASSERT(CAN_device_mock_get_filter(0, 0, &filter, &mask));
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 0, mask);
+}
+
+void CANFilterTest::latency_test(void)
+{
+        struct can_filter_status before;
+        struct can_filter_status status;
+        CAN_msg msg;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.can_bus = 1;
+        CAN_filter_get_status(1, &before);
+
+        /* 10 ms at the host tick rate */
+        set_ticks(msToTicks(10));
+        msg.timestamp = 7500;
+        CAN_filter_count_rx(&msg);
+        msg.timestamp = 9000;
+        CAN_filter_count_rx(&msg);
+
+        CAN_filter_get_status(1, &status);
+        CPPUNIT_ASSERT_EQUAL(before.accepted + 2, status.accepted);
+        CPPUNIT_ASSERT_EQUAL(MAX(before.max_latency_us, 2500u),
+                             status.max_latency_us);
+        reset_ticks();
+}
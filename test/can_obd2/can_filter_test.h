@@ -0,0 +1,52 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TEST_CAN_OBD2_CAN_FILTER_TEST_H_
+#define TEST_CAN_OBD2_CAN_FILTER_TEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class CANFilterTest : public CppUnit::TestFixture
+{
+        CPPUNIT_TEST_SUITE( CANFilterTest );
+        CPPUNIT_TEST( wildcard_test );
+        CPPUNIT_TEST( list_packing_test );
+        CPPUNIT_TEST( covered_rule_test );
+        CPPUNIT_TEST( merge_test );
+        CPPUNIT_TEST( apply_test );
+        CPPUNIT_TEST( script_filter_kept_test );
+        CPPUNIT_TEST( latency_test );
+        CPPUNIT_TEST_SUITE_END();
+
+public:
+        void setUp();
+        void tearDown();
+
+        void wildcard_test(void);
+        void list_packing_test(void);
+        void covered_rule_test(void);
+        void merge_test(void);
+        void apply_test(void);
+        void script_filter_kept_test(void);
+        void latency_test(void);
+};
+
+#endif /* TEST_CAN_OBD2_CAN_FILTER_TEST_H_ */
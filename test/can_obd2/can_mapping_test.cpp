@@ -20,6 +20,7 @@
  */
 
 #include "can_mapping.h"
+#include "units_conversion.h"
 #include "can_mapping_test.h"
 #include <string.h>
 #include <cppunit/extensions/HelperMacros.h>
@@ -443,3 +444,53 @@ void CANMappingTest::mapping_test(void)
         CPPUNIT_ASSERT_EQUAL(true, result);
         CPPUNIT_ASSERT_EQUAL((float)MAPPING_FORMULA(0x0102, multiplier, divider, adder), value);
 }
+
+void CANMappingTest::compiled_test(void)
+{
+        CAN_msg msg;
+        CANMapping mapping;
+        struct can_extractor ex;
+        memset(&mapping, 0, sizeof(mapping));
+        memset(&msg, 0, sizeof(CAN_msg));
+
+        /* 12 bit sign-magnitude at bit 4, -0x123 */
+        msg.data[0] = 0x09;
+        msg.data[1] = 0x23;
+        mapping.bit_mode = true;
+        mapping.offset = 4;
+        mapping.length = 12;
+        mapping.big_endian = true;
+        mapping.type = CANMappingType_sign_magnitude;
+
+        /* the formula and units conversion fold into one scale and offset */
+        mapping.multiplier = 2;
+        mapping.divider = 4;
+        mapping.adder = 10;
+        mapping.conversion_filter_id = UNIT_CONVERSION_TEMPERATURE_C_TO_F;
+
+        canmapping_compile(&ex, &mapping);
+        const uint64_t frame = canmapping_frame_bits(&msg);
+        CPPUNIT_ASSERT_EQUAL(-291.0f, canmapping_extract_raw(&ex, frame));
+
+        const float expected = (-291.0f * 2 / 4 + 10) * 1.8f + 32;
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(expected, canmapping_extract(&ex, frame),
+                                     0.001);
+
+        /* the full mapping gives the same as the compiled one */
+        float value;
+        CPPUNIT_ASSERT(canmapping_map_value(&value, &msg, &mapping));
+        CPPUNIT_ASSERT_EQUAL(canmapping_extract(&ex, frame), value);
+
+        /* 24 bit little endian signed only extends the sign from bit 31 */
+        msg.data[0] = 0xFF;
+        msg.data[1] = 0xFF;
+        msg.data[2] = 0xFF;
+        mapping.bit_mode = false;
+        mapping.offset = 0;
+        mapping.length = 3;
+        mapping.big_endian = false;
+        mapping.type = CANMappingType_signed;
+        canmapping_compile(&ex, &mapping);
+        CPPUNIT_ASSERT_EQUAL(16777215.0f, canmapping_extract_raw(
+                                     &ex, canmapping_frame_bits(&msg)));
+}
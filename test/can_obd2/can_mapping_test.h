@@ -19,6 +19,7 @@ class CANMappingTest : public CppUnit::TestFixture
         CPPUNIT_TEST( extract_test );
         CPPUNIT_TEST( extract_test_bit_mode );
         CPPUNIT_TEST( extract_type_test );
+        CPPUNIT_TEST( compiled_test );
         CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -28,6 +29,7 @@ public:
         void extract_test(void);
         void extract_test_bit_mode(void);
         void extract_type_test(void);
+        void compiled_test(void);
 };
 
 #endif /* TEST_CAN_OBD2_CAN_MAPPING_TEST_H_ */
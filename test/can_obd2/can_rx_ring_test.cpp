@@ -0,0 +1,110 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CAN_rx_ring.h"
+#include "can_rx_ring_test.h"
+#include <string.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CANRxRingTest );
+
+static bool put(const uint32_t can_id)
+{
+        signed portBASE_TYPE task_woken = pdFALSE;
+        CAN_msg msg;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.addressValue = can_id;
+
+        return CAN_rx_ring_put_from_isr(&msg, &task_woken);
+}
+
+void CANRxRingTest::setUp()
+{
+        CAN_msg msgs[CAN_RX_RING_SIZE];
+
+        CAN_rx_ring_init();
+        CAN_rx_ring_get(msgs, CAN_RX_RING_SIZE, 0);
+}
+
+void CANRxRingTest::empty_test(void)
+{
+        CAN_msg msg;
+
+        CPPUNIT_ASSERT_EQUAL((size_t) 0, CAN_rx_ring_get(&msg, 1, 0));
+        CPPUNIT_ASSERT_EQUAL((size_t) 0, CAN_rx_ring_get(&msg, 1, 10));
+}
+
+void CANRxRingTest::batch_test(void)
+{
+        CAN_msg msgs[CAN_RX_RING_SIZE];
+        struct can_rx_stats before;
+        struct can_rx_stats stats;
+
+        CAN_rx_ring_get_stats(&before);
+        for (uint32_t i = 0; i < 5; i++)
+                CPPUNIT_ASSERT(put(0x100 + i));
+
+        /* A drain takes what is waiting, oldest first, up to the count */
+        CPPUNIT_ASSERT_EQUAL((size_t) 3, CAN_rx_ring_get(msgs, 3, 0));
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 0x100, msgs[0].addressValue);
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 0x102, msgs[2].addressValue);
+
+        CPPUNIT_ASSERT_EQUAL((size_t) 2,
+                             CAN_rx_ring_get(msgs, CAN_RX_RING_SIZE, 0));
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 0x103, msgs[0].addressValue);
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 0x104, msgs[1].addressValue);
+
+        CAN_rx_ring_get_stats(&stats);
+        CPPUNIT_ASSERT_EQUAL(before.received + 5, stats.received);
+        CPPUNIT_ASSERT_EQUAL(before.dropped, stats.dropped);
+        CPPUNIT_ASSERT(stats.high_water >= 5);
+}
+
+void CANRxRingTest::overflow_test(void)
+{
+        CAN_msg msgs[CAN_RX_RING_SIZE];
+        struct can_rx_stats before;
+        struct can_rx_stats stats;
+
+        CAN_rx_ring_get_stats(&before);
+        for (uint32_t i = 0; i < CAN_RX_RING_SIZE; i++)
+                CPPUNIT_ASSERT(put(i));
+
+        /* A full ring drops the newest frames */
+        CPPUNIT_ASSERT(!put(CAN_RX_RING_SIZE));
+        CPPUNIT_ASSERT(!put(CAN_RX_RING_SIZE + 1));
+
+        CAN_rx_ring_get_stats(&stats);
+        CPPUNIT_ASSERT_EQUAL(before.received + CAN_RX_RING_SIZE,
+                             stats.received);
+        CPPUNIT_ASSERT_EQUAL(before.dropped + 2, stats.dropped);
+        CPPUNIT_ASSERT_EQUAL((uint16_t) CAN_RX_RING_SIZE, stats.high_water);
+
+        CPPUNIT_ASSERT_EQUAL((size_t) CAN_RX_RING_SIZE,
+                             CAN_rx_ring_get(msgs, CAN_RX_RING_SIZE, 0));
+        CPPUNIT_ASSERT_EQUAL((uint32_t) CAN_RX_RING_SIZE - 1,
+                             msgs[CAN_RX_RING_SIZE - 1].addressValue);
+
+        /* Space is free again once drained */
+        CPPUNIT_ASSERT(put(0x200));
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, CAN_rx_ring_get(msgs, 1, 0));
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 0x200, msgs[0].addressValue);
+}
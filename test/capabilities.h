@@ -121,6 +121,8 @@ CPP_GUARD_BEGIN
 #define MAX_SENSOR_SAMPLE_RATE	1000
 #define MAX_GPS_SAMPLE_RATE		50
 #define MAX_OBD2_SAMPLE_RATE	1000
+/* Analog scans buffered by the high rate lane.  A power of two, or 0 */
+#define HIGH_RATE_LANE_SCANS	1024
 
 //logger message buffering
 // Should have no effect in testing.  Kept for consistency.
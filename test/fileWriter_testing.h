@@ -28,6 +28,9 @@
 
 CPP_GUARD_BEGIN
 
+bool file_writer_init(void);
+int commit_logfile(struct logging_status *ls);
+void update_logger_status(struct logging_status *ls);
 int flush_logfile(struct logging_status *ls);
 int logging_stop(struct logging_status *ls);
 int logging_start(struct logging_status *ls);
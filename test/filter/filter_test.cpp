@@ -0,0 +1,155 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "filter.h"
+#include "filter_test.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( FilterTest );
+
+#define UPDATE_HZ	500.0f
+
+void FilterTest::setUp() {}
+
+void FilterTest::tearDown() {}
+
+void FilterTest::test_pass_through()
+{
+        Filter f;
+
+        init_filter(&f, 1);
+        CPPUNIT_ASSERT_EQUAL((int32_t) 10, update_filter(&f, 10));
+        CPPUNIT_ASSERT_EQUAL((int32_t) -3000, update_filter(&f, -3000));
+        CPPUNIT_ASSERT_EQUAL((int32_t) 4095, update_filter(&f, 4095));
+}
+
+void FilterTest::test_primed_by_first_value()
+{
+        Filter f;
+
+        /* No ramp up from zero, no matter how slow the filter */
+        init_filter(&f, 0.01f);
+        CPPUNIT_ASSERT_EQUAL((int32_t) 2048, update_filter(&f, 2048));
+        for (int i = 0; i < 100; ++i)
+                CPPUNIT_ASSERT_EQUAL((int32_t) 2048, update_filter(&f, 2048));
+
+        init_biquad_filter(&f, 5, UPDATE_HZ);
+        CPPUNIT_ASSERT_EQUAL((int32_t) 2048, update_filter(&f, 2048));
+        CPPUNIT_ASSERT_EQUAL((int32_t) 2048, update_filter(&f, 2048));
+
+        /* Starting over primes it again */
+        reset_filter(&f);
+        CPPUNIT_ASSERT_EQUAL((int32_t) 100, update_filter(&f, 100));
+}
+
+void FilterTest::test_ema_cutoff()
+{
+        const float cutoff = 10;
+        const float alpha = filter_cutoff_to_alpha(cutoff, UPDATE_HZ);
+        Filter f;
+
+        init_ema_filter(&f, cutoff, UPDATE_HZ);
+        update_filter(&f, 0);
+
+        /* Follows a floating point EMA to within a count */
+        float expected = 0;
+        for (int i = 0; i < 200; ++i) {
+                expected += alpha * (4000 - expected);
+                const int32_t actual = update_filter(&f, 4000);
+                CPPUNIT_ASSERT(fabsf(expected - actual) <= 1);
+        }
+
+        /* The same cutoff makes a faster alpha at a slower rate */
+        CPPUNIT_ASSERT(filter_cutoff_to_alpha(cutoff, 50) > alpha);
+}
+
+void FilterTest::test_biquad_dc_gain()
+{
+        Filter f;
+
+        init_biquad_filter(&f, 2, UPDATE_HZ);
+        update_filter(&f, 0);
+
+        int32_t value = 0;
+        for (int i = 0; i < 2000; ++i)
+                value = update_filter(&f, 1000);
+
+        /* Error feedback keeps small steps from stalling short of the input */
+        CPPUNIT_ASSERT_EQUAL((int32_t) 1000, value);
+
+        for (int i = 0; i < 2000; ++i)
+                value = update_filter(&f, 1001);
+        CPPUNIT_ASSERT_EQUAL((int32_t) 1001, value);
+}
+
+void FilterTest::test_biquad_attenuation()
+{
+        Filter f;
+        int32_t peak = 0;
+
+        init_biquad_filter(&f, 10, UPDATE_HZ);
+        update_filter(&f, 0);
+
+        /* 100Hz is more than three octaves above the cutoff */
+        for (int i = 0; i < 1000; ++i) {
+                const float t = i / UPDATE_HZ;
+                const int32_t in = (int32_t) (1000 * sinf(2 * M_PI * 100 * t));
+                const int32_t out = update_filter(&f, in);
+
+                if (i > 500 && abs(out) > peak)
+                        peak = abs(out);
+        }
+
+        CPPUNIT_ASSERT(peak < 20);
+}
+
+void FilterTest::test_biquad_above_nyquist()
+{
+        Filter f;
+
+        init_biquad_filter(&f, 300, UPDATE_HZ);
+        update_filter(&f, 0);
+        CPPUNIT_ASSERT_EQUAL((int32_t) 77, update_filter(&f, 77));
+}
+
+void FilterTest::test_batch_update()
+{
+        Filter batch[3];
+        Filter single[3];
+
+        for (int i = 0; i < 3; ++i) {
+                init_biquad_filter(batch + i, 5 + i, UPDATE_HZ);
+                init_biquad_filter(single + i, 5 + i, UPDATE_HZ);
+        }
+
+        for (int n = 0; n < 50; ++n) {
+                const int32_t values[3] = {n * 7, 4095 - n, (n % 5) * 100};
+
+                update_filters(batch, values, 3);
+                for (int i = 0; i < 3; ++i) {
+                        update_filter(single + i, values[i]);
+                        CPPUNIT_ASSERT_EQUAL(single[i].current_value,
+                                             batch[i].current_value);
+                }
+        }
+}
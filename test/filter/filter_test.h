@@ -0,0 +1,52 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _FILTER_TEST_H_
+#define _FILTER_TEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class FilterTest : public CppUnit::TestFixture
+{
+        CPPUNIT_TEST_SUITE( FilterTest );
+        CPPUNIT_TEST( test_pass_through );
+        CPPUNIT_TEST( test_primed_by_first_value );
+        CPPUNIT_TEST( test_ema_cutoff );
+        CPPUNIT_TEST( test_biquad_dc_gain );
+        CPPUNIT_TEST( test_biquad_attenuation );
+        CPPUNIT_TEST( test_biquad_above_nyquist );
+        CPPUNIT_TEST( test_batch_update );
+        CPPUNIT_TEST_SUITE_END();
+
+public:
+        void setUp();
+        void tearDown();
+
+        void test_pass_through();
+        void test_primed_by_first_value();
+        void test_ema_cutoff();
+        void test_biquad_dc_gain();
+        void test_biquad_attenuation();
+        void test_biquad_above_nyquist();
+        void test_batch_update();
+};
+
+#endif /* _FILTER_TEST_H_ */
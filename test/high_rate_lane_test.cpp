@@ -0,0 +1,194 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "high_rate_lane.h"
+#include "high_rate_lane_test.h"
+#include "loggerConfig.h"
+
+#include <stdint.h>
+#include <string.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( HighRateLaneTest );
+
+#define SCAN_WIDTH	4
+#define LANE_RATE_HZ	4000
+
+static ChannelConfig cfgs[2];
+static struct channel_scaling scaling;
+static struct high_rate_lane_channel channels[2];
+
+/* Pushes scans whose values encode the scan and ADC channel */
+static void push(const uint32_t first, const size_t count)
+{
+        uint16_t scans[64][SCAN_WIDTH];
+
+        for (size_t s = 0; s < count; ++s)
+                for (size_t c = 0; c < SCAN_WIDTH; ++c)
+                        scans[s][c] = (first + s) * 10 + c;
+
+        high_rate_lane_push_scans(&scans[0][0], count, SCAN_WIDTH);
+}
+
+static void push_many(uint32_t first, size_t count)
+{
+        while (count) {
+                const size_t n = count < 64 ? count : 64;
+                push(first, n);
+                first += n;
+                count -= n;
+        }
+}
+
+void HighRateLaneTest::setUp()
+{
+        memset(cfgs, 0, sizeof(cfgs));
+        for (size_t i = 0; i < 2; ++i) {
+                cfgs[i].sampleRate = SAMPLE_10Hz;
+                channels[i].cfg = cfgs + i;
+                channels[i].scaling = &scaling;
+        }
+        channels[0].source = 3;
+        channels[1].source = 1;
+
+        high_rate_lane_configure(channels, 2, LANE_RATE_HZ);
+}
+
+void HighRateLaneTest::tearDown()
+{
+        high_rate_lane_configure(NULL, 0, 0);
+}
+
+void HighRateLaneTest::test_configure()
+{
+        const struct high_rate_lane_channel *chs;
+
+        CPPUNIT_ASSERT_EQUAL((size_t) 2, high_rate_lane_get_channels(&chs));
+        CPPUNIT_ASSERT_EQUAL((uint32_t) LANE_RATE_HZ,
+                             high_rate_lane_get_rate());
+        CPPUNIT_ASSERT_EQUAL(3, (int) chs[0].source);
+        CPPUNIT_ASSERT(cfgs + 1 == chs[1].cfg);
+
+        struct high_rate_lane_channel many[HIGH_RATE_LANE_CHANNELS_MAX + 1];
+        for (size_t i = 0; i < HIGH_RATE_LANE_CHANNELS_MAX + 1; ++i)
+                many[i] = channels[0];
+
+        CPPUNIT_ASSERT_EQUAL((size_t) HIGH_RATE_LANE_CHANNELS_MAX,
+                             high_rate_lane_configure(many,
+                                                      HIGH_RATE_LANE_CHANNELS_MAX + 1,
+                                                      LANE_RATE_HZ));
+}
+
+void HighRateLaneTest::test_disabled_without_rate()
+{
+        const struct high_rate_lane_channel *chs;
+
+        CPPUNIT_ASSERT_EQUAL((size_t) 0,
+                             high_rate_lane_configure(channels, 2, 0));
+        CPPUNIT_ASSERT_EQUAL((size_t) 0, high_rate_lane_get_channels(&chs));
+
+        const uint32_t seq = high_rate_lane_get_seq();
+        push(0, 8);
+        CPPUNIT_ASSERT_EQUAL(seq, high_rate_lane_get_seq());
+}
+
+void HighRateLaneTest::test_slow_channel_rejected()
+{
+        const struct high_rate_lane_channel *chs;
+
+        /* The ring lasts a quarter second at this rate */
+        cfgs[0].sampleRate = SAMPLE_1Hz;
+        CPPUNIT_ASSERT_EQUAL((size_t) 1,
+                             high_rate_lane_configure(channels, 2,
+                                                      LANE_RATE_HZ));
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, high_rate_lane_get_channels(&chs));
+        CPPUNIT_ASSERT(cfgs + 1 == chs[0].cfg);
+
+        cfgs[1].sampleRate = SAMPLE_DISABLED;
+        CPPUNIT_ASSERT_EQUAL((size_t) 0,
+                             high_rate_lane_configure(channels, 2,
+                                                      LANE_RATE_HZ));
+}
+
+void HighRateLaneTest::test_read_blocks()
+{
+        uint32_t cursor = high_rate_lane_get_seq();
+        const uint32_t start = cursor;
+        struct high_rate_block block;
+
+        push_many(0, HIGH_RATE_LANE_BLOCK_SCANS + 8);
+        const uint32_t end = high_rate_lane_get_seq();
+        CPPUNIT_ASSERT_EQUAL(start + HIGH_RATE_LANE_BLOCK_SCANS + 8, end);
+
+        CPPUNIT_ASSERT(high_rate_lane_read_block(&cursor, end, &block));
+        CPPUNIT_ASSERT_EQUAL(start, block.seq);
+        CPPUNIT_ASSERT_EQUAL((uint16_t) HIGH_RATE_LANE_BLOCK_SCANS,
+                             block.scans);
+        CPPUNIT_ASSERT_EQUAL((uint16_t) 3, block.values[0][0]);
+        CPPUNIT_ASSERT_EQUAL((uint16_t) 1, block.values[0][1]);
+        CPPUNIT_ASSERT_EQUAL((uint16_t) 53, block.values[5][0]);
+        CPPUNIT_ASSERT_EQUAL((uint16_t) 51, block.values[5][1]);
+
+        CPPUNIT_ASSERT(high_rate_lane_read_block(&cursor, end, &block));
+        CPPUNIT_ASSERT_EQUAL((uint16_t) 8, block.scans);
+        CPPUNIT_ASSERT_EQUAL(start + HIGH_RATE_LANE_BLOCK_SCANS, block.seq);
+        CPPUNIT_ASSERT_EQUAL((uint16_t) ((HIGH_RATE_LANE_BLOCK_SCANS + 7) *
+                                         10 + 3), block.values[7][0]);
+
+        CPPUNIT_ASSERT(!high_rate_lane_read_block(&cursor, end, &block));
+        CPPUNIT_ASSERT_EQUAL(end, cursor);
+}
+
+void HighRateLaneTest::test_read_stops_at_end()
+{
+        uint32_t cursor = high_rate_lane_get_seq();
+        struct high_rate_block block;
+
+        push(0, 10);
+        const uint32_t end = high_rate_lane_get_seq();
+        push(10, 10);
+
+        CPPUNIT_ASSERT(high_rate_lane_read_block(&cursor, end, &block));
+        CPPUNIT_ASSERT_EQUAL((uint16_t) 10, block.scans);
+        CPPUNIT_ASSERT(!high_rate_lane_read_block(&cursor, end, &block));
+
+        /* An end beyond the scans pushed so far is clamped */
+        CPPUNIT_ASSERT(high_rate_lane_read_block(&cursor, end + 100, &block));
+        CPPUNIT_ASSERT_EQUAL((uint16_t) 10, block.scans);
+        CPPUNIT_ASSERT_EQUAL((uint16_t) 103, block.values[0][0]);
+        CPPUNIT_ASSERT_EQUAL(end + 10, cursor);
+}
+
+void HighRateLaneTest::test_lapped_reader_skips()
+{
+        uint32_t cursor = high_rate_lane_get_seq();
+        struct high_rate_block block;
+
+        push_many(0, 2 * HIGH_RATE_LANE_SCANS);
+        const uint32_t end = high_rate_lane_get_seq();
+
+        CPPUNIT_ASSERT(high_rate_lane_read_block(&cursor, end, &block));
+        CPPUNIT_ASSERT_EQUAL(end - HIGH_RATE_LANE_SCANS +
+                             HIGH_RATE_LANE_BLOCK_SCANS, block.seq);
+
+        const uint32_t first = 2 * HIGH_RATE_LANE_SCANS -
+                HIGH_RATE_LANE_SCANS + HIGH_RATE_LANE_BLOCK_SCANS;
+        CPPUNIT_ASSERT_EQUAL((uint16_t) (first * 10 + 3), block.values[0][0]);
+}
@@ -0,0 +1,50 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _HIGH_RATE_LANE_TEST_H_
+#define _HIGH_RATE_LANE_TEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class HighRateLaneTest : public CppUnit::TestFixture
+{
+        CPPUNIT_TEST_SUITE( HighRateLaneTest );
+        CPPUNIT_TEST( test_configure );
+        CPPUNIT_TEST( test_disabled_without_rate );
+        CPPUNIT_TEST( test_slow_channel_rejected );
+        CPPUNIT_TEST( test_read_blocks );
+        CPPUNIT_TEST( test_read_stops_at_end );
+        CPPUNIT_TEST( test_lapped_reader_skips );
+        CPPUNIT_TEST_SUITE_END();
+
+public:
+        void setUp();
+        void tearDown();
+
+        void test_configure();
+        void test_disabled_without_rate();
+        void test_slow_channel_rejected();
+        void test_read_blocks();
+        void test_read_stops_at_end();
+        void test_lapped_reader_skips();
+};
+
+#endif /* _HIGH_RATE_LANE_TEST_H_ */
@@ -0,0 +1,291 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ADC.h"
+#include "ADC_mock.h"
+#include "histogram.h"
+#include "histogram_test.h"
+#include "histogram_testing.h"
+#include "loggerConfig.h"
+#include "loggerHardware.h"
+#include "loggerSampleData.h"
+#include "sampleRecord.h"
+
+#include <string.h>
+#include <string>
+
+using std::string;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( HistogramTest );
+
+#define BATTERY_CHANNEL	(CONFIG_ADC_CHANNELS - 1)
+
+static struct histogram_config hc;
+static struct histogram h;
+
+void HistogramTest::setUp()
+{
+        InitLoggerHardware();
+        initialize_logger_config();
+
+        hc.mode = HISTOGRAM_MODE_LAP;
+        hc.source = HISTOGRAM_SOURCE_VALUE;
+        hc.bins = 4;
+        hc.min = -2;
+        hc.max = 2;
+        histogram_reset(&h);
+}
+
+void HistogramTest::tearDown()
+{
+        initialize_logger_config();
+        init_histograms(getWorkingLoggerConfig());
+}
+
+void HistogramTest::test_bins()
+{
+        CPPUNIT_ASSERT_EQUAL(0.0f, histogram_bin_percent(&h, 0));
+
+        histogram_add(&h, &hc, 1, -1.5f);
+        histogram_add(&h, &hc, 2, -0.5f);
+        histogram_add(&h, &hc, 3, 0.5f);
+        histogram_add(&h, &hc, 4, 0.9f);
+
+        /* Out of range readings count in the outer bins */
+        histogram_add(&h, &hc, 5, -10);
+        histogram_add(&h, &hc, 6, 2);
+        histogram_add(&h, &hc, 7, 10);
+        histogram_add(&h, &hc, 8, 1.0f);
+
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 8, h.total);
+        CPPUNIT_ASSERT_EQUAL(25.0f, histogram_bin_percent(&h, 0));
+        CPPUNIT_ASSERT_EQUAL(12.5f, histogram_bin_percent(&h, 1));
+        CPPUNIT_ASSERT_EQUAL(25.0f, histogram_bin_percent(&h, 2));
+        CPPUNIT_ASSERT_EQUAL(37.5f, histogram_bin_percent(&h, 3));
+}
+
+void HistogramTest::test_rate_source()
+{
+        hc.source = HISTOGRAM_SOURCE_RATE;
+        hc.min = -200;
+        hc.max = 200;
+
+        /* The first reading only primes the rate */
+        histogram_add(&h, &hc, 10, 5);
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 0, h.total);
+
+        /* +0.15 over 1 ms is +150 per second */
+        histogram_add(&h, &hc, 10 + TICK_RATE_HZ / 1000, 5.15f);
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 1, h.total);
+        CPPUNIT_ASSERT_EQUAL(100.0f, histogram_bin_percent(&h, 3));
+
+        /* -0.15 over 2 ms is -75 per second */
+        histogram_add(&h, &hc, 10 + 3 * TICK_RATE_HZ / 1000, 5.0f);
+        CPPUNIT_ASSERT_EQUAL(50.0f, histogram_bin_percent(&h, 1));
+}
+
+void HistogramTest::test_rolling()
+{
+        hc.mode = HISTOGRAM_MODE_ROLLING;
+
+        for (size_t i = 0; i < HISTOGRAM_ROLLING_READINGS - 1; ++i)
+                histogram_add(&h, &hc, i, -1.5f);
+        histogram_add(&h, &hc, 0, 1.5f);
+
+        /* Old readings fade out when the window fills up */
+        CPPUNIT_ASSERT_EQUAL((uint32_t) HISTOGRAM_ROLLING_READINGS / 2 - 1,
+                             h.total);
+        for (size_t i = 0; i < HISTOGRAM_ROLLING_READINGS / 2; ++i)
+                histogram_add(&h, &hc, i, 1.5f);
+
+        CPPUNIT_ASSERT(histogram_bin_percent(&h, 3) > 50.0f);
+}
+
+void HistogramTest::test_config_valid()
+{
+        CPPUNIT_ASSERT(is_histogram_config_valid(&hc));
+
+        hc.max = hc.min;
+        CPPUNIT_ASSERT(!is_histogram_config_valid(&hc));
+        hc.max = 2;
+
+        hc.mode = HISTOGRAM_MODE_DISABLED;
+        CPPUNIT_ASSERT(!is_histogram_config_valid(&hc));
+        hc.mode = HISTOGRAM_MODE_ROLLING;
+
+        hc.bins = filterHistogramBins(100);
+        CPPUNIT_ASSERT_EQUAL(HISTOGRAM_BINS_MAX, (int) hc.bins);
+        hc.bins = filterHistogramBins(1);
+        CPPUNIT_ASSERT_EQUAL(HISTOGRAM_BINS_MIN, (int) hc.bins);
+        CPPUNIT_ASSERT(is_histogram_config_valid(&hc));
+}
+
+void HistogramTest::test_analog_histogram()
+{
+        LoggerConfig *lc = getWorkingLoggerConfig();
+        ADCConfig *ac = lc->ADCConfigs + BATTERY_CHANNEL;
+        const size_t base = get_enabled_channel_count(lc);
+
+        CPPUNIT_ASSERT_EQUAL(false, is_histogram_enabled(lc));
+        ac->histogram.mode = HISTOGRAM_MODE_ROLLING;
+        ac->histogram.bins = 5;
+        ac->histogram.min = 0;
+        ac->histogram.max = 5;
+        CPPUNIT_ASSERT_EQUAL(true, is_histogram_enabled(lc));
+
+        /* The bins only show up once the logger task sets them up */
+        CPPUNIT_ASSERT_EQUAL(base, get_enabled_channel_count(lc));
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, init_histograms(lc));
+        CPPUNIT_ASSERT_EQUAL(base + 5, get_enabled_channel_count(lc));
+
+        struct sample_channels sc;
+        struct sample s;
+        memset(&sc, 0, sizeof(sc));
+        memset(&s, 0, sizeof(s));
+        CPPUNIT_ASSERT(init_sample_channels(&sc, get_enabled_channel_count(lc)));
+        CPPUNIT_ASSERT(init_sample_buffer(&s, &sc));
+
+        const ChannelConfig *bin_cfg = get_histogram_bin_config(0, 4);
+        CPPUNIT_ASSERT_EQUAL(string("BatteryH4"), string(bin_cfg->label));
+        CPPUNIT_ASSERT_EQUAL(string("%"), string(bin_cfg->units));
+        CPPUNIT_ASSERT_EQUAL(ac->cfg.sampleRate, bin_cfg->sampleRate);
+
+        /* Readings between log ticks all count */
+        const size_t rate = ac->cfg.sampleRate;
+        const int raw[] = {100, 300, 700, 900};
+        for (size_t i = 0; i < 4; ++i) {
+                ADC_mock_set_value(BATTERY_CHANNEL, raw[i]);
+                ADC_sample_all();
+                histogram_channel_samples(rate / 4 * (i + 1));
+        }
+        populate_sample_buffer(&s, rate);
+
+        const char *labels[] = {
+                "BatteryH0", "BatteryH1", "BatteryH2", "BatteryH3",
+                "BatteryH4",
+        };
+        const double shares[] = {25, 25, 0, 25, 25};
+        for (size_t i = 0; i < 5; ++i) {
+                double value;
+                char *units;
+                CPPUNIT_ASSERT(get_sample_value_by_name(&s, labels[i],
+                                                        &value, &units));
+                CPPUNIT_ASSERT_EQUAL(shares[i], value);
+        }
+
+        free_sample_buffer(&s);
+        free_sample_channels(&sc);
+}
+
+void HistogramTest::test_histogram_limit()
+{
+        LoggerConfig *lc = getWorkingLoggerConfig();
+        const size_t base = get_enabled_channel_count(lc);
+
+        for (size_t i = 0; i < CONFIG_ADC_CHANNELS; ++i) {
+                ADCConfig *ac = lc->ADCConfigs + i;
+                ac->cfg.sampleRate = SAMPLE_10Hz;
+                ac->histogram = hc;
+        }
+
+        CPPUNIT_ASSERT(CONFIG_ADC_CHANNELS > HISTOGRAM_CHANNELS_MAX);
+        CPPUNIT_ASSERT_EQUAL((size_t) HISTOGRAM_CHANNELS_MAX,
+                             init_histograms(lc));
+        const size_t enabled = get_enabled_channel_count(lc) - base;
+        CPPUNIT_ASSERT_EQUAL((size_t) (CONFIG_ADC_CHANNELS - 1 +
+                                       HISTOGRAM_CHANNELS_MAX * hc.bins),
+                             enabled);
+}
+
+static double get_bin_share(struct sample *s, const char *label)
+{
+        double value;
+        char *units;
+
+        CPPUNIT_ASSERT(get_sample_value_by_name(s, label, &value, &units));
+        return value;
+}
+
+void HistogramTest::test_lap_logged_before_reset()
+{
+        LoggerConfig *lc = getWorkingLoggerConfig();
+        ADCConfig *ac = lc->ADCConfigs + BATTERY_CHANNEL;
+
+        ac->histogram.mode = HISTOGRAM_MODE_LAP;
+        ac->histogram.bins = 5;
+        ac->histogram.min = 0;
+        ac->histogram.max = 5;
+        init_histograms(lc);
+
+        struct sample_channels sc;
+        struct sample s;
+        memset(&sc, 0, sizeof(sc));
+        memset(&s, 0, sizeof(s));
+        CPPUNIT_ASSERT(init_sample_channels(&sc, get_enabled_channel_count(lc)));
+        CPPUNIT_ASSERT(init_sample_buffer(&s, &sc));
+
+        const size_t rate = ac->cfg.sampleRate;
+        ADC_mock_set_value(BATTERY_CHANNEL, 100);
+        ADC_sample_all();
+        update_histograms(rate / 2, 0);
+
+        /* The next lap starts before the first lap was logged */
+        ADC_mock_set_value(BATTERY_CHANNEL, 900);
+        ADC_sample_all();
+        update_histograms(rate + rate / 2, 1);
+        populate_sample_buffer(&s, 2 * rate);
+        CPPUNIT_ASSERT_EQUAL(100.0, get_bin_share(&s, "BatteryH0"));
+        CPPUNIT_ASSERT_EQUAL(0.0, get_bin_share(&s, "BatteryH4"));
+
+        /* Then the new lap is logged from its first reading on */
+        update_histograms(2 * rate + rate / 2, 1);
+        populate_sample_buffer(&s, 3 * rate);
+        CPPUNIT_ASSERT_EQUAL(0.0, get_bin_share(&s, "BatteryH0"));
+        CPPUNIT_ASSERT_EQUAL(100.0, get_bin_share(&s, "BatteryH4"));
+
+        free_sample_buffer(&s);
+        free_sample_channels(&sc);
+}
+
+void HistogramTest::test_table_keeps_readings()
+{
+        LoggerConfig *lc = getWorkingLoggerConfig();
+        ADCConfig *ac = lc->ADCConfigs + BATTERY_CHANNEL;
+
+        ac->histogram.mode = HISTOGRAM_MODE_LAP;
+        ac->histogram.bins = 5;
+        ac->histogram.min = 0;
+        ac->histogram.max = 5;
+        init_histograms(lc);
+
+        ADC_mock_set_value(BATTERY_CHANNEL, 900);
+        ADC_sample_all();
+        update_histograms(1, 0);
+
+        /* As when the API builds a table for getMeta or sampleData */
+        struct sample_channels sc;
+        memset(&sc, 0, sizeof(sc));
+        CPPUNIT_ASSERT(init_sample_channels(&sc, get_enabled_channel_count(lc)));
+        free_sample_channels(&sc);
+
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, get_histogram_count());
+        CPPUNIT_ASSERT_EQUAL(100.0f, get_histogram_bin(4));
+}
@@ -0,0 +1,54 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _HISTOGRAM_TEST_H_
+#define _HISTOGRAM_TEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class HistogramTest : public CppUnit::TestFixture
+{
+        CPPUNIT_TEST_SUITE( HistogramTest );
+        CPPUNIT_TEST( test_bins );
+        CPPUNIT_TEST( test_rate_source );
+        CPPUNIT_TEST( test_rolling );
+        CPPUNIT_TEST( test_config_valid );
+        CPPUNIT_TEST( test_analog_histogram );
+        CPPUNIT_TEST( test_histogram_limit );
+        CPPUNIT_TEST( test_lap_logged_before_reset );
+        CPPUNIT_TEST( test_table_keeps_readings );
+        CPPUNIT_TEST_SUITE_END();
+
+public:
+        void setUp();
+        void tearDown();
+
+        void test_bins();
+        void test_rate_source();
+        void test_rolling();
+        void test_config_valid();
+        void test_analog_histogram();
+        void test_histogram_limit();
+        void test_lap_logged_before_reset();
+        void test_table_keeps_readings();
+};
+
+#endif /* _HISTOGRAM_TEST_H_ */
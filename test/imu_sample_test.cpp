@@ -0,0 +1,207 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "imu.h"
+#include "imu_device.h"
+#include "imu_mock.h"
+#include "imu_sample_ring.h"
+#include "imu_sample_test.h"
+#include "loggerConfig.h"
+#include "macros.h"
+
+#include <string.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( ImuSampleTest );
+
+static float read_raw(enum imu_channel channel)
+{
+        ImuConfig *c = getWorkingLoggerConfig()->ImuConfigs + channel;
+        c->zeroValue = 0;
+        return imu_read_value(channel, c) *
+                imu_device_counts_per_unit(channel);
+}
+
+static void set_alpha(const float alpha)
+{
+        ImuConfig *c = getWorkingLoggerConfig()->ImuConfigs;
+        for (size_t i = 0; i < CONFIG_IMU_CHANNELS; i++)
+                c[i].filterAlpha = alpha;
+
+        imu_soft_init(getWorkingLoggerConfig());
+}
+
+void ImuSampleTest::setUp()
+{
+        initialize_logger_config();
+        imu_init(getWorkingLoggerConfig());
+
+        for (size_t i = 0; i < CONFIG_IMU_CHANNELS; i++)
+                imu_mock_set_value(i, 0);
+}
+
+void ImuSampleTest::tearDown() {}
+
+void ImuSampleTest::test_ring_read()
+{
+        struct imu_sample_ring ring;
+        struct imu_sample sample;
+        struct imu_sample out[4];
+        memset(&ring, 0, sizeof(ring));
+        memset(&sample, 0, sizeof(sample));
+
+        CPPUNIT_ASSERT(NULL == imu_sample_ring_newest(&ring));
+        CPPUNIT_ASSERT_EQUAL((size_t) 0, imu_sample_ring_read(&ring, out, 4));
+
+        for (int i = 1; i <= 3; i++) {
+                sample.axis[IMU_CHANNEL_X] = i;
+                imu_sample_ring_push(&ring, &sample);
+        }
+
+        CPPUNIT_ASSERT_EQUAL(3, (int) imu_sample_ring_newest(&ring)->axis[0]);
+        CPPUNIT_ASSERT_EQUAL((size_t) 2, imu_sample_ring_read(&ring, out, 2));
+        CPPUNIT_ASSERT_EQUAL(1, (int) out[0].axis[IMU_CHANNEL_X]);
+        CPPUNIT_ASSERT_EQUAL(2, (int) out[1].axis[IMU_CHANNEL_X]);
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, imu_sample_ring_read(&ring, out, 4));
+        CPPUNIT_ASSERT_EQUAL(3, (int) out[0].axis[IMU_CHANNEL_X]);
+        CPPUNIT_ASSERT_EQUAL((size_t) 0, imu_sample_ring_read(&ring, out, 4));
+}
+
+void ImuSampleTest::test_ring_lapped()
+{
+        struct imu_sample_ring ring;
+        struct imu_sample sample;
+        struct imu_sample out[IMU_SAMPLE_RING_SIZE];
+        memset(&ring, 0, sizeof(ring));
+        memset(&sample, 0, sizeof(sample));
+
+        for (int i = 0; i < 2 * IMU_SAMPLE_RING_SIZE; i++) {
+                sample.axis[IMU_CHANNEL_X] = i;
+                imu_sample_ring_push(&ring, &sample);
+        }
+
+        /* Only the newest samples are left, minus the slot being reused */
+        const size_t count = imu_sample_ring_read(&ring, out,
+                                                  IMU_SAMPLE_RING_SIZE);
+        CPPUNIT_ASSERT_EQUAL((size_t) IMU_SAMPLE_RING_SIZE - 1, count);
+        CPPUNIT_ASSERT_EQUAL(IMU_SAMPLE_RING_SIZE + 1,
+                             (int) out[0].axis[IMU_CHANNEL_X]);
+        CPPUNIT_ASSERT_EQUAL(2 * IMU_SAMPLE_RING_SIZE - 1,
+                             (int) out[count - 1].axis[IMU_CHANNEL_X]);
+}
+
+void ImuSampleTest::test_filters_every_reading()
+{
+        set_alpha(0.5);
+
+        imu_mock_set_value(IMU_CHANNEL_X, 0);
+        imu_mock_push_sample();
+        imu_mock_set_value(IMU_CHANNEL_X, 1000);
+        imu_mock_push_sample();
+        imu_mock_push_sample();
+
+        /* Nothing moves until the sampler drains the readings */
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(0, read_raw(IMU_CHANNEL_X), 1);
+
+        imu_sample_all();
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(750, read_raw(IMU_CHANNEL_X), 1);
+
+        /* Without new readings the filter holds */
+        imu_sample_all();
+        imu_sample_all();
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(750, read_raw(IMU_CHANNEL_X), 1);
+        CPPUNIT_ASSERT_EQUAL(1000, imu_read(IMU_CHANNEL_X));
+}
+
+void ImuSampleTest::test_alpha_scaled_to_device_rate()
+{
+        /* The mock device runs at the reference rate, so alpha is kept */
+        set_alpha(0.25);
+
+        imu_mock_set_value(IMU_CHANNEL_Y, 0);
+        imu_mock_push_sample();
+        imu_mock_set_value(IMU_CHANNEL_Y, 1000);
+        imu_mock_push_sample();
+        imu_sample_all();
+
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(250, read_raw(IMU_CHANNEL_Y), 1);
+}
+
+void ImuSampleTest::test_mounting_rotation()
+{
+        struct imu_mounting *m = &getWorkingLoggerConfig()->imu_mounting;
+        m->yaw = 90;
+        set_alpha(1);
+
+        /* The unit's X axis and roll rate point along the vehicle's Y */
+        imu_mock_set_value(IMU_CHANNEL_X, 819);
+        imu_mock_set_value(IMU_CHANNEL_ROLL, 100);
+        imu_mock_push_sample();
+        imu_sample_all();
+
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(0, read_raw(IMU_CHANNEL_X), 1);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(819, read_raw(IMU_CHANNEL_Y), 1);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(0, read_raw(IMU_CHANNEL_ROLL), 1);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(100, read_raw(IMU_CHANNEL_PITCH), 1);
+}
+
+void ImuSampleTest::test_calibrate_mounting()
+{
+        const struct imu_mounting *m =
+                &getWorkingLoggerConfig()->imu_mounting;
+        set_alpha(1);
+
+        /* Mounted on its side, gravity shows up on the unit's Y axis */
+        imu_mock_set_value(IMU_CHANNEL_Y, 819);
+        imu_mock_push_sample();
+        imu_calibrate_mounting();
+
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(90, m->roll, 0.1);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(0, m->pitch, 0.1);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(0, m->yaw, 0.1);
+
+        imu_mock_push_sample();
+        imu_sample_all();
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(0, imu_read_scaled(IMU_CHANNEL_X), 0.01);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(0, imu_read_scaled(IMU_CHANNEL_Y), 0.01);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(0, imu_read_scaled(IMU_CHANNEL_Z), 0.01);
+}
+
+void ImuSampleTest::test_calibrate_averages_readings()
+{
+        const ImuConfig *c = getWorkingLoggerConfig()->ImuConfigs;
+        const int readings[] = {100, 200, 600, -100};
+
+        for (size_t i = 0; i < ARRAY_LEN(readings); i++) {
+                imu_mock_set_value(IMU_CHANNEL_X, readings[i]);
+                imu_mock_set_value(IMU_CHANNEL_YAW, 2 * readings[i]);
+                imu_mock_push_sample();
+        }
+
+        /* The newest reading stays put, but the average is what counts */
+        imu_calibrate_zero();
+        CPPUNIT_ASSERT_EQUAL(200, (int) c[IMU_CHANNEL_X].zeroValue);
+        CPPUNIT_ASSERT_EQUAL(400, (int) c[IMU_CHANNEL_YAW].zeroValue);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(0, imu_read_scaled(IMU_CHANNEL_X), 0.01);
+
+        /* Without readings the calibration is left alone */
+        imu_calibrate_zero();
+        CPPUNIT_ASSERT_EQUAL(200, (int) c[IMU_CHANNEL_X].zeroValue);
+}
@@ -0,0 +1,52 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _IMU_SAMPLE_TEST_H_
+#define _IMU_SAMPLE_TEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class ImuSampleTest : public CppUnit::TestFixture
+{
+        CPPUNIT_TEST_SUITE( ImuSampleTest );
+        CPPUNIT_TEST( test_ring_read );
+        CPPUNIT_TEST( test_ring_lapped );
+        CPPUNIT_TEST( test_filters_every_reading );
+        CPPUNIT_TEST( test_alpha_scaled_to_device_rate );
+        CPPUNIT_TEST( test_mounting_rotation );
+        CPPUNIT_TEST( test_calibrate_mounting );
+        CPPUNIT_TEST( test_calibrate_averages_readings );
+        CPPUNIT_TEST_SUITE_END();
+
+public:
+        void setUp();
+        void tearDown();
+
+        void test_ring_read();
+        void test_ring_lapped();
+        void test_filters_every_reading();
+        void test_alpha_scaled_to_device_rate();
+        void test_mounting_rotation();
+        void test_calibrate_mounting();
+        void test_calibrate_averages_readings();
+};
+
+#endif /* _IMU_SAMPLE_TEST_H_ */
@@ -26,6 +26,7 @@
 #include <string.h>
 #include <string>
 #include <stdio.h>
+#include "CAN_rx_ring.h"
 #include "FreeRTOS.h"
 #include "api.h"
 #include "auto_logger.h"
@@ -276,6 +277,15 @@ void LoggerApiTest::testGetAnalogConfigFile(string filename, int index)
         analogCfg->scalingMode = 2;
         analogCfg->filterAlpha = 0.6F;
         analogCfg->calibration = 1.01F;
+        analogCfg->aggregation = AGGREGATION_MIN_MAX;
+        analogCfg->filterType = ANALOG_FILTER_TYPE_BIQUAD;
+        analogCfg->filterCutoff = 12.5F;
+        analogCfg->highRate = 1;
+        analogCfg->histogram.mode = HISTOGRAM_MODE_LAP;
+        analogCfg->histogram.source = HISTOGRAM_SOURCE_RATE;
+        analogCfg->histogram.bins = 6;
+        analogCfg->histogram.min = -300.0F;
+        analogCfg->histogram.max = 300.0F;
 
         int i = 0;
         for (int x = 0; x < ANALOG_SCALING_BINS; i+=10,x++) {
@@ -299,6 +309,15 @@ void LoggerApiTest::testGetAnalogConfigFile(string filename, int index)
         CPPUNIT_ASSERT_EQUAL(0.6F, (float)(Number)analogJson["alpha"]);
         CPPUNIT_ASSERT_EQUAL(2, (int)(Number)analogJson["scalMod"]);
         CPPUNIT_ASSERT_EQUAL(1.01F, (float)(Number)analogJson["cal"]);
+        CPPUNIT_ASSERT_EQUAL(AGGREGATION_MIN_MAX, (int)(Number)analogJson["agg"]);
+        CPPUNIT_ASSERT_EQUAL(ANALOG_FILTER_TYPE_BIQUAD, (int)(Number)analogJson["ftype"]);
+        CPPUNIT_ASSERT_EQUAL(12.5F, (float)(Number)analogJson["cutoff"]);
+        CPPUNIT_ASSERT_EQUAL(1, (int)(Number)analogJson["hr"]);
+        CPPUNIT_ASSERT_EQUAL(HISTOGRAM_MODE_LAP, (int)(Number)analogJson["hist"]);
+        CPPUNIT_ASSERT_EQUAL(HISTOGRAM_SOURCE_RATE, (int)(Number)analogJson["hsrc"]);
+        CPPUNIT_ASSERT_EQUAL(6, (int)(Number)analogJson["hbins"]);
+        CPPUNIT_ASSERT_EQUAL(-300.0F, (float)(Number)analogJson["hmin"]);
+        CPPUNIT_ASSERT_EQUAL(300.0F, (float)(Number)analogJson["hmax"]);
 
         Object scalMap = (Object)analogJson["map"];
         Array raw = (Array)scalMap["raw"];
@@ -344,6 +363,7 @@ void LoggerApiTest::testSetAnalogConfigFile(string filename)
         CPPUNIT_ASSERT_EQUAL(9.9F, adcCfg->linearOffset);
         CPPUNIT_ASSERT_EQUAL(0.6F, adcCfg->filterAlpha);
         CPPUNIT_ASSERT_EQUAL(1.01F, adcCfg->calibration);
+        CPPUNIT_ASSERT_EQUAL(AGGREGATION_MIN_MAX, (int)adcCfg->aggregation);
 
         CPPUNIT_ASSERT_EQUAL(0.0F, adcCfg->scalingMap.rawValues[0]);
         CPPUNIT_ASSERT_EQUAL(1.25F, adcCfg->scalingMap.rawValues[1]);
@@ -380,6 +400,10 @@ void LoggerApiTest::testGetImuConfigFile(string filename, int index)
         imuCfg->physicalChannel = IMU_CHANNEL_YAW;
         imuCfg->zeroValue = 1234;
         imuCfg->filterAlpha = 0.7F;
+        imuCfg->aggregation = AGGREGATION_MEAN;
+        imuCfg->histogram.mode = HISTOGRAM_MODE_ROLLING;
+        imuCfg->histogram.bins = 4;
+        imuCfg->histogram.max = 2.5F;
 
         const char * response = processApiGeneric(filename);
         Object json;
@@ -397,6 +421,10 @@ void LoggerApiTest::testGetImuConfigFile(string filename, int index)
         CPPUNIT_ASSERT_EQUAL(3, (int)(Number)imuJson["chan"]);
         CPPUNIT_ASSERT_EQUAL(1234, (int)(Number)imuJson["zeroVal"]);
         CPPUNIT_ASSERT_EQUAL(0.7F, (float)(Number)imuJson["alpha"]);
+        CPPUNIT_ASSERT_EQUAL(AGGREGATION_MEAN, (int)(Number)imuJson["agg"]);
+        CPPUNIT_ASSERT_EQUAL(HISTOGRAM_MODE_ROLLING, (int)(Number)imuJson["hist"]);
+        CPPUNIT_ASSERT_EQUAL(4, (int)(Number)imuJson["hbins"]);
+        CPPUNIT_ASSERT_EQUAL(2.5F, (float)(Number)imuJson["hmax"]);
 }
 
 void LoggerApiTest::testGetImuCfg()
@@ -426,6 +454,12 @@ void LoggerApiTest::testSetImuConfigFile(string filename)
         CPPUNIT_ASSERT_EQUAL(2, (int)imuCfg->physicalChannel);
         CPPUNIT_ASSERT_EQUAL(1234, (int)imuCfg->zeroValue);
         CPPUNIT_ASSERT_EQUAL(0.7F, imuCfg->filterAlpha);
+        CPPUNIT_ASSERT_EQUAL(AGGREGATION_MEAN, (int)imuCfg->aggregation);
+        CPPUNIT_ASSERT_EQUAL(HISTOGRAM_MODE_LAP, (int)imuCfg->histogram.mode);
+        CPPUNIT_ASSERT_EQUAL(HISTOGRAM_SOURCE_RATE, (int)imuCfg->histogram.source);
+        CPPUNIT_ASSERT_EQUAL(HISTOGRAM_BINS_MAX, (int)imuCfg->histogram.bins);
+        CPPUNIT_ASSERT_EQUAL(-2.0F, imuCfg->histogram.min);
+        CPPUNIT_ASSERT_EQUAL(2.0F, imuCfg->histogram.max);
 
         char *txBuffer = mock_getTxBuffer();
         assertGenericResponse(txBuffer, "setImuCfg", API_SUCCESS);
@@ -436,6 +470,28 @@ void LoggerApiTest::testSetImuCfg()
         testSetImuConfigFile("setImuCfg1.json");
 }
 
+void LoggerApiTest::testImuMount()
+{
+        string json = readFile("setImuMount1.json");
+        mock_resetTxBuffer();
+        process_api(getMockSerial(), (char *)json.c_str(), json.size());
+        assertGenericResponse(mock_getTxBuffer(), "setImuMount", API_SUCCESS);
+
+        const struct imu_mounting *m =
+                &getWorkingLoggerConfig()->imu_mounting;
+        CPPUNIT_ASSERT_EQUAL(180.0F, m->roll);
+        CPPUNIT_ASSERT_EQUAL(0.0F, m->pitch);
+        CPPUNIT_ASSERT_EQUAL(-90.0F, m->yaw);
+
+        const char *response = processApiGeneric("getImuMount1.json");
+        Object mountJson;
+        stringToJson(response, mountJson);
+        Object &mount = mountJson["imuMount"];
+        CPPUNIT_ASSERT_EQUAL(180.0F, (float)(Number)mount["roll"]);
+        CPPUNIT_ASSERT_EQUAL(0.0F, (float)(Number)mount["pitch"]);
+        CPPUNIT_ASSERT_EQUAL(-90.0F, (float)(Number)mount["yaw"]);
+}
+
 void LoggerApiTest::testSetConnectivityCfgFile(string filename)
 {
         LoggerConfig *c = getWorkingLoggerConfig();
@@ -1145,6 +1201,7 @@ void LoggerApiTest::testGetCanCfgFile(string filename)
         canConfig->enabled = 1;
         canConfig->baud[0] = 1000000;
         canConfig->baud[1] = 125000;
+        canConfig->auto_filter = true;
 
         const char *response = processApiGeneric(filename);
         Object json;
@@ -1153,6 +1210,7 @@ void LoggerApiTest::testGetCanCfgFile(string filename)
         CPPUNIT_ASSERT_EQUAL(1, (int)(Number)json["canCfg"]["en"]);
         CPPUNIT_ASSERT_EQUAL(1000000, (int)(Number)json["canCfg"]["baud"][0]);
         CPPUNIT_ASSERT_EQUAL(125000, (int)(Number)json["canCfg"]["baud"][1]);
+        CPPUNIT_ASSERT_EQUAL(true, (bool)(Boolean)json["canCfg"]["filt"]);
 }
 
 void LoggerApiTest::testSetCanCfg()
@@ -1170,6 +1228,7 @@ void LoggerApiTest::testSetCanCfgFile(string filename)
         CPPUNIT_ASSERT_EQUAL(1, (int)canCfg->enabled );
         CPPUNIT_ASSERT_EQUAL(125000, (int)canCfg->baud[0]);
         CPPUNIT_ASSERT_EQUAL(1000000, (int)canCfg->baud[1]);
+        CPPUNIT_ASSERT_EQUAL(true, canCfg->auto_filter);
 }
 
 void LoggerApiTest::check_can_mapping_config(Object &jch, CANMapping *mapping)
@@ -1564,6 +1623,15 @@ void LoggerApiTest::testGetStatus()
         CPPUNIT_ASSERT_EQUAL(0, (int)(Number)track_obj["armed"]);
         CPPUNIT_ASSERT_EQUAL(0, (int)(Number)track_obj["inLap"]);
 
+        struct can_rx_stats rx_stats;
+        CAN_rx_ring_get_stats(&rx_stats);
+        Object can_ring = json["status"]["can"]["ring"];
+        CPPUNIT_ASSERT_EQUAL((int) rx_stats.dropped,
+                             (int)(Number)can_ring["drop"]);
+
+        Array can_filt = (Array)json["status"]["can"]["filt"];
+        CPPUNIT_ASSERT_EQUAL((size_t) CAN_CHANNELS, can_filt.Size());
+
         Object telemetry_obj = json["status"]["telemetry"];
         CPPUNIT_ASSERT_EQUAL((int) TELEMETRY_STATUS_IDLE,
                              (int)(Number)telemetry_obj["status"]);
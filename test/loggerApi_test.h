@@ -46,6 +46,7 @@ class LoggerApiTest : public CppUnit::TestFixture
         CPPUNIT_TEST( testSetAnalogCfg );
         CPPUNIT_TEST( testGetImuCfg );
         CPPUNIT_TEST( testSetImuCfg );
+        CPPUNIT_TEST( testImuMount );
         CPPUNIT_TEST( testGetPwmCfg );
         CPPUNIT_TEST( testSetPwmCfg );
         CPPUNIT_TEST( testGetGpioCfg );
@@ -128,6 +129,7 @@ public:
         void testSetAnalogCfg();
         void testGetImuCfg();
         void testSetImuCfg();
+        void testImuMount();
         void testGetPwmCfg();
         void testSetPwmCfg();
         void testGetGpioCfg();
@@ -276,3 +276,30 @@ void LoggerConfigTest::testLoggerInitConnectivityConfig()
         CPPUNIT_ASSERT_EQUAL(string(DEFAULT_TELEMETRY_SERVER_HOST),
                              string(tc->telemetryServerHost));
 }
+
+void LoggerConfigTest::testLoggerInitLoggingConfig()
+{
+        struct logging_config *lc = &getWorkingLoggerConfig()->logging_cfg;
+
+        CPPUNIT_ASSERT_EQUAL(LOG_FILE_FORMAT_CSV, lc->file_format);
+        CPPUNIT_ASSERT_EQUAL(DEFAULT_LOG_FILE_COMMIT_SIZE,
+                             (int) lc->file_commit_size);
+        CPPUNIT_ASSERT_EQUAL(DEFAULT_LOG_FILE_COMMIT_INTERVAL_MS,
+                             (int) lc->file_commit_interval_ms);
+}
+
+void LoggerConfigTest::testLogFileCommitFilters()
+{
+        /* Commit sizes are whole sectors within bounds */
+        CPPUNIT_ASSERT_EQUAL(LOG_FILE_COMMIT_SIZE_MIN,
+                             (int) filter_log_file_commit_size(0));
+        CPPUNIT_ASSERT_EQUAL(1024, (int) filter_log_file_commit_size(1500));
+        CPPUNIT_ASSERT_EQUAL(LOG_FILE_COMMIT_SIZE_MAX,
+                             (int) filter_log_file_commit_size(100000));
+
+        CPPUNIT_ASSERT_EQUAL(LOG_FILE_COMMIT_INTERVAL_MS_MIN,
+                             (int) filter_log_file_commit_interval(0));
+        CPPUNIT_ASSERT_EQUAL(250, (int) filter_log_file_commit_interval(250));
+        CPPUNIT_ASSERT_EQUAL(LOG_FILE_COMMIT_INTERVAL_MS_MAX,
+                             (int) filter_log_file_commit_interval(60000));
+}
@@ -39,6 +39,8 @@ class LoggerConfigTest : public CppUnit::TestFixture
         CPPUNIT_TEST( testLoggerInitGpsConfig );
         CPPUNIT_TEST( testLoggerInitLapConfig );
         CPPUNIT_TEST( testLoggerInitConnectivityConfig );
+        CPPUNIT_TEST( testLoggerInitLoggingConfig );
+        CPPUNIT_TEST( testLogFileCommitFilters );
         CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -56,6 +58,8 @@ public:
         void testLoggerInitGpsConfig();
         void testLoggerInitLapConfig();
         void testLoggerInitConnectivityConfig();
+        void testLoggerInitLoggingConfig();
+        void testLogFileCommitFilters();
 };
 
 #endif /* LOGGERDATA_TEST_H_ */
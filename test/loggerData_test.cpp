@@ -6,6 +6,8 @@
 #include "rcp_cpp_unit.hh"
 #include "imu_mock.h"
 #include "imu.h"
+#include "ADC.h"
+#include "ADC_mock.h"
 #include <stdlib.h>
 // Registers the fixture into the 'registry'
 CPPUNIT_TEST_SUITE_REGISTRATION( LoggerDataTest );
@@ -47,3 +49,46 @@ void LoggerDataTest::testMappedValue()
                 CPPUNIT_ASSERT_CLOSE_ENOUGH(scaled, expected);
         }
 }
+
+/*
+ * The scaling compiled by ADC_init must match scaling the calibrated
+ * voltage on every read.
+ */
+void LoggerDataTest::testCompiledScaling()
+{
+        LoggerConfig *lc = getWorkingLoggerConfig();
+        const size_t channel = 1;
+        ADCConfig *ac = lc->ADCConfigs + channel;
+
+        ac->filterAlpha = 1;
+        ac->filterCutoff = 0;
+        ac->calibration = 1.1f;
+        ac->linearScaling = 2.5f;
+        ac->linearOffset = -3.0f;
+        for (int i = 0; i < ANALOG_SCALING_BINS; i++) {
+                ac->scalingMap.rawValues[i] = i + 0.5f;
+                ac->scalingMap.scaledValues[i] = i * i * 10.0f;
+        }
+
+        for (int mode = SCALING_MODE_RAW; mode <= SCALING_MODE_MAP; mode++) {
+                ac->scalingMode = mode;
+                ADC_init(lc);
+
+                for (int raw = 0; raw < 4096; raw += 7) {
+                        ADC_mock_set_value(channel, raw);
+                        ADC_sample_all();
+
+                        const float volts = ADC_read(channel);
+                        float expected = volts;
+                        if (SCALING_MODE_LINEAR == mode)
+                                expected = ac->linearScaling * volts +
+                                        ac->linearOffset;
+                        if (SCALING_MODE_MAP == mode)
+                                expected = get_mapped_value(volts,
+                                                            &ac->scalingMap);
+
+                        CPPUNIT_ASSERT_DOUBLES_EQUAL(
+                                expected, ADC_read_scaled(channel), 0.0001);
+                }
+        }
+}
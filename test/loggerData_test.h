@@ -28,6 +28,7 @@ class LoggerDataTest : public CppUnit::TestFixture
 {
         CPPUNIT_TEST_SUITE( LoggerDataTest );
         CPPUNIT_TEST( testMappedValue );
+        CPPUNIT_TEST( testCompiledScaling );
         CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -38,6 +39,7 @@ public:
         void testGpsChannels();
         void testImuChannels();
         void testMappedValue();
+        void testCompiledScaling();
 };
 
 #endif /* LOGGERDATA_TEST_H_ */
@@ -22,9 +22,13 @@
 #include "FreeRTOS.h"
 #include "fileWriter.h"
 #include "fileWriter_testing.h"
+#include "ff_testing.h"
+#include "logger.h"
+#include "loggerConfig.h"
 #include <string.h>
 #include "task.h"
 #include "task_testing.h"
+#include "taskUtil.h"
 
 #include <stdio.h>
 #include <string>
@@ -35,15 +39,42 @@ CPPUNIT_TEST_SUITE_REGISTRATION( LoggerFileWriterTest );
 struct logging_status _ls;
 struct logging_status *ls;
 
+static ChannelSample no_channels[1];
+static struct sample empty_sample;
+
 void LoggerFileWriterTest::setUp()
 {
         _ls = (struct logging_status) {
                 0
         };
         ls = &_ls;
+
+        initialize_logger_config();
+        getWorkingLoggerConfig()->logging_cfg.file_format =
+                LOG_FILE_FORMAT_CSV;
+        empty_sample.channel_count = 0;
+        empty_sample.channel_samples = no_channels;
+
+        reset_ticks();
+        ff_testing_reset();
+        CPPUNIT_ASSERT(file_writer_init());
 }
 
-void LoggerFileWriterTest::tearDown() {}
+void LoggerFileWriterTest::tearDown()
+{
+        ff_testing_reset();
+        initialize_logger_config();
+}
+
+/* Stages one row of the empty sample, plus the header for the first */
+static void stage_row(void)
+{
+        LoggerMessage msg = create_logger_message(
+                LoggerMessageType_Sample, xTaskGetTickCount(),
+                &empty_sample, false);
+
+        CPPUNIT_ASSERT_EQUAL(0, logging_sample(ls, &msg));
+}
 
 void LoggerFileWriterTest::testFlushLogfile()
 {
@@ -97,3 +128,79 @@ void LoggerFileWriterTest::testLoggingSampleSkip()
 /*
  * TODO: Build in tests for file open and close methods.
  */
+
+void LoggerFileWriterTest::testCommitOnSize()
+{
+        getWorkingLoggerConfig()->logging_cfg.file_commit_size =
+                LOG_FILE_SECTOR_SIZE;
+        logging_start(ls);
+
+        /*
+         * Each row of the empty sample is just its newline, and the
+         * header of the first row is one too.
+         */
+        for (size_t i = 0; i < LOG_FILE_SECTOR_SIZE - 2; ++i)
+                stage_row();
+        CPPUNIT_ASSERT_EQUAL(0u, ff_testing_get_writes());
+
+        stage_row();
+        CPPUNIT_ASSERT_EQUAL(1u, ff_testing_get_writes());
+        CPPUNIT_ASSERT_EQUAL((unsigned int) LOG_FILE_SECTOR_SIZE,
+                             ff_testing_get_bytes_written());
+}
+
+void LoggerFileWriterTest::testCommitOnInterval()
+{
+        const uint16_t interval_ms = 100;
+        getWorkingLoggerConfig()->logging_cfg.file_commit_interval_ms =
+                interval_ms;
+        logging_start(ls);
+        stage_row();
+
+        set_ticks(msToTicks(interval_ms) - 1);
+        CPPUNIT_ASSERT_EQUAL(0, commit_logfile(ls));
+        CPPUNIT_ASSERT_EQUAL(0u, ff_testing_get_writes());
+
+        set_ticks(msToTicks(interval_ms));
+        CPPUNIT_ASSERT_EQUAL(0, commit_logfile(ls));
+        CPPUNIT_ASSERT_EQUAL(1u, ff_testing_get_writes());
+        CPPUNIT_ASSERT_EQUAL(2u, ff_testing_get_bytes_written());
+
+        /* Nothing staged, nothing to commit */
+        set_ticks(3 * msToTicks(interval_ms));
+        CPPUNIT_ASSERT_EQUAL(0, commit_logfile(ls));
+        CPPUNIT_ASSERT_EQUAL(1u, ff_testing_get_writes());
+}
+
+void LoggerFileWriterTest::testCommitOnStop()
+{
+        logging_start(ls);
+        stage_row();
+        stage_row();
+
+        CPPUNIT_ASSERT_EQUAL(0, logging_stop(ls));
+        CPPUNIT_ASSERT_EQUAL(1u, ff_testing_get_writes());
+        CPPUNIT_ASSERT_EQUAL(3u, ff_testing_get_bytes_written());
+
+        update_logger_status(ls);
+        CPPUNIT_ASSERT_EQUAL(LOGGING_STATUS_IDLE, logging_get_status());
+}
+
+void LoggerFileWriterTest::testCommitOnStopFails()
+{
+        logging_start(ls);
+        stage_row();
+
+        ff_testing_set_write_result(FR_DISK_ERR);
+        CPPUNIT_ASSERT(0 != logging_stop(ls));
+        CPPUNIT_ASSERT_EQUAL(0u, ff_testing_get_bytes_written());
+
+        update_logger_status(ls);
+        CPPUNIT_ASSERT_EQUAL(LOGGING_STATUS_ERROR_WRITING,
+                             logging_get_status());
+
+        /* Cleared when the next log starts */
+        logging_start(ls);
+        update_logger_status(ls);
+        CPPUNIT_ASSERT_EQUAL(LOGGING_STATUS_IDLE, logging_get_status());
+}
@@ -30,6 +30,10 @@ class LoggerFileWriterTest : public CppUnit::TestFixture
         CPPUNIT_TEST( testLoggingStart );
         CPPUNIT_TEST( testLoggingStop );
         CPPUNIT_TEST( testLoggingSampleSkip );
+        CPPUNIT_TEST( testCommitOnSize );
+        CPPUNIT_TEST( testCommitOnInterval );
+        CPPUNIT_TEST( testCommitOnStop );
+        CPPUNIT_TEST( testCommitOnStopFails );
         CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -41,6 +45,10 @@ public:
         void testLoggingStart();
         void testLoggingStop();
         void testLoggingSampleSkip();
+        void testCommitOnSize();
+        void testCommitOnInterval();
+        void testCommitOnStop();
+        void testCommitOnStopFails();
 };
 
 #endif /* _LOGGERFILEWRITER_TEST_H_ */
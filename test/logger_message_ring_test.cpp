@@ -0,0 +1,223 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "logger_message_ring.h"
+#include "logger_message_ring_test.h"
+#include "macros.h"
+#include "sampleRecord.h"
+
+#include <string.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( LoggerMessageRingTest );
+
+#define FILE_WRITER	SAMPLE_CONSUMER_FILE_WRITER
+#define TELEMETRY	SAMPLE_CONSUMER_TELEMETRY
+
+static struct sample sample;
+
+void LoggerMessageRingTest::setUp()
+{
+        memset(&sample, 0, sizeof(sample));
+        sample.ticks = 42;
+
+        /* Subscribing again drops anything left by the previous test */
+        logger_message_subscribe(FILE_WRITER);
+        logger_message_subscribe(TELEMETRY);
+}
+
+void LoggerMessageRingTest::tearDown() {}
+
+void LoggerMessageRingTest::test_publish_to_all()
+{
+        const LoggerMessage msg = create_logger_message(
+                LoggerMessageType_Sample, 42, &sample, false);
+        LoggerMessage rx;
+
+        publish_logger_message(&msg, SAMPLE_CONSUMER_MASK(FILE_WRITER) |
+                               SAMPLE_CONSUMER_MASK(TELEMETRY));
+        CPPUNIT_ASSERT_EQUAL(true, sample_is_referenced(&sample));
+
+        CPPUNIT_ASSERT_EQUAL((portBASE_TYPE) pdTRUE,
+                             receive_logger_message(FILE_WRITER, &rx, 0));
+        CPPUNIT_ASSERT_EQUAL(&sample, rx.sample);
+        CPPUNIT_ASSERT_EQUAL((size_t) 42, rx.ticks);
+        release_logger_message(&rx, FILE_WRITER);
+        CPPUNIT_ASSERT_EQUAL(true, sample_is_referenced(&sample));
+
+        CPPUNIT_ASSERT_EQUAL((portBASE_TYPE) pdTRUE,
+                             receive_logger_message(TELEMETRY, &rx, 0));
+        CPPUNIT_ASSERT_EQUAL(&sample, rx.sample);
+        release_logger_message(&rx, TELEMETRY);
+        CPPUNIT_ASSERT_EQUAL(false, sample_is_referenced(&sample));
+
+        /* Each reader has its own cursor */
+        CPPUNIT_ASSERT_EQUAL((portBASE_TYPE) pdFALSE,
+                             receive_logger_message(FILE_WRITER, &rx, 0));
+        CPPUNIT_ASSERT_EQUAL((portBASE_TYPE) pdFALSE,
+                             receive_logger_message(TELEMETRY, &rx, 0));
+}
+
+void LoggerMessageRingTest::test_addressed_consumers_only()
+{
+        const LoggerMessage start = create_logger_message(
+                LoggerMessageType_Start, 0, NULL, false);
+        const LoggerMessage msg = create_logger_message(
+                LoggerMessageType_Sample, 42, &sample, false);
+        LoggerMessage rx;
+
+        publish_logger_message(&msg, SAMPLE_CONSUMER_MASK(TELEMETRY));
+        publish_logger_message(&start, SAMPLE_CONSUMER_MASK(FILE_WRITER));
+
+        /* Only the telemetry consumer holds the sample */
+        CPPUNIT_ASSERT_EQUAL((uint16_t) SAMPLE_CONSUMER_MASK(TELEMETRY),
+                             (uint16_t) sample.refs);
+
+        CPPUNIT_ASSERT_EQUAL((portBASE_TYPE) pdTRUE,
+                             receive_logger_message(FILE_WRITER, &rx, 0));
+        CPPUNIT_ASSERT_EQUAL(LoggerMessageType_Start, rx.type);
+        CPPUNIT_ASSERT_EQUAL((portBASE_TYPE) pdFALSE,
+                             receive_logger_message(FILE_WRITER, &rx, 0));
+
+        CPPUNIT_ASSERT_EQUAL((portBASE_TYPE) pdTRUE,
+                             receive_logger_message(TELEMETRY, &rx, 0));
+        CPPUNIT_ASSERT_EQUAL(LoggerMessageType_Sample, rx.type);
+        CPPUNIT_ASSERT_EQUAL((portBASE_TYPE) pdFALSE,
+                             receive_logger_message(TELEMETRY, &rx, 0));
+
+        /* Unsubscribed consumers are never addressed */
+        publish_logger_message(&msg, SAMPLE_CONSUMER_MASK(SAMPLE_CONSUMER_USB));
+        CPPUNIT_ASSERT_EQUAL((uint16_t) SAMPLE_CONSUMER_MASK(TELEMETRY),
+                             (uint16_t) sample.refs);
+}
+
+void LoggerMessageRingTest::test_reclaimed_sample_skipped()
+{
+        const LoggerMessage msg = create_logger_message(
+                LoggerMessageType_Sample, 42, &sample, false);
+        LoggerMessage rx;
+
+        publish_logger_message(&msg, SAMPLE_CONSUMER_MASK(FILE_WRITER));
+        sample_reclaim(&sample);
+        sample.ticks = 43;
+
+        CPPUNIT_ASSERT_EQUAL((portBASE_TYPE) pdFALSE,
+                             receive_logger_message(FILE_WRITER, &rx, 0));
+}
+
+static struct sample lap_samples[LOGGER_MESSAGE_RING_SIZE + 5];
+
+/* Publishes one sample per slot of lap_samples to the file writer */
+static void publish_lap_samples(void)
+{
+        for (size_t i = 0; i < ARRAY_LEN(lap_samples); ++i) {
+                struct sample *s = lap_samples + i;
+
+                memset(s, 0, sizeof(*s));
+                s->ticks = i;
+                const LoggerMessage msg = create_logger_message(
+                        LoggerMessageType_Sample, i, s, false);
+                publish_logger_message(&msg,
+                                       SAMPLE_CONSUMER_MASK(FILE_WRITER));
+        }
+}
+
+void LoggerMessageRingTest::test_lapped_reader()
+{
+        const size_t count = ARRAY_LEN(lap_samples);
+        const uint32_t overruns = sample_get_overruns(FILE_WRITER);
+        LoggerMessage rx;
+
+        publish_lap_samples();
+
+        /* The lapped samples were counted and given back */
+        const size_t lapped = count - LOGGER_MESSAGE_RING_SIZE;
+        CPPUNIT_ASSERT_EQUAL((uint32_t) (overruns + lapped),
+                             sample_get_overruns(FILE_WRITER));
+        for (size_t i = 0; i < lapped; ++i)
+                CPPUNIT_ASSERT_EQUAL(false,
+                                     sample_is_referenced(lap_samples + i));
+
+        /* The reader resumes at the oldest message still in the ring */
+        size_t expected = lapped;
+        while (receive_logger_message(FILE_WRITER, &rx, 0)) {
+                CPPUNIT_ASSERT_EQUAL(expected++, rx.ticks);
+                release_logger_message(&rx, FILE_WRITER);
+        }
+
+        CPPUNIT_ASSERT_EQUAL(count, expected);
+}
+
+void LoggerMessageRingTest::test_lapped_reader_keeps_stop()
+{
+        const LoggerMessage stop = create_logger_message(
+                LoggerMessageType_Stop, 0, NULL, false);
+        const LoggerMessage start = create_logger_message(
+                LoggerMessageType_Start, 0, NULL, false);
+        LoggerMessage rx;
+
+        publish_logger_message(&stop, SAMPLE_CONSUMER_MASK(FILE_WRITER));
+        publish_lap_samples();
+        publish_logger_message(&start, SAMPLE_CONSUMER_MASK(FILE_WRITER));
+
+        /* The Stop comes first even though its place in the ring is gone */
+        CPPUNIT_ASSERT_EQUAL((portBASE_TYPE) pdTRUE,
+                             receive_logger_message(FILE_WRITER, &rx, 0));
+        CPPUNIT_ASSERT_EQUAL(LoggerMessageType_Stop, rx.type);
+
+        size_t samples = 0;
+        while (receive_logger_message(FILE_WRITER, &rx, 0) &&
+               LoggerMessageType_Sample == rx.type) {
+                release_logger_message(&rx, FILE_WRITER);
+                ++samples;
+        }
+
+        /* And the Start after every sample published before it */
+        CPPUNIT_ASSERT_EQUAL((size_t) LOGGER_MESSAGE_RING_SIZE, samples);
+        CPPUNIT_ASSERT_EQUAL(LoggerMessageType_Start, rx.type);
+        CPPUNIT_ASSERT_EQUAL((portBASE_TYPE) pdFALSE,
+                             receive_logger_message(FILE_WRITER, &rx, 0));
+}
+
+void LoggerMessageRingTest::test_control_queue_full()
+{
+        const LoggerMessage start = create_logger_message(
+                LoggerMessageType_Start, 0, NULL, false);
+        const LoggerMessage stop = create_logger_message(
+                LoggerMessageType_Stop, 0, NULL, false);
+        const uint32_t overruns = sample_get_overruns(FILE_WRITER);
+        LoggerMessage rx;
+
+        for (size_t i = 0; i <= LOGGER_MESSAGE_CONTROL_SLOTS; ++i)
+                publish_logger_message(i % 2 ? &stop : &start,
+                                       SAMPLE_CONSUMER_MASK(FILE_WRITER));
+        CPPUNIT_ASSERT_EQUAL(overruns + 1, sample_get_overruns(FILE_WRITER));
+
+        /* Still alternating, and ending on the last message published */
+        enum LoggerMessageType expected = LoggerMessageType_Start;
+        size_t count = 0;
+        while (receive_logger_message(FILE_WRITER, &rx, 0)) {
+                CPPUNIT_ASSERT_EQUAL(expected, rx.type);
+                expected = LoggerMessageType_Start == expected ?
+                        LoggerMessageType_Stop : LoggerMessageType_Start;
+                ++count;
+        }
+        CPPUNIT_ASSERT_EQUAL((size_t) LOGGER_MESSAGE_CONTROL_SLOTS - 1, count);
+}
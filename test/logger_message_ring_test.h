@@ -0,0 +1,50 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _LOGGER_MESSAGE_RING_TEST_H_
+#define _LOGGER_MESSAGE_RING_TEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class LoggerMessageRingTest : public CppUnit::TestFixture
+{
+        CPPUNIT_TEST_SUITE( LoggerMessageRingTest );
+        CPPUNIT_TEST( test_publish_to_all );
+        CPPUNIT_TEST( test_addressed_consumers_only );
+        CPPUNIT_TEST( test_reclaimed_sample_skipped );
+        CPPUNIT_TEST( test_lapped_reader );
+        CPPUNIT_TEST( test_lapped_reader_keeps_stop );
+        CPPUNIT_TEST( test_control_queue_full );
+        CPPUNIT_TEST_SUITE_END();
+
+public:
+        void setUp();
+        void tearDown();
+
+        void test_publish_to_all();
+        void test_addressed_consumers_only();
+        void test_reclaimed_sample_skipped();
+        void test_lapped_reader();
+        void test_lapped_reader_keeps_stop();
+        void test_control_queue_full();
+};
+
+#endif /* _LOGGER_MESSAGE_RING_TEST_H_ */
@@ -27,6 +27,8 @@
 #define SCALING_5V 	       		0.00122070312f
 #define SCALING_20V    			0.0048828125f
 
+#define ADC_MOCK_SCAN_RATE_HZ		4000
+
 static unsigned int g_adc[CONFIG_ADC_CHANNELS];
 
 int ADC_device_init(void)
@@ -44,6 +46,17 @@ int ADC_device_sample(const size_t channel)
         return channel_in_bounds(channel) ? g_adc[channel] : -1;
 }
 
+size_t ADC_device_sample_all(int32_t *values, const size_t count)
+{
+        const size_t n = count < CONFIG_ADC_CHANNELS ?
+                count : CONFIG_ADC_CHANNELS;
+
+        for (size_t i = 0; i < n; ++i)
+                values[i] = g_adc[i];
+
+        return n;
+}
+
 void ADC_mock_set_value(const size_t channel, const unsigned int value)
 {
         if (!channel_in_bounds(channel))
@@ -75,3 +88,8 @@ float ADC_device_get_channel_scaling(const size_t channel)
         }
         return scaling;
 }
+
+uint32_t ADC_device_get_scan_rate(void)
+{
+        return ADC_MOCK_SCAN_RATE_HZ;
+}
@@ -21,10 +21,32 @@
 
 
 #include "CAN_device.h"
+#include "CAN_device_mock.h"
+#include "CAN_filter.h"
+#include "capabilities.h"
 #include <stdbool.h>
 
+static struct {
+        bool enabled;
+        uint32_t filter;
+        uint32_t mask;
+} filters[CAN_CHANNELS][CAN_FILTER_BANKS];
+
+bool CAN_device_mock_get_filter(const uint8_t channel, const uint8_t id,
+                                uint32_t *filter, uint32_t *mask)
+{
+        *filter = filters[channel][id].filter;
+        *mask = filters[channel][id].mask;
+        return filters[channel][id].enabled;
+}
+
 int CAN_device_init(const uint8_t channel, const uint32_t baud, const bool termination_enabled)
 {
+        /* Like the hardware, bank 0 accepts all and the rest are off */
+        CAN_device_set_filter(channel, 0, 1, 0, 0, true);
+        for (size_t i = 1; i < CAN_FILTER_BANKS; i++)
+                CAN_device_set_filter(channel, i, 0, 0, 0, false);
+
         return 1;
 }
 
@@ -33,13 +55,27 @@ int CAN_device_tx_msg(const uint8_t channel, const CAN_msg *msg, unsigned int ti
         return 1;
 }
 
-int CAN_device_rx_msg(CAN_msg *msg, const unsigned int timeoutMs)
+size_t CAN_device_rx_msgs(CAN_msg *msgs, const size_t count,
+                         const unsigned int timeoutMs)
 {
-        return 1;
+        return 0;
 }
 
 int CAN_device_set_filter(const uint8_t channel, const uint8_t id, const uint8_t extended,
                           const uint32_t filter, const uint32_t mask, const bool enabled)
 {
+        if (channel >= CAN_CHANNELS || id >= CAN_FILTER_BANKS)
+                return 0;
+
+        filters[channel][id].enabled = enabled;
+        filters[channel][id].filter = filter;
+        filters[channel][id].mask = mask;
         return 1;
 }
+
+int CAN_device_set_filter_list(const uint8_t channel, const uint8_t id, const uint8_t extended,
+                               const uint32_t *ids, const size_t count)
+{
+        return CAN_device_set_filter(channel, id, extended, ids[0],
+                                     UINT32_MAX, true);
+}
@@ -0,0 +1,40 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CAN_DEVICE_MOCK_H_
+#define CAN_DEVICE_MOCK_H_
+
+#include "cpp_guard.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+CPP_GUARD_BEGIN
+
+/**
+ * Gets what was last programmed into a filter bank.
+ * @return true if the bank is enabled.
+ */
+bool CAN_device_mock_get_filter(uint8_t channel, uint8_t id,
+                                uint32_t *filter, uint32_t *mask);
+
+CPP_GUARD_END
+
+#endif /* CAN_DEVICE_MOCK_H_ */
@@ -20,7 +20,9 @@
  */
 
 
+#include "FreeRTOS.h"
 #include "cpu_device.h"
+#include "task.h"
 
 int cpu_device_init(void)
 {
@@ -38,3 +40,8 @@ const char * cpu_device_get_serialnumber(void)
 }
 
 void cpu_device_spin(uint32_t ms) {}
+
+uint32_t cpu_device_get_usec(void)
+{
+        return xTaskGetTickCount() * (1000000 / configTICK_RATE_HZ);
+}
@@ -22,19 +22,36 @@
 
 #include "imu_device.h"
 #include "imu_mock.h"
+#include "imu_sample_ring.h"
 #include "loggerConfig.h"
 
 #define ACCEL_DEVICE_COUNTS_PER_G 				819
 #define YAW_DEVICE_COUNTS_PER_DEGREE_PER_SEC	4.69
 
+#define IMU_MOCK_SAMPLE_RATE_HZ	50
+
 static unsigned int g_imuDevice[CONFIG_IMU_CHANNELS] = {0,0,0,0,0,0};
+static struct imu_sample_ring g_samples;
 
 void imu_mock_set_value(unsigned int channel, unsigned int value)
 {
         g_imuDevice[channel] = value;
 }
 
-void imu_device_init() { }
+void imu_mock_push_sample()
+{
+        struct imu_sample sample;
+
+        for (size_t i = 0; i < IMU_DEVICE_AXES; i++)
+                sample.axis[i] = g_imuDevice[i];
+
+        imu_sample_ring_push(&g_samples, &sample);
+}
+
+void imu_device_init()
+{
+        imu_sample_ring_reset(&g_samples);
+}
 
 int imu_device_read(unsigned int channel)
 {
@@ -50,3 +67,13 @@ enum imu_init_status imu_device_init_status()
 {
         return IMU_INIT_STATUS_SUCCESS;
 }
+
+size_t imu_device_read_samples(struct imu_sample *samples, size_t max)
+{
+        return imu_sample_ring_read(&g_samples, samples, max);
+}
+
+float imu_device_sample_rate()
+{
+        return IMU_MOCK_SAMPLE_RATE_HZ;
+}
@@ -28,6 +28,9 @@ CPP_GUARD_BEGIN
 
 void imu_mock_set_value(unsigned int channel, unsigned int value);
 
+/* Produces a reading of the values set, as the device task would */
+void imu_mock_push_sample();
+
 CPP_GUARD_END
 
 #endif /* ACCELEROMETER_MOCK_H_ */
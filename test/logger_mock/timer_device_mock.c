@@ -20,17 +20,34 @@
  */
 
 #include "capabilities.h"
+#include "timer_capture.h"
 #include "timer_config.h"
 #include "timer_device.h"
+#include "timer_mock.h"
 
 #include <stdbool.h>
 
 static int g_timer[TIMER_CHANNELS];
+static uint32_t g_usec[TIMER_CHANNELS];
+static struct timer_capture_ring g_captures[TIMER_CHANNELS];
+
+void timer_mock_capture(size_t channel, uint32_t usec)
+{
+        g_usec[channel] = usec;
+        timer_capture_push(g_captures + channel, usec);
+}
+
+void timer_mock_stall(size_t channel)
+{
+        g_usec[channel] = 0;
+}
 
 bool timer_device_init(const size_t channel, const uint32_t speed,
                        const uint32_t quiet_period_us,
                        const enum timer_edge edge)
 {
+        g_usec[channel] = 0;
+        timer_capture_reset(g_captures + channel);
         return true;
 }
 
@@ -55,5 +72,10 @@ void timer_device_get_all_periods(unsigned int *t0, unsigned int *t1, unsigned i
 
 uint32_t timer_device_get_usec(size_t channel)
 {
-        return 0;
+        return g_usec[channel];
+}
+
+bool timer_device_get_capture_average(size_t channel, uint32_t *avg_us)
+{
+        return timer_capture_average(g_captures + channel, avg_us);
 }
@@ -0,0 +1,40 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TIMER_MOCK_H_
+#define TIMER_MOCK_H_
+
+#include "cpp_guard.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+CPP_GUARD_BEGIN
+
+/* Captures a period as the timer ISR would */
+void timer_mock_capture(size_t channel, uint32_t usec);
+
+/* Drops the period as a timer overflow on a stalled input would */
+void timer_mock_stall(size_t channel);
+
+CPP_GUARD_END
+
+#endif /* TIMER_MOCK_H_ */
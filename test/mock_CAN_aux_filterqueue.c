@@ -30,6 +30,11 @@ void CAN_aux_filterqueue_configure(uint8_t new_can_bus, uint32_t new_low_id_rang
 {
 }
 
+bool CAN_aux_filterqueue_get_range(uint8_t *can_bus, uint32_t *low_id_range, uint32_t *high_id_range)
+{
+        return false;
+}
+
 bool CAN_aux_filterqueue_put_msg(CAN_msg * can_msg)
 {
         return false;
@@ -38,6 +38,8 @@
 #include "sampleRecord.h"
 #include "task.h"
 #include "task_testing.h"
+#include "timer.h"
+#include "timer_mock.h"
 
 #include <string>
 #include <stdio.h>
@@ -48,6 +50,7 @@ using std::string;
 CPPUNIT_TEST_SUITE_REGISTRATION( SampleRecordTest );
 
 LoggerConfig *lc;
+struct sample_channels sc;
 struct sample s;
 
 void SampleRecordTest::setUp()
@@ -61,7 +64,8 @@ void SampleRecordTest::setUp()
         lc = getWorkingLoggerConfig();
         lapstats_reset(false);
         size_t channelCount = get_enabled_channel_count(lc);
-        init_sample_buffer(&s, channelCount);
+        init_sample_channels(&sc, channelCount);
+        init_sample_buffer(&s, &sc);
 
 }
 
@@ -69,6 +73,7 @@ void SampleRecordTest::setUp()
 void SampleRecordTest::tearDown()
 {
         free_sample_buffer(&s);
+        free_sample_channels(&sc);
 }
 
 
@@ -86,110 +91,110 @@ void SampleRecordTest::testPopulateSampleRecord()
 
         populate_sample_buffer(&s, 0);
 
-        const ChannelSample *samples = s.channel_samples;
+        size_t i = 0;
 
         // Interval Channel
         CPPUNIT_ASSERT_EQUAL((int) (xTaskGetTickCount() * MS_PER_TICK),
-                             samples->valueInt);
+                             sample_get_int(&s, i));
 
         // UTC Channel.  Just test that its 0 for now
-        samples++;
+        i++;
         CPPUNIT_ASSERT_EQUAL(0ll, (long long) getMillisSinceEpoch());
-        CPPUNIT_ASSERT_EQUAL(0ll, samples->valueLongLong);
+        CPPUNIT_ASSERT_EQUAL(0ll, sample_get_longlong(&s, i));
 
         //ElapsedTime
-        samples++;
+        i++;
         //5 milliseconds in minutes. We incremented 1 tick earlier;
         //test is configured for 5ms / tick
-        CPPUNIT_ASSERT_EQUAL((float) (5/60000.0), samples->valueFloat);
+        CPPUNIT_ASSERT_EQUAL((float) (5/60000.0), sample_get_float(&s, i));
 
         //analog channel
-        samples++;
-        CPPUNIT_ASSERT_EQUAL(123 * 0.0048828125f, samples->valueFloat);
+        i++;
+        CPPUNIT_ASSERT_EQUAL(123 * 0.0048828125f, sample_get_float(&s, i));
 
         //accelerometer channels
-        samples++;
+        i++;
         CPPUNIT_ASSERT_EQUAL(imu_read_value(IMU_CHANNEL_X, &lc->ImuConfigs[0]),
-                             samples->valueFloat);
+                             sample_get_float(&s, i));
 
-        samples++;
+        i++;
         CPPUNIT_ASSERT_EQUAL(imu_read_value(IMU_CHANNEL_Y, &lc->ImuConfigs[1]),
-                             samples->valueFloat);
+                             sample_get_float(&s, i));
 
-        samples++;
+        i++;
         CPPUNIT_ASSERT_EQUAL(imu_read_value(IMU_CHANNEL_Z, &lc->ImuConfigs[2]),
-                             samples->valueFloat);
+                             sample_get_float(&s, i));
 
-        samples++;
+        i++;
         CPPUNIT_ASSERT_EQUAL(imu_read_value(IMU_CHANNEL_YAW, &lc->ImuConfigs[3]),
-                             samples->valueFloat);
+                             sample_get_float(&s, i));
 
-        samples++;
+        i++;
         CPPUNIT_ASSERT_EQUAL(imu_read_value(IMU_CHANNEL_PITCH, &lc->ImuConfigs[4]),
-                             samples->valueFloat);
+                             sample_get_float(&s, i));
 
-        samples++;
+        i++;
         CPPUNIT_ASSERT_EQUAL(imu_read_value(IMU_CHANNEL_ROLL, &lc->ImuConfigs[5]),
-                             samples->valueFloat);
+                             sample_get_float(&s, i));
 
-        samples++;
-        CPPUNIT_ASSERT_EQUAL( 1.0f, samples->valueFloat); //IMU Gsum channel
+        i++;
+        CPPUNIT_ASSERT_EQUAL( 1.0f, sample_get_float(&s, i)); //IMU Gsum channel
 
-        samples++;
-        CPPUNIT_ASSERT_EQUAL( 1.0f, samples->valueFloat); //IMU Gsum_max channel
+        i++;
+        CPPUNIT_ASSERT_EQUAL( 1.0f, sample_get_float(&s, i)); //IMU Gsum_max channel
 
-        samples++;
-        CPPUNIT_ASSERT_EQUAL( 100.0f, samples->valueFloat); //IMU Gsum_pct channel
+        i++;
+        CPPUNIT_ASSERT_EQUAL( 100.0f, sample_get_float(&s, i)); //IMU Gsum_pct channel
 
         //GPS / Track channels
         /*
-         * !!! BE WARNED!!!  It seems some of these samples should be valueInts instead of
-         * valueFloat.  If you are going to change it to a non-zero value, you will
+         * !!! BE WARNED!!!  It seems some of these samples should be sample_get_int instead of
+         * sample_get_float.  If you are going to change it to a non-zero value, you will
          * need to double check this.  GDB was the quickest way I found to debug this.
          * Else you will enter a world of pain as I did trying to figure out why you
          * get NaN or something else weird that you didn't expect.
          */
-        samples++;
-        CPPUNIT_ASSERT_EQUAL((float) 0, samples->valueFloat); //Latitude
+        i++;
+        CPPUNIT_ASSERT_EQUAL((float) 0, sample_get_float(&s, i)); //Latitude
 
-        samples++;
-        CPPUNIT_ASSERT_EQUAL((float) 0, samples->valueFloat); //Longtiude
+        i++;
+        CPPUNIT_ASSERT_EQUAL((float) 0, sample_get_float(&s, i)); //Longtiude
 
-        samples++;
-        CPPUNIT_ASSERT_EQUAL((float) 0, samples->valueFloat); //Speed
+        i++;
+        CPPUNIT_ASSERT_EQUAL((float) 0, sample_get_float(&s, i)); //Speed
 
-        samples++;
-        CPPUNIT_ASSERT_EQUAL((float) 0, samples->valueFloat); //Altitude
+        i++;
+        CPPUNIT_ASSERT_EQUAL((float) 0, sample_get_float(&s, i)); //Altitude
 
-        samples++;
-        CPPUNIT_ASSERT_EQUAL((float) 0, samples->valueFloat); //GPSSats
+        i++;
+        CPPUNIT_ASSERT_EQUAL((float) 0, sample_get_float(&s, i)); //GPSSats
 
-        samples++;
-        CPPUNIT_ASSERT_EQUAL((float) 0, samples->valueFloat); //GPSQual
+        i++;
+        CPPUNIT_ASSERT_EQUAL((float) 0, sample_get_float(&s, i)); //GPSQual
 
-        samples++;
-        CPPUNIT_ASSERT_EQUAL((float) 0, samples->valueFloat); //GPSDOP
+        i++;
+        CPPUNIT_ASSERT_EQUAL((float) 0, sample_get_float(&s, i)); //GPSDOP
 
-        samples++;
-        CPPUNIT_ASSERT_EQUAL((float) 0, samples->valueFloat); //lapCount
+        i++;
+        CPPUNIT_ASSERT_EQUAL((float) 0, sample_get_float(&s, i)); //lapCount
 
-        samples++;
-        CPPUNIT_ASSERT_EQUAL((float) 0, samples->valueFloat); //lapTime
+        i++;
+        CPPUNIT_ASSERT_EQUAL((float) 0, sample_get_float(&s, i)); //lapTime
 
-        samples++;
-        CPPUNIT_ASSERT_EQUAL((int) -1, samples->valueInt); //sectorCfg
+        i++;
+        CPPUNIT_ASSERT_EQUAL((int) -1, sample_get_int(&s, i)); //sectorCfg
 
-        samples++;
-        CPPUNIT_ASSERT_EQUAL((float) 0, samples->valueFloat); //SectorTime
+        i++;
+        CPPUNIT_ASSERT_EQUAL((float) 0, sample_get_float(&s, i)); //SectorTime
 
-        samples++;
-        CPPUNIT_ASSERT_EQUAL((float) 0, samples->valueFloat); //PredTime
+        i++;
+        CPPUNIT_ASSERT_EQUAL((float) 0, sample_get_float(&s, i)); //PredTime
 
-        samples++;
-        CPPUNIT_ASSERT_EQUAL((int) 0, samples->valueInt); //CurrentLap
+        i++;
+        CPPUNIT_ASSERT_EQUAL((int) 0, sample_get_int(&s, i)); //CurrentLap
 
-        samples++;
-        CPPUNIT_ASSERT_EQUAL((float) 0, samples->valueFloat); //Distance
+        i++;
+        CPPUNIT_ASSERT_EQUAL((float) 0, sample_get_float(&s, i)); //Distance
 }
 
 void SampleRecordTest::testInitSampleRecord()
@@ -487,12 +492,104 @@ void SampleRecordTest::testLoggerMessageAlwaysHasTime()
                         continue;
 
                 ++var;
-                CPPUNIT_ASSERT_EQUAL(true, s.channel_samples->populated);
+                CPPUNIT_ASSERT_EQUAL(true, sample_is_populated(&s, 0));
         }
 
         CPPUNIT_ASSERT_EQUAL(true, tick < 1000);
 }
 
+void SampleRecordTest::testPopulateSampleSchedule()
+{
+        /*
+         * Check the rate groups against a brute force scan of every
+         * channel on every tick.
+         */
+        for (size_t tick = 0; tick <= TICK_RATE_HZ; ++tick) {
+                int expected = SAMPLE_DISABLED;
+                for (size_t i = 0; i < s.channel_count; ++i) {
+                        const int rate = s.channel_samples[i].cfg->sampleRate;
+                        if (tick % rate == 0)
+                                expected = getHigherSampleRate(rate, expected);
+                }
+
+                const int sr = populate_sample_buffer(&s, tick);
+                CPPUNIT_ASSERT_EQUAL(expected, sr);
+                if (SAMPLE_DISABLED == sr)
+                        continue;
+
+                for (size_t i = 0; i < s.channel_count; ++i) {
+                        const ChannelSample *cs = s.channel_samples + i;
+                        const bool populated =
+                                tick % cs->cfg->sampleRate == 0 ||
+                                (cs->cfg->flags & ALWAYS_SAMPLED);
+                        CPPUNIT_ASSERT_EQUAL(populated,
+                                             sample_is_populated(&s, i));
+                }
+        }
+}
+
+void SampleRecordTest::testSampleValueLayout()
+{
+        /* Only the Utc channel is 8 bytes wide, so it is packed first */
+        CPPUNIT_ASSERT_EQUAL((size_t) (8 + 4 * (s.channel_count - 1)),
+                             sc.values_size);
+        CPPUNIT_ASSERT_EQUAL((uint16_t) 0, s.channel_samples[1].offset);
+        CPPUNIT_ASSERT_EQUAL((uint16_t) 8, s.channel_samples[0].offset);
+
+        for (size_t i = 0; i < s.channel_count; ++i)
+                CPPUNIT_ASSERT_EQUAL(false, sample_is_populated(&s, i));
+
+        sample_set_populated(&s, 0);
+        sample_set_populated(&s, s.channel_count - 1);
+        CPPUNIT_ASSERT_EQUAL(true, sample_is_populated(&s, 0));
+        CPPUNIT_ASSERT_EQUAL(false, sample_is_populated(&s, 1));
+        CPPUNIT_ASSERT_EQUAL(true,
+                             sample_is_populated(&s, s.channel_count - 1));
+
+        sample_clear_populated(&s);
+        CPPUNIT_ASSERT_EQUAL(false, sample_is_populated(&s, 0));
+        CPPUNIT_ASSERT_EQUAL(false,
+                             sample_is_populated(&s, s.channel_count - 1));
+}
+
+void SampleRecordTest::testSampleRefs()
+{
+        const uint32_t wifi_overruns =
+                sample_get_overruns(SAMPLE_CONSUMER_WIFI);
+        const uint32_t usb_overruns =
+                sample_get_overruns(SAMPLE_CONSUMER_USB);
+
+        s.ticks = 10;
+        CPPUNIT_ASSERT_EQUAL(false, sample_is_referenced(&s));
+
+        sample_ref(&s, SAMPLE_CONSUMER_WIFI);
+        sample_ref(&s, SAMPLE_CONSUMER_USB);
+        CPPUNIT_ASSERT_EQUAL(true, sample_is_referenced(&s));
+
+        sample_unref(&s, 10, SAMPLE_CONSUMER_WIFI);
+        CPPUNIT_ASSERT_EQUAL(true, sample_is_referenced(&s));
+        sample_unref(&s, 10, SAMPLE_CONSUMER_USB);
+        CPPUNIT_ASSERT_EQUAL(false, sample_is_referenced(&s));
+
+        /* Reclaiming charges every holder an overrun */
+        sample_ref(&s, SAMPLE_CONSUMER_WIFI);
+        sample_ref(&s, SAMPLE_CONSUMER_USB);
+        sample_reclaim(&s);
+        CPPUNIT_ASSERT_EQUAL(false, sample_is_referenced(&s));
+        CPPUNIT_ASSERT_EQUAL(wifi_overruns + 1,
+                             sample_get_overruns(SAMPLE_CONSUMER_WIFI));
+        CPPUNIT_ASSERT_EQUAL(usb_overruns + 1,
+                             sample_get_overruns(SAMPLE_CONSUMER_USB));
+
+        /* A late release must not drop a newer sample's reference */
+        s.ticks = 20;
+        sample_ref(&s, SAMPLE_CONSUMER_WIFI);
+        sample_unref(&s, 10, SAMPLE_CONSUMER_WIFI);
+        CPPUNIT_ASSERT_EQUAL(true, sample_is_referenced(&s));
+        sample_unref(&s, 20, SAMPLE_CONSUMER_WIFI);
+        CPPUNIT_ASSERT_EQUAL(false, sample_is_referenced(&s));
+}
+
 void SampleRecordTest::test_get_sample_value_by_name()
 {
         lc->ADCConfigs[7].scalingMode = SCALING_MODE_RAW;
@@ -520,3 +617,209 @@ void SampleRecordTest::test_get_sample_value_by_name()
         result = get_sample_value_by_name(&s, "FooBar", &value, &units);
         CPPUNIT_ASSERT_EQUAL(false, result);
 }
+
+void SampleRecordTest::test_channel_handles()
+{
+        lc->ADCConfigs[7].scalingMode = SCALING_MODE_RAW;
+        ADC_mock_set_value(7, 123);
+        ADC_sample_all();
+        populate_sample_buffer(&s, 0);
+
+        struct channel_handle h;
+        CPPUNIT_ASSERT_EQUAL(false, resolve_channel_handle(&h, &sc, "FooBar"));
+        CPPUNIT_ASSERT_EQUAL(false, is_channel_handle_valid(&h, &sc));
+
+        /* Every channel resolves to its own index */
+        for (size_t i = 0; i < sc.count; ++i) {
+                CPPUNIT_ASSERT_EQUAL(true, resolve_channel_handle(
+                                             &h, &sc, sc.samples[i].cfg->label));
+                CPPUNIT_ASSERT_EQUAL(string(sc.samples[i].cfg->label),
+                                     string(sc.samples[h.index].cfg->label));
+        }
+
+        CPPUNIT_ASSERT_EQUAL(true, resolve_channel_handle(&h, &sc, "Battery"));
+        CPPUNIT_ASSERT_EQUAL(true, is_channel_handle_valid(&h, &sc));
+
+        /* The captured value is read, not the live one */
+        ADC_mock_set_value(7, 456);
+        ADC_sample_all();
+
+        double value;
+        char *units;
+        CPPUNIT_ASSERT_EQUAL(true,
+                             get_sample_value_by_handle(&s, &h, &value, &units));
+        CPPUNIT_ASSERT_EQUAL((double) 123 * 0.0048828125f, value);
+        CPPUNIT_ASSERT_EQUAL(string("Volts"), string(units));
+
+        /* Rebuilding the table invalidates the handle */
+        free_sample_buffer(&s);
+        init_sample_channels(&sc, get_enabled_channel_count(lc));
+        init_sample_buffer(&s, &sc);
+        CPPUNIT_ASSERT_EQUAL(false, is_channel_handle_valid(&h, &sc));
+        CPPUNIT_ASSERT_EQUAL(false,
+                             get_sample_value_by_handle(&s, &h, &value, &units));
+
+        /* A cached name re-resolves a stale handle on its own */
+        populate_sample_buffer(&s, 0);
+        CPPUNIT_ASSERT_EQUAL(true, get_sample_value_by_cached_name(
+                                     &s, "Battery", &h, &value, &units));
+        CPPUNIT_ASSERT_EQUAL(true, is_channel_handle_valid(&h, &sc));
+        CPPUNIT_ASSERT_EQUAL((double) 456 * 0.0048828125f, value);
+}
+
+void SampleRecordTest::test_deadband()
+{
+        ADCConfig *ac = &lc->ADCConfigs[7];
+        ac->scalingMode = SCALING_MODE_RAW;
+        ac->cfg.deadband = 0.5;
+
+        struct channel_handle h;
+        CPPUNIT_ASSERT_EQUAL(true, resolve_channel_handle(&h, &sc, "Battery"));
+        const size_t rate = ac->cfg.sampleRate;
+        const size_t keyframe = DEADBAND_KEYFRAME_TICKS;
+
+        /* The first value is always emitted */
+        ADC_mock_set_value(7, 123);
+        ADC_sample_all();
+        populate_sample_buffer(&s, 0);
+        CPPUNIT_ASSERT_EQUAL(true, sample_is_populated(&s, h.index));
+
+        /* Small moves stay inside the deadband... */
+        ADC_mock_set_value(7, 150);
+        ADC_sample_all();
+        populate_sample_buffer(&s, rate);
+        CPPUNIT_ASSERT_EQUAL(false, sample_is_populated(&s, h.index));
+
+        /* ...and are measured from the last emitted value */
+        ADC_mock_set_value(7, 230);
+        ADC_sample_all();
+        populate_sample_buffer(&s, 2 * rate);
+        CPPUNIT_ASSERT_EQUAL(true, sample_is_populated(&s, h.index));
+        populate_sample_buffer(&s, 3 * rate);
+        CPPUNIT_ASSERT_EQUAL(false, sample_is_populated(&s, h.index));
+
+        /* Time channels ignore the deadband */
+        CPPUNIT_ASSERT_EQUAL(true, sample_is_populated(&s, 0));
+
+        /* A keyframe goes out even when nothing moved */
+        populate_sample_buffer(&s, 2 * rate + keyframe);
+        CPPUNIT_ASSERT_EQUAL(true, sample_is_populated(&s, h.index));
+        populate_sample_buffer(&s, 3 * rate + keyframe);
+        CPPUNIT_ASSERT_EQUAL(false, sample_is_populated(&s, h.index));
+
+        force_channel_keyframe(&sc);
+        populate_sample_buffer(&s, 4 * rate + keyframe);
+        CPPUNIT_ASSERT_EQUAL(true, sample_is_populated(&s, h.index));
+}
+
+void SampleRecordTest::test_channel_pipelines()
+{
+        lc->ADCConfigs[0].scalingMode = SCALING_MODE_MAP;
+        lc->ADCConfigs[1].scalingMode = SCALING_MODE_LINEAR;
+        lc->ADCConfigs[1].linearScaling = 2.5;
+        lc->ADCConfigs[1].linearOffset = -1;
+        lc->ImuConfigs[1].mode = IMU_MODE_INVERTED;
+
+        TimerConfig *tc = lc->TimerConfigs;
+        tc[0].cfg.sampleRate = encodeSampleRate(10);
+        tc[0].mode = MODE_LOGGING_TIMER_RPM;
+        tc[0].pulsePerRevolution = 2;
+        tc[0].filterAlpha = 1;
+        tc[1].cfg.sampleRate = encodeSampleRate(10);
+        tc[1].mode = MODE_LOGGING_TIMER_PERIOD_MS;
+        tc[1].pulsePerRevolution = 1;
+        tc[1].filterAlpha = 1;
+
+        ADC_init(lc);
+        imu_soft_init(lc);
+        timer_init(lc);
+        init_sample_channels(&sc, get_enabled_channel_count(lc));
+        init_sample_buffer(&s, &sc);
+
+        ADC_mock_set_value(0, 321);
+        ADC_mock_set_value(1, 654);
+        ADC_sample_all();
+        timer_mock_capture(0, 2500);
+        timer_mock_capture(1, 2500);
+        timer_sample_all();
+        populate_sample_buffer(&s, 0);
+
+        /*
+         * Fused channels must read exactly what their getter reads, and
+         * only mapped analog channels are left to the getter.
+         */
+        size_t fused = 0;
+        for (size_t i = 0; i < s.channel_count; ++i) {
+                const ChannelSample *cs = s.channel_samples + i;
+                const int ch = cs->channelIndex;
+                void *getter = (void *) cs->get_float_sample;
+                float expected;
+
+                if (getter == (void *) get_analog_sample) {
+                        expected = get_analog_sample(ch);
+                        CPPUNIT_ASSERT(cs->pipeline.raw);
+                        CPPUNIT_ASSERT_EQUAL(lc->ADCConfigs[ch].scalingMode ==
+                                             SCALING_MODE_MAP,
+                                             CHANNEL_SCALING_MAPPED ==
+                                             cs->pipeline.scaling->op);
+                } else if (getter == (void *) get_imu_sample) {
+                        expected = get_imu_sample(ch);
+                        CPPUNIT_ASSERT(cs->pipeline.raw);
+                } else if (getter == (void *) timer_get_sample) {
+                        expected = timer_get_sample(ch);
+                        CPPUNIT_ASSERT(cs->pipeline.raw);
+                } else {
+                        CPPUNIT_ASSERT(!cs->pipeline.raw);
+                        continue;
+                }
+
+                CPPUNIT_ASSERT_EQUAL(expected, sample_get_float(&s, i));
+                if (cs->pipeline.raw)
+                        ++fused;
+        }
+        CPPUNIT_ASSERT(fused > CONFIG_IMU_CHANNELS);
+
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(ADC_read(1) * 2.5 - 1,
+                                     get_analog_sample(1), 0.0001);
+        CPPUNIT_ASSERT_EQUAL(12000.0f, timer_get_sample(0));
+        CPPUNIT_ASSERT_EQUAL(2.5f, timer_get_sample(1));
+
+        ImuConfig normal = lc->ImuConfigs[1];
+        normal.mode = IMU_MODE_NORMAL;
+        CPPUNIT_ASSERT_EQUAL(-imu_read_value(IMU_CHANNEL_Y, &normal),
+                             get_imu_sample(1));
+}
+
+void SampleRecordTest::test_pipeline_follows_scaling_mode()
+{
+        ADCConfig *ac = lc->ADCConfigs;
+        ac->cfg.sampleRate = encodeSampleRate(10);
+        ac->scalingMode = SCALING_MODE_LINEAR;
+        ac->linearScaling = 1;
+        ac->linearOffset = 0;
+        for (size_t i = 0; i < ANALOG_SCALING_BINS; ++i) {
+                ac->scalingMap.rawValues[i] = i;
+                ac->scalingMap.scaledValues[i] = 100 * i;
+        }
+
+        ADC_init(lc);
+        init_sample_channels(&sc, get_enabled_channel_count(lc));
+        init_sample_buffer(&s, &sc);
+
+        /* Switched to the map without the buffer being rebuilt */
+        ac->scalingMode = SCALING_MODE_MAP;
+        ADC_init(lc);
+
+        ADC_mock_set_value(0, 321);
+        ADC_sample_all();
+        populate_sample_buffer(&s, 0);
+
+        size_t i = 0;
+        while (s.channel_samples[i].cfg != &ac->cfg)
+                ++i;
+
+        const float volts = ADC_read(0);
+        CPPUNIT_ASSERT(volts > 0 && volts < ANALOG_SCALING_BINS - 1);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(100 * volts, sample_get_float(&s, i),
+                                     0.01);
+}
@@ -31,7 +31,14 @@ class SampleRecordTest : public CppUnit::TestFixture
         CPPUNIT_TEST( testPopulateSampleRecord );
         CPPUNIT_TEST( testIsValidLoggerMessage );
         CPPUNIT_TEST( testLoggerMessageAlwaysHasTime );
+        CPPUNIT_TEST( testPopulateSampleSchedule );
+        CPPUNIT_TEST( testSampleValueLayout );
+        CPPUNIT_TEST( testSampleRefs );
         CPPUNIT_TEST( test_get_sample_value_by_name );
+        CPPUNIT_TEST( test_channel_handles );
+        CPPUNIT_TEST( test_deadband );
+        CPPUNIT_TEST( test_channel_pipelines );
+        CPPUNIT_TEST( test_pipeline_follows_scaling_mode );
         CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -42,7 +49,14 @@ public:
         void testPopulateSampleRecord();
         void testIsValidLoggerMessage();
         void testLoggerMessageAlwaysHasTime();
+        void testPopulateSampleSchedule();
+        void testSampleValueLayout();
+        void testSampleRefs();
         void test_get_sample_value_by_name();
+        void test_channel_handles();
+        void test_deadband();
+        void test_channel_pipelines();
+        void test_pipeline_follows_scaling_mode();
 
 private:
 
@@ -0,0 +1,157 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ADC.h"
+#include "ADC_mock.h"
+#include "loggerConfig.h"
+#include "loggerHardware.h"
+#include "loggerSampleData.h"
+#include "sampleRecord.h"
+#include "sample_aggregate.h"
+#include "sample_aggregate_test.h"
+
+#include <string.h>
+#include <string>
+
+using std::string;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SampleAggregateTest );
+
+#define BATTERY_CHANNEL	(CONFIG_ADC_CHANNELS - 1)
+#define ADC_VOLTS(raw)	((raw) * 0.0048828125f)
+
+void SampleAggregateTest::setUp()
+{
+        InitLoggerHardware();
+        initialize_logger_config();
+        reset_channel_aggregates();
+}
+
+void SampleAggregateTest::tearDown() {}
+
+void SampleAggregateTest::test_window()
+{
+        /* A log tick closes the window that the readings before it opened */
+        CPPUNIT_ASSERT_EQUAL((size_t) 0, sample_aggregate_window(0, 40));
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, sample_aggregate_window(1, 40));
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, sample_aggregate_window(40, 40));
+        CPPUNIT_ASSERT_EQUAL((size_t) 2, sample_aggregate_window(41, 40));
+}
+
+void SampleAggregateTest::test_reduce()
+{
+        struct sample_aggregate a;
+        float value;
+
+        memset(&a, 0, sizeof(a));
+        CPPUNIT_ASSERT_EQUAL(false,
+                             sample_aggregate_value(&a, AGGREGATION_MEAN, &value));
+
+        sample_aggregate_add(&a, 1, 2);
+        sample_aggregate_add(&a, 1, -4);
+        sample_aggregate_add(&a, 1, 8);
+
+        CPPUNIT_ASSERT(sample_aggregate_value(&a, AGGREGATION_MEAN, &value));
+        CPPUNIT_ASSERT_EQUAL(2.0f, value);
+        CPPUNIT_ASSERT(sample_aggregate_value(&a, AGGREGATION_MIN, &value));
+        CPPUNIT_ASSERT_EQUAL(-4.0f, value);
+        CPPUNIT_ASSERT(sample_aggregate_value(&a, AGGREGATION_MAX, &value));
+        CPPUNIT_ASSERT_EQUAL(8.0f, value);
+        CPPUNIT_ASSERT(sample_aggregate_value(&a, AGGREGATION_MIN_MAX, &value));
+        CPPUNIT_ASSERT_EQUAL(8.0f, value);
+        CPPUNIT_ASSERT_EQUAL(false,
+                             sample_aggregate_value(&a, AGGREGATION_LAST, &value));
+
+        /* Reading is not destructive; a new window is */
+        CPPUNIT_ASSERT(sample_aggregate_value(&a, AGGREGATION_MEAN, &value));
+        CPPUNIT_ASSERT_EQUAL(2.0f, value);
+
+        sample_aggregate_add(&a, 2, 5);
+        CPPUNIT_ASSERT(sample_aggregate_value(&a, AGGREGATION_MIN, &value));
+        CPPUNIT_ASSERT_EQUAL(5.0f, value);
+        CPPUNIT_ASSERT(sample_aggregate_value(&a, AGGREGATION_MEAN, &value));
+        CPPUNIT_ASSERT_EQUAL(5.0f, value);
+}
+
+void SampleAggregateTest::test_min_config_label()
+{
+        ChannelConfig cfg = {"ShockFL", "mm", 0, 100, SAMPLE_25Hz, 1, 0};
+        ChannelConfig min_cfg;
+
+        init_aggregate_min_config(&min_cfg, &cfg);
+        CPPUNIT_ASSERT_EQUAL(string("ShockFLMin"), string(min_cfg.label));
+        CPPUNIT_ASSERT_EQUAL(string("mm"), string(min_cfg.units));
+        CPPUNIT_ASSERT_EQUAL(SAMPLE_25Hz, (int) min_cfg.sampleRate);
+
+        /* Long labels are cut short to keep the suffix */
+        strcpy(cfg.label, "ShockFrontL");
+        init_aggregate_min_config(&min_cfg, &cfg);
+        CPPUNIT_ASSERT_EQUAL(string("ShockFroMin"), string(min_cfg.label));
+}
+
+void SampleAggregateTest::test_analog_min_max()
+{
+        LoggerConfig *lc = getWorkingLoggerConfig();
+        ADCConfig *ac = lc->ADCConfigs + BATTERY_CHANNEL;
+        const size_t base = get_enabled_channel_count(lc);
+
+        ac->aggregation = AGGREGATION_MIN_MAX;
+        CPPUNIT_ASSERT_EQUAL(true, is_channel_aggregation_enabled(lc));
+        CPPUNIT_ASSERT_EQUAL(base + 1, get_enabled_channel_count(lc));
+
+        struct sample_channels sc;
+        struct sample s;
+        memset(&sc, 0, sizeof(sc));
+        memset(&s, 0, sizeof(s));
+        CPPUNIT_ASSERT(init_sample_channels(&sc, get_enabled_channel_count(lc)));
+        CPPUNIT_ASSERT(init_sample_buffer(&s, &sc));
+
+        /* A peak between log ticks makes it into the logged sample */
+        const size_t rate = ac->cfg.sampleRate;
+        const int raw[] = {100, 400, 50, 200};
+        for (size_t i = 0; i < 4; ++i) {
+                ADC_mock_set_value(BATTERY_CHANNEL, raw[i]);
+                ADC_sample_all();
+                aggregate_channel_samples(lc, rate / 4 * (i + 1));
+        }
+        populate_sample_buffer(&s, rate);
+
+        double value;
+        char *units;
+        CPPUNIT_ASSERT(get_sample_value_by_name(&s, "Battery", &value, &units));
+        CPPUNIT_ASSERT_EQUAL((double) ADC_VOLTS(400), value);
+        CPPUNIT_ASSERT(get_sample_value_by_name(&s, "BatteryMin", &value,
+                                                &units));
+        CPPUNIT_ASSERT_EQUAL((double) ADC_VOLTS(50), value);
+        CPPUNIT_ASSERT_EQUAL(string("Volts"), string(units));
+
+        /* The next window starts over */
+        ADC_mock_set_value(BATTERY_CHANNEL, 300);
+        ADC_sample_all();
+        aggregate_channel_samples(lc, rate + 1);
+        populate_sample_buffer(&s, 2 * rate);
+        CPPUNIT_ASSERT(get_sample_value_by_name(&s, "BatteryMin", &value,
+                                                &units));
+        CPPUNIT_ASSERT_EQUAL((double) ADC_VOLTS(300), value);
+
+        free_sample_buffer(&s);
+        free_sample_channels(&sc);
+}
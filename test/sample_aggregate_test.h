@@ -0,0 +1,46 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SAMPLE_AGGREGATE_TEST_H_
+#define _SAMPLE_AGGREGATE_TEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class SampleAggregateTest : public CppUnit::TestFixture
+{
+        CPPUNIT_TEST_SUITE( SampleAggregateTest );
+        CPPUNIT_TEST( test_window );
+        CPPUNIT_TEST( test_reduce );
+        CPPUNIT_TEST( test_min_config_label );
+        CPPUNIT_TEST( test_analog_min_max );
+        CPPUNIT_TEST_SUITE_END();
+
+public:
+        void setUp();
+        void tearDown();
+
+        void test_window();
+        void test_reduce();
+        void test_min_config_label();
+        void test_analog_min_max();
+};
+
+#endif /* _SAMPLE_AGGREGATE_TEST_H_ */
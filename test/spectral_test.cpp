@@ -0,0 +1,266 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ADC.h"
+#include "fft.h"
+#include "high_rate_lane.h"
+#include "imu.h"
+#include "imu_device.h"
+#include "loggerConfig.h"
+#include "loggerHardware.h"
+#include "sampleRecord.h"
+#include "spectral.h"
+#include "spectral_test.h"
+
+#include <math.h>
+#include <string.h>
+#include <string>
+
+using std::string;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SpectralTest );
+
+#define BATTERY_CHANNEL	(CONFIG_ADC_CHANNELS - 1)
+#define LANE_RATE_HZ	4000.0f
+#define PI		3.14159265
+
+static struct spectral_config sc;
+static int32_t samples[FFT_POINTS];
+
+static int32_t tone(const size_t i, const double hz, const double rate_hz,
+                    const double amplitude)
+{
+        return 2048 + (int32_t) lround(amplitude *
+                                       sin(2 * PI * hz * i / rate_hz));
+}
+
+static void fill_tone(const double hz, const double rate_hz,
+                      const double amplitude)
+{
+        for (size_t i = 0; i < FFT_POINTS; ++i)
+                samples[i] = tone(i, hz, rate_hz, amplitude);
+}
+
+void SpectralTest::setUp()
+{
+        InitLoggerHardware();
+        initialize_logger_config();
+
+        sc.mode = SPECTRAL_MODE_PEAK;
+        sc.bands = 4;
+        sc.min_hz = 0;
+        sc.max_hz = LANE_RATE_HZ / 2;
+}
+
+void SpectralTest::tearDown()
+{
+        high_rate_lane_configure(NULL, 0, 0);
+        initialize_logger_config();
+        init_spectral_channels(getWorkingLoggerConfig());
+}
+
+void SpectralTest::test_fft_tone()
+{
+        struct fft_block b;
+
+        fft_init();
+        fill_tone(16 * LANE_RATE_HZ / FFT_POINTS, LANE_RATE_HZ, 1000);
+        fft_load(&b, samples);
+        fft_transform(&b);
+
+        /* The window spreads the tone into its neighbours and no further */
+        for (size_t bin = 1; bin < FFT_BINS; ++bin) {
+                if (bin >= 15 && bin <= 17)
+                        continue;
+
+                CPPUNIT_ASSERT(fft_bin_power(&b, bin) * 100 <
+                               fft_bin_power(&b, 16));
+        }
+        CPPUNIT_ASSERT(fft_bin_power(&b, 15) < fft_bin_power(&b, 16));
+        CPPUNIT_ASSERT(fft_bin_power(&b, 17) < fft_bin_power(&b, 16));
+}
+
+void SpectralTest::test_peak_frequency()
+{
+        const float bin_hz = LANE_RATE_HZ / FFT_POINTS;
+        float peak;
+
+        fill_tone(437, LANE_RATE_HZ, 500);
+        spectral_analyze(&sc, samples, LANE_RATE_HZ, 1, &peak);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(437, peak, bin_hz / 4);
+
+        /* Only the configured range is searched */
+        for (size_t i = 0; i < FFT_POINTS; ++i)
+                samples[i] += tone(i, 1500, LANE_RATE_HZ, 100) - 2048;
+
+        sc.min_hz = 1000;
+        spectral_analyze(&sc, samples, LANE_RATE_HZ, 1, &peak);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(1500, peak, bin_hz / 4);
+}
+
+void SpectralTest::test_band_amplitude()
+{
+        float bands[4];
+
+        /* 4 bands of 250Hz from 0 to 1000Hz */
+        sc.mode = SPECTRAL_MODE_BANDS;
+        sc.max_hz = 1000;
+        CPPUNIT_ASSERT_EQUAL((size_t) 4, get_spectral_outputs(&sc));
+
+        fill_tone(625, LANE_RATE_HZ, 1000);
+        spectral_analyze(&sc, samples, LANE_RATE_HZ, 0.01f, bands);
+
+        /* The RMS of a sine is its amplitude over sqrt(2) */
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(1000 * 0.01 / sqrt(2), bands[2], 0.3);
+        CPPUNIT_ASSERT(bands[0] < 0.1f);
+        CPPUNIT_ASSERT(bands[1] < 0.1f);
+        CPPUNIT_ASSERT(bands[3] < 0.1f);
+}
+
+void SpectralTest::test_imu_channel()
+{
+        LoggerConfig *lc = getWorkingLoggerConfig();
+        ImuConfig *ic = lc->ImuConfigs + IMU_CHANNEL_Y;
+        const size_t base = get_enabled_channel_count(lc);
+        const float rate = imu_device_sample_rate();
+
+        ic->spectral = sc;
+        ic->spectral.max_hz = rate / 2;
+        CPPUNIT_ASSERT_EQUAL(base, get_enabled_channel_count(lc));
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, init_spectral_channels(lc));
+        CPPUNIT_ASSERT_EQUAL(base + 1, get_enabled_channel_count(lc));
+
+        const ChannelConfig *out = get_spectral_output_config(0, 0);
+        CPPUNIT_ASSERT_EQUAL(string("AccelYPk"), string(out->label));
+        CPPUNIT_ASSERT_EQUAL(string("Hz"), string(out->units));
+
+        struct imu_sample reading;
+        memset(&reading, 0, sizeof(reading));
+        for (size_t i = 0; i < FFT_POINTS - 1; ++i) {
+                reading.axis[IMU_CHANNEL_Y] = tone(i, rate / 5, rate, 400);
+                spectral_add_imu_reading(reading.axis);
+        }
+        CPPUNIT_ASSERT_EQUAL(0.0f, get_spectral_value(0));
+
+        spectral_add_imu_reading(reading.axis);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(rate / 5, get_spectral_value(0),
+                                     rate / FFT_POINTS / 4);
+}
+
+void SpectralTest::test_analog_channel()
+{
+        LoggerConfig *lc = getWorkingLoggerConfig();
+        ADCConfig *ac = lc->ADCConfigs + BATTERY_CHANNEL;
+
+        ac->highRate = 1;
+        ac->cfg.sampleRate = SAMPLE_50Hz;
+        ac->spectral = sc;
+        ADC_init(lc);
+        CPPUNIT_ASSERT_EQUAL(LANE_RATE_HZ, (float) high_rate_lane_get_rate());
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, init_spectral_channels(lc));
+
+        uint16_t scans[FFT_POINTS][CONFIG_ADC_CHANNELS];
+        memset(scans, 0, sizeof(scans));
+        for (size_t i = 0; i < FFT_POINTS; ++i)
+                scans[i][BATTERY_CHANNEL] = tone(i, 1250, LANE_RATE_HZ, 300);
+
+        /* Scans arrive in halves, as from the DMA */
+        high_rate_lane_push_scans(&scans[0][0], FFT_POINTS / 2,
+                                  CONFIG_ADC_CHANNELS);
+        spectral_channel_samples();
+        CPPUNIT_ASSERT_EQUAL(0.0f, get_spectral_value(0));
+
+        high_rate_lane_push_scans(&scans[FFT_POINTS / 2][0], FFT_POINTS / 2,
+                                  CONFIG_ADC_CHANNELS);
+        spectral_channel_samples();
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(1250, get_spectral_value(0),
+                                     LANE_RATE_HZ / FFT_POINTS / 4);
+}
+
+void SpectralTest::test_mapped_bands_rejected()
+{
+        LoggerConfig *lc = getWorkingLoggerConfig();
+        ADCConfig *ac = lc->ADCConfigs + BATTERY_CHANNEL;
+        const size_t base = get_enabled_channel_count(lc);
+
+        ac->highRate = 1;
+        ac->scalingMode = SCALING_MODE_MAP;
+        ac->spectral = sc;
+
+        /* The peak frequency needs no scale */
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, init_spectral_channels(lc));
+        CPPUNIT_ASSERT_EQUAL(base + 1, get_enabled_channel_count(lc));
+
+        /* Band amplitudes would always read 0 */
+        ac->spectral.mode = SPECTRAL_MODE_BANDS;
+        CPPUNIT_ASSERT_EQUAL((size_t) 0, init_spectral_channels(lc));
+        CPPUNIT_ASSERT_EQUAL(base, get_enabled_channel_count(lc));
+
+        ac->scalingMode = SCALING_MODE_LINEAR;
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, init_spectral_channels(lc));
+        CPPUNIT_ASSERT_EQUAL(base + sc.bands, get_enabled_channel_count(lc));
+}
+
+void SpectralTest::test_channel_limit()
+{
+        LoggerConfig *lc = getWorkingLoggerConfig();
+
+        for (size_t i = 0; i < CONFIG_ADC_CHANNELS; ++i) {
+                ADCConfig *ac = lc->ADCConfigs + i;
+                ac->cfg.sampleRate = SAMPLE_10Hz;
+                ac->spectral = sc;
+        }
+
+        CPPUNIT_ASSERT(CONFIG_ADC_CHANNELS > SPECTRAL_CHANNELS_MAX);
+        CPPUNIT_ASSERT_EQUAL((size_t) SPECTRAL_CHANNELS_MAX,
+                             init_spectral_channels(lc));
+}
+
+void SpectralTest::test_table_keeps_block()
+{
+        LoggerConfig *lc = getWorkingLoggerConfig();
+        ImuConfig *ic = lc->ImuConfigs + IMU_CHANNEL_Y;
+        const float rate = imu_device_sample_rate();
+
+        ic->spectral = sc;
+        ic->spectral.max_hz = rate / 2;
+        CPPUNIT_ASSERT_EQUAL((size_t) 1, init_spectral_channels(lc));
+
+        struct imu_sample reading;
+        memset(&reading, 0, sizeof(reading));
+        for (size_t i = 0; i < FFT_POINTS / 2; ++i) {
+                reading.axis[IMU_CHANNEL_Y] = tone(i, rate / 5, rate, 400);
+                spectral_add_imu_reading(reading.axis);
+        }
+
+        /* As when the API builds a table for getMeta or sampleData */
+        struct sample_channels sch;
+        memset(&sch, 0, sizeof(sch));
+        CPPUNIT_ASSERT(init_sample_channels(&sch, get_enabled_channel_count(lc)));
+        free_sample_channels(&sch);
+
+        for (size_t i = FFT_POINTS / 2; i < FFT_POINTS; ++i) {
+                reading.axis[IMU_CHANNEL_Y] = tone(i, rate / 5, rate, 400);
+                spectral_add_imu_reading(reading.axis);
+        }
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(rate / 5, get_spectral_value(0),
+                                     rate / FFT_POINTS / 4);
+}
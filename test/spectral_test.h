@@ -0,0 +1,54 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SPECTRAL_TEST_H_
+#define _SPECTRAL_TEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class SpectralTest : public CppUnit::TestFixture
+{
+        CPPUNIT_TEST_SUITE( SpectralTest );
+        CPPUNIT_TEST( test_fft_tone );
+        CPPUNIT_TEST( test_peak_frequency );
+        CPPUNIT_TEST( test_band_amplitude );
+        CPPUNIT_TEST( test_imu_channel );
+        CPPUNIT_TEST( test_analog_channel );
+        CPPUNIT_TEST( test_mapped_bands_rejected );
+        CPPUNIT_TEST( test_channel_limit );
+        CPPUNIT_TEST( test_table_keeps_block );
+        CPPUNIT_TEST_SUITE_END();
+
+public:
+        void setUp();
+        void tearDown();
+
+        void test_fft_tone();
+        void test_peak_frequency();
+        void test_band_amplitude();
+        void test_imu_channel();
+        void test_analog_channel();
+        void test_mapped_bands_rejected();
+        void test_channel_limit();
+        void test_table_keeps_block();
+};
+
+#endif /* _SPECTRAL_TEST_H_ */
@@ -0,0 +1,126 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "loggerConfig.h"
+#include "timer.h"
+#include "timer_capture.h"
+#include "timer_capture_test.h"
+#include "timer_config.h"
+#include "timer_mock.h"
+
+#include <string.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TimerCaptureTest );
+
+#define TEST_CHANNEL	0
+
+void TimerCaptureTest::setUp()
+{
+        initialize_logger_config();
+
+        TimerConfig *tc = getWorkingLoggerConfig()->TimerConfigs;
+        for (size_t i = 0; i < CONFIG_TIMER_CHANNELS; i++) {
+                tc[i].mode = MODE_LOGGING_TIMER_PERIOD_USEC;
+                tc[i].pulsePerRevolution = 1;
+                tc[i].filterAlpha = 1;
+        }
+        timer_init(getWorkingLoggerConfig());
+}
+
+void TimerCaptureTest::tearDown() {}
+
+void TimerCaptureTest::test_ring_average()
+{
+        struct timer_capture_ring ring;
+        memset(&ring, 0, sizeof(ring));
+        uint32_t avg = 0;
+
+        CPPUNIT_ASSERT(!timer_capture_average(&ring, &avg));
+
+        timer_capture_push(&ring, 1000);
+        timer_capture_push(&ring, 2000);
+        timer_capture_push(&ring, 3000);
+        CPPUNIT_ASSERT(timer_capture_average(&ring, &avg));
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 2000, avg);
+
+        /* Each capture is only averaged once */
+        CPPUNIT_ASSERT(!timer_capture_average(&ring, &avg));
+
+        timer_capture_push(&ring, 500);
+        timer_capture_reset(&ring);
+        CPPUNIT_ASSERT(!timer_capture_average(&ring, &avg));
+}
+
+void TimerCaptureTest::test_ring_lapped()
+{
+        struct timer_capture_ring ring;
+        memset(&ring, 0, sizeof(ring));
+        uint32_t avg = 0;
+
+        /* Only the newest captures survive once the ring wraps */
+        for (size_t i = 0; i < TIMER_CAPTURE_RING_SIZE; i++)
+                timer_capture_push(&ring, 100);
+        for (size_t i = 0; i < TIMER_CAPTURE_RING_SIZE; i++)
+                timer_capture_push(&ring, 400);
+
+        CPPUNIT_ASSERT(timer_capture_average(&ring, &avg));
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 400, avg);
+}
+
+void TimerCaptureTest::test_read_is_pure()
+{
+        TimerConfig *tc = getWorkingLoggerConfig()->TimerConfigs;
+        tc[TEST_CHANNEL].filterAlpha = 0.5;
+        timer_init(getWorkingLoggerConfig());
+
+        timer_mock_capture(TEST_CHANNEL, 1000);
+        timer_sample_all();
+        CPPUNIT_ASSERT_EQUAL(1000.0f, timer_get_sample(TEST_CHANNEL));
+
+        timer_mock_capture(TEST_CHANNEL, 2000);
+        timer_mock_capture(TEST_CHANNEL, 4000);
+
+        /* Reading must not advance the filter, only sampling does */
+        for (int i = 0; i < 10; i++)
+                CPPUNIT_ASSERT_EQUAL(1000.0f, timer_get_sample(TEST_CHANNEL));
+
+        timer_sample_all();
+        const float value = timer_get_sample(TEST_CHANNEL);
+        CPPUNIT_ASSERT(value > 1000.0f && value < 3000.0f);
+        CPPUNIT_ASSERT_EQUAL(value, timer_get_sample(TEST_CHANNEL));
+        CPPUNIT_ASSERT_EQUAL((uint32_t) value, timer_get_usec(TEST_CHANNEL));
+}
+
+void TimerCaptureTest::test_stall()
+{
+        timer_mock_capture(TEST_CHANNEL, 1000);
+        timer_mock_capture(TEST_CHANNEL, 3000);
+        timer_sample_all();
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 2000, timer_get_usec(TEST_CHANNEL));
+
+        /* No new captures holds the last average */
+        timer_sample_all();
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 2000, timer_get_usec(TEST_CHANNEL));
+
+        timer_mock_stall(TEST_CHANNEL);
+        timer_sample_all();
+        CPPUNIT_ASSERT_EQUAL((uint32_t) 0, timer_get_usec(TEST_CHANNEL));
+}
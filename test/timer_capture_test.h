@@ -0,0 +1,46 @@
+/*
+ * Race Capture Firmware
+ *
+ * Copyright (C) 2016 Autosport Labs
+ *
+ * This file is part of the Race Capture firmware suite
+ *
+ * This is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details. You should
+ * have received a copy of the GNU General Public License along with
+ * this code. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _TIMER_CAPTURE_TEST_H_
+#define _TIMER_CAPTURE_TEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class TimerCaptureTest : public CppUnit::TestFixture
+{
+        CPPUNIT_TEST_SUITE( TimerCaptureTest );
+        CPPUNIT_TEST( test_ring_average );
+        CPPUNIT_TEST( test_ring_lapped );
+        CPPUNIT_TEST( test_read_is_pure );
+        CPPUNIT_TEST( test_stall );
+        CPPUNIT_TEST_SUITE_END();
+
+public:
+        void setUp();
+        void tearDown();
+
+        void test_ring_average();
+        void test_ring_lapped();
+        void test_read_is_pure();
+        void test_stall();
+};
+
+#endif /* _TIMER_CAPTURE_TEST_H_ */